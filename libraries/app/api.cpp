@@ -26,6 +26,7 @@
 #include <graphene/app/api.hpp>
 #include <graphene/app/api_access.hpp>
 #include <graphene/app/application.hpp>
+#include <graphene/account_history/account_history_plugin.hpp>
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/get_config.hpp>
 #include <graphene/utilities/key_conversion.hpp>
@@ -94,7 +95,7 @@ namespace graphene { namespace app {
        }
        else if( api_name == "block_api" )
        {
-          _block_api = std::make_shared< block_api >( std::ref( *_app.chain_database() ) );
+          _block_api = std::make_shared< block_api >( std::ref( *_app.chain_database() ), &( _app.get_options() ) );
        }
        else if( api_name == "network_broadcast_api" )
        {
@@ -135,7 +136,19 @@ namespace graphene { namespace app {
     }
 
     // block_api
-    block_api::block_api(graphene::chain::database& db) : _db(db) { }
+    block_api::block_api(graphene::chain::database& db, const application_options* app_options)
+       : _db(db), _app_options(app_options)
+    {
+       try
+       {
+          _operations_by_block = &_db.get_index_type< primary_index< operation_history_index > >()
+                .get_secondary_index< account_history::operation_history_block_index >();
+       }
+       catch( const fc::assert_exception& )
+       {
+          _operations_by_block = nullptr;
+       }
+    }
     block_api::~block_api() { }
 
     vector<optional<signed_block>> block_api::get_blocks(uint32_t block_num_from, uint32_t block_num_to)const
@@ -148,6 +161,60 @@ namespace graphene { namespace app {
        return res;
     }
 
+    raw_block_batch block_api::export_raw_blocks(uint32_t block_num_from, uint32_t block_num_to,
+                                                 bool include_virtual_ops)const
+    {
+       FC_ASSERT( block_num_to >= block_num_from );
+       static const application_options default_options;
+       const auto configured_limit = ( _app_options != nullptr ? _app_options : &default_options )
+                                        ->api_limit_export_raw_blocks;
+       FC_ASSERT( block_num_to - block_num_from < configured_limit,
+                  "Can not export more than ${configured_limit} blocks at once",
+                  ("configured_limit", configured_limit) );
+       FC_ASSERT( !include_virtual_ops || _operations_by_block != nullptr,
+                  "Exporting virtual operations requires the account_history plugin with index-operations-by-block" );
+
+       raw_block_batch result;
+       result.first_block_num = block_num_from;
+
+       const auto* by_block = include_virtual_ops ? _operations_by_block : nullptr;
+       vector<operation_history_object> virtual_ops;
+       result.block_count = _db.visit_raw_blocks( block_num_from, block_num_to,
+             [this,&result,&virtual_ops,by_block]( uint32_t block_num, const char* data, size_t size )
+       {
+          if( by_block != nullptr )
+          {
+             // operations that are not part of the block are appended at the end of the block (trx_in_block is
+             // the number of transactions) or follow the operation which caused them (virtual_op > 0)
+             fc::datastream<const char*> header( data, size );
+             signed_block_header block_header;
+             fc::unsigned_int trx_count;
+             fc::raw::unpack( header, block_header );
+             fc::raw::unpack( header, trx_count );
+             virtual_ops.clear();
+             for( const auto& op_id : by_block->get_operations( block_num ) )
+             {
+                const auto& op = op_id( _db );
+                if( op.virtual_op > 0 || op.trx_in_block >= trx_count.value )
+                   virtual_ops.push_back( op );
+             }
+          }
+
+          const fc::unsigned_int block_size( size );
+          const size_t ops_size = by_block != nullptr ? fc::raw::pack_size( virtual_ops ) : 0;
+          const size_t offset = result.data.size();
+          result.data.resize( offset + fc::raw::pack_size( block_size ) + size + ops_size );
+          fc::datastream<char*> ds( result.data.data() + offset, result.data.size() - offset );
+          fc::raw::pack( ds, block_size );
+          ds.write( data, size );
+          if( by_block != nullptr )
+             fc::raw::pack( ds, virtual_ops );
+          // the data is transferred hex encoded, i.e. two characters per byte
+          return result.data.size() * 2 < max_export_batch_size;
+       });
+       return result;
+    }
+
     network_broadcast_api::network_broadcast_api(application& a):_app(a)
     {
        _applied_block_connection = _app.chain_database()->applied_block.connect([this](const signed_block& b){ on_applied_block(b); });
@@ -346,6 +413,36 @@ namespace graphene { namespace app {
        return result;
     }
 
+    /// @return the store of the irreversible account history, or nullptr if the history is only kept in memory
+    static const account_history::history_store* get_history_store( const application& app )
+    {
+       if( !app.is_plugin_enabled( "account_history" ) )
+          return nullptr;
+       return app.get_plugin<account_history::account_history_plugin>( "account_history" )->get_history_store();
+    }
+
+    /// @return the sequence number preceding the oldest entry of the account history kept in memory
+    static uint64_t sequence_before_memory( const database& db, account_id_type account )
+    {
+       const auto& by_seq_idx = db.get_index_type<account_transaction_history_index>().indices().get<by_seq>();
+       auto itr = by_seq_idx.lower_bound( boost::make_tuple( account, 0 ) );
+       if( itr == by_seq_idx.end() || itr->account != account )
+          return account(db).statistics(db).total_ops;
+       return itr->sequence - 1;
+    }
+
+    /// @return an operation referenced by the account history, which is either kept in memory or in the store
+    static operation_history_object fetch_operation( const database& db, const account_history::history_store& store,
+                                                     operation_history_id_type id )
+    {
+       const operation_history_object* op = db.find( id );
+       if( op != nullptr )
+          return *op;
+       optional<operation_history_object> stored = store.fetch_operation( id );
+       FC_ASSERT( stored.valid(), "Operation ${id} is missing in the account history store", ("id",id) );
+       return *stored;
+    }
+
     vector<operation_history_object> history_api::get_account_history( const std::string account_id_or_name,
                                                                        operation_history_id_type stop,
                                                                        uint32_t limit,
@@ -395,6 +492,23 @@ namespace graphene { namespace app {
          result.push_back(itr->operation_id(db));
        }
 
+       // continue with the older history which was moved to the store
+       const auto* store = get_history_store( _app );
+       if( store != nullptr && result.size() < limit )
+       {
+          const uint64_t sequence = std::min( store->find_sequence( account, start ),
+                                              sequence_before_memory( db, account ) );
+          if( sequence > 0 )
+          {
+             for( const auto& entry : store->get_entries( account, sequence, 1, limit - result.size() ) )
+             {
+                if( stop.instance.value > 0 && entry.operation_id.instance.value <= stop.instance.value )
+                   break;
+                result.push_back( fetch_operation( db, *store, entry.operation_id ) );
+             }
+          }
+       }
+
        return result;
     }
 
@@ -439,6 +553,36 @@ namespace graphene { namespace app {
           if (head != nullptr && head->account == account && head->operation_id(db).op.which() == operation_type)
             result.push_back(head->operation_id(db));
        }
+
+       // continue with the older history which was moved to the store
+       const auto* store = get_history_store( _app );
+       if( store != nullptr && result.size() < limit )
+       {
+          uint64_t sequence = std::min( store->find_sequence( account, start ),
+                                        sequence_before_memory( db, account ) );
+          const uint32_t batch_size = 100;
+          while( sequence > 0 && result.size() < limit )
+          {
+             const auto entries = store->get_entries( account, sequence, 1, batch_size );
+             sequence = 0;
+             for( const auto& entry : entries )
+             {
+                if( stop.instance.value > 0 && entry.operation_id.instance.value <= stop.instance.value )
+                {
+                   sequence = 0;
+                   break;
+                }
+                operation_history_object op = fetch_operation( db, *store, entry.operation_id );
+                if( op.op.which() == operation_type )
+                {
+                   result.push_back( std::move( op ) );
+                   if( result.size() >= limit )
+                      break;
+                }
+                sequence = entry.sequence - 1;
+             }
+          }
+       }
        return result;
     }
 
@@ -475,12 +619,26 @@ namespace graphene { namespace app {
           auto itr = by_seq_idx.upper_bound( boost::make_tuple( account, start ) );
           auto itr_stop = by_seq_idx.lower_bound( boost::make_tuple( account, stop ) );
 
-          do
+          uint64_t sequence = start;
+          while( itr != itr_stop && result.size() < limit )
           {
              --itr;
              result.push_back( itr->operation_id(db) );
+             sequence = itr->sequence - 1;
+          }
+
+          // continue with the older history which was moved to the store
+          const auto* store = get_history_store( _app );
+          if( store != nullptr && result.size() < limit )
+          {
+             sequence = std::min( sequence, sequence_before_memory( db, account ) );
+             if( sequence > 0 && sequence >= stop )
+             {
+                for( const auto& entry : store->get_entries( account, sequence, std::max<uint64_t>( stop, 1 ),
+                                                             limit - result.size() ) )
+                   result.push_back( fetch_operation( db, *store, entry.operation_id ) );
+             }
           }
-          while ( itr != itr_stop && result.size() < limit );
        }
        return result;
     }
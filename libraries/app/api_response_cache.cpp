@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/api_response_cache.hpp>
+
+#include <graphene/chain/impacted.hpp>
+
+namespace graphene { namespace app {
+
+api_response_cache::api_response_cache( graphene::chain::database& db, uint64_t capacity )
+   : _capacity( capacity )
+{
+   _stats.capacity = capacity;
+   _applied_block_connection = db.applied_block.connect( [this]( const graphene::chain::signed_block& ) {
+      clear();
+   });
+   _pending_transaction_connection = db.on_pending_transaction.connect(
+         [this]( const graphene::chain::signed_transaction& trx ) {
+      on_pending_transaction( trx );
+   });
+   // pending transactions may be dropped, e.g. when they expire or are evicted, so responses computed on
+   // the pending state can not be kept when it is undone
+   _pending_state_reset_connection = db.pending_state_reset.connect( [this]() {
+      clear();
+   });
+}
+
+api_response_cache::~api_response_cache() {}
+
+std::shared_ptr<const void> api_response_cache::find( const std::string& key, uint64_t& generation )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto itr = _entries_by_key.find( key );
+   if( itr == _entries_by_key.end() )
+   {
+      ++_stats.misses;
+      generation = _generation;
+      return std::shared_ptr<const void>();
+   }
+   ++_stats.hits;
+   _entries.splice( _entries.begin(), _entries, itr->second );
+   return itr->second->value;
+}
+
+void api_response_cache::insert( const std::string& key, uint8_t depends_on,
+                                 fc::flat_set<graphene::chain::account_id_type>&& relevant_accounts,
+                                 std::shared_ptr<const void> value, size_t size, uint64_t generation )
+{
+   if( size > _capacity )
+      return;
+   std::lock_guard<std::mutex> lock( _mutex );
+   // the database changed while the response was computed, or another query computed it meanwhile
+   if( generation != _generation || _entries_by_key.find( key ) != _entries_by_key.end() )
+      return;
+   while( !_entries.empty() && _stats.size + size > _capacity )
+   {
+      erase( std::prev( _entries.end() ) );
+      ++_stats.evicted;
+   }
+   _entries.push_front( entry() );
+   entry& e = _entries.front();
+   e.key = key;
+   e.value = std::move( value );
+   e.depends_on = depends_on;
+   e.relevant_accounts = std::move( relevant_accounts );
+   e.size = size;
+   _entries_by_key[key] = _entries.begin();
+   for( const auto& account : e.relevant_accounts )
+      _entries_by_account.emplace( account, _entries.begin() );
+   _stats.size += size;
+   ++_stats.entries;
+}
+
+void api_response_cache::erase( entry_list::iterator itr )
+{
+   for( const auto& account : itr->relevant_accounts )
+   {
+      auto range = _entries_by_account.equal_range( account );
+      for( auto by_account = range.first; by_account != range.second; ++by_account )
+      {
+         if( by_account->second == itr )
+         {
+            _entries_by_account.erase( by_account );
+            break;
+         }
+      }
+   }
+   _entries_by_key.erase( itr->key );
+   _stats.size -= itr->size;
+   --_stats.entries;
+   _entries.erase( itr );
+}
+
+/// Operations which may create, fill, cancel or trigger orders
+static bool may_change_orders( const graphene::chain::operation& op )
+{
+   using namespace graphene::chain;
+   return op.is_type<limit_order_create_operation>()
+       || op.is_type<limit_order_cancel_operation>()
+       || op.is_type<call_order_update_operation>()
+       || op.is_type<asset_settle_operation>()
+       || op.is_type<asset_global_settle_operation>()
+       || op.is_type<asset_publish_feed_operation>()
+       || op.is_type<asset_update_bitasset_operation>()
+       || op.is_type<bid_collateral_operation>()
+       || op.is_type<proposal_update_operation>(); // approved proposals execute any operation
+}
+
+void api_response_cache::on_pending_transaction( const graphene::chain::signed_transaction& trx )
+{
+   bool orders_changed = false;
+   for( const auto& op : trx.operations )
+      orders_changed = orders_changed || may_change_orders( op );
+   fc::flat_set<graphene::chain::account_id_type> impacted_accounts;
+   if( !orders_changed )
+      graphene::chain::transaction_get_impacted_accounts( trx, impacted_accounts, false );
+
+   std::lock_guard<std::mutex> lock( _mutex );
+   const uint64_t old_entries = _stats.entries;
+   if( orders_changed )
+   {
+      for( auto itr = _entries.begin(); itr != _entries.end(); )
+      {
+         auto next = std::next( itr );
+         if( itr->depends_on & ( markets | accounts ) )
+            erase( itr );
+         itr = next;
+      }
+   }
+   for( const auto& account : impacted_accounts )
+   {
+      auto by_account = _entries_by_account.find( account );
+      while( by_account != _entries_by_account.end() )
+      {
+         erase( by_account->second );
+         by_account = _entries_by_account.find( account );
+      }
+   }
+   // responses computed meanwhile may depend on anything the transaction changed
+   ++_generation;
+   _stats.invalidated += old_entries - _stats.entries;
+}
+
+void api_response_cache::clear()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _stats.invalidated += _stats.entries;
+   _entries_by_account.clear();
+   _entries_by_key.clear();
+   _entries.clear();
+   _stats.size = 0;
+   _stats.entries = 0;
+   ++_generation;
+}
+
+api_response_cache_stats api_response_cache::get_stats()const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return _stats;
+}
+
+} } // graphene::app
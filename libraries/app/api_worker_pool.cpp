@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/api_worker_pool.hpp>
+
+namespace graphene { namespace app {
+
+api_worker_pool::api_worker_pool( const graphene::chain::database& db, uint16_t num_threads )
+   : _db( db )
+{
+   FC_ASSERT( num_threads > 0, "The API worker pool needs at least one thread" );
+   _threads.reserve( num_threads );
+   for( uint16_t i = 0; i < num_threads; ++i )
+      _threads.emplace_back( std::make_unique<fc::thread>( "api-worker-" + fc::to_string( i ) ) );
+}
+
+api_worker_pool::~api_worker_pool()
+{
+   for( auto& thread : _threads )
+      thread->quit();
+}
+
+fc::thread& api_worker_pool::next_thread()
+{
+   return *_threads[ _next_thread.fetch_add( 1, std::memory_order_relaxed ) % _threads.size() ];
+}
+
+} } // graphene::app
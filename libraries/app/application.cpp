@@ -23,12 +23,16 @@
  */
 #include <graphene/app/api.hpp>
 #include <graphene/app/api_access.hpp>
+#include <graphene/app/api_response_cache.hpp>
+#include <graphene/app/api_worker_pool.hpp>
 #include <graphene/app/application.hpp>
 #include <graphene/app/plugin.hpp>
+#include <graphene/app/subscription_dispatcher.hpp>
 
 #include <graphene/chain/db_with.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
+#include <graphene/protocol/signature_cache.hpp>
 #include <graphene/protocol/types.hpp>
 
 #include <graphene/egenesis/egenesis.hpp>
@@ -50,7 +54,9 @@
 #include <boost/range/algorithm/reverse.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 
 #include <fc/log/file_appender.hpp>
 #include <fc/log/logger.hpp>
@@ -253,6 +259,10 @@ void application_impl::initialize(const fc::path& data_dir, shared_ptr<boost::pr
    if ( _options->count("enable-subscribe-to-all") > 0 )
       _app_options.enable_subscribe_to_all = _options->at( "enable-subscribe-to-all" ).as<bool>();
 
+   if( _options->count("signature-cache-size") > 0 )
+      graphene::protocol::signature_cache::instance().set_capacity(
+            _options->at("signature-cache-size").as<uint64_t>() );
+
    set_api_limit();
 
    if( is_plugin_enabled( "market_history" ) )
@@ -394,6 +404,9 @@ void application_impl::set_api_limit() {
       _app_options.api_limit_get_liquidity_pool_history =
             _options->at("api-limit-get-liquidity-pool-history").as<uint64_t>();
    }
+   if(_options->count("api-limit-export-raw-blocks") > 0) {
+      _app_options.api_limit_export_raw_blocks = _options->at("api-limit-export-raw-blocks").as<uint64_t>();
+   }
 }
 
 graphene::chain::genesis_state_type application_impl::initialize_genesis_state() const
@@ -474,6 +487,46 @@ void application_impl::open_chain_database() const
       _chain_db->enable_standby_votes_tracking( _options->at("enable-standby-votes-tracking").as<bool>() );
    }
 
+   {
+      graphene::chain::mempool_limits limits;
+      if( _options->count("mempool-max-memory") > 0 )
+         limits.max_memory = _options->at("mempool-max-memory").as<uint64_t>() * 1024 * 1024;
+      if( _options->count("mempool-max-per-account") > 0 )
+         limits.max_per_account = _options->at("mempool-max-per-account").as<uint32_t>();
+      _chain_db->set_mempool_limits( limits );
+   }
+
+   if( _options->count("replay-queue-size") > 0 )
+      _chain_db->set_replay_queue_size( _options->at("replay-queue-size").as<uint64_t>() * 1024 * 1024 );
+
+   if( _options->count("vote-tally-threads") > 0 )
+      _chain_db->set_vote_tally_threads( _options->at("vote-tally-threads").as<uint16_t>() );
+
+   if( _options->count("api-worker-threads") > 0 )
+   {
+      const uint16_t num_threads = _options->at("api-worker-threads").as<uint16_t>();
+      if( num_threads > 0 )
+      {
+         ilog( "Running read-only API queries on ${n} worker threads", ("n",num_threads) );
+         _app_options.api_workers = std::make_shared<api_worker_pool>( *_chain_db, num_threads );
+      }
+   }
+
+   _app_options.subscriptions = std::make_shared<subscription_dispatcher>( *_chain_db,
+         _options->count("subscription-max-pending-notifications") > 0
+            ? _options->at("subscription-max-pending-notifications").as<uint32_t>()
+            : subscription_dispatcher::default_max_pending_notifications,
+         _options->count("subscription-max-objects-per-connection") > 0
+            ? _options->at("subscription-max-objects-per-connection").as<uint32_t>()
+            : subscription_dispatcher::default_max_items_per_session );
+
+   if( _options->count("api-response-cache-size") > 0 )
+   {
+      const uint64_t cache_size = _options->at("api-response-cache-size").as<uint64_t>() * 1024 * 1024;
+      if( cache_size > 0 )
+         _app_options.response_cache = std::make_shared<api_response_cache>( *_chain_db, cache_size );
+   }
+
    if( _options->count("replay-blockchain") > 0 || _options->count("revalidate-blockchain") > 0 )
       _chain_db->wipe( _data_dir / "blockchain", false );
 
@@ -650,22 +703,117 @@ bool application_impl::handle_block(const graphene::net::block_message& blk_msg,
    }
 } FC_CAPTURE_AND_RETHROW( (blk_msg)(sync_mode) ) return false; }
 
+/**
+ * Transactions are collected in batches while the previous batch is processed. The signatures of a whole batch
+ * are recovered in parallel, then the batch is pushed without interruption. The caller waits for the result
+ * of its transaction, so that only valid transactions are relayed.
+ */
 void application_impl::handle_transaction(const graphene::net::trx_message& transaction_message)
 { try {
-   static fc::time_point last_call;
-   static int trx_count = 0;
-   ++trx_count;
-   auto now = fc::time_point::now();
-   if( now - last_call > fc::seconds(1) ) {
-      ilog("Got ${c} transactions from network", ("c",trx_count) );
-      last_call = now;
-      trx_count = 0;
-   }
-
-   _chain_db->precompute_parallel( transaction_message.trx ).wait();
-   _chain_db->push_transaction( transaction_message.trx );
+   auto result = fc::promise<void>::create( "handle_transaction" );
+   _incoming_transactions.push_back( incoming_transaction{ transaction_message.trx, result } );
+   if( !_incoming_transactions_done.valid() || _incoming_transactions_done.ready() )
+      _incoming_transactions_done = fc::async( [this]() { process_incoming_transactions(); },
+                                               "process_incoming_transactions" );
+   fc::future<void>( result ).wait();
 } FC_CAPTURE_AND_RETHROW( (transaction_message) ) }
 
+void application_impl::process_incoming_transactions()
+{
+   const size_t max_batch_size = 1000;
+   while( !_incoming_transactions.empty() )
+   {
+      std::vector<incoming_transaction> batch;
+      if( _incoming_transactions.size() <= max_batch_size )
+         batch.swap( _incoming_transactions );
+      else
+      {
+         batch.reserve( max_batch_size );
+         std::move( _incoming_transactions.begin(), _incoming_transactions.begin() + max_batch_size,
+                    std::back_inserter( batch ) );
+         _incoming_transactions.erase( _incoming_transactions.begin(),
+                                       _incoming_transactions.begin() + max_batch_size );
+      }
+
+      auto& stats = _incoming_transaction_stats;
+      const auto start_time = fc::time_point::now();
+      std::vector<bool> failed( batch.size(), false );
+      std::vector<fc::future<void>> precomputed;
+      try
+      {
+         precomputed.reserve( batch.size() );
+         for( const incoming_transaction& item : batch )
+            precomputed.push_back( _chain_db->precompute_parallel( item.trx ) );
+         // more transactions are collected for the next batch while waiting
+         for( size_t i = 0; i < batch.size(); ++i )
+         {
+            try
+            {
+               precomputed[i].wait();
+            }
+            catch( const fc::canceled_exception& )
+            {
+               throw;
+            }
+            catch( const fc::exception& e )
+            {
+               batch[i].result->set_exception( e.dynamic_copy_exception() );
+               failed[i] = true;
+            }
+         }
+      }
+      catch( const fc::canceled_exception& e )
+      {
+         // the precomputations still in flight refer to the transactions in the batch
+         for( auto& f : precomputed )
+         {
+            try { f.wait(); } catch( ... ) {}
+         }
+         for( size_t i = 0; i < batch.size(); ++i )
+            if( !failed[i] )
+               batch[i].result->set_exception( e.dynamic_copy_exception() );
+         for( const incoming_transaction& item : _incoming_transactions )
+            item.result->set_exception( e.dynamic_copy_exception() );
+         _incoming_transactions.clear();
+         throw;
+      }
+      const auto precomputed_time = fc::time_point::now();
+
+      for( size_t i = 0; i < batch.size(); ++i )
+      {
+         if( failed[i] )
+            continue;
+         try
+         {
+            _chain_db->push_transaction( batch[i].trx );
+            batch[i].result->set_value();
+         }
+         catch( const fc::exception& e )
+         {
+            batch[i].result->set_exception( e.dynamic_copy_exception() );
+            failed[i] = true;
+         }
+      }
+      const auto end_time = fc::time_point::now();
+
+      stats.transactions += batch.size();
+      stats.rejected += std::count( failed.begin(), failed.end(), true );
+      ++stats.batches;
+      stats.largest_batch = std::max<uint64_t>( stats.largest_batch, batch.size() );
+      stats.precompute_time += precomputed_time - start_time;
+      stats.push_time += end_time - precomputed_time;
+      if( end_time - stats.last_log_time > fc::seconds(1) )
+      {
+         ilog( "Got ${c} transactions from network in ${b} batches of up to ${m}, ${r} rejected, "
+               "${p} ms recovering signatures, ${u} ms pushing",
+               ("c", stats.transactions)("b", stats.batches)("m", stats.largest_batch)("r", stats.rejected)
+               ("p", stats.precompute_time.count() / 1000)("u", stats.push_time.count() / 1000) );
+         stats = incoming_transaction_stats();
+         stats.last_log_time = end_time;
+      }
+   }
+}
+
 void application_impl::handle_message(const message& message_to_process)
 {
    // not a transaction, not a block
@@ -744,13 +892,21 @@ message application_impl::get_item(const item_id& id)
   // ilog("Request for item ${id}", ("id", id));
    if( id.item_type == graphene::net::block_message_type )
    {
-      auto opt_block = _chain_db->fetch_block_by_id(id.item_hash);
+      auto opt_block = _chain_db->fetch_raw_block_by_id(id.item_hash);
       if( !opt_block )
          elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
               ("id", id.item_hash)("id2", _chain_db->get_block_id_for_num(block_header::num_from_id(id.item_hash))));
       FC_ASSERT( opt_block.valid() );
-      // ilog("Serving up block #${num}", ("num", opt_block->block_num()));
-      return block_message(std::move(*opt_block));
+      // ilog("Serving up block #${num}", ("num", block_header::num_from_id(id.item_hash)));
+      // A packed block_message is the packed block followed by the packed block id,
+      // so it can be assembled from the stored bytes without unpacking and repacking the block
+      message result;
+      result.msg_type = graphene::net::block_message_type;
+      result.data = std::move( *opt_block );
+      const auto packed_id = fc::raw::pack( block_id_type( id.item_hash ) );
+      result.data.insert( result.data.end(), packed_id.begin(), packed_id.end() );
+      result.size = (uint32_t)result.data.size();
+      return result;
    }
    return trx_message( _chain_db->get_recent_transaction( id.item_hash ) );
 } FC_CAPTURE_AND_RETHROW( (id) ) }
@@ -1018,6 +1174,20 @@ void application_impl::shutdown()
    else
       ilog( "P2P network is disabled" );
 
+   if( _incoming_transactions_done.valid() && !_incoming_transactions_done.ready() )
+   {
+      ilog( "Canceling processing of incoming transactions" );
+      _incoming_transactions_done.cancel_and_wait( __FUNCTION__ );
+   }
+
+   _app_options.response_cache.reset();
+   _app_options.subscriptions.reset();
+   if( _app_options.api_workers )
+   {
+      ilog( "Stopping API worker threads" );
+      _app_options.api_workers.reset();
+   }
+
    if( _chain_db )
    {
       ilog( "Closing chain database" );
@@ -1122,6 +1292,35 @@ void application::set_program_options(boost::program_options::options_descriptio
           "Number of IO threads, default to 0 for auto-configuration")
          ("enable-subscribe-to-all", bpo::value<bool>()->implicit_value(true),
           "Whether allow API clients to subscribe to universal object creation and removal events")
+         ("signature-cache-size", bpo::value<uint64_t>()->default_value(
+                                        uint64_t( graphene::protocol::signature_cache::default_capacity ) ),
+          "Maximum number of public keys recovered from transaction signatures to keep in memory, 0 to disable")
+         ("mempool-max-memory", bpo::value<uint64_t>()->default_value(256),
+          "Maximum memory in MiB used by pending transactions, 0 for no limit. When it is reached, pending "
+          "transactions paying a lower fee per byte are dropped to make room for better paying ones")
+         ("mempool-max-per-account", bpo::value<uint32_t>()->default_value(0),
+          "Maximum number of pending transactions per fee paying account, 0 for no limit")
+         ("replay-queue-size", bpo::value<uint64_t>()->default_value(
+                                        graphene::chain::database::default_replay_queue_size / ( 1024 * 1024 ) ),
+          "Maximum size in MiB of the serialized blocks read ahead during a replay. Larger values keep more "
+          "blocks in memory and let reading and unpacking run further ahead of applying")
+         ("vote-tally-threads", bpo::value<uint16_t>()->default_value(0),
+          "Number of threads counting votes during maintenance, 0 for one per hardware thread, "
+          "1 to count them on the block processing thread")
+         ("api-worker-threads", bpo::value<uint16_t>()->default_value(0),
+          "Number of threads running read-only database API queries, so that they do not delay block processing, "
+          "0 to run them on the block processing thread")
+         ("api-response-cache-size", bpo::value<uint64_t>()->default_value(0),
+          "Maximum size in MiB of the responses of frequent database API queries shared between connections, "
+          "0 to disable the cache")
+         ("subscription-max-pending-notifications", bpo::value<uint32_t>()->default_value(
+                                        subscription_dispatcher::default_max_pending_notifications ),
+          "Maximum number of undelivered object and market notifications per API connection, "
+          "further notifications are dropped until the client catches up")
+         ("subscription-max-objects-per-connection", bpo::value<uint32_t>()->default_value(
+                                        subscription_dispatcher::default_max_items_per_session ),
+          "Maximum number of objects an API connection can subscribe to, further subscriptions are refused "
+          "and counted in get_subscription_stats, 0 for no limit")
          ("enable-standby-votes-tracking", bpo::value<bool>()->implicit_value(true),
           "Whether to enable tracking of votes of standby witnesses and committee members. "
           "Set it to true to provide accurate data to API clients, set to false for slightly better performance.")
@@ -1188,6 +1387,8 @@ void application::set_program_options(boost::program_options::options_descriptio
           "Set maximum limit value for database APIs which query for liquidity pools")
          ("api-limit-get-liquidity-pool-history", boost::program_options::value<uint64_t>()->default_value(101),
           "Set maximum limit value for APIs which query for history of liquidity pools")
+         ("api-limit-export-raw-blocks", boost::program_options::value<uint64_t>()->default_value(1000),
+          "Set maximum number of blocks to export at once by block_api::export_raw_blocks")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -1257,6 +1458,11 @@ std::shared_ptr<chain::database> application::chain_database() const
    return my->_chain_db;
 }
 
+const fc::path& application::data_dir()const
+{
+   return my->_data_dir;
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->set_block_production(producing_blocks);
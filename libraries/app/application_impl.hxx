@@ -206,6 +206,9 @@ class application_impl : public net::node_delegate, public std::enable_shared_fr
       /// Open the chain database. Called by @ref startup.
       void open_chain_database() const;
 
+      /// Pushes the transactions received from the network in batches, see @ref handle_transaction
+      void process_incoming_transactions();
+
       friend class graphene::app::application;
 
       application& _self;
@@ -225,6 +228,28 @@ class application_impl : public net::node_delegate, public std::enable_shared_fr
       bool _is_finished_syncing = false;
 
       fc::serial_valve valve;
+
+      /// A transaction received from the network, and the result of pushing it
+      struct incoming_transaction
+      {
+         graphene::chain::precomputable_transaction trx;
+         fc::promise<void>::ptr                      result;
+      };
+      /// Transactions received while the previous batch is being processed
+      std::vector<incoming_transaction> _incoming_transactions;
+      fc::future<void> _incoming_transactions_done;
+
+      /// Counters of the incoming transactions, logged about once per second
+      struct incoming_transaction_stats
+      {
+         fc::time_point last_log_time;
+         uint64_t transactions = 0;
+         uint64_t rejected = 0;
+         uint64_t batches = 0;
+         uint64_t largest_batch = 0;
+         fc::microseconds precompute_time;
+         fc::microseconds push_time;
+      } _incoming_transaction_stats;
    };
 
 }}} // namespace graphene namespace app namespace detail
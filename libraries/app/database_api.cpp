@@ -56,19 +56,12 @@ database_api_impl::database_api_impl( graphene::chain::database& db, const appli
 :_db(db), _app_options(app_options)
 {
    dlog("creating database api ${x}", ("x",int64_t(this)) );
-   _new_connection = _db.new_objects.connect([this](const vector<object_id_type>& ids,
-                                                    const flat_set<account_id_type>& impacted_accounts) {
-                                on_objects_new(ids, impacted_accounts);
-                                });
-   _change_connection = _db.changed_objects.connect([this](const vector<object_id_type>& ids,
-                                                           const flat_set<account_id_type>& impacted_accounts) {
-                                on_objects_changed(ids, impacted_accounts);
-                                });
-   _removed_connection = _db.removed_objects.connect([this](const vector<object_id_type>& ids,
-                                                            const vector<const object*>& objs,
-                                                            const flat_set<account_id_type>& impacted_accounts) {
-                                on_objects_removed(ids, objs, impacted_accounts);
-                                });
+   if( _app_options && _app_options->subscriptions )
+      _subscription_dispatcher = _app_options->subscriptions;
+   else
+      _subscription_dispatcher = std::make_shared<subscription_dispatcher>( _db );
+   _subscriptions = _subscription_dispatcher->open_session();
+
    _applied_block_connection = _db.applied_block.connect([this](const signed_block&){ on_applied_block(); });
 
    _pending_trx_connection = _db.on_pending_transaction.connect([this](const signed_transaction& trx ){
@@ -94,10 +87,21 @@ database_api_impl::database_api_impl( graphene::chain::database& db, const appli
    {
       asset_in_liquidity_pools_index = nullptr;
    }
+
+   try
+   {
+      market_depth_index = &_db.get_index_type< primary_index< limit_order_index > >()
+            .get_secondary_index<graphene::api_helper_indexes::market_depth_index>();
+   }
+   catch( const fc::assert_exception& )
+   {
+      market_depth_index = nullptr;
+   }
 }
 
 database_api_impl::~database_api_impl()
 {
+   _subscription_dispatcher->close_session( *_subscriptions );
    dlog("freeing database api ${x}", ("x",int64_t(this)) );
 }
 
@@ -152,10 +156,7 @@ void database_api_impl::set_subscribe_callback( std::function<void(const variant
                  "Subscribing to universal object creation and removal is disallowed in this server." );
    }
 
-   cancel_all_subscriptions(false, false);
-
-   _subscribe_callback = cb;
-   _notify_remove_create = notify_remove_create;
+   _subscription_dispatcher->set_object_callback( *_subscriptions, cb, notify_remove_create );
 }
 
 void database_api::set_auto_subscription( bool enable )
@@ -195,16 +196,7 @@ void database_api::cancel_all_subscriptions()
 
 void database_api_impl::cancel_all_subscriptions( bool reset_callback, bool reset_market_subscriptions )
 {
-   if ( reset_callback )
-      _subscribe_callback = std::function<void(const fc::variant&)>();
-
-   if ( reset_market_subscriptions )
-      _market_subscriptions.clear();
-
-   _notify_remove_create = false;
-   _subscribed_accounts.clear();
-   static fc::bloom_parameters param(10000, 1.0/100, 1024*8*8*2);
-   _subscribe_filter = fc::bloom_filter(param);
+   _subscription_dispatcher->cancel_all_subscriptions( *_subscriptions, reset_callback, reset_market_subscriptions );
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -321,7 +313,9 @@ chain_id_type database_api_impl::get_chain_id()const
 
 dynamic_global_property_object database_api::get_dynamic_global_properties()const
 {
-   return my->get_dynamic_global_properties();
+   return my->run_cached( []() { return api_response_cache::make_key( "get_dynamic_global_properties" ); },
+                          api_response_cache::global_properties,
+                          [this]() { return my->get_dynamic_global_properties(); } );
 }
 
 dynamic_global_property_object database_api_impl::get_dynamic_global_properties()const
@@ -329,6 +323,58 @@ dynamic_global_property_object database_api_impl::get_dynamic_global_properties(
    return _db.get(dynamic_global_property_id_type());
 }
 
+vector<graphene::db::index_memory_usage> database_api::get_index_memory_usage()const
+{
+   return my->get_index_memory_usage();
+}
+
+vector<graphene::db::index_memory_usage> database_api_impl::get_index_memory_usage()const
+{
+   return _db.get_memory_usage();
+}
+
+graphene::protocol::signature_cache_stats database_api::get_signature_cache_stats()const
+{
+   return my->get_signature_cache_stats();
+}
+
+graphene::protocol::signature_cache_stats database_api_impl::get_signature_cache_stats()const
+{
+   return graphene::protocol::signature_cache::instance().get_stats();
+}
+
+mempool_stats database_api::get_mempool_stats()const
+{
+   return my->get_mempool_stats();
+}
+
+mempool_stats database_api_impl::get_mempool_stats()const
+{
+   return _db.get_mempool_stats();
+}
+
+subscription_stats database_api::get_subscription_stats()const
+{
+   return my->get_subscription_stats();
+}
+
+subscription_stats database_api_impl::get_subscription_stats()const
+{
+   return _subscription_dispatcher->get_stats( *_subscriptions );
+}
+
+api_response_cache_stats database_api::get_response_cache_stats()const
+{
+   return my->get_response_cache_stats();
+}
+
+api_response_cache_stats database_api_impl::get_response_cache_stats()const
+{
+   if( _app_options && _app_options->response_cache )
+      return _app_options->response_cache->get_stats();
+   return api_response_cache_stats();
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Keys                                                             //
@@ -468,12 +514,22 @@ vector<optional<account_object>> database_api_impl::get_accounts( const vector<s
 std::map<string,full_account> database_api::get_full_accounts( const vector<string>& names_or_ids,
                                                                optional<bool> subscribe )
 {
-   return my->get_full_accounts( names_or_ids, subscribe );
+   if( my->get_whether_to_subscribe( subscribe ) )
+      return my->get_full_accounts( names_or_ids, subscribe );
+   return my->run_cached( [&]() { return api_response_cache::make_key( "get_full_accounts", names_or_ids ); },
+                          api_response_cache::accounts,
+                          [&]() { return my->get_full_accounts( names_or_ids, false ); },
+                          []( const std::map<string,full_account>& accounts ) {
+                             flat_set<account_id_type> ids;
+                             for( const auto& account : accounts )
+                                ids.insert( account.second.account.get_id() );
+                             return ids;
+                          } );
 }
 
 vector<account_statistics_object> database_api::get_top_voters(uint32_t limit)const
 {
-   return my->get_top_voters( limit );
+   return my->run_read_only( [&]() { return my->get_top_voters( limit ); } );
 }
 
 std::map<std::string, full_account> database_api_impl::get_full_accounts( const vector<std::string>& names_or_ids,
@@ -495,13 +551,8 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
       if (account == nullptr)
          continue;
 
-      if( to_subscribe )
-      {
-         if(_subscribed_accounts.size() < 100) {
-            _subscribed_accounts.insert( account->get_id() );
-            subscribe_to_item( account->id );
-         }
-      }
+      if( to_subscribe && _subscription_dispatcher->subscribe_to_account( *_subscriptions, account->get_id() ) )
+         subscribe_to_item( account->id );
 
       full_account acnt;
       acnt.account = *account;
@@ -1007,7 +1058,7 @@ vector<optional<extended_asset_object>> database_api_impl::lookup_asset_symbols(
 
 vector<limit_order_object> database_api::get_limit_orders(std::string a, std::string b, uint32_t limit)const
 {
-   return my->get_limit_orders( a, b, limit );
+   return my->run_read_only( [&]() { return my->get_limit_orders( a, b, limit ); } );
 }
 
 vector<limit_order_object> database_api_impl::get_limit_orders( const std::string& a, const std::string& b,
@@ -1069,7 +1120,9 @@ vector<limit_order_object> database_api::get_account_limit_orders(
                               const string& account_name_or_id, const string &base, const string &quote,
                               uint32_t limit, optional<limit_order_id_type> ostart_id, optional<price> ostart_price )
 {
-   return my->get_account_limit_orders( account_name_or_id, base, quote, limit, ostart_id, ostart_price );
+   return my->run_read_only( [&]() {
+      return my->get_account_limit_orders( account_name_or_id, base, quote, limit, ostart_id, ostart_price );
+   } );
 }
 
 vector<limit_order_object> database_api_impl::get_account_limit_orders(
@@ -1136,7 +1189,7 @@ vector<limit_order_object> database_api_impl::get_account_limit_orders(
          FC_ASSERT(loo.sell_price.quote.asset_id == quote_id, "Order quote asset inconsistent with order");
          FC_ASSERT(loo.seller == account->get_id(), "Order not owned by specified account");
 
-         lower_itr = index_by_account.lower_bound(std::make_tuple(account->id, loo.sell_price, *ostart_id));
+         lower_itr = index_by_account.lower_bound(std::make_tuple(account->id, loo.sell_price_key, *ostart_id));
       }
    }
    else
@@ -1159,7 +1212,7 @@ vector<limit_order_object> database_api_impl::get_account_limit_orders(
 
 vector<call_order_object> database_api::get_call_orders(const std::string& a, uint32_t limit)const
 {
-   return my->get_call_orders( a, limit );
+   return my->run_read_only( [&]() { return my->get_call_orders( a, limit ); } );
 }
 
 vector<call_order_object> database_api_impl::get_call_orders(const std::string& a, uint32_t limit)const
@@ -1215,7 +1268,7 @@ vector<call_order_object> database_api_impl::get_call_orders_by_account(const st
 
 vector<force_settlement_object> database_api::get_settle_orders(const std::string& a, uint32_t limit)const
 {
-   return my->get_settle_orders( a, limit );
+   return my->run_read_only( [&]() { return my->get_settle_orders( a, limit ); } );
 }
 
 vector<force_settlement_object> database_api_impl::get_settle_orders(const std::string& a, uint32_t limit)const
@@ -1350,7 +1403,7 @@ void database_api_impl::subscribe_to_market( std::function<void(const variant&)>
 
    if(asset_a_id > asset_b_id) std::swap(asset_a_id,asset_b_id);
    FC_ASSERT(asset_a_id != asset_b_id);
-   _market_subscriptions[ std::make_pair(asset_a_id,asset_b_id) ] = callback;
+   _subscription_dispatcher->subscribe_to_market( *_subscriptions, std::make_pair(asset_a_id,asset_b_id), callback );
 }
 
 void database_api::unsubscribe_from_market(const std::string& a, const std::string& b)
@@ -1365,12 +1418,14 @@ void database_api_impl::unsubscribe_from_market(const std::string& a, const std:
 
    if(a > b) std::swap(asset_a_id,asset_b_id);
    FC_ASSERT(asset_a_id != asset_b_id);
-   _market_subscriptions.erase(std::make_pair(asset_a_id,asset_b_id));
+   _subscription_dispatcher->unsubscribe_from_market( *_subscriptions, std::make_pair(asset_a_id,asset_b_id) );
 }
 
 market_ticker database_api::get_ticker( const string& base, const string& quote )const
 {
-    return my->get_ticker( base, quote );
+   return my->run_cached( [&]() { return api_response_cache::make_key( "get_ticker", base, quote ); },
+                          api_response_cache::markets,
+                          [&]() { return my->get_ticker( base, quote ); } );
 }
 
 market_ticker database_api_impl::get_ticker( const string& base, const string& quote, bool skip_order_book )const
@@ -1423,7 +1478,9 @@ market_volume database_api_impl::get_24_volume( const string& base, const string
 
 order_book database_api::get_order_book( const string& base, const string& quote, unsigned limit )const
 {
-   return my->get_order_book( base, quote, limit);
+   return my->run_cached( [&]() { return api_response_cache::make_key( "get_order_book", base, quote, limit ); },
+                          api_response_cache::markets,
+                          [&]() { return my->get_order_book( base, quote, limit ); } );
 }
 
 order_book database_api_impl::get_order_book( const string& base, const string& quote, unsigned limit )const
@@ -1473,9 +1530,94 @@ order_book database_api_impl::get_order_book( const string& base, const string&
    return result;
 }
 
+order_book_depth database_api::get_order_book_depth( const string& base, const string& quote, unsigned limit )const
+{
+   return my->run_cached( [&]() { return api_response_cache::make_key( "get_order_book_depth", base, quote, limit ); },
+                          api_response_cache::markets,
+                          [&]() { return my->get_order_book_depth( base, quote, limit ); } );
+}
+
+order_book_depth database_api_impl::get_order_book_depth( const string& base, const string& quote,
+                                                          unsigned limit )const
+{
+   // api_helper_indexes plugin is required for accessing the secondary index
+   FC_ASSERT( _app_options && _app_options->has_api_helper_indexes_plugin,
+              "api_helper_indexes plugin is not enabled on this server." );
+
+   const auto configured_limit = _app_options->api_limit_get_order_book;
+   FC_ASSERT( limit <= configured_limit,
+              "limit can not be greater than ${configured_limit}",
+              ("configured_limit", configured_limit) );
+
+   FC_ASSERT( market_depth_index, "Internal error" );
+
+   auto assets = lookup_asset_symbols( {base, quote} );
+   FC_ASSERT( assets[0], "Invalid base asset symbol: ${s}", ("s",base) );
+   FC_ASSERT( assets[1], "Invalid quote asset symbol: ${s}", ("s",quote) );
+   const asset_object& base_asset = *assets[0];
+   const asset_object& quote_asset = *assets[1];
+
+   order_book_depth result;
+   result.base = base;
+   result.quote = quote;
+   result.bid_depth = base_asset.amount_to_string( 0 );
+   result.ask_depth = quote_asset.amount_to_string( 0 );
+
+   // bids sell the base asset, asks sell the quote asset
+   const auto* bids = market_depth_index->get_book_side( base_asset.id, quote_asset.id );
+   if( bids != nullptr )
+   {
+      result.bid_depth = base_asset.amount_to_string( bids->for_sale );
+      result.bid_orders = bids->order_count;
+      share_type cumulative_base = 0;
+      share_type cumulative_quote = 0;
+      for( auto itr = bids->levels.begin(); itr != bids->levels.end() && result.bids.size() < limit; ++itr )
+      {
+         const auto& level = itr->second;
+         cumulative_base += level.for_sale;
+         cumulative_quote += level.to_receive;
+         order_book_level l;
+         l.price = price_to_string( level.sell_price, base_asset, quote_asset );
+         l.base = base_asset.amount_to_string( level.for_sale );
+         l.quote = quote_asset.amount_to_string( level.to_receive );
+         l.cumulative_base = base_asset.amount_to_string( cumulative_base );
+         l.cumulative_quote = quote_asset.amount_to_string( cumulative_quote );
+         l.orders = level.order_count;
+         result.bids.push_back( std::move( l ) );
+      }
+   }
+
+   const auto* asks = market_depth_index->get_book_side( quote_asset.id, base_asset.id );
+   if( asks != nullptr )
+   {
+      result.ask_depth = quote_asset.amount_to_string( asks->for_sale );
+      result.ask_orders = asks->order_count;
+      share_type cumulative_base = 0;
+      share_type cumulative_quote = 0;
+      for( auto itr = asks->levels.begin(); itr != asks->levels.end() && result.asks.size() < limit; ++itr )
+      {
+         const auto& level = itr->second;
+         cumulative_quote += level.for_sale;
+         cumulative_base += level.to_receive;
+         order_book_level l;
+         l.price = price_to_string( level.sell_price, base_asset, quote_asset );
+         l.quote = quote_asset.amount_to_string( level.for_sale );
+         l.base = base_asset.amount_to_string( level.to_receive );
+         l.cumulative_base = base_asset.amount_to_string( cumulative_base );
+         l.cumulative_quote = quote_asset.amount_to_string( cumulative_quote );
+         l.orders = level.order_count;
+         result.asks.push_back( std::move( l ) );
+      }
+   }
+
+   return result;
+}
+
 vector<market_ticker> database_api::get_top_markets(uint32_t limit)const
 {
-   return my->get_top_markets(limit);
+   return my->run_cached( [&]() { return api_response_cache::make_key( "get_top_markets", limit ); },
+                          api_response_cache::markets,
+                          [&]() { return my->get_top_markets( limit ); } );
 }
 
 vector<market_ticker> database_api_impl::get_top_markets(uint32_t limit)const
@@ -1512,7 +1654,7 @@ vector<market_trade> database_api::get_trade_history( const string& base,
                                                       fc::time_point_sec stop,
                                                       unsigned limit )const
 {
-   return my->get_trade_history( base, quote, start, stop, limit );
+   return my->run_read_only( [&]() { return my->get_trade_history( base, quote, start, stop, limit ); } );
 }
 
 vector<market_trade> database_api_impl::get_trade_history( const string& base,
@@ -1614,7 +1756,7 @@ vector<market_trade> database_api::get_trade_history_by_sequence(
                                                       fc::time_point_sec stop,
                                                       unsigned limit )const
 {
-   return my->get_trade_history_by_sequence( base, quote, start, stop, limit );
+   return my->run_read_only( [&]() { return my->get_trade_history_by_sequence( base, quote, start, stop, limit ); } );
 }
 
 vector<market_trade> database_api_impl::get_trade_history_by_sequence(
@@ -3076,8 +3218,8 @@ vector<limit_order_object> database_api_impl::get_limit_orders( const asset_id_t
    result.reserve(limit*2);
 
    uint32_t count = 0;
-   auto limit_itr = limit_price_idx.lower_bound(price::max(a,b));
-   auto limit_end = limit_price_idx.upper_bound(price::min(a,b));
+   auto limit_itr = limit_price_idx.lower_bound( price_key( price::max(a,b) ) );
+   auto limit_end = limit_price_idx.upper_bound( price_key( price::min(a,b) ) );
    while(limit_itr != limit_end && count < limit)
    {
       result.push_back(*limit_itr);
@@ -3085,8 +3227,8 @@ vector<limit_order_object> database_api_impl::get_limit_orders( const asset_id_t
       ++count;
    }
    count = 0;
-   limit_itr = limit_price_idx.lower_bound(price::max(b,a));
-   limit_end = limit_price_idx.upper_bound(price::min(b,a));
+   limit_itr = limit_price_idx.lower_bound( price_key( price::max(b,a) ) );
+   limit_end = limit_price_idx.upper_bound( price_key( price::min(b,a) ) );
    while(limit_itr != limit_end && count < limit)
    {
       result.push_back(*limit_itr);
@@ -3097,136 +3239,6 @@ vector<limit_order_object> database_api_impl::get_limit_orders( const asset_id_t
    return result;
 }
 
-bool database_api_impl::is_impacted_account( const flat_set<account_id_type>& accounts)
-{
-   if( !_subscribed_accounts.size() || !accounts.size() )
-      return false;
-
-   return std::any_of(accounts.begin(), accounts.end(), [this](const account_id_type& account) {
-      return _subscribed_accounts.find(account) != _subscribed_accounts.end();
-   });
-}
-
-void database_api_impl::broadcast_updates( const vector<variant>& updates )
-{
-   if( updates.size() && _subscribe_callback ) {
-      auto capture_this = shared_from_this();
-      fc::async([capture_this,updates](){
-          if(capture_this->_subscribe_callback)
-            capture_this->_subscribe_callback( fc::variant(updates) );
-      });
-   }
-}
-
-void database_api_impl::broadcast_market_updates( const market_queue_type& queue)
-{
-   if( queue.size() )
-   {
-      auto capture_this = shared_from_this();
-      fc::async([capture_this, this, queue](){
-          for( const auto& item : queue )
-          {
-            auto sub = _market_subscriptions.find(item.first);
-            if( sub != _market_subscriptions.end() )
-                sub->second( fc::variant(item.second ) );
-          }
-      });
-   }
-}
-
-void database_api_impl::on_objects_removed( const vector<object_id_type>& ids,
-                                            const vector<const object*>& objs,
-                                            const flat_set<account_id_type>& impacted_accounts )
-{
-   handle_object_changed(_notify_remove_create, false, ids, impacted_accounts,
-      [objs](object_id_type id) -> const object* {
-         auto it = std::find_if(
-               objs.begin(), objs.end(),
-               [id](const object* o) {return o != nullptr && o->id == id;});
-
-         if (it != objs.end())
-            return *it;
-
-         return nullptr;
-      }
-   );
-}
-
-void database_api_impl::on_objects_new( const vector<object_id_type>& ids,
-                                        const flat_set<account_id_type>& impacted_accounts )
-{
-   handle_object_changed(_notify_remove_create, true, ids, impacted_accounts,
-      std::bind(&object_database::find_object, &_db, std::placeholders::_1)
-   );
-}
-
-void database_api_impl::on_objects_changed( const vector<object_id_type>& ids,
-                                            const flat_set<account_id_type>& impacted_accounts )
-{
-   handle_object_changed(false, true, ids, impacted_accounts,
-      std::bind(&object_database::find_object, &_db, std::placeholders::_1)
-   );
-}
-
-void database_api_impl::handle_object_changed( bool force_notify,
-                                               bool full_object,
-                                               const vector<object_id_type>& ids,
-                                               const flat_set<account_id_type>& impacted_accounts,
-                                               std::function<const object*(object_id_type id)> find_object )
-{
-   if( _subscribe_callback )
-   {
-      vector<variant> updates;
-
-      for(auto id : ids)
-      {
-         if( force_notify || is_subscribed_to_item(id) || is_impacted_account(impacted_accounts) )
-         {
-            if( full_object )
-            {
-               auto obj = find_object(id);
-               if( obj )
-               {
-                  updates.emplace_back( obj->to_variant() );
-               }
-            }
-            else
-            {
-               updates.emplace_back( fc::variant( id, 1 ) );
-            }
-         }
-      }
-
-      if( updates.size() )
-         broadcast_updates(updates);
-   }
-
-   if( _market_subscriptions.size() )
-   {
-      market_queue_type broadcast_queue;
-
-      for(auto id : ids)
-      {
-         if( id.is<call_order_object>() )
-         {
-            enqueue_if_subscribed_to_market<call_order_object>( find_object(id), broadcast_queue, full_object );
-         }
-         else if( id.is<limit_order_object>() )
-         {
-            enqueue_if_subscribed_to_market<limit_order_object>( find_object(id), broadcast_queue, full_object );
-         }
-         else if( id.is<force_settlement_object>() )
-         {
-            enqueue_if_subscribed_to_market<force_settlement_object>( find_object(id), broadcast_queue,
-                                                                      full_object );
-         }
-      }
-
-      if( broadcast_queue.size() )
-         broadcast_market_updates(broadcast_queue);
-   }
-}
-
 /** note: this method cannot yield because it is called in the middle of
  * apply a block.
  */
@@ -3241,7 +3253,8 @@ void database_api_impl::on_applied_block()
       });
    }
 
-   if(_market_subscriptions.size() == 0)
+   const auto& market_subscriptions = _subscriptions->get_market_callbacks();
+   if( market_subscriptions.empty() )
       return;
 
    const auto& ops = _db.get_applied_operations();
@@ -3268,17 +3281,18 @@ void database_api_impl::on_applied_block()
          */
          default: break;
       }
-      if( market.valid() && _market_subscriptions.count(*market) > 0 )
+      if( market.valid() && market_subscriptions.count(*market) > 0 )
          // FIXME this may cause fill_order_operation be pushed before order creation
          subscribed_markets_ops[*market].emplace_back(std::make_pair(op.op, op.result));
    }
    /// we need to ensure the database_api is not deleted for the life of the async operation
    auto capture_this = shared_from_this();
    fc::async([this,capture_this,subscribed_markets_ops](){
+      const auto& market_subscriptions = _subscriptions->get_market_callbacks();
       for(auto item : subscribed_markets_ops)
       {
-         auto itr = _market_subscriptions.find(item.first);
-         if(itr != _market_subscriptions.end())
+         auto itr = market_subscriptions.find(item.first);
+         if(itr != market_subscriptions.end())
             itr->second(fc::variant(item.second, GRAPHENE_NET_MAX_NESTED_OBJECTS));
       }
    });
@@ -22,17 +22,15 @@
  * THE SOFTWARE.
  */
 
+#include <graphene/app/api_response_cache.hpp>
+#include <graphene/app/api_worker_pool.hpp>
 #include <graphene/app/database_api.hpp>
-
-#include <fc/bloom_filter.hpp>
+#include <graphene/app/subscription_dispatcher.hpp>
 
 #define GET_REQUIRED_FEES_MAX_RECURSION 4
 
 namespace graphene { namespace app {
 
-typedef std::map< std::pair<graphene::chain::asset_id_type, graphene::chain::asset_id_type>,
-                  std::vector<fc::variant> > market_queue_type;
-
 class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 {
    public:
@@ -61,6 +59,11 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       fc::variant_object get_config()const;
       chain_id_type get_chain_id()const;
       dynamic_global_property_object get_dynamic_global_properties()const;
+      vector<graphene::db::index_memory_usage> get_index_memory_usage()const;
+      graphene::protocol::signature_cache_stats get_signature_cache_stats()const;
+      mempool_stats get_mempool_stats()const;
+      subscription_stats get_subscription_stats()const;
+      api_response_cache_stats get_response_cache_stats()const;
 
       // Keys
       vector<flat_set<account_id_type>> get_key_references( vector<public_key_type> key )const;
@@ -130,6 +133,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       market_volume                      get_24_volume( const string& base, const string& quote )const;
       order_book                         get_order_book( const string& base, const string& quote,
                                                          unsigned limit = 50 )const;
+      order_book_depth                   get_order_book_depth( const string& base, const string& quote,
+                                                               unsigned limit )const;
       vector<market_ticker>              get_top_markets( uint32_t limit )const;
       vector<market_trade>               get_trade_history( const string& base, const string& quote,
                                                             fc::time_point_sec start, fc::time_point_sec stop,
@@ -348,129 +353,66 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       // Subscription
       ////////////////////////////////////////////////
 
-      // Decides whether to subscribe using member variables and given parameter
-      bool get_whether_to_subscribe( optional<bool> subscribe )const
-      {
-         if( !_subscribe_callback )
-            return false;
-         if( subscribe.valid() )
-            return *subscribe;
-         return _enabled_auto_subscription;
-      }
-
-      // Note:
-      //   Different type of object_id<T> objects could become identical after packed.
-      //   For example, both `account_id_type a=1.2.0` and `asset_id_type b=1.3.0` will become `0` after packed.
-      //   In order to avoid collision, we don't use a template function here, instead, we implicitly convert all
-      //   object IDs to `object_id_type` when subscribing.
-      //
-      //   If need to subscribe to other data types, override this function with the types as parameter.
-      //   For example, we had a `get_subscription_key( const public_key_type& item )` function here, which was
-      //   removed lately since we no longer subscribe to public keys.
-      vector<char> get_subscription_key( const object_id_type& item )const
+      // Runs a query which neither changes nor depends on subscriptions on the API worker threads if enabled
+      template<typename Query>
+      auto run_read_only( Query&& query )const -> decltype( query() )
       {
-         return fc::raw::pack(item);
+         if( _app_options && _app_options->api_workers )
+            return _app_options->api_workers->run( std::forward<Query>( query ) );
+         return query();
       }
 
-      template<typename T>
-      void subscribe_to_item( const T& item )const
+      // Serves a read-only query from the API response cache if enabled, see api_response_cache::get
+      template<typename MakeKey, typename Query, typename... GetAccounts>
+      auto run_cached( MakeKey&& make_key, uint8_t depends_on, Query&& query, GetAccounts&&... get_accounts )const
+         -> decltype( query() )
       {
-         if( !_subscribe_callback )
-            return;
-
-         vector<char> key = get_subscription_key( item );
-         if( !_subscribe_filter.contains( key.data(), key.size() ) )
-         {
-            _subscribe_filter.insert( key.data(), key.size() );
-         }
+         if( !_app_options || !_app_options->response_cache )
+            return run_read_only( std::forward<Query>( query ) );
+         return _app_options->response_cache->get( make_key(), depends_on,
+                                                   [this,&query]() { return run_read_only( query ); },
+                                                   std::forward<GetAccounts>( get_accounts )... );
       }
 
-      template<typename T>
-      bool is_subscribed_to_item( const T& item )const
+      // Decides whether to subscribe using member variables and given parameter
+      bool get_whether_to_subscribe( optional<bool> subscribe )const
       {
-         if( !_subscribe_callback )
+         if( !_subscriptions->get_object_callback() )
             return false;
-
-         vector<char> key = get_subscription_key( item );
-         return _subscribe_filter.contains( key.data(), key.size() );
-      }
-
-      // for full-account subscription
-      bool is_impacted_account( const flat_set<account_id_type>& accounts );
-
-      // for market subscription
-      template<typename T>
-      const std::pair<asset_id_type,asset_id_type> get_order_market( const T& order )
-      {
-         return order.get_market();
-      }
-
-      // for market subscription
-      const std::pair<asset_id_type,asset_id_type> get_order_market( const force_settlement_object& order )
-      {
-         // TODO cache the result to avoid repeatly fetching from db
-         asset_id_type backing_id = order.balance.asset_id( _db ).bitasset_data( _db ).options.short_backing_asset;
-         auto tmp = std::make_pair( order.balance.asset_id, backing_id );
-         if( tmp.first > tmp.second ) std::swap( tmp.first, tmp.second );
-         return tmp;
+         if( subscribe.valid() )
+            return *subscribe;
+         return _enabled_auto_subscription;
       }
 
-      template<typename T>
-      void enqueue_if_subscribed_to_market(const object* obj, market_queue_type& queue, bool full_object=true)
+      void subscribe_to_item( const object_id_type& id )const
       {
-         const T* order = dynamic_cast<const T*>(obj);
-         FC_ASSERT( order != nullptr);
-
-         const auto& market = get_order_market( *order );
-
-         auto sub = _market_subscriptions.find( market );
-         if( sub != _market_subscriptions.end() ) {
-            queue[market].emplace_back( full_object ? obj->to_variant() : fc::variant(obj->id, 1) );
-         }
+         _subscription_dispatcher->subscribe_to_item( *_subscriptions, id );
       }
 
-      void broadcast_updates( const vector<variant>& updates );
-      void broadcast_market_updates( const market_queue_type& queue);
-      void handle_object_changed( bool force_notify,
-                                  bool full_object,
-                                  const vector<object_id_type>& ids,
-                                  const flat_set<account_id_type>& impacted_accounts,
-                                  std::function<const object*(object_id_type id)> find_object );
-
-      /** called every time a block is applied to report the objects that were changed */
-      void on_objects_new(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
-      void on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
-      void on_objects_removed(const vector<object_id_type>& ids, const vector<const object*>& objs,
-                              const flat_set<account_id_type>& impacted_accounts);
+      /** called every time a block is applied */
       void on_applied_block();
 
       ////////////////////////////////////////////////
       // Member variables
       ////////////////////////////////////////////////
 
-      bool _notify_remove_create = false;
       bool _enabled_auto_subscription = true;
 
-      mutable fc::bloom_filter  _subscribe_filter;
-      std::set<account_id_type> _subscribed_accounts;
-
-      std::function<void(const fc::variant&)> _subscribe_callback;
       std::function<void(const fc::variant&)> _pending_trx_callback;
       std::function<void(const fc::variant&)> _block_applied_callback;
 
-      boost::signals2::scoped_connection _new_connection;
-      boost::signals2::scoped_connection _change_connection;
-      boost::signals2::scoped_connection _removed_connection;
       boost::signals2::scoped_connection _applied_block_connection;
       boost::signals2::scoped_connection _pending_trx_connection;
 
-      map< pair<asset_id_type,asset_id_type>, std::function<void(const variant&)> > _market_subscriptions;
+      std::shared_ptr<subscription_dispatcher>          _subscription_dispatcher;
+      std::shared_ptr<subscription_dispatcher::session> _subscriptions;
 
       graphene::chain::database& _db;
       const application_options* _app_options = nullptr;
 
       const graphene::api_helper_indexes::amount_in_collateral_index* amount_in_collateral_index;
       const graphene::api_helper_indexes::asset_in_liquidity_pools_index* asset_in_liquidity_pools_index;
+      const graphene::api_helper_indexes::market_depth_index* market_depth_index;
 };
 
 } } // graphene::app
@@ -50,6 +50,10 @@
 #include <string>
 #include <vector>
 
+namespace graphene { namespace account_history {
+   class operation_history_block_index;
+} }
+
 namespace graphene { namespace app {
    using namespace graphene::chain;
    using namespace graphene::market_history;
@@ -97,6 +101,20 @@ namespace graphene { namespace app {
       vector<operation_history_object> operation_history_objs;
    };
 
+   /**
+    * @brief a batch of serialized blocks exported by @ref block_api::export_raw_blocks
+    *
+    * For every block @ref data contains the serialized block prefixed with its size as a varint. If virtual
+    * operations were requested, the block is followed by a serialized vector of the operation history objects
+    * of the virtual operations applied with the block.
+    */
+   struct raw_block_batch
+   {
+      uint32_t       first_block_num = 0; ///< number of the first block in the batch
+      uint32_t       block_count = 0; ///< number of blocks in the batch, the next batch starts after them
+      vector<char>   data;
+   };
+
    /**
     * @brief summary data of a group of limit orders
     */
@@ -290,7 +308,7 @@ namespace graphene { namespace app {
    class block_api
    {
    public:
-      block_api(graphene::chain::database& db);
+      block_api(graphene::chain::database& db, const application_options* app_options = nullptr );
       ~block_api();
 
       /**
@@ -301,8 +319,26 @@ namespace graphene { namespace app {
           */
       vector<optional<signed_block>> get_blocks(uint32_t block_num_from, uint32_t block_num_to)const;
 
+      /**
+          * @brief Export serialized signed blocks in a single buffer
+          * @param block_num_from The lowest block number
+          * @param block_num_to The highest block number, at most the configured api-limit-export-raw-blocks
+          *        minus one above block_num_from
+          * @param include_virtual_ops Whether to add the virtual operations applied with each block, requires
+          *        the account_history plugin with index-operations-by-block enabled
+          * @return The stored blocks from block_num_from on, copied from the block database without being
+          *         unpacked; the batch stops at the first missing block or once its hex encoded data reaches
+          *         @ref max_export_batch_size bytes, so clients continue with the block following it
+          */
+      raw_block_batch export_raw_blocks(uint32_t block_num_from, uint32_t block_num_to,
+                                        bool include_virtual_ops = false)const;
+
+      static constexpr size_t max_export_batch_size = 32 * 1024 * 1024;
+
    private:
       graphene::chain::database& _db;
+      const application_options* _app_options = nullptr;
+      const account_history::operation_history_block_index* _operations_by_block = nullptr;
    };
 
 
@@ -688,6 +724,8 @@ FC_REFLECT( graphene::app::verify_range_proof_rewind_result,
         (success)(min_val)(max_val)(value_out)(blind_out)(message_out) )
 FC_REFLECT( graphene::app::history_operation_detail,
             (total_count)(operation_history_objs) )
+FC_REFLECT( graphene::app::raw_block_batch,
+            (first_block_num)(block_count)(data) )
 FC_REFLECT( graphene::app::limit_order_group,
             (min_price)(max_price)(total_for_sale) )
 //FC_REFLECT_TYPENAME( fc::ecc::compact_signature )
@@ -709,6 +747,7 @@ FC_API(graphene::app::history_api,
      )
 FC_API(graphene::app::block_api,
        (get_blocks)
+       (export_raw_blocks)
      )
 FC_API(graphene::app::network_broadcast_api,
        (broadcast_transaction)
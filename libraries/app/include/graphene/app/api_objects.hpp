@@ -94,6 +94,28 @@ namespace graphene { namespace app {
      vector< order >             asks;
    };
 
+   struct order_book_level
+   {
+      string                     price;
+      string                     quote;
+      string                     base;
+      string                     cumulative_quote; ///< quote amount of this level and all better ones
+      string                     cumulative_base; ///< base amount of this level and all better ones
+      uint32_t                   orders = 0; ///< number of orders at this price
+   };
+
+   struct order_book_depth
+   {
+     string                      base;
+     string                      quote;
+     vector< order_book_level >  bids;
+     vector< order_book_level >  asks;
+     string                      bid_depth; ///< base amount of all bids
+     string                      ask_depth; ///< quote amount of all asks
+     uint32_t                    bid_orders = 0;
+     uint32_t                    ask_orders = 0;
+   };
+
    struct market_ticker
    {
       time_point_sec             time;
@@ -193,6 +215,9 @@ FC_REFLECT( graphene::app::full_account,
 
 FC_REFLECT( graphene::app::order, (price)(quote)(base) )
 FC_REFLECT( graphene::app::order_book, (base)(quote)(bids)(asks) )
+FC_REFLECT( graphene::app::order_book_level, (price)(quote)(base)(cumulative_quote)(cumulative_base)(orders) )
+FC_REFLECT( graphene::app::order_book_depth,
+            (base)(quote)(bids)(asks)(bid_depth)(ask_depth)(bid_orders)(ask_orders) )
 FC_REFLECT( graphene::app::market_ticker,
             (time)(base)(quote)(latest)(lowest_ask)(lowest_ask_base_size)(lowest_ask_quote_size)
             (highest_bid)(highest_bid_base_size)(highest_bid_quote_size)(percent_change)(base_volume)(quote_volume)(mto_id) )
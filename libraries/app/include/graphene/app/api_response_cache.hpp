@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/signals.hpp>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace graphene { namespace app {
+
+   struct api_response_cache_stats
+   {
+      uint64_t capacity = 0;      ///< maximum estimated size of the cached responses in bytes
+      uint64_t size = 0;          ///< estimated size of the cached responses in bytes
+      uint64_t entries = 0;       ///< number of cached responses
+      uint64_t hits = 0;          ///< number of responses taken from the cache
+      uint64_t misses = 0;        ///< number of responses computed
+      uint64_t invalidated = 0;   ///< number of responses dropped because the database changed
+      uint64_t evicted = 0;       ///< number of responses dropped to stay within the capacity
+   };
+
+   /**
+    * @class api_response_cache
+    * @brief Shares the responses of frequent database API queries between all connections
+    *
+    * Responses are keyed by method and arguments. All of them are dropped when a block is applied or popped,
+    * and when the pending state is undone to drop or re-apply pending transactions. In between, a pending
+    * transaction drops the responses depending on the accounts it impacts, and if it may change orders, also
+    * those depending on markets or on any account, because orders may be filled. The least recently used
+    * responses are dropped when the estimated size of all responses exceeds the capacity.
+    *
+    * Queries may run on the API worker threads, the database signals are handled on the chain thread.
+    */
+   class api_response_cache
+   {
+      public:
+         /// What a response depends on besides the head block
+         enum dependency
+         {
+            global_properties = 1, ///< the global and dynamic global properties, which only blocks change
+            markets           = 2, ///< orders and bitasset data
+            accounts          = 4  ///< the objects relevant to the accounts given with the response
+         };
+
+         api_response_cache( graphene::chain::database& db, uint64_t capacity );
+         ~api_response_cache();
+
+         /// @return the key of a response to method called with args
+         template<typename... Args>
+         static std::string make_key( const char* method, const Args&... args )
+         {
+            std::vector<char> packed( 1, '\0' );
+            using expand = int[];
+            (void)expand{ 0, ( append_packed( packed, args ), 0 )... };
+            return std::string( method ) + std::string( packed.begin(), packed.end() );
+         }
+
+         /**
+          * Returns the cached response for key, or computes it by calling query and caches it
+          * @param get_accounts returns the accounts a result depends on if the accounts dependency is given
+          */
+         template<typename Query, typename GetAccounts>
+         auto get( const std::string& key, uint8_t depends_on, Query&& query, GetAccounts&& get_accounts )
+            -> decltype( query() )
+         {
+            using result_type = decltype( query() );
+            uint64_t generation;
+            if( std::shared_ptr<const void> cached = find( key, generation ) )
+               return *static_cast<const result_type*>( cached.get() );
+
+            auto result = std::make_shared<result_type>( query() );
+            fc::flat_set<graphene::chain::account_id_type> relevant_accounts;
+            if( depends_on & accounts )
+               relevant_accounts = get_accounts( *result );
+            const size_t size = key.size() + fc::raw::pack_size( *result ) + entry_overhead;
+            insert( key, depends_on, std::move( relevant_accounts ), result, size, generation );
+            return *result;
+         }
+
+         template<typename Query>
+         auto get( const std::string& key, uint8_t depends_on, Query&& query ) -> decltype( query() )
+         {
+            using result_type = decltype( query() );
+            FC_ASSERT( !( depends_on & accounts ), "Responses depending on accounts need to name them" );
+            return get( key, depends_on, std::forward<Query>( query ),
+                        []( const result_type& ) { return fc::flat_set<graphene::chain::account_id_type>(); } );
+         }
+
+         api_response_cache_stats get_stats()const;
+
+      private:
+         /// estimated memory used by an entry besides the key and the response
+         static constexpr size_t entry_overhead = 128;
+
+         struct entry
+         {
+            std::string                                      key;
+            std::shared_ptr<const void>                      value;
+            uint8_t                                          depends_on = 0;
+            fc::flat_set<graphene::chain::account_id_type>   relevant_accounts;
+            size_t                                           size = 0;
+         };
+         typedef std::list<entry> entry_list;
+
+         template<typename T>
+         static void append_packed( std::vector<char>& packed, const T& value )
+         {
+            const auto data = fc::raw::pack( value );
+            packed.insert( packed.end(), data.begin(), data.end() );
+         }
+
+         /// @return the cached response, the current generation if there is none
+         std::shared_ptr<const void> find( const std::string& key, uint64_t& generation );
+         /// caches a response unless the database changed since generation
+         void insert( const std::string& key, uint8_t depends_on,
+                      fc::flat_set<graphene::chain::account_id_type>&& relevant_accounts,
+                      std::shared_ptr<const void> value, size_t size, uint64_t generation );
+
+         void on_pending_transaction( const graphene::chain::signed_transaction& trx );
+         void clear();
+         void erase( entry_list::iterator itr ); ///< requires the mutex
+
+         mutable std::mutex                                            _mutex;
+         const uint64_t                                                _capacity;
+         /// most recently used first
+         entry_list                                                    _entries;
+         std::unordered_map<std::string, entry_list::iterator>         _entries_by_key;
+         std::multimap<graphene::chain::account_id_type, entry_list::iterator> _entries_by_account;
+         /// increases whenever responses are dropped because the database changed
+         uint64_t                                                      _generation = 0;
+         api_response_cache_stats                                      _stats;
+
+         boost::signals2::scoped_connection                            _applied_block_connection;
+         boost::signals2::scoped_connection                            _pending_transaction_connection;
+         boost::signals2::scoped_connection                            _pending_state_reset_connection;
+   };
+
+} } // graphene::app
+
+FC_REFLECT( graphene::app::api_response_cache_stats,
+            (capacity)(size)(entries)(hits)(misses)(invalidated)(evicted) )
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace graphene { namespace app {
+
+/**
+ * @brief Threads that run read-only API queries off the thread that applies blocks
+ *
+ * A query runs while holding the read side of the database lock, so it sees the state between two changes
+ * of the database. The calling fiber waits for the result without blocking its thread.
+ */
+class api_worker_pool
+{
+   public:
+      api_worker_pool( const graphene::chain::database& db, uint16_t num_threads );
+      ~api_worker_pool();
+
+      template<typename Query>
+      auto run( Query&& query ) -> decltype( query() )
+      {
+         const graphene::chain::database& db = _db;
+         return next_thread().async( [&query,&db]() {
+            graphene::chain::database_lock::read_guard lock( db.get_database_lock() );
+            return query();
+         }, "API query" ).wait();
+      }
+
+      size_t size()const { return _threads.size(); }
+
+   private:
+      fc::thread& next_thread();
+
+      const graphene::chain::database&          _db;
+      std::vector<std::unique_ptr<fc::thread>>  _threads;
+      std::atomic<uint32_t>                     _next_thread{ 0 };
+};
+
+} } // graphene::app
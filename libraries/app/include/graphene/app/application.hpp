@@ -34,6 +34,9 @@ namespace graphene { namespace app {
    using std::string;
 
    class abstract_plugin;
+   class api_response_cache;
+   class api_worker_pool;
+   class subscription_dispatcher;
 
    class application_options
    {
@@ -43,6 +46,13 @@ namespace graphene { namespace app {
          bool has_api_helper_indexes_plugin = false;
          bool has_market_history_plugin = false;
 
+         /// runs read-only database API queries off the thread that applies blocks if set
+         std::shared_ptr<api_worker_pool> api_workers;
+         /// shares the responses of frequent database API queries between connections if set
+         std::shared_ptr<api_response_cache> response_cache;
+         /// notifies the database API connections about changed objects
+         std::shared_ptr<subscription_dispatcher> subscriptions;
+
          uint64_t api_limit_get_account_history_operations = 100;
          uint64_t api_limit_get_account_history = 100;
          uint64_t api_limit_get_grouped_limit_orders = 101;
@@ -75,6 +85,7 @@ namespace graphene { namespace app {
          uint64_t api_limit_get_tickets = 101;
          uint64_t api_limit_get_liquidity_pools = 101;
          uint64_t api_limit_get_liquidity_pool_history = 101;
+         uint64_t api_limit_export_raw_blocks = 1000;
    };
 
    class application
@@ -129,6 +140,8 @@ namespace graphene { namespace app {
 
          net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
+         /// @return the data directory passed to @ref initialize
+         const fc::path& data_dir()const;
          void set_api_limit();
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
@@ -24,7 +24,10 @@
 #pragma once
 
 #include <graphene/app/api_objects.hpp>
+#include <graphene/app/api_response_cache.hpp>
+#include <graphene/app/subscription_dispatcher.hpp>
 
+#include <graphene/protocol/signature_cache.hpp>
 #include <graphene/protocol/types.hpp>
 
 #include <graphene/chain/database.hpp>
@@ -221,6 +224,38 @@ class database_api
        */
       dynamic_global_property_object get_dynamic_global_properties()const;
 
+      /**
+       * @brief Get the memory used by the objects of each index of the object database
+       * @return a list of the memory usage of every index, byte counts are estimates unless @a exact is set
+       */
+      vector<graphene::db::index_memory_usage> get_index_memory_usage()const;
+
+      /**
+       * @brief Get the counters of the cache of public keys recovered from transaction signatures
+       * @return the size and capacity of the cache, and the numbers of cache hits and misses since startup
+       */
+      graphene::protocol::signature_cache_stats get_signature_cache_stats()const;
+
+      /**
+       * @brief Get the counters of the pending transaction pool
+       * @return the number of pending transactions, and how they were handled when restored after new blocks
+       */
+      mempool_stats get_mempool_stats()const;
+
+      /**
+       * @brief Get the counters of the cache of API responses shared between connections
+       * @return the size and capacity of the cache, and how its responses were used and dropped since startup,
+       *         all zero if the cache is disabled
+       */
+      api_response_cache_stats get_response_cache_stats()const;
+
+      /**
+       * @brief Get the counters of the object and market notifications of all connections
+       * @return the numbers of notified connections, serialized objects, and posted and dropped notifications,
+       *         and the numbers of notifications of this connection which are pending and were dropped
+       */
+      subscription_stats get_subscription_stats()const;
+
       //////////
       // Keys //
       //////////
@@ -590,6 +625,18 @@ class database_api
        */
       order_book get_order_book( const string& base, const string& quote, unsigned limit = 50 )const;
 
+      /**
+       * @brief Returns the order book for the market base:quote aggregated into price levels
+       * @param base symbol name or ID of the base asset
+       * @param quote symbol name or ID of the quote asset
+       * @param limit number of price levels to retrieve, for bids and asks each, capped at 50
+       * @return Price levels of the market, best first, with the cumulative amounts and the total depth
+       *
+       * @note This API requires the api_helper_indexes plugin, which maintains the price levels as orders change,
+       *       so the cost of a call does not depend on the depth of the order book.
+       */
+      order_book_depth get_order_book_depth( const string& base, const string& quote, unsigned limit = 50 )const;
+
       /**
        * @brief Returns vector of tickers sorted by reverse base_volume
        * Note: this API is experimental and subject to change in next releases
@@ -1145,6 +1192,11 @@ FC_API(graphene::app::database_api,
    (get_config)
    (get_chain_id)
    (get_dynamic_global_properties)
+   (get_index_memory_usage)
+   (get_signature_cache_stats)
+   (get_mempool_stats)
+   (get_response_cache_stats)
+   (get_subscription_stats)
 
    // Keys
    (get_key_references)
@@ -1178,6 +1230,7 @@ FC_API(graphene::app::database_api,
 
    // Markets / feeds
    (get_order_book)
+   (get_order_book_depth)
    (get_limit_orders)
    (get_limit_orders_by_account)
    (get_account_limit_orders)
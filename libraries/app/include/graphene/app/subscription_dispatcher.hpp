@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+
+#include <fc/signals.hpp>
+#include <fc/variant.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+namespace graphene { namespace app {
+
+   typedef std::pair<graphene::chain::asset_id_type, graphene::chain::asset_id_type> market_type;
+
+   struct subscription_stats
+   {
+      uint64_t sessions = 0;            ///< number of sessions with object or market subscriptions
+      uint64_t serialized_objects = 0;  ///< number of changed objects serialized for notifications
+      uint64_t notifications = 0;       ///< number of notifications posted to sessions
+      uint64_t dropped = 0;             ///< number of notifications dropped because sessions did not keep up
+      uint64_t refused = 0;             ///< number of subscriptions refused because sessions had too many
+      uint64_t session_pending = 0;     ///< notifications of the calling session not delivered yet
+      uint64_t session_dropped = 0;     ///< notifications of the calling session dropped
+      uint64_t session_refused = 0;     ///< subscriptions of the calling session refused
+   };
+
+   /**
+    * @class subscription_dispatcher
+    * @brief Notifies all API sessions about the objects changed by a block
+    *
+    * Subscriptions of all sessions are indexed by object, account and market, so that each changed object is
+    * looked up once, serialized once if any session is interested in it, and the shared payload is posted to the
+    * interested sessions.
+    *
+    * Notifications are delivered asynchronously. A session with too many undelivered notifications, e.g.
+    * because its client reads slowly, does not get new ones until it catches up, and the dropped ones are
+    * counted. Subscriptions beyond the per session limits are refused and counted as well.
+    */
+   class subscription_dispatcher
+   {
+      public:
+         static constexpr uint32_t default_max_pending_notifications = 1000;
+         static constexpr uint32_t default_max_items_per_session = 10000;
+         /// maximum number of accounts a session can subscribe to
+         static constexpr size_t max_accounts_per_session = 100;
+
+         typedef std::function<void(const fc::variant&)> callback_type;
+
+         /// The subscriptions of an API session
+         class session : public std::enable_shared_from_this<session>
+         {
+            public:
+               const callback_type& get_object_callback()const { return _object_callback; }
+               bool notifies_remove_create()const { return _notify_remove_create; }
+               const fc::flat_set<graphene::chain::account_id_type>& get_accounts()const { return _accounts; }
+               const std::map<market_type, callback_type>& get_market_callbacks()const { return _market_callbacks; }
+               uint32_t get_pending()const { return _pending; }
+               uint64_t get_dropped()const { return _dropped; }
+               uint64_t get_refused()const { return _refused; }
+
+            private:
+               friend class subscription_dispatcher;
+
+               callback_type                                       _object_callback;
+               bool                                                _notify_remove_create = false;
+               fc::flat_set<graphene::db::object_id_type>          _items;
+               fc::flat_set<graphene::chain::account_id_type>      _accounts;
+               std::map<market_type, callback_type>                _market_callbacks;
+               uint32_t                                            _pending = 0;
+               uint64_t                                            _dropped = 0;
+               uint64_t                                            _refused = 0;
+         };
+
+         /**
+          * @param max_pending_notifications maximum number of undelivered notifications per session
+          * @param max_items_per_session maximum number of objects a session can subscribe to, 0 for no limit
+          */
+         subscription_dispatcher( graphene::chain::database& db,
+                                  uint32_t max_pending_notifications = default_max_pending_notifications,
+                                  uint32_t max_items_per_session = default_max_items_per_session );
+         ~subscription_dispatcher();
+
+         std::shared_ptr<session> open_session();
+         /// drops all subscriptions of the session
+         void close_session( session& s );
+
+         /**
+          * Sets the callback receiving changed objects, and drops all object and account subscriptions
+          * @param notify_remove_create whether to notify about all created and removed objects
+          */
+         void set_object_callback( session& s, callback_type cb, bool notify_remove_create );
+         /// drops all object and account subscriptions, and if requested, the callback and the market subscriptions
+         void cancel_all_subscriptions( session& s, bool reset_callback, bool reset_market_subscriptions );
+
+         /**
+          * Subscribes to changes of an object, ignored without a callback
+          * @return false if the session has a callback but too many subscriptions, the refusal is counted
+          */
+         bool subscribe_to_item( session& s, const graphene::db::object_id_type& id );
+         /// subscribes to changes of all objects relevant to an account, ignored or refused like @ref subscribe_to_item
+         bool subscribe_to_account( session& s, graphene::chain::account_id_type account );
+
+         void subscribe_to_market( session& s, const market_type& market, callback_type cb );
+         void unsubscribe_from_market( session& s, const market_type& market );
+
+         /// @return the counters of all sessions, and the pending and dropped notifications of s
+         subscription_stats get_stats( const session& s )const;
+
+      private:
+         void handle_object_changed( bool new_or_removed,
+                                     bool full_object,
+                                     const std::vector<graphene::db::object_id_type>& ids,
+                                     const fc::flat_set<graphene::chain::account_id_type>& impacted_accounts,
+                                     const std::function<const graphene::db::object*(graphene::db::object_id_type id)>&
+                                        find_object );
+         /// @return the market of an order object, or nothing if obj is no order
+         fc::optional<market_type> get_order_market( const graphene::db::object& obj )const;
+         /// calls deliver asynchronously unless the session has too many notifications pending
+         void post( session& s, std::function<void(session&)> deliver );
+         void drop_object_subscriptions( session& s );
+         void update_session_count( session& s );
+
+         graphene::chain::database&                                          _db;
+         const uint32_t                                                      _max_pending;
+         const uint32_t                                                      _max_items;
+         std::unordered_map<uint64_t, fc::flat_set<session*>>                _sessions_by_item;
+         std::map<graphene::chain::account_id_type, fc::flat_set<session*>>  _sessions_by_account;
+         std::map<market_type, fc::flat_set<session*>>                       _sessions_by_market;
+         fc::flat_set<session*>                                              _remove_create_sessions;
+         fc::flat_set<session*>                                              _sessions_with_subscriptions;
+         subscription_stats                                                  _stats;
+
+         boost::signals2::scoped_connection                                  _new_connection;
+         boost::signals2::scoped_connection                                  _change_connection;
+         boost::signals2::scoped_connection                                  _removed_connection;
+   };
+
+} } // graphene::app
+
+FC_REFLECT( graphene::app::subscription_stats,
+            (sessions)(serialized_objects)(notifications)(dropped)(refused)
+            (session_pending)(session_dropped)(session_refused) )
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/subscription_dispatcher.hpp>
+
+#include <graphene/chain/market_object.hpp>
+
+#include <fc/thread/thread.hpp>
+
+namespace graphene { namespace app {
+
+using graphene::chain::account_id_type;
+using graphene::db::object;
+using graphene::db::object_id_type;
+using fc::flat_set;
+using fc::optional;
+using std::vector;
+
+subscription_dispatcher::subscription_dispatcher( graphene::chain::database& db, uint32_t max_pending_notifications,
+                                                  uint32_t max_items_per_session )
+   : _db( db ), _max_pending( max_pending_notifications ), _max_items( max_items_per_session )
+{
+   _new_connection = _db.new_objects.connect( [this]( const vector<object_id_type>& ids,
+                                                      const flat_set<account_id_type>& impacted_accounts ) {
+      handle_object_changed( true, true, ids, impacted_accounts,
+                             std::bind( &graphene::db::object_database::find_object, &_db, std::placeholders::_1 ) );
+   });
+   _change_connection = _db.changed_objects.connect( [this]( const vector<object_id_type>& ids,
+                                                             const flat_set<account_id_type>& impacted_accounts ) {
+      handle_object_changed( false, true, ids, impacted_accounts,
+                             std::bind( &graphene::db::object_database::find_object, &_db, std::placeholders::_1 ) );
+   });
+   _removed_connection = _db.removed_objects.connect( [this]( const vector<object_id_type>& ids,
+                                                              const vector<const object*>& objs,
+                                                              const flat_set<account_id_type>& impacted_accounts ) {
+      handle_object_changed( true, false, ids, impacted_accounts, [&objs]( object_id_type id ) -> const object* {
+         auto it = std::find_if( objs.begin(), objs.end(),
+                                 [id]( const object* o ) { return o != nullptr && o->id == id; } );
+         return it != objs.end() ? *it : nullptr;
+      });
+   });
+}
+
+subscription_dispatcher::~subscription_dispatcher() {}
+
+std::shared_ptr<subscription_dispatcher::session> subscription_dispatcher::open_session()
+{
+   return std::make_shared<session>();
+}
+
+void subscription_dispatcher::close_session( session& s )
+{
+   cancel_all_subscriptions( s, true, true );
+}
+
+void subscription_dispatcher::set_object_callback( session& s, callback_type cb, bool notify_remove_create )
+{
+   cancel_all_subscriptions( s, false, false );
+   s._object_callback = std::move( cb );
+   s._notify_remove_create = notify_remove_create && s._object_callback;
+   if( s._notify_remove_create )
+      _remove_create_sessions.insert( &s );
+   update_session_count( s );
+}
+
+void subscription_dispatcher::cancel_all_subscriptions( session& s, bool reset_callback,
+                                                        bool reset_market_subscriptions )
+{
+   drop_object_subscriptions( s );
+   if( reset_callback )
+      s._object_callback = callback_type();
+   if( reset_market_subscriptions )
+   {
+      for( const auto& market : s._market_callbacks )
+      {
+         auto itr = _sessions_by_market.find( market.first );
+         itr->second.erase( &s );
+         if( itr->second.empty() )
+            _sessions_by_market.erase( itr );
+      }
+      s._market_callbacks.clear();
+   }
+   update_session_count( s );
+}
+
+void subscription_dispatcher::drop_object_subscriptions( session& s )
+{
+   for( const auto& id : s._items )
+   {
+      auto itr = _sessions_by_item.find( id.number );
+      itr->second.erase( &s );
+      if( itr->second.empty() )
+         _sessions_by_item.erase( itr );
+   }
+   s._items.clear();
+   for( const auto& account : s._accounts )
+   {
+      auto itr = _sessions_by_account.find( account );
+      itr->second.erase( &s );
+      if( itr->second.empty() )
+         _sessions_by_account.erase( itr );
+   }
+   s._accounts.clear();
+   _remove_create_sessions.erase( &s );
+   s._notify_remove_create = false;
+}
+
+void subscription_dispatcher::update_session_count( session& s )
+{
+   if( s._object_callback || !s._market_callbacks.empty() )
+      _sessions_with_subscriptions.insert( &s );
+   else
+      _sessions_with_subscriptions.erase( &s );
+   _stats.sessions = _sessions_with_subscriptions.size();
+}
+
+bool subscription_dispatcher::subscribe_to_item( session& s, const object_id_type& id )
+{
+   if( !s._object_callback )
+      return true;
+   if( _max_items > 0 && s._items.size() >= _max_items && s._items.find( id ) == s._items.end() )
+   {
+      ++s._refused;
+      ++_stats.refused;
+      return false;
+   }
+   if( s._items.insert( id ).second )
+      _sessions_by_item[ id.number ].insert( &s );
+   return true;
+}
+
+bool subscription_dispatcher::subscribe_to_account( session& s, account_id_type account )
+{
+   if( !s._object_callback )
+      return true;
+   if( s._accounts.size() >= max_accounts_per_session && s._accounts.find( account ) == s._accounts.end() )
+   {
+      ++s._refused;
+      ++_stats.refused;
+      return false;
+   }
+   if( s._accounts.insert( account ).second )
+      _sessions_by_account[ account ].insert( &s );
+   return true;
+}
+
+void subscription_dispatcher::subscribe_to_market( session& s, const market_type& market, callback_type cb )
+{
+   s._market_callbacks[ market ] = std::move( cb );
+   _sessions_by_market[ market ].insert( &s );
+   update_session_count( s );
+}
+
+void subscription_dispatcher::unsubscribe_from_market( session& s, const market_type& market )
+{
+   if( s._market_callbacks.erase( market ) > 0 )
+   {
+      auto itr = _sessions_by_market.find( market );
+      itr->second.erase( &s );
+      if( itr->second.empty() )
+         _sessions_by_market.erase( itr );
+   }
+   update_session_count( s );
+}
+
+subscription_stats subscription_dispatcher::get_stats( const session& s )const
+{
+   subscription_stats result = _stats;
+   result.session_pending = s._pending;
+   result.session_dropped = s._dropped;
+   result.session_refused = s._refused;
+   return result;
+}
+
+optional<market_type> subscription_dispatcher::get_order_market( const object& obj )const
+{
+   using namespace graphene::chain;
+   if( obj.id.is<limit_order_id_type>() )
+      return static_cast<const limit_order_object&>( obj ).get_market();
+   if( obj.id.is<call_order_id_type>() )
+      return static_cast<const call_order_object&>( obj ).get_market();
+   if( obj.id.is<force_settlement_id_type>() )
+   {
+      const auto& order = static_cast<const force_settlement_object&>( obj );
+      // TODO cache the result to avoid repeatly fetching from db
+      asset_id_type backing_id = order.balance.asset_id( _db ).bitasset_data( _db ).options.short_backing_asset;
+      auto tmp = std::make_pair( order.balance.asset_id, backing_id );
+      if( tmp.first > tmp.second ) std::swap( tmp.first, tmp.second );
+      return tmp;
+   }
+   return optional<market_type>();
+}
+
+void subscription_dispatcher::handle_object_changed( bool new_or_removed,
+                                                     bool full_object,
+                                                     const vector<object_id_type>& ids,
+                                                     const flat_set<account_id_type>& impacted_accounts,
+                                                     const std::function<const object*(object_id_type id)>& find_object )
+{
+   if( _sessions_with_subscriptions.empty() )
+      return;
+
+   // sessions following any of the impacted accounts are notified about all objects
+   flat_set<session*> account_sessions;
+   for( const auto& account : impacted_accounts )
+   {
+      auto itr = _sessions_by_account.find( account );
+      if( itr != _sessions_by_account.end() )
+         account_sessions.insert( itr->second.begin(), itr->second.end() );
+   }
+
+   std::map<session*, vector<fc::variant>> updates;
+   std::map<session*, std::map<market_type, vector<fc::variant>>> market_updates;
+   for( const auto& id : ids )
+   {
+      flat_set<session*> interested( account_sessions );
+      if( new_or_removed )
+         interested.insert( _remove_create_sessions.begin(), _remove_create_sessions.end() );
+      auto item_itr = _sessions_by_item.find( id.number );
+      if( item_itr != _sessions_by_item.end() )
+         interested.insert( item_itr->second.begin(), item_itr->second.end() );
+
+      const object* obj = nullptr;
+      optional<market_type> market;
+      const flat_set<session*>* market_sessions = nullptr;
+      if( !_sessions_by_market.empty() && ( id.is<graphene::chain::limit_order_id_type>()
+                                            || id.is<graphene::chain::call_order_id_type>()
+                                            || id.is<graphene::chain::force_settlement_id_type>() ) )
+      {
+         obj = find_object( id );
+         if( obj != nullptr )
+            market = get_order_market( *obj );
+         if( market.valid() )
+         {
+            auto market_itr = _sessions_by_market.find( *market );
+            if( market_itr != _sessions_by_market.end() )
+               market_sessions = &market_itr->second;
+         }
+      }
+      if( interested.empty() && market_sessions == nullptr )
+         continue;
+
+      // the payload is shared by all sessions
+      fc::variant payload;
+      if( full_object )
+      {
+         if( obj == nullptr )
+            obj = find_object( id );
+         if( obj == nullptr )
+            interested.clear();
+         else
+         {
+            payload = obj->to_variant();
+            ++_stats.serialized_objects;
+         }
+      }
+      else
+         payload = fc::variant( id, 1 );
+
+      for( session* s : interested )
+         updates[s].push_back( payload );
+      if( market_sessions != nullptr )
+         for( session* s : *market_sessions )
+            market_updates[s][*market].push_back( payload );
+   }
+
+   for( auto& update : updates )
+   {
+      post( *update.first, [payload = std::move( update.second )]( session& s ) {
+         if( s._object_callback )
+            s._object_callback( fc::variant( payload ) );
+      });
+   }
+   for( auto& update : market_updates )
+   {
+      post( *update.first, [queue = std::move( update.second )]( session& s ) {
+         for( const auto& item : queue )
+         {
+            auto sub = s._market_callbacks.find( item.first );
+            if( sub != s._market_callbacks.end() )
+               sub->second( fc::variant( item.second ) );
+         }
+      });
+   }
+}
+
+void subscription_dispatcher::post( session& s, std::function<void(session&)> deliver )
+{
+   if( s._pending >= _max_pending )
+   {
+      ++s._dropped;
+      ++_stats.dropped;
+      return;
+   }
+   ++s._pending;
+   ++_stats.notifications;
+   // keeps the session alive until the notification is delivered
+   fc::async( [capture_session = s.shared_from_this(), deliver = std::move( deliver )]() {
+      session& target = *capture_session;
+      try
+      {
+         deliver( target );
+      }
+      catch( ... )
+      {
+         --target._pending;
+         throw;
+      }
+      --target._pending;
+   }, "subscription notification" );
+}
+
+} } // graphene::app
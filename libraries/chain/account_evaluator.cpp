@@ -218,7 +218,10 @@ object_id_type account_create_evaluator::do_apply( const account_create_operatio
          && global_properties.parameters.account_fee_scale_bitshifts != 0 )
    {
       d.modify(global_properties, [](global_property_object& p) {
-         p.parameters.get_mutable_fees().get<account_create_operation>().basic_fee <<= p.parameters.account_fee_scale_bitshifts;
+         fee_schedule& fees = p.parameters.get_mutable_fees();
+         auto account_create_fees = fees.get<account_create_operation>();
+         account_create_fees.basic_fee <<= p.parameters.account_fee_scale_bitshifts;
+         fees.set_parameters( account_create_fees );
       });
    }
 
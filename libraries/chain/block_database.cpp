@@ -50,15 +50,18 @@ void block_database::open( const fc::path& dbdir )
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
    _index_filename = dbdir / "index";
+   _blocks_filename = dbdir / "blocks";
+   _last_read_pos = 0;
+   _blocks_readable_size = 0;
    if( !fc::exists( _index_filename ) )
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
    }
    else
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
    }
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
@@ -69,6 +72,7 @@ bool block_database::is_open()const
 
 void block_database::close()
 {
+  unmap_blocks();
   _blocks.close();
   _block_num_to_pos.close();
 }
@@ -149,28 +153,70 @@ block_id_type block_database::fetch_block_id( uint32_t block_num )const
    return e.block_id;
 }
 
-optional<signed_block> block_database::fetch_optional( const block_id_type& id )const
+void block_database::unmap_blocks()const
 {
-   try
+   _blocks_region.reset();
+   _blocks_mapping.reset();
+}
+
+const char* block_database::map_block_data( const index_entry& e )const
+{
+   const uint64_t end_pos = e.block_pos.value() + e.block_size.value();
+   if( _blocks_readable_size < end_pos )
    {
-      index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
-         return {};
+      // blocks are only ever appended, so previously mapped data stays valid once it has been written
+      _blocks.flush();
+      _blocks_readable_size = fc::file_size( _blocks_filename );
+      FC_ASSERT( _blocks_readable_size >= end_pos, "Block data exceeds the blocks file (maybe corrupt on disk?)",
+                 ("end",end_pos)("size",_blocks_readable_size) );
+   }
+   if( !_blocks_region || _blocks_region->get_size() < end_pos )
+   {
+      // Grow the mapping geometrically, so that reading the blocks appended meanwhile does not remap the whole
+      // file each time. Pages past the end of the file are only read after the blocks in them have been written.
+      uint64_t map_size = _blocks_readable_size;
+#ifndef _WIN32
+      if( _blocks_region )
+         map_size = std::max<uint64_t>( map_size, 2 * _blocks_region->get_size() );
+#endif
+      unmap_blocks();
+      _blocks_mapping = std::make_unique<fc::file_mapping>( _blocks_filename.generic_string().c_str(), fc::read_only );
+      _blocks_region = std::make_unique<fc::mapped_region>( *_blocks_mapping, fc::read_only, 0, map_size );
+   }
+   _last_read_pos = end_pos;
+   return (const char*)_blocks_region->get_address() + e.block_pos.value();
+}
 
-      _block_num_to_pos.seekg( index_pos );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+signed_block block_database::unpack_block( const index_entry& e )const
+{
+   FC_ASSERT( e.block_size.value() > 0, "Block ${id} has been removed", ("id",e.block_id) );
+   fc::datastream<const char*> ds( map_block_data( e ), e.block_size.value() );
+   signed_block result;
+   fc::raw::unpack( ds, result );
+   FC_ASSERT( result.id() == e.block_id );
+   return result;
+}
 
-      if( e.block_id != id ) return optional<signed_block>();
+optional<index_entry> block_database::fetch_index_entry( uint32_t block_num )const
+{
+   index_entry e;
+   int64_t index_pos = sizeof(e) * int64_t(block_num);
+   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+   if ( _block_num_to_pos.tellg() <= index_pos )
+      return {};
+
+   _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
+   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   return e;
+}
 
-      vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      if (e.block_size.value())
-         _blocks.read( data.data(), e.block_size.value() );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+optional<signed_block> block_database::fetch_optional( const block_id_type& id )const
+{
+   try
+   {
+      optional<index_entry> e = fetch_index_entry( block_header::num_from_id(id) );
+      if( !e.valid() || e->block_id != id ) return optional<signed_block>();
+      return unpack_block( *e );
    }
    catch (const fc::exception&)
    {
@@ -185,21 +231,9 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
 {
    try
    {
-      index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_num);
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
-         return {};
-
-      _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
-      vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      _blocks.read( data.data(), e.block_size.value() );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      optional<index_entry> e = fetch_index_entry( block_num );
+      if( !e.valid() ) return optional<signed_block>();
+      return unpack_block( *e );
    }
    catch (const fc::exception&)
    {
@@ -210,6 +244,79 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    return optional<signed_block>();
 }
 
+optional<vector<char>> block_database::fetch_raw_optional( const block_id_type& id )const
+{
+   try
+   {
+      optional<index_entry> e = fetch_index_entry( block_header::num_from_id(id) );
+      if( !e.valid() || e->block_id != id || e->block_size.value() == 0 ) return optional<vector<char>>();
+      const char* data = map_block_data( *e );
+      return vector<char>( data, data + e->block_size.value() );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<vector<char>>();
+}
+
+optional<vector<char>> block_database::fetch_raw_by_number( uint32_t block_num )const
+{
+   try
+   {
+      optional<index_entry> e = fetch_index_entry( block_num );
+      if( !e.valid() || e->block_size.value() == 0 ) return optional<vector<char>>();
+      const char* data = map_block_data( *e );
+      return vector<char>( data, data + e->block_size.value() );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<vector<char>>();
+}
+
+uint32_t block_database::visit_raw_blocks( uint32_t first_block_num, uint32_t last_block_num,
+                                          const std::function<bool( uint32_t, const char*, size_t )>& visit )const
+{
+   if( first_block_num == 0 || last_block_num < first_block_num )
+      return 0;
+
+   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+   const uint64_t index_size = _block_num_to_pos.tellg();
+   const uint64_t stored_entries = index_size / sizeof(index_entry);
+   if( stored_entries <= first_block_num )
+      return 0;
+   last_block_num = uint32_t( std::min<uint64_t>( last_block_num, stored_entries - 1 ) );
+
+   // read the index entries in chunks instead of seeking for every block
+   const uint32_t chunk_entries = 1024;
+   vector<index_entry> entries;
+   uint32_t visited = 0;
+   uint32_t block_num = first_block_num;
+   while( block_num <= last_block_num )
+   {
+      const uint32_t count = std::min<uint32_t>( chunk_entries, last_block_num - block_num + 1 );
+      entries.resize( count );
+      _block_num_to_pos.seekg( sizeof(index_entry) * int64_t(block_num), _block_num_to_pos.beg );
+      _block_num_to_pos.read( (char*)entries.data(), sizeof(index_entry) * count );
+      for( const index_entry& e : entries )
+      {
+         if( e.block_size.value() == 0 )
+            return visited;
+         ++visited;
+         if( !visit( block_num, map_block_data( e ), e.block_size.value() ) )
+            return visited;
+         ++block_num;
+      }
+   }
+   return visited;
+}
+
 optional<index_entry> block_database::last_index_entry()const {
    try
    {
@@ -277,7 +384,7 @@ optional<block_id_type> block_database::last_id()const
 
 size_t block_database::blocks_current_position()const
 {
-   return (size_t)_blocks.tellg();
+   return _last_read_pos;
 }
 
 size_t block_database::total_block_size()const
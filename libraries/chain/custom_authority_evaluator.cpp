@@ -162,9 +162,6 @@ void_result custom_authority_update_evaluator::do_apply(const custom_authority_u
       std::for_each(op.restrictions_to_add.begin(), op.restrictions_to_add.end(), [&obj](const auto& r) mutable {
          obj.restrictions.insert(std::make_pair(obj.restriction_counter++, r));
       });
-
-      // Clear the predicate cache
-      obj.clear_predicate_cache();
    });
 
    return void_result();
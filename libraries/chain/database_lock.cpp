@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/database_lock.hpp>
+
+#include <fc/thread/thread_specific.hpp>
+
+namespace graphene { namespace chain {
+
+/// @return an address which identifies the calling fiber, i.e. the running fc task or the context of the thread
+static const void* current_fiber()
+{
+   static fc::task_specific_ptr<char> marker;
+   if( marker.get() == nullptr )
+      marker.reset( new char() );
+   return marker.get();
+}
+
+void database_lock::lock_read()
+{
+   std::unique_lock<std::mutex> lock( _mutex );
+   _change_done.wait( lock, [this]() { return !_write_pending; } );
+   ++_readers;
+}
+
+void database_lock::unlock_read()
+{
+   fc::promise<void>::ptr readers_done;
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( --_readers == 0 )
+         readers_done = std::move( _readers_done );
+   }
+   if( readers_done )
+      readers_done->set_value();
+}
+
+void database_lock::lock_write()
+{
+   const void* fiber = current_fiber();
+   if( _writer == fiber )
+   {
+      ++_write_depth;
+      return;
+   }
+
+   // another fiber of this thread is changing the database
+   while( _writer != nullptr )
+   {
+      if( !_write_released )
+         _write_released = fc::promise<void>::create( "database_write_released" );
+      fc::promise<void>::ptr released = _write_released;
+      released->wait();
+   }
+   _writer = fiber;
+   _write_depth = 1;
+
+   try
+   {
+      fc::promise<void>::ptr readers_done;
+      {
+         std::lock_guard<std::mutex> lock( _mutex );
+         _write_pending = true;
+         if( _readers > 0 )
+         {
+            readers_done = fc::promise<void>::create( "database_readers_done" );
+            _readers_done = readers_done;
+         }
+      }
+      if( readers_done )
+         readers_done->wait();
+   }
+   catch( ... )
+   {
+      unlock_write();
+      throw;
+   }
+}
+
+void database_lock::unlock_write()
+{
+   if( --_write_depth > 0 )
+      return;
+   _writer = nullptr;
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _write_pending = false;
+      _readers_done.reset();
+   }
+   _change_done.notify_all();
+   if( _write_released )
+   {
+      fc::promise<void>::ptr released = std::move( _write_released );
+      released->set_value();
+   }
+}
+
+} } // graphene::chain
@@ -27,6 +27,7 @@
 #include <graphene/chain/hardfork.hpp>
 
 #include <graphene/chain/block_summary_object.hpp>
+#include <graphene/chain/custom_authority_object.hpp>
 #include <graphene/chain/global_property_object.hpp>
 #include <graphene/chain/operation_history_object.hpp>
 
@@ -41,6 +42,7 @@
 
 #include <fc/io/raw.hpp>
 #include <fc/thread/parallel.hpp>
+#include <fc/uint128.hpp>
 
 namespace graphene { namespace chain {
 
@@ -72,6 +74,20 @@ optional<signed_block> database::fetch_block_by_id( const block_id_type& id )con
    return b->data;
 }
 
+optional<vector<char>> database::fetch_raw_block_by_id( const block_id_type& id )const
+{
+   auto b = _fork_db.fetch_block( id );
+   if( !b )
+      return _block_id_to_block.fetch_raw_optional(id);
+   return fc::raw::pack( b->data );
+}
+
+uint32_t database::visit_raw_blocks( uint32_t first_block_num, uint32_t last_block_num,
+                                    const std::function<bool( uint32_t, const char*, size_t )>& visit )const
+{
+   return _block_id_to_block.visit_raw_blocks( first_block_num, last_block_num, visit );
+}
+
 optional<signed_block> database::fetch_block_by_number( uint32_t num )const
 {
    auto results = _fork_db.fetch_block_by_number(num);
@@ -116,6 +132,7 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
 //   idump((new_block.block_num())(new_block.id())(new_block.timestamp)(new_block.previous));
+   database_lock::write_guard write_lock( _database_lock );
    bool result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -266,17 +283,35 @@ void database::update_witnesses( fork_item& fork_entry )const
  */
 processed_transaction database::push_transaction( const precomputable_transaction& trx, uint32_t skip )
 { try {
+   database_lock::write_guard write_lock( _database_lock );
    // see https://github.com/bitshares/bitshares-core/issues/1573
-   FC_ASSERT( fc::raw::pack_size( trx ) < (1024 * 1024), "Transaction exceeds maximum transaction size." );
+   const size_t trx_size = fc::raw::pack_size( trx );
+   FC_ASSERT( trx_size < (1024 * 1024), "Transaction exceeds maximum transaction size." );
    processed_transaction result;
    detail::with_skip_flags( *this, skip, [&]()
    {
-      result = _push_transaction( trx );
+      check_pending_transaction_count( trx );
+      result = _push_transaction( trx, true );
    } );
    return result;
 } FC_CAPTURE_AND_RETHROW( (trx) ) }
 
-processed_transaction database::_push_transaction( const precomputable_transaction& trx )
+/// Records the objects looked up by ID while it is in scope
+class read_recorder_guard {
+public:
+   read_recorder_guard( object_database& db, flat_set<object_id_type>& reads )
+      : _db( db ), _previous( db.set_read_recorder( &reads ) )
+   {}
+   ~read_recorder_guard()
+   {
+      _db.set_read_recorder( _previous );
+   }
+private:
+   object_database& _db;
+   flat_set<object_id_type>* const _previous;
+};
+
+processed_transaction database::_push_transaction( const precomputable_transaction& trx, bool check_limits )
 {
    // If this is the first transaction pushed after applying a block, start a new undo session.
    // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
@@ -289,8 +324,25 @@ processed_transaction database::_push_transaction( const precomputable_transacti
    // apply the changes.
 
    auto temp_session = _undo_db.start_undo_session();
-   auto processed_trx = _apply_transaction( trx );
-   _pending_tx.push_back(processed_trx);
+   flat_set<object_id_type> reads;
+   processed_transaction processed_trx;
+   share_type core_fees_paid;
+   {
+      read_recorder_guard guard( *this, reads );
+      processed_trx = _apply_transaction( trx, &core_fees_paid );
+   }
+   // The transaction is ranked by the fees it was actually charged. Only a transaction which applied successfully
+   // can push out others, and if there is no room for it, it is discarded together with the temporary session.
+   const uint64_t trx_size = fc::raw::pack_size( trx );
+   const auto fee_rate = get_pending_fee_rate( trx, core_fees_paid, trx_size );
+   // the changes are recorded, so that they can be applied again without evaluating the transaction
+   auto effects = get_pending_effects( trx, std::move( reads ) );
+   vector<uint64_t> evicted;
+   if( check_limits )
+      evicted = select_pending_transactions_to_evict( fee_rate.second,
+                                                      mempool::estimate_memory_usage( trx_size, effects.get() ) );
+
+   _pending_tx.push_back( processed_trx, fee_rate.first, fee_rate.second, std::move( effects ) );
 
    // notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
@@ -298,11 +350,15 @@ processed_transaction database::_push_transaction( const precomputable_transacti
 
    // notify anyone listening to pending transactions
    notify_on_pending_transaction( trx );
+
+   if( !evicted.empty() )
+      evict_pending_transactions( evicted );
    return processed_trx;
 }
 
 processed_transaction database::validate_transaction( const signed_transaction& trx )
 {
+   database_lock::write_guard write_lock( _database_lock );
    auto session = _undo_db.start_undo_session();
    return _apply_transaction( trx );
 }
@@ -372,6 +428,7 @@ signed_block database::generate_block(
    uint32_t skip /* = 0 */
    )
 { try {
+   database_lock::write_guard write_lock( _database_lock );
    signed_block result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -407,6 +464,7 @@ signed_block database::_generate_block(
 
    // pop pending state (reset to head block state)
    _pending_tx_session.reset();
+   notify_pending_state_reset();
 
    // Check witness signing key
    if( !(skip & skip_witness_signature) )
@@ -431,9 +489,13 @@ signed_block database::_generate_block(
 
    _pending_tx_session = _undo_db.start_undo_session();
 
-   uint64_t postponed_tx_count = 0;
-   for( const processed_transaction& tx : _pending_tx )
+   // If not all pending transactions fit into the block, the best paying ones are included
+   const vector<const mempool_entry*> selected = _pending_tx.select_best_paying(
+         maximum_block_size > total_block_size ? maximum_block_size - total_block_size : 0 );
+   uint64_t postponed_tx_count = _pending_tx.size() - selected.size();
+   for( const mempool_entry* entry : selected )
    {
+      const processed_transaction& tx = entry->trx;
       size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
 
       // postpone transaction if it would make block too big
@@ -506,7 +568,9 @@ signed_block database::_generate_block(
  */
 void database::pop_block()
 { try {
+   database_lock::write_guard write_lock( _database_lock );
    _pending_tx_session.reset();
+   notify_pending_state_reset();
    auto fork_db_head = _fork_db.head();
    FC_ASSERT( fork_db_head, "Trying to pop() from empty fork database!?" );
    if( fork_db_head->id == head_block_id() )
@@ -522,11 +586,356 @@ void database::pop_block()
 
 void database::clear_pending()
 { try {
+   database_lock::write_guard write_lock( _database_lock );
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
    _pending_tx.clear();
    _pending_tx_session.reset();
+   notify_pending_state_reset();
 } FC_CAPTURE_AND_RETHROW() }
 
+/**
+ * Operations whose evaluation only depends on objects looked up by ID, on the chain parameters and on the
+ * custom authorities of the accounts involved, so that the recorded dependencies of a transaction consisting
+ * of them are complete.
+ */
+static bool is_replayable_pending_operation( const operation& op )
+{
+   return op.is_type<transfer_operation>()
+       || op.is_type<override_transfer_operation>()
+       || op.is_type<limit_order_cancel_operation>()
+       || op.is_type<asset_issue_operation>()
+       || op.is_type<asset_reserve_operation>()
+       || op.is_type<custom_operation>();
+}
+
+std::shared_ptr<const pending_transaction_effects> database::get_pending_effects( const signed_transaction& trx,
+                                                                                  flat_set<object_id_type>&& reads )const
+{
+   if( !_undo_db.enabled() )
+      return nullptr;
+
+   const undo_state& state = _undo_db.head();
+   auto effects = std::make_shared<pending_transaction_effects>();
+   effects->dependencies = std::move( reads );
+
+   state.old_values.for_each_id( [this,&effects]( object_id_type id ) {
+      effects->modified.push_back( get_object( id ).clone() );
+   });
+   vector<object_id_type> created( state.new_ids.begin(), state.new_ids.end() );
+   std::sort( created.begin(), created.end() );
+   effects->created.reserve( created.size() );
+   for( const object_id_type& id : created )
+      effects->created.push_back( get_object( id ).clone() );
+   effects->removed.reserve( state.removed.size() );
+   for( const auto& item : state.removed )
+      effects->removed.push_back( item.first );
+
+   // estimated from the packed sizes of the objects
+   vector<char> buffer;
+   effects->memory_usage = sizeof( pending_transaction_effects )
+                           + effects->removed.size() * sizeof( object_id_type )
+                           + effects->dependencies.size() * sizeof( object_id_type );
+   for( const auto* objects : { &effects->modified, &effects->created } )
+   {
+      for( const auto& obj : *objects )
+      {
+         buffer.clear();
+         obj->pack_to( buffer );
+         effects->memory_usage += sizeof( object ) + buffer.size();
+      }
+   }
+
+   bool writes_dynamic_global_properties = false;
+   effects->for_each_written( [&effects,&writes_dynamic_global_properties]( object_id_type id ) {
+      // the duplicate check entry is created again with a new ID, see apply_pending_effects()
+      if( !id.is<transaction_history_id_type>() )
+         effects->dependencies.insert( id );
+      if( id == dynamic_global_property_id_type() )
+         writes_dynamic_global_properties = true;
+   });
+   // Changed by every block, but transactions only read the head block time from it, to check for
+   // expiration, which is done separately.
+   effects->dependencies.erase( dynamic_global_property_id_type() );
+
+   effects->replayable = !writes_dynamic_global_properties
+                         && std::all_of( trx.operations.begin(), trx.operations.end(),
+                                         is_replayable_pending_operation );
+   // Custom authorities can be used until they expire, which does not change any object
+   if( effects->replayable )
+   {
+      const auto& custom_idx = get_index_type<custom_authority_index>().indices().get<by_account_custom>();
+      for( const object_id_type& id : effects->dependencies )
+      {
+         if( !id.is<account_id_type>() )
+            continue;
+         auto itr = custom_idx.lower_bound( boost::make_tuple( account_id_type( id ) ) );
+         if( itr != custom_idx.end() && itr->account == account_id_type( id ) )
+         {
+            effects->replayable = false;
+            break;
+         }
+      }
+   }
+   return effects;
+}
+
+bool database::apply_pending_effects( const pending_transaction_effects& effects )
+{
+   // Created objects must get the same IDs again, because they may be referenced by other objects and results
+   std::map<std::pair<uint8_t,uint8_t>, object_id_type> next_ids;
+   for( const auto& obj : effects.created )
+   {
+      if( obj->id.is<transaction_history_id_type>() )
+         continue;
+      const auto index_key = std::make_pair( obj->id.space(), obj->id.type() );
+      auto itr = next_ids.find( index_key );
+      if( itr == next_ids.end() )
+         itr = next_ids.emplace( index_key, get_index( obj->id ).get_next_id() ).first;
+      if( itr->second != obj->id )
+         return false;
+      ++itr->second;
+   }
+
+   for( const auto& obj : effects.modified )
+   {
+      const object* current = find_object( obj->id );
+      if( current == nullptr )
+         return false;
+      modify( *current, [&obj]( object& o ) {
+         auto value = obj->clone();
+         o.move_from( *value );
+      });
+   }
+   for( const auto& obj : effects.created )
+   {
+      if( obj->id.is<transaction_history_id_type>() )
+      {
+         const auto& history = static_cast<const transaction_history_object&>( *obj );
+         create<transaction_history_object>( [&history]( transaction_history_object& o ) {
+            o.trx_id = history.trx_id;
+            o.trx = history.trx;
+         });
+         continue;
+      }
+      auto value = obj->clone();
+      insert( std::move( *value ) );
+      get_mutable_index( obj->id ).set_next_id( obj->id + 1 );
+   }
+   for( const object_id_type& id : effects.removed )
+   {
+      const object* current = find_object( id );
+      if( current == nullptr )
+         return false;
+      remove( *current );
+   }
+   return true;
+}
+
+void database::restore_pending_transactions( mempool&& pending, const block_id_type& old_head_block_id )
+{
+   // Objects changed since the pending transactions were evaluated, by the new block or by pending transactions
+   // that are dropped or evaluated again. Recorded changes can only be applied again if a single block was pushed.
+   std::unordered_set<object_id_type> changed;
+   bool incremental = _popped_tx.empty() && _undo_db.enabled() && _undo_db.size() > 0
+                      && head_block_id() != old_head_block_id;
+   if( incremental )
+   {
+      auto head = _fork_db.fetch_block( head_block_id() );
+      incremental = head && head->data.previous == old_head_block_id;
+   }
+   if( incremental )
+   {
+      const undo_state& block_changes = _undo_db.head();
+      block_changes.old_values.for_each_id( [&changed]( object_id_type id ) { changed.insert( id ); } );
+      changed.insert( block_changes.new_ids.begin(), block_changes.new_ids.end() );
+      for( const auto& item : block_changes.removed )
+         changed.insert( item.first );
+      // Changes of the chain parameters, which includes every maintenance, affect all transactions,
+      // and custom authorities are not looked up by ID
+      incremental = ( changed.count( global_property_id_type() ) == 0 )
+                    && std::none_of( changed.begin(), changed.end(), []( const object_id_type& id ) {
+                          return id.is<custom_authority_id_type>();
+                       });
+   }
+   _restore_pending_transactions( std::move( pending ), incremental, std::move( changed ) );
+}
+
+void database::_restore_pending_transactions( mempool&& pending, bool incremental,
+                                              std::unordered_set<object_id_type>&& changed )
+{
+   const auto start_time = fc::time_point::now();
+   ++_mempool_stats.revalidations;
+   if( !incremental )
+      ++_mempool_stats.full_revalidations;
+
+   // the changes of evicted transactions were in the pending state the remaining ones were evaluated on
+   changed.insert( _evicted_pending_writes.begin(), _evicted_pending_writes.end() );
+   _evicted_pending_writes.clear();
+
+   const auto mark_changed = [&changed]( const mempool_entry& entry ) {
+      if( entry.effects )
+         entry.effects->for_each_written( [&changed]( object_id_type id ) { changed.insert( id ); } );
+   };
+
+   for( const auto& tx : _popped_tx )
+   {
+      try {
+         if( !is_known_transaction( tx.id() ) ) {
+            _push_transaction( tx );
+            ++_mempool_stats.reevaluated;
+         }
+      } catch ( const fc::exception& ) { // ignore invalid transactions
+         ++_mempool_stats.evicted;
+      }
+   }
+   _popped_tx.clear();
+
+   pending.remove_expired( head_block_time(), [this,&mark_changed]( const mempool_entry& entry ) {
+      ++_mempool_stats.dropped_expired;
+      mark_changed( entry );
+   });
+
+   for( const mempool_entry& entry : pending.entries() )
+   {
+      if( is_known_transaction( entry.trx_id ) )
+      {
+         ++_mempool_stats.dropped_included;
+         mark_changed( entry );
+         continue;
+      }
+
+      if( incremental && entry.effects && entry.effects->replayable
+            && std::none_of( entry.effects->dependencies.begin(), entry.effects->dependencies.end(),
+                             [&changed]( const object_id_type& id ) { return changed.count( id ) > 0; } ) )
+      {
+         bool replayed = false;
+         try
+         {
+            if( !_pending_tx_session.valid() )
+               _pending_tx_session = _undo_db.start_undo_session();
+            auto temp_session = _undo_db.start_undo_session();
+            if( apply_pending_effects( *entry.effects ) )
+            {
+               temp_session.merge();
+               replayed = true;
+            }
+         }
+         catch( const fc::exception& )
+         { // evaluate it again below
+         }
+         if( replayed )
+         {
+            _pending_tx.push_back( entry.trx, entry.fee_payer, entry.fee_per_kbyte, entry.effects );
+            notify_on_pending_transaction( entry.trx );
+            ++_mempool_stats.replayed;
+            continue;
+         }
+      }
+
+      mark_changed( entry );
+      try
+      {
+         _push_transaction( entry.trx );
+         ++_mempool_stats.reevaluated;
+         mark_changed( *_pending_tx.entries().rbegin() );
+      }
+      catch( const fc::exception& )
+      { // ignore invalid transactions
+         ++_mempool_stats.evicted;
+      }
+   }
+
+   _mempool_stats.last_revalidation_time = ( fc::time_point::now() - start_time ).count();
+   _mempool_stats.total_revalidation_time += _mempool_stats.last_revalidation_time;
+}
+
+mempool_stats database::get_mempool_stats()const
+{
+   mempool_stats result = _mempool_stats;
+   result.size = _pending_tx.size();
+   result.memory_usage = _pending_tx.memory_usage();
+   return result;
+}
+
+struct operation_fee_payer_getter
+{
+   typedef account_id_type result_type;
+   template<typename Op>
+   account_id_type operator()( const Op& op )const { return op.fee_payer(); }
+};
+
+std::pair<account_id_type, uint64_t> database::get_pending_fee_rate( const signed_transaction& trx,
+                                                                     share_type core_fees, uint64_t size )const
+{
+   if( trx.operations.empty() )
+      return std::make_pair( account_id_type(), 0 );
+
+   uint64_t fee_per_kbyte = 0;
+   if( core_fees > 0 && size > 0 )
+   {
+      fc::uint128_t rate = core_fees.value;
+      rate *= 1024;
+      rate /= size;
+      fee_per_kbyte = static_cast<uint64_t>( rate );
+   }
+   return std::make_pair( trx.operations.front().visit( operation_fee_payer_getter() ), fee_per_kbyte );
+}
+
+void database::check_pending_transaction_count( const signed_transaction& trx )
+{
+   if( _mempool_limits.max_per_account == 0 || trx.operations.empty() )
+      return;
+
+   const account_id_type fee_payer = trx.operations.front().visit( operation_fee_payer_getter() );
+   if( _pending_tx.count( fee_payer ) >= _mempool_limits.max_per_account )
+   {
+      ++_mempool_stats.rejected;
+      FC_THROW( "Account ${a} already has ${n} pending transactions",
+                ("a", fee_payer)("n", _mempool_limits.max_per_account) );
+   }
+}
+
+vector<uint64_t> database::select_pending_transactions_to_evict( uint64_t fee_per_kbyte, uint64_t memory_usage )
+{
+   vector<uint64_t> evicted;
+   const uint64_t new_memory = memory_usage;
+   if( _mempool_limits.max_memory == 0 || _pending_tx.memory_usage() + new_memory <= _mempool_limits.max_memory )
+      return evicted;
+
+   const uint64_t target = _mempool_limits.max_memory > new_memory ? _mempool_limits.max_memory - new_memory : 0;
+   uint64_t remaining = _pending_tx.memory_usage();
+   for( const mempool_entry& entry : _pending_tx.entries_by_fee_rate() )
+   {
+      if( remaining <= target || entry.fee_per_kbyte >= fee_per_kbyte )
+         break;
+      remaining -= entry.memory_usage;
+      evicted.push_back( entry.sequence );
+   }
+   if( remaining + new_memory > _mempool_limits.max_memory )
+   {
+      ++_mempool_stats.rejected;
+      FC_THROW( "Pending transactions are using the maximum memory of ${m} bytes, "
+                "and the fee of the transaction is too low to replace any of them",
+                ("m", _mempool_limits.max_memory) );
+   }
+   return evicted;
+}
+
+void database::evict_pending_transactions( const vector<uint64_t>& evicted )
+{
+   // Rebuilding the pending state for every transaction that pushes out others would evaluate all pending
+   // transactions again and again while the pool is full. The evicted ones are only dropped from the pool, and
+   // the pending state is rebuilt without them in one go with the next block.
+   for( uint64_t sequence : evicted )
+   {
+      const mempool_entry& entry = *_pending_tx.entries().find( sequence );
+      if( entry.effects )
+         entry.effects->for_each_written( [this]( object_id_type id ) { _evicted_pending_writes.insert( id ); } );
+      _pending_tx.remove( sequence );
+      ++_mempool_stats.evicted_low_fee;
+   }
+}
+
 uint32_t database::push_applied_operation( const operation& op )
 {
    _applied_ops.emplace_back(op);
@@ -676,7 +1085,7 @@ processed_transaction database::apply_transaction(const signed_transaction& trx,
    return result;
 }
 
-processed_transaction database::_apply_transaction(const signed_transaction& trx)
+processed_transaction database::_apply_transaction(const signed_transaction& trx, share_type* core_fees_paid)
 { try {
    uint32_t skip = get_node_properties().skip_flags;
 
@@ -753,6 +1162,8 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
       ++_current_op_in_trx;
    }
    ptrx.operation_results = std::move(eval_state.operation_results);
+   if( core_fees_paid != nullptr )
+      *core_fees_paid = eval_state.core_fees_paid;
 
    return ptrx;
 } FC_CAPTURE_AND_RETHROW( (trx) ) }
@@ -48,6 +48,8 @@
 #include <graphene/chain/worker_object.hpp>
 #include <graphene/chain/custom_authority_object.hpp>
 
+#include <graphene/db/parallel_for.hpp>
+
 namespace graphene { namespace chain {
 
 template<class Index>
@@ -75,7 +77,7 @@ vector<std::reference_wrapper<const typename Index::object_type>> database::sort
 }
 
 template<class Type>
-void database::perform_account_maintenance(Type tally_helper)
+void database::perform_account_maintenance(Type& tally_helper)
 {
    const auto& bal_idx = get_index_type< account_balance_index >().indices().get< by_maintenance_flag >();
    if( bal_idx.begin() != bal_idx.end() )
@@ -100,19 +102,34 @@ void database::perform_account_maintenance(Type tally_helper)
    const auto& stats_idx = get_index_type< account_stats_index >().indices().get< by_maintenance_seq >();
    auto stats_itr = stats_idx.lower_bound( true );
 
-   while( stats_itr != stats_idx.end() )
+   if( !tally_helper.can_tally_in_parallel() )
    {
-      const account_statistics_object& acc_stat = *stats_itr;
-      const account_object& acc_obj = acc_stat.owner( *this );
-      ++stats_itr;
+      while( stats_itr != stats_idx.end() )
+      {
+         const account_statistics_object& acc_stat = *stats_itr;
+         const account_object& acc_obj = acc_stat.owner( *this );
+         ++stats_itr;
 
-      if( acc_stat.has_some_core_voting() )
-         tally_helper( acc_obj, acc_stat );
+         if( acc_stat.has_some_core_voting() )
+            tally_helper( acc_obj, acc_stat );
 
-      if( acc_stat.has_pending_fees() )
-         acc_stat.process_fees( acc_obj, *this );
+         if( acc_stat.has_pending_fees() )
+            acc_stat.process_fees( acc_obj, *this );
+      }
+      return;
    }
 
+   // Counting votes only reads the database, so it is done for all accounts at once in parallel,
+   // and processing fees, which writes, follows in a separate pass in the same order.
+   vector<std::pair<const account_object*, const account_statistics_object*>> accounts;
+   for( ; stats_itr != stats_idx.end(); ++stats_itr )
+      accounts.emplace_back( &stats_itr->owner( *this ), &*stats_itr );
+
+   tally_helper.tally_in_parallel( accounts );
+
+   for( const auto& account : accounts )
+      if( account.second->has_pending_fees() )
+         account.second->process_fees( *account.first, *this );
 }
 
 /// @brief A visitor for @ref worker_type which calls pay_worker on the worker within
@@ -1194,6 +1211,38 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
    create_buyback_orders(*this);
 
    struct vote_tally_helper {
+      /// What the stake of one account contributes to the tally
+      struct account_votes
+      {
+         const account_object*           opinion_account = nullptr;
+         const account_statistics_object* opinion_account_stats = nullptr;
+         uint64_t voting_stake[3]; // 0=committee, 1=witness, 2=worker, as in vote_id_type::vote_type
+         uint64_t num_committee_voting_stake; // number of committee members
+         uint64_t vp_all;
+         uint64_t vp_active;
+         uint64_t vp_committee;
+         uint64_t vp_witness;
+         uint64_t vp_worker;
+      };
+
+      /// Vote counters, filled by one thread each and summed up afterwards
+      struct tally_buffers
+      {
+         vector<uint64_t> vote_tally;
+         vector<uint64_t> witness_count_histogram;
+         vector<uint64_t> committee_count_histogram;
+         uint64_t         total_voting_stake[2] = { 0, 0 }; // 0=committee, 1=witness
+      };
+
+      /// Accounts counted by one task of the parallel tally, and the votes of those that count
+      struct tally_chunk
+      {
+         tally_buffers          buffers;
+         vector<account_votes>  votes;
+      };
+
+      static constexpr size_t parallel_chunk_size = 10000;
+
       database& d;
       const global_property_object& props;
       const dynamic_global_property_object& dprops;
@@ -1207,17 +1256,15 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
       optional<detail::vote_recalc_times> worker_recalc_times;
       optional<detail::vote_recalc_times> delegator_recalc_times;
 
+      tally_buffers serial_buffers;
+
       vote_tally_helper( database& db )
          : d(db), props( d.get_global_properties() ), dprops( d.get_dynamic_global_properties() ), 
            now( d.head_block_time() ), hf2103_passed( HARDFORK_CORE_2103_PASSED( now ) ),
            hf2262_passed( HARDFORK_CORE_2262_PASSED( now ) ),
            pob_activated( dprops.total_pob > 0 || dprops.total_inactive > 0 )
       {
-         d._vote_tally_buffer.resize( props.next_available_vote_id, 0 );
-         d._witness_count_histogram_buffer.resize( props.parameters.maximum_witness_count / 2 + 1, 0 );
-         d._committee_count_histogram_buffer.resize( props.parameters.maximum_committee_count / 2 + 1, 0 );
-         d._total_voting_stake[0] = 0;
-         d._total_voting_stake[1] = 0;
+         init_buffers( serial_buffers );
          if( hf2103_passed )
          {
             witness_recalc_times   = detail::vote_recalc_options::witness().get_vote_recalc_times( now );
@@ -1227,11 +1274,102 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
          }
       }
 
+      void init_buffers( tally_buffers& buffers )const
+      {
+         buffers.vote_tally.resize( props.next_available_vote_id, 0 );
+         buffers.witness_count_histogram.resize( props.parameters.maximum_witness_count / 2 + 1, 0 );
+         buffers.committee_count_histogram.resize( props.parameters.maximum_committee_count / 2 + 1, 0 );
+      }
+
+      /**
+       * Before core-2262 the tally of an account depends on the cashback paid out to it by the accounts processed
+       * before it, so accounts have to be counted one by one, interleaved with processing their fees.
+       * Since then counting votes only reads the state, and the only effect of processing fees on the tally
+       * is that accounts receiving their first cashback are added to the accounts to process, without any
+       * voting stake to count.
+       */
+      bool can_tally_in_parallel()const
+      {
+         return hf2262_passed && d.get_vote_tally_threads() != 1;
+      }
+
+      /// Serial tally, counts the votes of one account and updates its voting power
       void operator()( const account_object& stake_account, const account_statistics_object& stats )
+      {
+         account_votes votes;
+         if( !get_votes( stake_account, stats, votes ) )
+            return;
+         count_votes( votes, serial_buffers );
+         update_voting_power( votes );
+      }
+
+      /**
+       * Counts the votes of the accounts in parallel, then updates their voting power in the given order.
+       * The calling thread blocks without yielding to its other fibers until all votes are counted, so the
+       * database does not change meanwhile.
+       */
+      void tally_in_parallel( const vector<std::pair<const account_object*, const account_statistics_object*>>& accounts )
+      {
+         const size_t num_chunks = ( accounts.size() + parallel_chunk_size - 1 ) / parallel_chunk_size;
+         vector<tally_chunk> chunks( num_chunks );
+         graphene::db::parallel_for( num_chunks, [this,&accounts,&chunks] ( size_t i ) {
+            tally_chunk& chunk = chunks[i];
+            init_buffers( chunk.buffers );
+            const size_t end = std::min( accounts.size(), ( i + 1 ) * parallel_chunk_size );
+            for( size_t j = i * parallel_chunk_size; j < end; ++j )
+            {
+               if( !accounts[j].second->has_some_core_voting() )
+                  continue;
+               account_votes votes;
+               if( get_votes( *accounts[j].first, *accounts[j].second, votes ) )
+               {
+                  count_votes( votes, chunk.buffers );
+                  chunk.votes.push_back( votes );
+               }
+            }
+         }, d.get_vote_tally_threads() );
+
+         // the sums do not depend on the order of the additions
+         for( const auto& chunk : chunks )
+         {
+            add_to( chunk.buffers.vote_tally, serial_buffers.vote_tally );
+            add_to( chunk.buffers.witness_count_histogram, serial_buffers.witness_count_histogram );
+            add_to( chunk.buffers.committee_count_histogram, serial_buffers.committee_count_histogram );
+            serial_buffers.total_voting_stake[0] += chunk.buffers.total_voting_stake[0];
+            serial_buffers.total_voting_stake[1] += chunk.buffers.total_voting_stake[1];
+         }
+         for( const auto& chunk : chunks )
+            for( const auto& votes : chunk.votes )
+               update_voting_power( votes );
+      }
+
+      /// Hands the tally over to the database
+      void finish()
+      {
+         d._vote_tally_buffer = std::move( serial_buffers.vote_tally );
+         d._witness_count_histogram_buffer = std::move( serial_buffers.witness_count_histogram );
+         d._committee_count_histogram_buffer = std::move( serial_buffers.committee_count_histogram );
+         d._total_voting_stake[0] = serial_buffers.total_voting_stake[0];
+         d._total_voting_stake[1] = serial_buffers.total_voting_stake[1];
+      }
+
+   private:
+      static void add_to( const vector<uint64_t>& from, vector<uint64_t>& to )
+      {
+         for( size_t i = 0; i < from.size(); ++i )
+            to[i] += from[i];
+      }
+
+      /**
+       * Calculates what the stake of an account contributes to the tally, only reads the database.
+       * @return false if the account does not contribute
+       */
+      bool get_votes( const account_object& stake_account, const account_statistics_object& stats,
+                      account_votes& result )const
       {
          // PoB activation
          if( pob_activated && stats.total_core_pob == 0 && stats.total_core_inactive == 0 )
-            return;
+            return false;
 
          if( props.parameters.count_non_member_votes || stake_account.is_member( now ) )
          {
@@ -1303,7 +1441,7 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
 
             // Shortcut
             if( voting_stake[2] == 0 )
-               return;
+               return false;
 
             const account_statistics_object& opinion_account_stats = ( directly_voting ? stats : opinion_account.statistics( d ) );
 
@@ -1334,59 +1472,80 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
                   voting_stake[2], opinion_account_stats.last_vote_time, *worker_recalc_times );
             }
 
-            // update voting power
-            d.modify( opinion_account_stats, [=]( account_statistics_object& update_stats ) {
-               if (update_stats.vote_tally_time != now)
-               {
-                  update_stats.vp_all = vp_all;
-                  update_stats.vp_active = vp_active;
-                  update_stats.vp_committee = vp_committee;
-                  update_stats.vp_witness = vp_witness;
-                  update_stats.vp_worker = vp_worker;
-                  update_stats.vote_tally_time = now;
-               }
-               else
-               {
-                  update_stats.vp_all += vp_all;
-                  update_stats.vp_active += vp_active;
-                  update_stats.vp_committee += vp_committee;
-                  update_stats.vp_witness += vp_witness;
-                  update_stats.vp_worker += vp_worker;
-                  // update_stats.vote_tally_time = now; 
-               }
-            });
+            result.opinion_account = &opinion_account;
+            result.opinion_account_stats = &opinion_account_stats;
+            std::copy( voting_stake, voting_stake + 3, result.voting_stake );
+            result.num_committee_voting_stake = num_committee_voting_stake;
+            result.vp_all = vp_all;
+            result.vp_active = vp_active;
+            result.vp_committee = vp_committee;
+            result.vp_witness = vp_witness;
+            result.vp_worker = vp_worker;
+            return true;
+         }
+         return false;
+      }
 
-            for( vote_id_type id : opinion_account.options.votes )
-            {
-               uint32_t offset = id.instance();
-               uint32_t type = std::min( id.type(), vote_id_type::vote_type::worker ); // cap the data
-               // if they somehow managed to specify an illegal offset, ignore it.
-               if( offset < d._vote_tally_buffer.size() )
-                  d._vote_tally_buffer[offset] += voting_stake[type];
-            }
+      void count_votes( const account_votes& votes, tally_buffers& buffers )const
+      {
+         const account_object& opinion_account = *votes.opinion_account;
+         const uint64_t* voting_stake = votes.voting_stake;
+         for( vote_id_type id : opinion_account.options.votes )
+         {
+            uint32_t offset = id.instance();
+            uint32_t type = std::min( id.type(), vote_id_type::vote_type::worker ); // cap the data
+            // if they somehow managed to specify an illegal offset, ignore it.
+            if( offset < buffers.vote_tally.size() )
+               buffers.vote_tally[offset] += voting_stake[type];
+         }
+
+         // votes for a number greater than maximum_witness_count are skipped here
+         if( voting_stake[1] > 0
+               && opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
+         {
+            uint16_t offset = opinion_account.options.num_witness / 2;
+            buffers.witness_count_histogram[offset] += voting_stake[1];
+         }
+         // votes for a number greater than maximum_committee_count are skipped here
+         if( votes.num_committee_voting_stake > 0
+               && opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
+         {
+            uint16_t offset = opinion_account.options.num_committee / 2;
+            buffers.committee_count_histogram[offset] += votes.num_committee_voting_stake;
+         }
+
+         buffers.total_voting_stake[0] += votes.num_committee_voting_stake;
+         buffers.total_voting_stake[1] += voting_stake[1];
+      }
 
-            // votes for a number greater than maximum_witness_count are skipped here
-            if( voting_stake[1] > 0
-                  && opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
+      void update_voting_power( const account_votes& votes )
+      {
+         const auto t = now;
+         d.modify( *votes.opinion_account_stats, [&votes,t]( account_statistics_object& update_stats ) {
+            if (update_stats.vote_tally_time != t)
             {
-               uint16_t offset = opinion_account.options.num_witness / 2;
-               d._witness_count_histogram_buffer[offset] += voting_stake[1];
+               update_stats.vp_all = votes.vp_all;
+               update_stats.vp_active = votes.vp_active;
+               update_stats.vp_committee = votes.vp_committee;
+               update_stats.vp_witness = votes.vp_witness;
+               update_stats.vp_worker = votes.vp_worker;
+               update_stats.vote_tally_time = t;
             }
-            // votes for a number greater than maximum_committee_count are skipped here
-            if( num_committee_voting_stake > 0
-                  && opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
+            else
             {
-               uint16_t offset = opinion_account.options.num_committee / 2;
-               d._committee_count_histogram_buffer[offset] += num_committee_voting_stake;
+               update_stats.vp_all += votes.vp_all;
+               update_stats.vp_active += votes.vp_active;
+               update_stats.vp_committee += votes.vp_committee;
+               update_stats.vp_witness += votes.vp_witness;
+               update_stats.vp_worker += votes.vp_worker;
+               // update_stats.vote_tally_time = now; 
             }
-
-            d._total_voting_stake[0] += num_committee_voting_stake;
-            d._total_voting_stake[1] += voting_stake[1];
-         }
+         });
       }
    } tally_helper(*this);
 
    perform_account_maintenance( tally_helper );
+   tally_helper.finish();
    
    struct clear_canary {
       clear_canary(vector<uint64_t>& target): target(target){}
@@ -1405,8 +1564,11 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
 
    modify(gpo, [&dgpo](global_property_object& p) {
       // Remove scaling of account registration fee
-      p.parameters.get_mutable_fees().get<account_create_operation>().basic_fee >>= p.parameters.account_fee_scale_bitshifts *
+      fee_schedule& fees = p.parameters.get_mutable_fees();
+      auto account_create_fees = fees.get<account_create_operation>();
+      account_create_fees.basic_fee >>= p.parameters.account_fee_scale_bitshifts *
             (dgpo.accounts_registered_this_interval / p.parameters.accounts_per_fee_scale);
+      fees.set_parameters( account_create_fees );
 
       if( p.pending_parameters )
       {
@@ -32,12 +32,14 @@
 #include <graphene/protocol/fee_schedule.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/thread/parallel.hpp>
+#include <fc/thread/thread.hpp>
 
+#include <atomic>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <queue>
-#include <tuple>
 
 namespace graphene { namespace chain {
 
@@ -52,6 +54,41 @@ database::~database()
    clear_pending();
 }
 
+namespace detail {
+
+   /// Blocks are read in chunks of this many blocks by the replay reader thread
+   constexpr uint32_t replay_read_chunk_size = 200;
+   /// Upper limit of the number of outstanding read requests
+   constexpr size_t   replay_max_pending_reads = 2;
+
+   /// A block on its way through the replay pipeline
+   struct replay_item
+   {
+      uint32_t          block_num = 0;
+      block_id_type     block_id;      ///< as recorded in the block database index
+      size_t            position = 0;  ///< end of the block in the blocks file
+      size_t            raw_size = 0;
+      vector<char>      data;          ///< serialized block, released after unpacking
+      signed_block      block;
+      uint32_t          skip = 0;
+      bool              valid = false; ///< unpacked and matching block_id
+      fc::future<void>  ready;         ///< set when the block has been unpacked and precomputed
+   };
+   using replay_item_ptr = std::shared_ptr<replay_item>;
+
+   /// Throughput counters of the replay pipeline stages
+   struct replay_stats
+   {
+      std::atomic<int64_t> read_us{0};
+      std::atomic<int64_t> read_bytes{0};
+      std::atomic<int64_t> decode_us{0};
+      int64_t              apply_us = 0;
+      int64_t              wait_us = 0;
+      uint32_t             applied = 0;
+   };
+
+} // namespace detail
+
 void database::reindex( fc::path data_dir )
 { try {
    auto last_block = _block_id_to_block.last();
@@ -76,86 +113,206 @@ void database::reindex( fc::path data_dir )
    else
       _undo_db.disable();
 
-   uint32_t skip = node_properties().skip_flags;
+   const uint32_t skip = node_properties().skip_flags;
 
    size_t total_block_size = _block_id_to_block.total_block_size();
    const auto& gpo = get_global_properties();
-   std::queue< std::tuple< size_t, signed_block, fc::future< void > > > blocks;
-   uint32_t next_block_num = head_block_num() + 1;
-   uint32_t i = next_block_num;
-   while( next_block_num <= last_block_num || !blocks.empty() )
-   {
-      if( next_block_num <= last_block_num && blocks.size() < 20 )
+   const fc::time_point_sec dupe_check_start = last_block->timestamp - gpo.parameters.maximum_time_until_expiration;
+
+   // The replay is a pipeline: a dedicated thread reads serialized blocks through its own handle to the block
+   // database, the thread pool unpacks and precomputes them, and this thread only applies them.
+   block_database reader_db;
+   reader_db.open( data_dir / "database" / "block_num_to_block" );
+   // shared with the thread pool, which may still be busy if applying a block fails
+   auto stats = std::make_shared<detail::replay_stats>();
+
+   auto read_chunk = [&reader_db,stats]( uint32_t first, uint32_t last ) {
+      const auto read_start = fc::time_point::now();
+      vector<detail::replay_item_ptr> result;
+      result.reserve( last - first + 1 );
+      for( uint32_t num = first; num <= last; ++num )
       {
-         const size_t processed_block_size = _block_id_to_block.blocks_current_position();
-         fc::optional< signed_block > block = _block_id_to_block.fetch_by_number( next_block_num++ );
-         if( block.valid() )
-         {
-            if( block->timestamp >= last_block->timestamp - gpo.parameters.maximum_time_until_expiration )
-               skip &= ~skip_transaction_dupe_check;
-            blocks.emplace( processed_block_size, std::move(*block), fc::future<void>() );
-            std::get<2>(blocks.back()) = precompute_parallel( std::get<1>(blocks.back()), skip );
-         }
-         else
-         {
-            wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
-            uint32_t dropped_count = 0;
-            while( true )
-            {
-               fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
-               // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
-               if( !last_id.valid() )
-                  break;
-               // we've caught up to the gap
-               if( block_header::num_from_id( *last_id ) <= i )
-                  break;
-               _block_id_to_block.remove( *last_id );
-               dropped_count++;
-            }
-            wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
-            next_block_num = last_block_num + 1; // don't load more blocks
-         }
+         auto data = reader_db.fetch_raw_by_number( num );
+         if( !data.valid() )
+            break; // gap
+         auto item = std::make_shared<detail::replay_item>();
+         item->block_num = num;
+         item->block_id = reader_db.fetch_block_id( num );
+         item->position = reader_db.blocks_current_position();
+         item->raw_size = data->size();
+         item->data = std::move( *data );
+         stats->read_bytes += item->raw_size;
+         result.push_back( std::move(item) );
       }
-      else
-      {
-         std::get<2>(blocks.front()).wait();
-         const signed_block& block = std::get<1>(blocks.front());
+      stats->read_us += ( fc::time_point::now() - read_start ).count();
+      return result;
+   };
 
-         if( i % 10000 == 0 )
+   auto decode = [this,stats,skip,dupe_check_start]( const detail::replay_item_ptr& item ) {
+      return fc::do_parallel( [this,stats,skip,dupe_check_start,item] () {
+         const auto decode_start = fc::time_point::now();
+         try
          {
-            std::stringstream bysize;
-            std::stringstream bynum;
-            size_t current_pos = std::get<0>(blocks.front());
-            if( current_pos > total_block_size )
-               total_block_size = current_pos;
-            bysize << std::fixed << std::setprecision(5) << double(current_pos) / total_block_size * 100;
-            bynum << std::fixed << std::setprecision(5) << double(i)*100/last_block_num;
-            ilog(
-               "   [by size: ${size}%   ${processed} of ${total}]   [by num: ${num}%   ${i} of ${last}]",
-               ("size", bysize.str())
-               ("processed", current_pos)
-               ("total", total_block_size)
-               ("num", bynum.str())
-               ("i", i)
-               ("last", last_block_num)
-            );
+            fc::datastream<const char*> ds( item->data.data(), item->data.size() );
+            fc::raw::unpack( ds, item->block );
+            vector<char>().swap( item->data );
+            item->skip = skip;
+            if( item->block.timestamp >= dupe_check_start )
+               item->skip &= ~skip_transaction_dupe_check;
+            if( item->block.id() == item->block_id )
+            {
+               precompute_parallel( item->block, item->skip ).wait();
+               item->valid = true;
+            }
          }
-         if( i == undo_point )
+         catch( const fc::exception& e )
          {
-            ilog( "Writing object database to disk at block ${i}, please DO NOT kill the program", ("i", i) );
-            flush();
-            ilog( "Done writing object database to disk" );
+            wlog( "Failed to unpack block ${n}: ${e}", ("n",item->block_num)("e",e.to_detail_string()) );
          }
-         if( i < undo_point )
-            apply_block( block, skip );
-         else
+         stats->decode_us += ( fc::time_point::now() - decode_start ).count();
+      });
+   };
+
+   // declared after what its tasks refer to, so that on any exit it is joined before that is destroyed
+   fc::thread reader_thread( "replay_reader" );
+   std::deque< std::pair< uint32_t, fc::future< vector<detail::replay_item_ptr> > > > reads;
+   std::deque< detail::replay_item_ptr > blocks;
+   size_t queued_bytes = 0;
+   uint32_t next_read = head_block_num() + 1;
+   optional<uint32_t> gap;
+   uint32_t i = next_read;
+   auto last_log = fc::time_point::now();
+   while( true )
+   {
+      // keep the reader busy as long as the memory budget allows, the queue depth follows the block sizes
+      while( !gap.valid() && next_read <= last_block_num && reads.size() < detail::replay_max_pending_reads
+             && queued_bytes < _replay_max_queued_bytes )
+      {
+         const uint32_t first = next_read;
+         const uint32_t last = std::min( last_block_num, first + detail::replay_read_chunk_size - 1 );
+         reads.emplace_back( first, reader_thread.async( [&read_chunk,first,last] () {
+            return read_chunk( first, last );
+         }, "replay_read" ) );
+         next_read = last + 1;
+      }
+
+      // hand blocks that have been read over to the thread pool, only wait for the reader if there is nothing to apply
+      while( !reads.empty() && ( blocks.empty() || reads.front().second.ready() ) )
+      {
+         const uint32_t first = reads.front().first;
+         const auto wait_start = fc::time_point::now();
+         vector<detail::replay_item_ptr> chunk = reads.front().second.wait();
+         stats->wait_us += ( fc::time_point::now() - wait_start ).count();
+         reads.pop_front();
+         if( gap.valid() )
+            continue; // read past the gap
+         for( auto& item : chunk )
          {
-            _undo_db.enable();
-            push_block( block, skip );
+            queued_bytes += item->raw_size;
+            item->ready = decode( item );
+            blocks.push_back( std::move(item) );
          }
-         blocks.pop();
-         i++;
+         const uint32_t expected_last = std::min( last_block_num, first + detail::replay_read_chunk_size - 1 );
+         if( first + chunk.size() <= expected_last )
+            gap = uint32_t( first + chunk.size() );
+      }
+
+      if( blocks.empty() )
+         break;
+
+      const detail::replay_item_ptr item = blocks.front();
+      blocks.pop_front();
+      queued_bytes -= item->raw_size;
+      const auto wait_start = fc::time_point::now();
+      item->ready.wait();
+      const auto apply_start = fc::time_point::now();
+      stats->wait_us += ( apply_start - wait_start ).count();
+      if( !item->valid )
+      {
+         gap = item->block_num;
+         // blocks after an unreadable block are dropped like those after a missing block
+         for( const auto& dropped : blocks )
+            dropped->ready.wait();
+         blocks.clear();
+         for( auto& read : reads )
+            read.second.wait();
+         reads.clear();
+         break;
+      }
+      const signed_block& block = item->block;
+
+      if( i % 10000 == 0 )
+      {
+         std::stringstream bysize;
+         std::stringstream bynum;
+         size_t current_pos = item->position;
+         if( current_pos > total_block_size )
+            total_block_size = current_pos;
+         bysize << std::fixed << std::setprecision(5) << double(current_pos) / total_block_size * 100;
+         bynum << std::fixed << std::setprecision(5) << double(i)*100/last_block_num;
+         ilog(
+            "   [by size: ${size}%   ${processed} of ${total}]   [by num: ${num}%   ${i} of ${last}]",
+            ("size", bysize.str())
+            ("processed", current_pos)
+            ("total", total_block_size)
+            ("num", bynum.str())
+            ("i", i)
+            ("last", last_block_num)
+         );
+         const auto now = fc::time_point::now();
+         const double elapsed = std::max<int64_t>( ( now - last_log ).count(), 1 ) / 1000000.0;
+         ilog( "   [replay: ${bps} blocks/s, read ${mb} MB in ${r} ms, decode ${d} ms, apply ${a} ms, "
+               "apply thread waiting ${w} ms, queued ${q} blocks / ${qb} bytes]",
+               ("bps", uint64_t( stats->applied / elapsed ))
+               ("mb", stats->read_bytes.exchange(0) / (1024 * 1024))
+               ("r", stats->read_us.exchange(0) / 1000)
+               ("d", stats->decode_us.exchange(0) / 1000)
+               ("a", stats->apply_us / 1000)
+               ("w", stats->wait_us / 1000)
+               ("q", blocks.size())
+               ("qb", queued_bytes) );
+         stats->apply_us = 0;
+         stats->wait_us = 0;
+         stats->applied = 0;
+         last_log = now;
+      }
+      if( i == undo_point )
+      {
+         ilog( "Writing object database to disk at block ${i}, please DO NOT kill the program", ("i", i) );
+         flush();
+         ilog( "Done writing object database to disk" );
+      }
+      if( i < undo_point )
+         apply_block( block, item->skip );
+      else
+      {
+         _undo_db.enable();
+         push_block( block, item->skip );
+      }
+      stats->apply_us += ( fc::time_point::now() - apply_start ).count();
+      ++stats->applied;
+      i++;
+   }
+   reader_thread.quit();
+   reader_db.close();
+
+   if( gap.valid() )
+   {
+      wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", *gap) );
+      uint32_t dropped_count = 0;
+      while( true )
+      {
+         fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
+         // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
+         if( !last_id.valid() )
+            break;
+         // we've caught up to the gap
+         if( block_header::num_from_id( *last_id ) <= *gap )
+            break;
+         _block_id_to_block.remove( *last_id );
+         dropped_count++;
       }
+      wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
    }
    _undo_db.enable();
    auto end = fc::time_point::now();
@@ -231,6 +388,7 @@ void database::close(bool rewind)
 {
    if (!_opened)
       return;
+   database_lock::write_guard write_lock( _database_lock );
       
    // TODO:  Save pending tx's on close()
    clear_pending();
@@ -263,7 +421,7 @@ void database::close(bool rewind)
    clear_pending();
 
    ilog( "Writing object database to disk at block ${i}, please DO NOT kill the program", ("i", head_block_num()) );
-   object_database::flush();
+   object_database::flush( true );
    ilog( "Done writing object database to disk" );
 
    object_database::close();
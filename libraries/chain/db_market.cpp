@@ -89,8 +89,8 @@ void database::globally_settle_asset_impl( const asset_object& mia,
    bool before_core_hardfork_342 = ( maint_time <= HARDFORK_CORE_342_TIME ); // better rounding
 
    // cancel all call orders and accumulate it into collateral_gathered
-   auto call_itr = call_index.lower_bound( price::min( bitasset.options.short_backing_asset, mia.id ) );
-   auto call_end = call_index.upper_bound( price::max( bitasset.options.short_backing_asset, mia.id ) );
+   auto call_itr = call_index.lower_bound( price_key( price::min( bitasset.options.short_backing_asset, mia.id ) ) );
+   auto call_end = call_index.upper_bound( price_key( price::max( bitasset.options.short_backing_asset, mia.id ) ) );
 
    asset pays;
    while( call_itr != call_end )
@@ -378,8 +378,8 @@ bool database::apply_order_before_hardfork_625(const limit_order_object& new_ord
    // constant time check. Potential optimization.
 
    auto max_price = ~new_order_object.sell_price;
-   auto limit_itr = limit_price_idx.lower_bound(max_price.max());
-   auto limit_end = limit_price_idx.upper_bound(max_price);
+   auto limit_itr = limit_price_idx.lower_bound( price_key( max_price.max() ) );
+   auto limit_end = limit_price_idx.upper_bound( price_key( max_price ) );
 
    bool finished = false;
    while( !finished && limit_itr != limit_end )
@@ -432,7 +432,7 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
 
    // We only need to check if the new order will match with others if it is at the front of the book
    const auto& limit_price_idx = get_index_type<limit_order_index>().indices().get<by_price>();
-   auto limit_itr = limit_price_idx.lower_bound( boost::make_tuple( new_order_object.sell_price, order_id ) );
+   auto limit_itr = limit_price_idx.lower_bound( boost::make_tuple( new_order_object.sell_price_key, order_id ) );
    if( limit_itr != limit_price_idx.begin() )
    {
       --limit_itr;
@@ -442,8 +442,8 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
 
    // this is the opposite side (on the book)
    auto max_price = ~new_order_object.sell_price;
-   limit_itr = limit_price_idx.lower_bound( max_price.max() );
-   auto limit_end = limit_price_idx.upper_bound( max_price );
+   limit_itr = limit_price_idx.lower_bound( price_key( max_price.max() ) );
+   auto limit_end = limit_price_idx.upper_bound( price_key( max_price ) );
 
    // Order matching should be in favor of the taker.
    // When a new limit order is created, e.g. an ask, need to check if it will match the highest bid.
@@ -523,7 +523,7 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
       {
          // check if there are margin calls
          const auto& call_collateral_idx = get_index_type<call_order_index>().indices().get<by_collateral>();
-         auto call_min = price::min( recv_asset_id, sell_asset_id );
+         const price_key call_min( price::min( recv_asset_id, sell_asset_id ) );
          while( !finished )
          {
             // hard fork core-343 and core-625 took place at same time,
@@ -550,7 +550,7 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
       {
          // check if there are margin calls
          const auto& call_price_idx = get_index_type<call_order_index>().indices().get<by_price>();
-         auto call_min = price::min( recv_asset_id, sell_asset_id );
+         const price_key call_min( price::min( recv_asset_id, sell_asset_id ) );
          while( !finished )
          {
             // assume hard fork core-343 and core-625 will take place at same time, always check call order with least call_price
@@ -1129,11 +1129,11 @@ bool database::check_call_orders( const asset_object& mia, bool enable_black_swa
     bool before_core_hardfork_1270 = ( maint_time <= HARDFORK_CORE_1270_TIME ); // call price caching issue
 
     // Looking for limit orders selling the most USD for the least CORE.
-    auto max_price = price::max( mia.id, bitasset.options.short_backing_asset );
+    const price_key max_price( price::max( mia.id, bitasset.options.short_backing_asset ) );
     // Stop when limit orders are selling too little USD for too much CORE.
     // Note that since BSIP74, margin calls offer somewhat less CORE per USD
     // if the issuer claims a Margin Call Fee.
-    auto min_price = ( before_core_hardfork_1270 ?
+    const price_key min_price( before_core_hardfork_1270 ?
                          bitasset.current_feed.max_short_squeeze_price_before_hf_1270()
                        : bitasset.current_feed.margin_call_order_price(
                                       bitasset.options.extensions.value.margin_call_fee_ratio )
@@ -1150,8 +1150,8 @@ bool database::check_call_orders( const asset_object& mia, bool enable_black_swa
     const auto& call_price_index = call_index.indices().get<by_price>();
     const auto& call_collateral_index = call_index.indices().get<by_collateral>();
 
-    auto call_min = price::min( bitasset.options.short_backing_asset, mia.id );
-    auto call_max = price::max( bitasset.options.short_backing_asset, mia.id );
+    const price_key call_min( price::min( bitasset.options.short_backing_asset, mia.id ) );
+    const price_key call_max( price::max( bitasset.options.short_backing_asset, mia.id ) );
 
     auto call_price_itr = call_price_index.begin();
     auto call_price_end = call_price_itr;
@@ -516,6 +516,24 @@ void get_relevant_accounts( const object* obj, flat_set<account_id_type>& accoun
    }
 } // end get_relevant_accounts( const object* obj, flat_set<account_id_type>& accounts )
 
+/**
+ * @return whether modifying an object of this type can change the accounts which get_relevant_accounts() finds,
+ *         all other objects only refer to accounts which are fixed when the object is created
+ */
+static bool relevant_accounts_may_change( object_id_type id )
+{
+   if( id.space() != protocol_ids )
+      return false;
+   switch( (object_type)id.type() )
+   {
+      case asset_object_type:            // the issuer can be updated
+      case custom_authority_object_type: // the authority can be updated
+         return true;
+      default:
+         return false;
+   }
+}
+
 void database::notify_applied_block( const signed_block& block )
 {
    GRAPHENE_TRY_NOTIFY( applied_block, block )
@@ -526,6 +544,11 @@ void database::notify_on_pending_transaction( const signed_transaction& tx )
    GRAPHENE_TRY_NOTIFY( on_pending_transaction, tx )
 }
 
+void database::notify_pending_state_reset()
+{
+   GRAPHENE_TRY_NOTIFY( pending_state_reset )
+}
+
 void database::notify_changed_objects()
 { try {
    if( _undo_db.enabled() ) 
@@ -556,12 +579,21 @@ void database::notify_changed_objects()
       {
         vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.old_values.size());
         flat_set<account_id_type> changed_accounts_impacted;
-        for( const auto& item : head_undo.old_values )
-        {
-          changed_ids.push_back(item.first);
-          get_relevant_accounts(item.second.get(), changed_accounts_impacted,
-                                MUST_IGNORE_CUSTOM_OP_REQD_AUTHS(chain_time));
-        }
+        head_undo.old_values.for_each_id( [&]( object_id_type id ) {
+          changed_ids.push_back(id);
+          const object& current = get_object(id);
+          // The old values are packed in the undo session, only unpack those whose relevant accounts may differ
+          // from the ones of the current value
+          if( relevant_accounts_may_change( id ) )
+          {
+             auto old_value = head_undo.old_values.get( current );
+             get_relevant_accounts(old_value.get(), changed_accounts_impacted,
+                                   MUST_IGNORE_CUSTOM_OP_REQD_AUTHS(chain_time));
+          }
+          else
+             get_relevant_accounts(&current, changed_accounts_impacted,
+                                   MUST_IGNORE_CUSTOM_OP_REQD_AUTHS(chain_time));
+        });
 
         if( changed_ids.size() )
            GRAPHENE_TRY_NOTIFY( changed_objects, changed_ids, changed_accounts_impacted)
@@ -195,7 +195,7 @@ bool database::check_for_blackswan( const asset_object& mia, bool enable_black_s
     const call_order_object* call_ptr = nullptr; // place holder for the call order with least collateral ratio
 
     asset_id_type debt_asset_id = mia.id;
-    auto call_min = price::min( bitasset.options.short_backing_asset, debt_asset_id );
+    const price_key call_min( price::min( bitasset.options.short_backing_asset, debt_asset_id ) );
 
     auto maint_time = get_dynamic_global_properties().next_maintenance_time;
     bool before_core_hardfork_1270 = ( maint_time <= HARDFORK_CORE_1270_TIME ); // call price caching issue
@@ -237,8 +237,8 @@ bool database::check_for_blackswan( const asset_object& mia, bool enable_black_s
 
     FC_ASSERT( highest_possible_bid.base.asset_id == lowest_possible_bid.base.asset_id );
     // NOTE limit_price_index is sorted from greatest to least
-    auto limit_itr = limit_price_index.lower_bound( highest_possible_bid );
-    auto limit_end = limit_price_index.upper_bound( lowest_possible_bid );
+    auto limit_itr = limit_price_index.lower_bound( price_key( highest_possible_bid ) );
+    auto limit_end = limit_price_index.upper_bound( price_key( lowest_possible_bid ) );
 
     if( limit_itr != limit_end ) {
        FC_ASSERT( highest.base.asset_id == limit_itr->sell_price.base.asset_id );
@@ -432,8 +432,8 @@ void database::clear_expired_orders()
          // Match against the least collateralized short until the settlement is finished or we reach max settlements
          while( settled < max_settlement_volume && find_object(order_id) )
          {
-            auto itr = call_index.lower_bound(boost::make_tuple(price::min(mia_object.bitasset_data(*this).options.short_backing_asset,
-                                                                           mia_object.get_id())));
+            auto itr = call_index.lower_bound(boost::make_tuple(price_key(price::min(mia_object.bitasset_data(*this).options.short_backing_asset,
+                                                                           mia_object.get_id()))));
             // There should always be a call order, since asset exists!
             assert(itr != call_index.end() && itr->debt_type() == mia_object.get_id());
             asset max_settlement = max_settlement_volume - settled;
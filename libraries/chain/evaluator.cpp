@@ -44,7 +44,13 @@ database& generic_evaluator::db()const { return trx_state->db(); }
       //check_required_authorities(op);
       auto result = evaluate( op );
 
-      if( apply ) result = this->apply( op );
+      if( apply )
+      {
+         // recorded before pay_fee() of some evaluators splits it up
+         if( !trx_state->skip_fee )
+            trx_state->core_fees_paid += core_fee_paid;
+         result = this->apply( op );
+      }
       return result;
    } FC_CAPTURE_AND_RETHROW() }
 
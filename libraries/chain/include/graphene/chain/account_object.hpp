@@ -385,7 +385,7 @@ namespace graphene { namespace chain {
    /**
     * @ingroup object_index
     */
-   typedef multi_index_container<
+   typedef chunked_multi_index_container<
       account_balance_object,
       indexed_by<
          ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
@@ -23,9 +23,11 @@
  */
 #pragma once
 #include <fstream>
+#include <functional>
 #include <graphene/protocol/block.hpp>
 
 #include <fc/filesystem.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 
 namespace graphene { namespace chain {
    struct index_entry;
@@ -46,14 +48,45 @@ namespace graphene { namespace chain {
          block_id_type          fetch_block_id( uint32_t block_num )const;
          optional<signed_block> fetch_optional( const block_id_type& id )const;
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /**
+          * These return the serialized block exactly as it is stored, without unpacking it.
+          * The block id is taken from the index and is not recomputed.
+          */
+         /// @{
+         optional<vector<char>> fetch_raw_optional( const block_id_type& id )const;
+         optional<vector<char>> fetch_raw_by_number( uint32_t block_num )const;
+         /// @}
+         /**
+          * Calls @p visit with the number and the serialized data of the stored blocks from @p first_block_num
+          * to @p last_block_num in ascending order. Stops at the first missing block or when @p visit returns
+          * false. The data pointer is only valid during the call.
+          * @return the number of blocks visited
+          */
+         uint32_t visit_raw_blocks( uint32_t first_block_num, uint32_t last_block_num,
+                                    const std::function<bool( uint32_t, const char*, size_t )>& visit )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
          size_t                 blocks_current_position()const;
          size_t                 total_block_size()const;
       private:
          optional<index_entry> last_index_entry()const;
+         optional<index_entry> fetch_index_entry( uint32_t block_num )const;
+         /**
+          * @return a pointer to the stored data of the block in the memory-mapped blocks file,
+          *         the mapping is extended if the block was appended after the last mapping
+          */
+         const char* map_block_data( const index_entry& e )const;
+         signed_block unpack_block( const index_entry& e )const;
+         void unmap_blocks()const;
+
          fc::path _index_filename;
+         fc::path _blocks_filename;
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+         mutable std::unique_ptr<fc::file_mapping>  _blocks_mapping;
+         mutable std::unique_ptr<fc::mapped_region> _blocks_region;
+         mutable size_t _last_read_pos = 0;
+         /// size of the blocks file when it was last flushed for reading
+         mutable uint64_t _blocks_readable_size = 0;
    };
 } }
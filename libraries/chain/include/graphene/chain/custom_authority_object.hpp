@@ -37,9 +37,8 @@ namespace graphene { namespace chain {
     *
     */
    class custom_authority_object : public abstract_object<custom_authority_object> {
-      /// Unreflected field to store a cache of the predicate function
-      /// Note that this cache can be modified when the object is const!
-      mutable optional<restriction_predicate_function> predicate_cache;
+      /// Unreflected field holding the compiled predicate function, shared by all objects with identical restrictions
+      std::shared_ptr<const restriction_predicate_function> predicate;
 
    public:
       static constexpr uint8_t space_id = protocol_ids;
@@ -64,19 +63,21 @@ namespace graphene { namespace chain {
                         std::back_inserter(rs), [](auto i) { return i.second; });
          return rs;
       }
-      /// Get predicate, from cache if possible, and update cache if not (modifies const object!)
-      restriction_predicate_function get_predicate() const {
-         if (!predicate_cache.valid())
-            update_predicate_cache();
-
-         return *predicate_cache;
+      /// Get the compiled predicate function, compiling it now if it could not be compiled in advance
+      std::shared_ptr<const restriction_predicate_function> get_predicate() const {
+         if (predicate)
+            return predicate;
+         return get_shared_restriction_predicate(get_restrictions(), operation_type.value);
       }
-      /// Regenerate predicate function and update predicate cache
-      void update_predicate_cache() const {
-         predicate_cache = get_restriction_predicate(get_restrictions(), operation_type);
+      /// Compile the predicate function; called by the index whenever the object is created, modified or restored
+      void update_derived_keys() {
+         try {
+            predicate = get_shared_restriction_predicate(get_restrictions(), operation_type.value);
+         } catch (const fc::exception&) {
+            // Leave the failure to be reported when the predicate is requested
+            predicate.reset();
+         }
       }
-      /// Clear the cache of the predicate function
-      void clear_predicate_cache() { predicate_cache.reset(); }
    };
 
    struct by_account_custom;
@@ -33,6 +33,8 @@
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/chain/evaluator.hpp>
+#include <graphene/chain/database_lock.hpp>
+#include <graphene/chain/mempool.hpp>
 
 #include <graphene/db/object_database.hpp>
 #include <graphene/db/object.hpp>
@@ -42,6 +44,7 @@
 #include <fc/log/logger.hpp>
 
 #include <map>
+#include <unordered_set>
 
 namespace graphene { namespace protocol { struct predicate_result; } }
 
@@ -137,6 +140,11 @@ namespace graphene { namespace chain {
          block_id_type              get_block_id_for_num( uint32_t block_num )const;
          optional<signed_block>     fetch_block_by_id( const block_id_type& id )const;
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
+         /// @return the serialized block, read from the block database without unpacking if possible
+         optional<vector<char>>     fetch_raw_block_by_id( const block_id_type& id )const;
+         /// Visits the serialized blocks of the given range as they are stored in the block database
+         uint32_t                   visit_raw_blocks( uint32_t first_block_num, uint32_t last_block_num,
+                                         const std::function<bool( uint32_t, const char*, size_t )>& visit )const;
          const signed_transaction&  get_recent_transaction( const transaction_id_type& trx_id )const;
          std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
 
@@ -153,7 +161,9 @@ namespace graphene { namespace chain {
          bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
          processed_transaction push_transaction( const precomputable_transaction& trx, uint32_t skip = skip_nothing );
          bool _push_block( const signed_block& b );
-         processed_transaction _push_transaction( const precomputable_transaction& trx );
+         /// Applies the transaction to the pending state, making room for it among the pending transactions if
+         /// @a check_limits is set
+         processed_transaction _push_transaction( const precomputable_transaction& trx, bool check_limits = false );
 
          ///@throws fc::exception if the proposed transaction fails to apply.
          processed_transaction push_proposal( const proposal_object& proposal );
@@ -173,6 +183,49 @@ namespace graphene { namespace chain {
          void pop_block();
          void clear_pending();
 
+         /**
+          * Applies pending transactions again after the head block changed. Transactions included in a block or
+          * expired are dropped without being evaluated. If a single block was pushed on top of the previous head,
+          * the recorded changes of transactions which depend on nothing the block changed are applied again,
+          * and only the other transactions are evaluated again.
+          *
+          * @param pending the transactions that were pending on top of the previous head block
+          * @param old_head_block_id the previous head block
+          */
+         void restore_pending_transactions( mempool&& pending, const block_id_type& old_head_block_id );
+
+         /// @return the counters of the pending transactions
+         mempool_stats get_mempool_stats()const;
+
+         /**
+          * Sets the limits of the pending transactions. When the memory limit is reached, transactions paying
+          * a lower fee per byte than a new one are dropped to make room for it, otherwise the new one is refused.
+          */
+         void set_mempool_limits( const mempool_limits& limits ) { _mempool_limits = limits; }
+         const mempool_limits& get_mempool_limits()const { return _mempool_limits; }
+
+         /// Default upper limit of the serialized size of the blocks on their way through the replay pipeline
+         static constexpr uint64_t default_replay_queue_size = 256 * 1024 * 1024;
+
+         /**
+          * Sets the upper limit of the serialized size of the blocks which have been read but not yet applied
+          * during a replay. The unpacked blocks take a multiple of this in memory.
+          */
+         void set_replay_queue_size( uint64_t bytes ) { _replay_max_queued_bytes = std::max<uint64_t>( bytes, 1 ); }
+
+         /**
+          * Sets the number of threads counting votes during maintenance since core-2262, 0 for one per hardware
+          * thread, 1 to count them on the block processing thread interleaved with processing fees.
+          */
+         void set_vote_tally_threads( uint16_t threads ) { _vote_tally_threads = threads; }
+         uint16_t get_vote_tally_threads()const { return _vote_tally_threads; }
+
+         /**
+          * Threads other than the one owning the database must hold the read side of this lock while reading
+          * the database, all changes of the database through its public interface hold the write side.
+          */
+         database_lock& get_database_lock()const { return _database_lock; }
+
          /**
           *  This method is used to track appied operations during the evaluation of a block, these
           *  operations should include any operation actually included in a transaction as well
@@ -204,6 +257,12 @@ namespace graphene { namespace chain {
           */
          fc::signal<void(const signed_transaction&)>     on_pending_transaction;
 
+         /**
+          * This signal is emitted any time the pending block state is undone, i.e. when pending
+          * transactions are cleared, dropped or about to be re-applied, and when a block is popped.
+          */
+         fc::signal<void()>                              pending_state_reset;
+
          /**
           *  Emitted After a block has been applied and committed.  The callback
           *  should not yield and should execute quickly.
@@ -550,6 +609,7 @@ namespace graphene { namespace chain {
          void pop_undo() { object_database::pop_undo(); }
          void notify_applied_block( const signed_block& block );
          void notify_on_pending_transaction( const signed_transaction& tx );
+         void notify_pending_state_reset();
          void notify_changed_objects();
 
       private:
@@ -569,7 +629,35 @@ namespace graphene { namespace chain {
 
       private:
          void                  _apply_block( const signed_block& next_block );
-         processed_transaction _apply_transaction( const signed_transaction& trx );
+         /// @param core_fees_paid set to the fees charged for the operations, converted to the core asset
+         processed_transaction _apply_transaction( const signed_transaction& trx,
+                                                   share_type* core_fees_paid = nullptr );
+         /// @return the changes made by the transaction just applied in the head undo session
+         std::shared_ptr<const pending_transaction_effects> get_pending_effects( const signed_transaction& trx,
+                                                                                flat_set<object_id_type>&& reads )const;
+         /// Applies recorded changes again, @return false if they do not fit the current state
+         bool                  apply_pending_effects( const pending_transaction_effects& effects );
+         /**
+          * Applies pending transactions again on top of a clean state, replaying the recorded changes of those
+          * which depend on none of the @a changed objects if @a incremental is set
+          */
+         void                  _restore_pending_transactions( mempool&& pending, bool incremental,
+                                                              std::unordered_set<object_id_type>&& changed );
+         /// @return the fee payer of the first operation and the given fees in CORE per 1024 bytes of the transaction
+         std::pair<account_id_type, uint64_t> get_pending_fee_rate( const signed_transaction& trx,
+                                                                    share_type core_fees, uint64_t size )const;
+         /// Throws if the fee payer of a new transaction already has the maximum number of pending transactions
+         void                  check_pending_transaction_count( const signed_transaction& trx );
+         /**
+          * Selects the worse paying pending transactions to drop to make room for a new transaction of the given
+          * fee rate and estimated memory usage, throws if the memory limit would still be exceeded without them
+          */
+         vector<uint64_t>      select_pending_transactions_to_evict( uint64_t fee_per_kbyte, uint64_t memory_usage );
+         /**
+          * Drops the pending transactions of the given sequence numbers. Their changes stay in the pending state
+          * until it is rebuilt with the next block, then the transactions depending on them are evaluated again.
+          */
+         void                  evict_pending_transactions( const vector<uint64_t>& evicted );
          void                  _cancel_bids_and_revive_mpa( const asset_object& bitasset, const asset_bitasset_data_object& bad );
 
          ///Steps involved in applying a new block
@@ -619,11 +707,18 @@ namespace graphene { namespace chain {
          void process_bitassets();
 
          template<class Type>
-         void perform_account_maintenance( Type tally_helper );
+         void perform_account_maintenance( Type& tally_helper );
          ///@}
          ///@}
 
-         vector< processed_transaction >        _pending_tx;
+         mempool                                _pending_tx;
+         /// objects written by evicted pending transactions since the pending state was last rebuilt
+         std::unordered_set<object_id_type>     _evicted_pending_writes;
+         mempool_stats                          _mempool_stats;
+         mempool_limits                         _mempool_limits;
+         uint64_t                               _replay_max_queued_bytes = default_replay_queue_size;
+         uint16_t                               _vote_tally_threads = 0;
+         mutable database_lock                  _database_lock;
          fork_database                          _fork_db;
 
          /**
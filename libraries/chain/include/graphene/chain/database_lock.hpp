@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/thread/future.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace graphene { namespace chain {
+
+/**
+ * @brief Lets other threads read the database while the thread that applies blocks is not changing it
+ *
+ * The thread owning the database takes the write side around everything that changes the database, i. e.
+ * pushing and generating blocks and pushing, validating or dropping transactions. Other threads, e.g. the API
+ * workers, take the read side for the duration of a query, so that they see the state between two such
+ * changes.
+ *
+ * The write side is reentrant for the fiber holding it. Other fibers of the owning thread wait until it is
+ * released, so that they can not change the database in the middle of a change that yields. Waiting for the
+ * write side never blocks the thread: the waiting fiber yields until it is signalled that running reads or the
+ * change of the other fiber are done, and new reads are held back until the change is done.
+ */
+class database_lock
+{
+   public:
+      /// Blocks the calling thread until no change is in progress or pending, must not be called by the owner
+      void lock_read();
+      void unlock_read();
+
+      /// Waits cooperatively until running reads and changes of other fibers are done, must only be called by the
+      /// thread owning the database
+      void lock_write();
+      void unlock_write();
+
+      class read_guard
+      {
+         public:
+            explicit read_guard( database_lock& lock ) : _lock( lock ) { _lock.lock_read(); }
+            ~read_guard() { _lock.unlock_read(); }
+         private:
+            database_lock& _lock;
+      };
+
+      class write_guard
+      {
+         public:
+            explicit write_guard( database_lock& lock ) : _lock( lock ) { _lock.lock_write(); }
+            ~write_guard() { _lock.unlock_write(); }
+         private:
+            database_lock& _lock;
+      };
+
+   private:
+      std::mutex              _mutex;
+      std::condition_variable _change_done;
+      uint32_t                _readers = 0;
+      bool                    _write_pending = false;
+      /// set while a change waits for the running reads, signalled by the last of them
+      fc::promise<void>::ptr  _readers_done;
+
+      // only accessed by the owning thread
+      const void*             _writer = nullptr;
+      uint32_t                _write_depth = 0;
+      /// set while other fibers wait for the write side, signalled when it is released
+      fc::promise<void>::ptr  _write_released;
+};
+
+} } // graphene::chain
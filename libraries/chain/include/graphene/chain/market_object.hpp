@@ -33,6 +33,38 @@ namespace graphene { namespace chain {
 
 using namespace graphene::db;
 
+/**
+ *  @brief an order preserving sort key of a price
+ *
+ *  Comparing two prices multiplies their amounts as 128-bit integers. The key additionally holds the ratio of
+ *  the amounts as a double. Converting amounts of up to 2^53 (all valid amounts are bounded by
+ *  GRAPHENE_MAX_SHARE_SUPPLY) and dividing them rounds monotonically, so prices of the same market whose ratios
+ *  differ are ordered by a single floating point comparison. Equal ratios and amounts out of that range fall back
+ *  to comparing the prices, therefore keys are ordered exactly like the prices they were created from.
+ *
+ *  Objects keep the keys of their indexed prices in members updated by update_derived_keys().
+ */
+struct price_key
+{
+   price_key() = default;
+   price_key( const price& p );
+
+   price    value;
+   double   ratio = -1; ///< base amount / quote amount, negative if it can not be compared exactly
+};
+
+inline bool operator < ( const price_key& a, const price_key& b )
+{
+   if( a.value.base.asset_id != b.value.base.asset_id )
+      return a.value.base.asset_id < b.value.base.asset_id;
+   if( a.value.quote.asset_id != b.value.quote.asset_id )
+      return a.value.quote.asset_id < b.value.quote.asset_id;
+   if( a.ratio >= 0 && b.ratio >= 0 && a.ratio != b.ratio )
+      return a.ratio < b.ratio;
+   return a.value < b.value;
+}
+inline bool operator > ( const price_key& a, const price_key& b ) { return b < a; }
+
 /**
  *  @brief an offer to sell a amount of a asset at a specified exchange rate by a certain time
  *  @ingroup object
@@ -54,6 +86,10 @@ class limit_order_object : public abstract_object<limit_order_object>
       share_type       deferred_fee; ///< fee converted to CORE
       asset            deferred_paid_fee; ///< originally paid fee
 
+      price_key        sell_price_key; ///< derived from sell_price, not serialized
+
+      void update_derived_keys() { sell_price_key = sell_price; }
+
       pair<asset_id_type,asset_id_type> get_market()const
       {
          auto tmp = std::make_pair( sell_price.base.asset_id, sell_price.quote.asset_id );
@@ -71,7 +107,7 @@ struct by_price;
 struct by_expiration;
 struct by_account;
 struct by_account_price;
-typedef multi_index_container<
+typedef chunked_multi_index_container<
    limit_order_object,
    indexed_by<
       ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
@@ -83,10 +119,10 @@ typedef multi_index_container<
       >,
       ordered_unique< tag<by_price>,
          composite_key< limit_order_object,
-            member< limit_order_object, price, &limit_order_object::sell_price>,
+            member< limit_order_object, price_key, &limit_order_object::sell_price_key>,
             member< object, object_id_type, &object::id>
          >,
-         composite_key_compare< std::greater<price>, std::less<object_id_type> >
+         composite_key_compare< std::greater<price_key>, std::less<object_id_type> >
       >,
       // index used by APIs
       ordered_unique< tag<by_account>,
@@ -99,10 +135,10 @@ typedef multi_index_container<
       ordered_unique< tag<by_account_price>,
          composite_key< limit_order_object,
             member<limit_order_object, account_id_type, &limit_order_object::seller>,
-            member<limit_order_object, price, &limit_order_object::sell_price>,
+            member<limit_order_object, price_key, &limit_order_object::sell_price_key>,
             member<object, object_id_type, &object::id>
          >,
-         composite_key_compare<std::less<account_id_type>, std::greater<price>, std::less<object_id_type>>
+         composite_key_compare<std::less<account_id_type>, std::greater<price_key>, std::less<object_id_type>>
       >
    >
 > limit_order_multi_index_type;
@@ -136,6 +172,15 @@ class call_order_object : public abstract_object<call_order_object>
 
       optional<uint16_t> target_collateral_ratio; ///< maximum CR to maintain when selling collateral on margin call
 
+      price_key        call_price_key; ///< derived from call_price, not serialized
+      price_key        collateralization_key; ///< derived from collateral and debt, not serialized
+
+      void update_derived_keys()
+      {
+         call_price_key = call_price;
+         collateralization_key = price( get_collateral(), get_debt() );
+      }
+
       pair<asset_id_type,asset_id_type> get_market()const
       {
          auto tmp = std::make_pair( call_price.base.asset_id, call_price.quote.asset_id );
@@ -198,6 +243,10 @@ class collateral_bid_object : public abstract_object<collateral_bid_object>
 
       account_id_type  bidder;
       price            inv_swan_price;  // Collateral / Debt
+
+      price_key        inv_swan_price_key; ///< derived from inv_swan_price, not serialized
+
+      void update_derived_keys() { inv_swan_price_key = inv_swan_price; }
 };
 
 struct by_collateral;
@@ -210,10 +259,10 @@ typedef multi_index_container<
          member< object, object_id_type, &object::id > >,
       ordered_unique< tag<by_price>,
          composite_key< call_order_object,
-            member< call_order_object, price, &call_order_object::call_price>,
+            member< call_order_object, price_key, &call_order_object::call_price_key>,
             member< object, object_id_type, &object::id>
          >,
-         composite_key_compare< std::less<price>, std::less<object_id_type> >
+         composite_key_compare< std::less<price_key>, std::less<object_id_type> >
       >,
       ordered_unique< tag<by_account>,
          composite_key< call_order_object,
@@ -223,7 +272,7 @@ typedef multi_index_container<
       >,
       ordered_unique< tag<by_collateral>,
          composite_key< call_order_object,
-            const_mem_fun< call_order_object, price, &call_order_object::collateralization >,
+            member< call_order_object, price_key, &call_order_object::collateralization_key >,
             member< object, object_id_type, &object::id >
          >
       >
@@ -265,10 +314,10 @@ typedef multi_index_container<
       ordered_unique< tag<by_price>,
          composite_key< collateral_bid_object,
             const_mem_fun< collateral_bid_object, asset_id_type, &collateral_bid_object::debt_type>,
-            member< collateral_bid_object, price, &collateral_bid_object::inv_swan_price >,
+            member< collateral_bid_object, price_key, &collateral_bid_object::inv_swan_price_key >,
             member< object, object_id_type, &object::id >
          >,
-         composite_key_compare< std::less<asset_id_type>, std::greater<price>, std::less<object_id_type> >
+         composite_key_compare< std::less<asset_id_type>, std::greater<price_key>, std::less<object_id_type> >
       >
    >
 > collateral_bid_object_multi_index_type;
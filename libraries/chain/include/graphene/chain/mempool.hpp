@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/types.hpp>
+#include <graphene/protocol/transaction.hpp>
+
+#include <graphene/db/object.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <memory>
+
+namespace graphene { namespace chain {
+
+   /**
+    * The changes a pending transaction made to the state when it was last evaluated, and the objects it
+    * depends on. As long as none of these objects are changed by a new block, the changes can be applied
+    * again on top of the block instead of evaluating the transaction again.
+    */
+   struct pending_transaction_effects
+   {
+      /// values of the modified objects after the transaction
+      vector< unique_ptr<object> > modified;
+      /// values of the created objects after the transaction, in the order of creation per index
+      vector< unique_ptr<object> > created;
+      vector< object_id_type >     removed;
+      /// objects looked up by ID during the evaluation, and all objects written
+      flat_set< object_id_type >   dependencies;
+      /// whether all operations are known to only depend on objects looked up by ID
+      bool                         replayable = false;
+      /// estimated memory used by the recorded objects, in bytes
+      uint64_t                     memory_usage = 0;
+
+      /// calls f( id ) for every object written by the transaction
+      template<typename Functor>
+      void for_each_written( Functor&& f )const
+      {
+         for( const auto& obj : modified )
+            f( obj->id );
+         for( const auto& obj : created )
+            f( obj->id );
+         for( const auto& id : removed )
+            f( id );
+      }
+   };
+
+   struct mempool_entry
+   {
+      uint64_t              sequence = 0;
+      transaction_id_type   trx_id;
+      time_point_sec        expiration;
+      /// the fee payer of the first operation
+      account_id_type       fee_payer;
+      /// the fees of all operations converted to the core asset, per 1024 bytes of the transaction
+      uint64_t              fee_per_kbyte = 0;
+      /// packed size of the transaction
+      uint64_t              size = 0;
+      /// estimated memory used by the entry, in bytes
+      uint64_t              memory_usage = 0;
+      processed_transaction trx;
+      /// null if the changes were not recorded, e.g. when the undo database is disabled
+      std::shared_ptr<const pending_transaction_effects> effects;
+   };
+
+   struct by_sequence;
+   struct by_trx_id;
+   struct by_expiration;
+   struct by_fee_rate;
+   struct by_fee_payer;
+   typedef boost::multi_index_container<
+      mempool_entry,
+      boost::multi_index::indexed_by<
+         boost::multi_index::ordered_unique< boost::multi_index::tag<by_sequence>,
+            boost::multi_index::member< mempool_entry, uint64_t, &mempool_entry::sequence > >,
+         boost::multi_index::hashed_non_unique< boost::multi_index::tag<by_trx_id>,
+            boost::multi_index::member< mempool_entry, transaction_id_type, &mempool_entry::trx_id >,
+            std::hash<transaction_id_type> >,
+         boost::multi_index::ordered_non_unique< boost::multi_index::tag<by_expiration>,
+            boost::multi_index::member< mempool_entry, time_point_sec, &mempool_entry::expiration > >,
+         /// lowest fee rate first, newest first for the same rate
+         boost::multi_index::ordered_unique< boost::multi_index::tag<by_fee_rate>,
+            boost::multi_index::composite_key< mempool_entry,
+               boost::multi_index::member< mempool_entry, uint64_t, &mempool_entry::fee_per_kbyte >,
+               boost::multi_index::member< mempool_entry, uint64_t, &mempool_entry::sequence >
+            >,
+            boost::multi_index::composite_key_compare< std::less<uint64_t>, std::greater<uint64_t> >
+         >,
+         /// transactions of each fee payer in the order they were applied
+         boost::multi_index::ordered_unique< boost::multi_index::tag<by_fee_payer>,
+            boost::multi_index::composite_key< mempool_entry,
+               boost::multi_index::member< mempool_entry, account_id_type, &mempool_entry::fee_payer >,
+               boost::multi_index::member< mempool_entry, uint64_t, &mempool_entry::sequence >
+            >
+         >
+      >
+   > mempool_entry_multi_index_type;
+
+   /// Counters of the pending transaction pool, the durations are in microseconds
+   struct mempool_stats
+   {
+      uint64_t size = 0;                  ///< number of pending transactions
+      uint64_t revalidations = 0;         ///< number of times the pending transactions were restored after a block
+      uint64_t full_revalidations = 0;    ///< of which every transaction had to be evaluated again
+      uint64_t replayed = 0;              ///< transactions whose recorded changes were applied again
+      uint64_t reevaluated = 0;           ///< transactions evaluated again
+      uint64_t dropped_included = 0;      ///< transactions dropped because they were included in a block
+      uint64_t dropped_expired = 0;       ///< transactions dropped because they expired
+      uint64_t evicted = 0;               ///< transactions dropped because they failed to evaluate again
+      uint64_t evicted_low_fee = 0;       ///< transactions dropped to make room for better paying ones
+      uint64_t rejected = 0;              ///< transactions refused because of the limits of the pool
+      uint64_t memory_usage = 0;          ///< estimated memory used by the pending transactions, in bytes
+      uint64_t last_revalidation_time = 0;
+      uint64_t total_revalidation_time = 0;
+   };
+
+   /// Limits of the pending transaction pool, 0 means unlimited
+   struct mempool_limits
+   {
+      /// estimated memory used by the pending transactions, in bytes
+      uint64_t max_memory = 0;
+      /// number of pending transactions per fee paying account
+      uint32_t max_per_account = 0;
+   };
+
+   /**
+    * @class mempool
+    * @brief The transactions applied to the pending state, in the order they were applied
+    *
+    * The same transaction can be pending more than once if it was pushed with the duplicate check skipped.
+    */
+   class mempool
+   {
+      public:
+         typedef mempool_entry_multi_index_type::index<by_sequence>::type entries_type;
+         typedef mempool_entry_multi_index_type::index<by_fee_rate>::type entries_by_fee_rate_type;
+         typedef mempool_entry_multi_index_type::index<by_fee_payer>::type entries_by_fee_payer_type;
+
+         /// Adds a transaction that has just been applied to the pending state
+         const mempool_entry& push_back( const processed_transaction& trx, account_id_type fee_payer,
+                                         uint64_t fee_per_kbyte,
+                                         std::shared_ptr<const pending_transaction_effects> effects );
+
+         /// @return the estimated memory used by an entry of a transaction of the given packed size
+         static uint64_t estimate_memory_usage( uint64_t size, const pending_transaction_effects* effects );
+
+         const entries_type& entries()const { return _entries.get<by_sequence>(); }
+         const entries_by_fee_rate_type& entries_by_fee_rate()const { return _entries.get<by_fee_rate>(); }
+         const entries_by_fee_payer_type& entries_by_fee_payer()const { return _entries.get<by_fee_payer>(); }
+         const mempool_entry* find( const transaction_id_type& id )const;
+
+         /// Removes the transactions expiring before the given time, and passes them to f
+         template<typename Functor>
+         void remove_expired( time_point_sec now, Functor&& f )
+         {
+            auto& idx = _entries.get<by_expiration>();
+            while( !idx.empty() && idx.begin()->expiration < now )
+            {
+               f( *idx.begin() );
+               _memory_usage -= idx.begin()->memory_usage;
+               idx.erase( idx.begin() );
+            }
+         }
+         /// Removes all entries of a transaction
+         void remove( const transaction_id_type& id );
+         /// Removes the entry with the given sequence number
+         void remove( uint64_t sequence );
+
+         /**
+          * Selects the best paying transactions whose sizes add up to at most @a max_size. Transactions are picked
+          * by fee rate, but those with the same fee payer in the order they were applied, because later ones may
+          * depend on earlier ones. If all transactions fit, all are selected.
+          * @return the selected entries, in the order they were applied
+          */
+         vector<const mempool_entry*> select_best_paying( uint64_t max_size )const;
+
+         /// @return the number of pending transactions whose first operation is paid by the account
+         size_t count( account_id_type fee_payer )const
+         {
+            return _entries.get<by_fee_payer>().count( boost::make_tuple( fee_payer ) );
+         }
+         uint64_t memory_usage()const { return _memory_usage; }
+
+         size_t size()const { return _entries.size(); }
+         bool   empty()const { return _entries.empty(); }
+         void   clear() { _entries.clear(); _memory_usage = 0; }
+
+      private:
+         mempool_entry_multi_index_type _entries;
+         uint64_t                       _next_sequence = 0;
+         uint64_t                       _memory_usage = 0;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::mempool_stats,
+            (size)(revalidations)(full_revalidations)(replayed)(reevaluated)
+            (dropped_included)(dropped_expired)(evicted)(evicted_low_fee)(rejected)(memory_usage)
+            (last_revalidation_time)(total_revalidation_time) )
@@ -24,7 +24,7 @@
 #pragma once
 
 #include <graphene/protocol/operations.hpp>
-#include <graphene/db/object.hpp>
+#include <graphene/db/generic_index.hpp>
 
 #include <boost/multi_index/composite_key.hpp>
 
@@ -98,7 +98,7 @@ namespace graphene { namespace chain {
          account_transaction_history_id_type  next;
    };
 
-   typedef multi_index_container<
+   typedef chunked_multi_index_container<
       operation_history_object,
       indexed_by<
          ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >
@@ -111,7 +111,7 @@ namespace graphene { namespace chain {
    struct by_op;
    struct by_opid;
 
-   typedef multi_index_container<
+   typedef chunked_multi_index_container<
       account_transaction_history_object,
       indexed_by<
          ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
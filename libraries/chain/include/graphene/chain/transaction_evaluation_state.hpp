@@ -49,5 +49,7 @@ namespace chain {
          bool                             _is_proposed_trx = false;
          bool                             skip_fee = false;
          bool                             skip_fee_schedule_check = false;
+         /// fees charged for the operations applied so far, converted to the core asset
+         share_type                       core_fees_paid;
    };
 } } // namespace graphene::chain
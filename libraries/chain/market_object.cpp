@@ -31,6 +31,15 @@
 
 using namespace graphene::chain;
 
+price_key::price_key( const price& p ) : value( p )
+{
+   // amounts of up to 2^53 are converted without loss, the division then rounds monotonically
+   static constexpr int64_t max_exact_amount = int64_t(1) << 53;
+   if( p.base.amount.value >= 0 && p.base.amount.value <= max_exact_amount
+         && p.quote.amount.value > 0 && p.quote.amount.value <= max_exact_amount )
+      ratio = double( p.base.amount.value ) / double( p.quote.amount.value );
+}
+
 /*
 target_CR = max( target_CR, MCR )
 
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/mempool.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+#include <set>
+
+namespace graphene { namespace chain {
+
+const mempool_entry& mempool::push_back( const processed_transaction& trx, account_id_type fee_payer,
+                                         uint64_t fee_per_kbyte,
+                                         std::shared_ptr<const pending_transaction_effects> effects )
+{
+   mempool_entry entry;
+   entry.sequence = _next_sequence++;
+   entry.trx_id = trx.id();
+   entry.expiration = trx.expiration;
+   entry.fee_payer = fee_payer;
+   entry.fee_per_kbyte = fee_per_kbyte;
+   entry.size = fc::raw::pack_size( trx );
+   entry.memory_usage = estimate_memory_usage( entry.size, effects.get() );
+   entry.trx = trx;
+   entry.effects = std::move( effects );
+   _memory_usage += entry.memory_usage;
+   return *_entries.insert( std::move( entry ) ).first;
+}
+
+uint64_t mempool::estimate_memory_usage( uint64_t size, const pending_transaction_effects* effects )
+{
+   // the transaction is held in memory unpacked, which takes roughly twice its packed size
+   return sizeof( mempool_entry ) + 2 * size + ( effects ? effects->memory_usage : 0 );
+}
+
+const mempool_entry* mempool::find( const transaction_id_type& id )const
+{
+   const auto& idx = _entries.get<by_trx_id>();
+   auto itr = idx.find( id );
+   return itr == idx.end() ? nullptr : &*itr;
+}
+
+void mempool::remove( const transaction_id_type& id )
+{
+   auto& idx = _entries.get<by_trx_id>();
+   auto range = idx.equal_range( id );
+   for( auto itr = range.first; itr != range.second; ++itr )
+      _memory_usage -= itr->memory_usage;
+   idx.erase( range.first, range.second );
+}
+
+vector<const mempool_entry*> mempool::select_best_paying( uint64_t max_size )const
+{
+   vector<const mempool_entry*> result;
+   result.reserve( _entries.size() );
+
+   uint64_t total_size = 0;
+   for( const mempool_entry& entry : entries() )
+      total_size += entry.size;
+   if( total_size <= max_size )
+   {
+      for( const mempool_entry& entry : entries() )
+         result.push_back( &entry );
+      return result;
+   }
+
+   // the next transaction of each fee payer, best paying first
+   const auto better_paying = []( const mempool_entry* a, const mempool_entry* b ) {
+      if( a->fee_per_kbyte != b->fee_per_kbyte )
+         return a->fee_per_kbyte > b->fee_per_kbyte;
+      return a->sequence < b->sequence;
+   };
+   std::set<const mempool_entry*, decltype(better_paying)> candidates( better_paying );
+   const auto& by_payer = entries_by_fee_payer();
+   for( auto itr = by_payer.begin(); itr != by_payer.end();
+        itr = by_payer.upper_bound( boost::make_tuple( itr->fee_payer ) ) )
+      candidates.insert( &*itr );
+
+   total_size = 0;
+   while( !candidates.empty() )
+   {
+      const mempool_entry* entry = *candidates.begin();
+      candidates.erase( candidates.begin() );
+      // the later transactions of the fee payer are skipped too
+      if( total_size + entry->size > max_size )
+         continue;
+      total_size += entry->size;
+      result.push_back( entry );
+      auto next = by_payer.iterator_to( *entry );
+      ++next;
+      if( next != by_payer.end() && next->fee_payer == entry->fee_payer )
+         candidates.insert( &*next );
+   }
+
+   std::sort( result.begin(), result.end(), []( const mempool_entry* a, const mempool_entry* b ) {
+      return a->sequence < b->sequence;
+   });
+   return result;
+}
+
+void mempool::remove( uint64_t sequence )
+{
+   auto& idx = _entries.get<by_sequence>();
+   auto itr = idx.find( sequence );
+   if( itr == idx.end() )
+      return;
+   _memory_usage -= itr->memory_usage;
+   idx.erase( itr );
+}
+
+} } // graphene::chain
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/db/chunked_allocator.hpp>
+
+#include <new>
+
+namespace graphene { namespace db {
+
+   namespace {
+      constexpr size_t block_alignment = alignof(std::max_align_t);
+
+      size_t round_up( size_t size )
+      {
+         if( size < sizeof(void*) )
+            size = sizeof(void*);
+         return ( size + block_alignment - 1 ) / block_alignment * block_alignment;
+      }
+   }
+
+   chunk_arena::size_class& chunk_arena::get_size_class( size_t size )
+   {
+      // there are only a few different node sizes per container, a linear search is fine
+      for( auto& sc : _size_classes )
+         if( sc.block_size == size )
+            return sc;
+      _size_classes.emplace_back();
+      _size_classes.back().block_size = size;
+      return _size_classes.back();
+   }
+
+   void* chunk_arena::allocate( size_t size )
+   {
+      size = round_up( size );
+      size_class& sc = get_size_class( size );
+      if( sc.free_list == nullptr )
+      {
+         const size_t chunk_size = size * _blocks_per_chunk;
+         sc.chunks.emplace_back( new char[chunk_size] );
+         _reserved_bytes += chunk_size;
+         char* chunk = sc.chunks.back().get();
+         // thread the new blocks into the free list, lowest address first
+         for( size_t i = _blocks_per_chunk; i > 0; --i )
+         {
+            free_block* block = reinterpret_cast<free_block*>( chunk + ( i - 1 ) * size );
+            block->next = sc.free_list;
+            sc.free_list = block;
+         }
+      }
+      free_block* result = sc.free_list;
+      sc.free_list = result->next;
+      _used_bytes += size;
+      return result;
+   }
+
+   void chunk_arena::deallocate( void* p, size_t size )
+   {
+      if( p == nullptr )
+         return;
+      size = round_up( size );
+      size_class& sc = get_size_class( size );
+      free_block* block = static_cast<free_block*>( p );
+      block->next = sc.free_list;
+      sc.free_list = block;
+      _used_bytes -= size;
+   }
+
+   void* chunk_arena::allocate_array( size_t size )
+   {
+      void* result = ::operator new( size );
+      _used_bytes += size;
+      _reserved_bytes += size;
+      return result;
+   }
+
+   void chunk_arena::deallocate_array( void* p, size_t size )
+   {
+      if( p == nullptr )
+         return;
+      ::operator delete( p );
+      _used_bytes -= size;
+      _reserved_bytes -= size;
+   }
+
+} } // graphene::db
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    * @class chunk_arena
+    * @brief Hands out fixed size blocks carved from large chunks of memory
+    *
+    * Single-object allocations are grouped by size, and every size is served from chunks holding many blocks,
+    * with freed blocks kept in a free list for reuse. This avoids one heap allocation per object and keeps the
+    * objects of an index close together. Memory of freed blocks is only given back when the arena is destroyed.
+    * Allocations of arrays are passed through to the heap but are accounted for.
+    *
+    * Not thread safe, like the indexes using it.
+    */
+   class chunk_arena
+   {
+      public:
+         explicit chunk_arena( size_t blocks_per_chunk = 1024 ) : _blocks_per_chunk( blocks_per_chunk ) {}
+         chunk_arena( const chunk_arena& ) = delete;
+         chunk_arena& operator=( const chunk_arena& ) = delete;
+
+         void* allocate( size_t size );
+         void  deallocate( void* p, size_t size );
+
+         void* allocate_array( size_t size );
+         void  deallocate_array( void* p, size_t size );
+
+         /// @return number of bytes currently handed out
+         size_t used_bytes()const { return _used_bytes; }
+         /// @return number of bytes taken from the heap, including unused blocks in chunks
+         size_t reserved_bytes()const { return _reserved_bytes; }
+
+      private:
+         struct free_block { free_block* next; };
+         struct size_class
+         {
+            size_t                               block_size = 0;
+            free_block*                          free_list = nullptr;
+            std::vector< std::unique_ptr<char[]> > chunks;
+         };
+
+         size_class& get_size_class( size_t size );
+
+         const size_t              _blocks_per_chunk;
+         std::vector< size_class > _size_classes;
+         size_t                    _used_bytes = 0;
+         size_t                    _reserved_bytes = 0;
+   };
+
+   /**
+    * @class chunked_allocator
+    * @brief Allocator for multi_index_container nodes backed by a @ref chunk_arena
+    *
+    * Every default constructed allocator creates its own arena which is shared by all copies and rebinds of it,
+    * so a container using this allocator gets an arena of its own.
+    */
+   template<typename T>
+   class chunked_allocator
+   {
+      public:
+         typedef T              value_type;
+         typedef T*             pointer;
+         typedef const T*       const_pointer;
+         typedef T&             reference;
+         typedef const T&       const_reference;
+         typedef std::size_t    size_type;
+         typedef std::ptrdiff_t difference_type;
+
+         template<typename U>
+         struct rebind { typedef chunked_allocator<U> other; };
+
+         chunked_allocator() : _arena( std::make_shared<chunk_arena>() ) {}
+
+         template<typename U>
+         chunked_allocator( const chunked_allocator<U>& other ) : _arena( other.get_arena() ) {}
+
+         T* allocate( size_type n )
+         {
+            if( n == 1 )
+               return static_cast<T*>( _arena->allocate( sizeof(T) ) );
+            return static_cast<T*>( _arena->allocate_array( n * sizeof(T) ) );
+         }
+
+         void deallocate( T* p, size_type n )
+         {
+            if( n == 1 )
+               _arena->deallocate( p, sizeof(T) );
+            else
+               _arena->deallocate_array( p, n * sizeof(T) );
+         }
+
+         template<typename U, typename... Args>
+         void construct( U* p, Args&&... args ) { ::new( (void*)p ) U( std::forward<Args>(args)... ); }
+
+         template<typename U>
+         void destroy( U* p ) { p->~U(); }
+
+         const std::shared_ptr<chunk_arena>& get_arena()const { return _arena; }
+
+         template<typename U>
+         bool operator==( const chunked_allocator<U>& other )const { return _arena == other.get_arena(); }
+         template<typename U>
+         bool operator!=( const chunked_allocator<U>& other )const { return _arena != other.get_arena(); }
+
+      private:
+         std::shared_ptr<chunk_arena> _arena;
+   };
+
+} } // graphene::db
@@ -23,17 +23,57 @@
  */
 #pragma once
 #include <graphene/db/index.hpp>
+#include <graphene/db/chunked_allocator.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
+#include <utility>
+
 namespace graphene { namespace db {
 
    using boost::multi_index_container;
    using namespace boost::multi_index;
 
    struct by_id;
+
+   /// Fills in the memory usage of a container if its allocator keeps track of it
+   template<typename Allocator>
+   struct allocator_memory_usage
+   {
+      static bool get( const Allocator&, index_memory_usage& ) { return false; }
+   };
+
+   template<typename T>
+   struct allocator_memory_usage< chunked_allocator<T> >
+   {
+      static bool get( const chunked_allocator<T>& alloc, index_memory_usage& usage )
+      {
+         usage.used_bytes = alloc.get_arena()->used_bytes();
+         usage.reserved_bytes = alloc.get_arena()->reserved_bytes();
+         usage.exact = true;
+         return true;
+      }
+   };
+
+   /**
+    * Objects may cache values derived from their other members, e.g. sort keys, in a member function
+    * update_derived_keys(). It is called whenever the object is created, inserted or modified, before the
+    * object is (re)indexed.
+    */
+   template<typename ObjectType, typename = void>
+   struct derived_keys
+   {
+      static void update( ObjectType& ) {}
+   };
+
+   template<typename ObjectType>
+   struct derived_keys< ObjectType, decltype( std::declval<ObjectType&>().update_derived_keys() ) >
+   {
+      static void update( ObjectType& obj ) { obj.update_derived_keys(); }
+   };
+
    /**
     *  Almost all objects can be tracked and managed via a boost::multi_index container that uses
     *  an unordered_unique key on the object ID.  This template class adapts the generic index interface
@@ -49,6 +89,7 @@ namespace graphene { namespace db {
          virtual const object& insert( object&& obj )override
          {
             assert( nullptr != dynamic_cast<ObjectType*>(&obj) );
+            derived_keys<ObjectType>::update( static_cast<ObjectType&>(obj) );
             auto insert_result = _indices.insert( std::move( static_cast<ObjectType&>(obj) ) );
             FC_ASSERT( insert_result.second, "Could not insert object, most likely a uniqueness constraint was violated" );
             return *insert_result.first;
@@ -59,6 +100,7 @@ namespace graphene { namespace db {
             ObjectType item;
             item.id = get_next_id();
             constructor( item );
+            derived_keys<ObjectType>::update( item );
             auto insert_result = _indices.insert( std::move(item) );
             FC_ASSERT(insert_result.second, "Could not create object! Most likely a uniqueness constraint is violated.");
             use_next_id();
@@ -73,6 +115,7 @@ namespace graphene { namespace db {
                                        [&m, &exc](ObjectType& o) mutable {
                                           try {
                                              m(o);
+                                             derived_keys<ObjectType>::update( o );
                                           } catch (fc::exception& e) {
                                              exc = std::current_exception();
                                              elog("Exception while modifying object: ${e} -- object may be corrupted",
@@ -110,12 +153,35 @@ namespace graphene { namespace db {
             } FC_CAPTURE_AND_RETHROW()
          }
 
+         virtual index_memory_usage get_memory_usage()const override
+         {
+            index_memory_usage usage;
+            usage.space_id = ObjectType::space_id;
+            usage.type_id = ObjectType::type_id;
+            usage.object_count = _indices.size();
+            typedef typename index_type::allocator_type allocator_type;
+            if( !allocator_memory_usage<allocator_type>::get( _indices.get_allocator(), usage ) )
+            {
+               usage.used_bytes = usage.object_count * sizeof(ObjectType);
+               usage.reserved_bytes = usage.used_bytes;
+            }
+            return usage;
+         }
+
          const index_type& indices()const { return _indices; }
 
       private:
          index_type  _indices;
    };
 
+   /**
+    * A multi_index_container whose nodes are allocated from a @ref chunk_arena instead of one by one from the
+    * heap. Meant for indexes holding a large number of small objects.
+    */
+   template<typename ObjectType, typename IndexSpecifierList>
+   using chunked_multi_index_container = multi_index_container< ObjectType, IndexSpecifierList,
+                                                                chunked_allocator<ObjectType> >;
+
    /**
     * @brief An index type for objects which may be deleted
     *
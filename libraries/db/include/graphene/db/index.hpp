@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <graphene/db/object.hpp>
+#include <graphene/db/undo_database.hpp>
 
 #include <fc/interprocess/file_mapping.hpp>
 #include <fc/io/raw.hpp>
@@ -52,6 +53,21 @@ namespace graphene { namespace db {
          virtual void on_modify( const object& obj ){}
    };
 
+   /**
+    * Memory used by the objects of an index. Unless the index keeps track of its allocations,
+    * the numbers are estimated from the object count and the object size, excluding dynamically
+    * allocated members and container overhead.
+    */
+   struct index_memory_usage
+   {
+      uint8_t  space_id = 0;
+      uint8_t  type_id = 0;
+      uint64_t object_count = 0;
+      uint64_t used_bytes = 0;     ///< bytes currently used by the objects
+      uint64_t reserved_bytes = 0; ///< bytes taken from the heap, including free space held for reuse
+      bool     exact = false;      ///< whether the byte counts are tracked or estimated
+   };
+
    /**
     *  @class index
     *  @brief abstract base class for accessing objects indexed in various ways.
@@ -98,7 +114,21 @@ namespace graphene { namespace db {
           */
          virtual void open( const fc::path& db ) = 0;
          virtual void save( const fc::path& db ) = 0;
+         /**
+          * Writes the index to out in the same format as @ref save. Unlike @ref save this does not change the
+          * state of the index, so it can be used to export the index while it is being read by other threads.
+          */
+         virtual void save_to( std::ostream& out )const = 0;
+         /**
+          * Writes the index to out in the same format as @ref save, as it was before the changes reverted by view.
+          */
+         virtual void save_to( std::ostream& out, const undo_revert_view& view )const = 0;
 
+         /**
+          * @return true if the index has been changed since it was last opened from or saved to disk,
+          *         i.e. the file written by the last @ref save or read by the last @ref open is outdated
+          */
+         virtual bool has_unsaved_changes()const { return true; }
 
 
          /** @return the object with id or nullptr if not found */
@@ -130,6 +160,7 @@ namespace graphene { namespace db {
          }
 
          virtual void               inspect_all_objects(std::function<void(const object&)> inspector)const = 0;
+         virtual index_memory_usage get_memory_usage()const = 0;
          virtual void               add_observer( const shared_ptr<index_observer>& ) = 0;
 
          virtual void               object_from_variant( const fc::variant& var, object& obj, uint32_t max_depth )const = 0;
@@ -298,6 +329,18 @@ namespace graphene { namespace db {
          };
    };
 
+   /**
+    * On-disk format of a single index, written by @ref primary_index::save:
+    *
+    *   magic (uint64) | format version (uint32) | next id | object version (sha256) |
+    *   { record size (unsigned_int) | packed object } ...
+    *
+    * The magic has the highest byte set to 0xff, which is never a valid space id, so files in this format
+    * can be told apart from the legacy format that starts with the next id directly.
+    */
+   constexpr uint64_t index_file_magic          = 0xff474f4244495846ULL;
+   constexpr uint32_t index_file_format_version = 2;
+
    /**
     * @class primary_index
     * @brief  Wraps a derived index to intercept calls to create, modify, and remove so that
@@ -325,8 +368,8 @@ namespace graphene { namespace db {
          { return object_type::type_id; }
 
          virtual object_id_type get_next_id()const override              { return _next_id;    }
-         virtual void           use_next_id()override                    { ++_next_id.number;  }
-         virtual void           set_next_id( object_id_type id )override { _next_id = id;      }
+         virtual void           use_next_id()override                    { ++_next_id.number; _dirty = true; }
+         virtual void           set_next_id( object_id_type id )override { _next_id = id; _dirty = true; }
 
          /** @return the object with id or nullptr if not found */
          virtual const object*  find( object_id_type id )const override
@@ -342,6 +385,8 @@ namespace graphene { namespace db {
             return fc::sha256::hash(desc);
          }
 
+         virtual bool has_unsaved_changes()const override { return _dirty; }
+
          virtual void open( const path& db )override
          { 
             if( !fc::exists( db ) ) return;
@@ -350,15 +395,47 @@ namespace graphene { namespace db {
             fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
             fc::sha256 open_ver;
 
+            uint64_t magic = 0;
+            if( ds.remaining() >= sizeof(magic) )
+               fc::raw::unpack( ds, magic );
+            if( magic != index_file_magic )
+            {
+               // legacy format: every object is a packed vector<char> holding the packed object
+               ds.seekp( 0 );
+               fc::raw::unpack(ds, _next_id);
+               fc::raw::unpack(ds, open_ver);
+               FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
+               vector<char> tmp;
+               while( ds.remaining() > 0 )
+               {
+                  fc::raw::unpack( ds, tmp );
+                  load( tmp );
+               }
+               // rewrite in the current format on next flush
+               _dirty = true;
+               return;
+            }
+
+            uint32_t format_version = 0;
+            fc::raw::unpack( ds, format_version );
+            FC_ASSERT( format_version == index_file_format_version,
+                       "Unsupported object database file format version ${v} in ${f}",
+                       ("v",format_version)("f",db) );
             fc::raw::unpack(ds, _next_id);
             fc::raw::unpack(ds, open_ver);
             FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
-            vector<char> tmp;
             while( ds.remaining() > 0 )
             {
-               fc::raw::unpack( ds, tmp );
-               load( tmp );
+               fc::unsigned_int record_size;
+               fc::raw::unpack( ds, record_size );
+               FC_ASSERT( ds.remaining() >= record_size.value, "Truncated record in ${f}", ("f",db) );
+               const auto before = ds.remaining();
+               object_type obj;
+               fc::raw::unpack( ds, obj );
+               FC_ASSERT( before - ds.remaining() == record_size.value, "Corrupted record in ${f}", ("f",db) );
+               load_object( std::move(obj) );
             }
+            _dirty = false;
          }
 
          virtual void save( const path& db ) override 
@@ -366,22 +443,31 @@ namespace graphene { namespace db {
             std::ofstream out( db.generic_string(), 
                                std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
             FC_ASSERT( out );
-            auto ver  = get_object_version();
-            fc::raw::pack( out, _next_id );
-            fc::raw::pack( out, ver );
-            this->inspect_all_objects( [&]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
+            save_to( out );
+            out.close();
+            FC_ASSERT( !out.fail(), "Failed to write ${f}", ("f",db) );
+            _dirty = false;
+         }
+
+         virtual void save_to( std::ostream& out )const override
+         {
+            save_header( out, _next_id );
+            this->inspect_all_objects( [&out]( const object& o ) {
+                save_record( out, static_cast<const object_type&>(o) );
+            });
+         }
+
+         virtual void save_to( std::ostream& out, const undo_revert_view& view )const override
+         {
+            save_header( out, view.get_next_id( *this ) );
+            view.inspect_all_objects( *this, [&out]( const object& o ) {
+                save_record( out, static_cast<const object_type&>(o) );
             });
          }
 
          virtual const object&  load( const std::vector<char>& data )override
          {
-            const auto& result = DerivedIndex::insert( fc::raw::unpack<object_type>( data ) );
-            for( const auto& item : _sindex )
-               item->object_inserted( result );
-            return result;
+            return load_object( fc::raw::unpack<object_type>( data ) );
          }
 
 
@@ -390,6 +476,7 @@ namespace graphene { namespace db {
             const auto& result = DerivedIndex::create( constructor );
             for( const auto& item : _sindex )
                item->object_inserted( result );
+            _dirty = true;
             on_add( result );
             return result;
          }
@@ -399,6 +486,7 @@ namespace graphene { namespace db {
             const auto& result = DerivedIndex::insert( std::move( obj ) );
             for( const auto& item : _sindex )
                item->object_inserted( result );
+            _dirty = true;
             on_add( result );
             return result;
          }
@@ -408,6 +496,7 @@ namespace graphene { namespace db {
             for( const auto& item : _sindex )
                item->object_removed( obj );
             on_remove(obj);
+            _dirty = true;
             DerivedIndex::remove(obj);
          }
 
@@ -416,6 +505,7 @@ namespace graphene { namespace db {
             save_undo( obj );
             for( const auto& item : _sindex )
                item->about_to_modify( obj );
+            _dirty = true;
             DerivedIndex::modify( obj, m );
             for( const auto& item : _sindex )
                item->object_modified( obj );
@@ -446,8 +536,35 @@ namespace graphene { namespace db {
          }
 
       private:
+         void save_header( std::ostream& out, object_id_type next_id )const
+         {
+            fc::raw::pack( out, index_file_magic );
+            fc::raw::pack( out, index_file_format_version );
+            fc::raw::pack( out, next_id );
+            fc::raw::pack( out, get_object_version() );
+         }
+
+         static void save_record( std::ostream& out, const object_type& obj )
+         {
+            fc::raw::pack( out, fc::unsigned_int( fc::raw::pack_size( obj ) ) );
+            fc::raw::pack( out, obj );
+         }
+
+         const object& load_object( object_type&& obj )
+         {
+            const auto& result = DerivedIndex::insert( std::move( obj ) );
+            for( const auto& item : _sindex )
+               item->object_inserted( result );
+            return result;
+         }
+
          object_id_type                                 _next_id;
          const direct_index< object_type, DirectBits >* _direct_by_id = nullptr;
+         /// whether the index has changed since it was last opened from or saved to disk
+         bool                                           _dirty = true;
    };
 
 } } // graphene::db
+
+FC_REFLECT( graphene::db::index_memory_usage,
+            (space_id)(type_id)(object_count)(used_bytes)(reserved_bytes)(exact) )
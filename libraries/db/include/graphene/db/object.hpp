@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <boost/multiprecision/integer.hpp>
+#include <graphene/protocol/json_writer.hpp>
 #include <graphene/protocol/object_id.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/crypto/city.hpp>
@@ -72,7 +73,13 @@ namespace graphene { namespace db {
          virtual unique_ptr<object> clone()const = 0;
          virtual void               move_from( object& obj ) = 0;
          virtual variant            to_variant()const  = 0;
+         /// appends the object as JSON to buffer, same as fc::json::to_string( to_variant() ) but without the variant
+         virtual void               to_json( std::string& buffer )const = 0;
          virtual vector<char>       pack()const = 0;
+         /// appends the packed object to buffer
+         virtual void               pack_to( vector<char>& buffer )const = 0;
+         /// replaces the content of this object with the packed object in data
+         virtual void               unpack_from( const char* data, size_t size ) = 0;
    };
 
    /**
@@ -96,7 +103,27 @@ namespace graphene { namespace db {
             static_cast<DerivedClass&>(*this) = std::move( static_cast<DerivedClass&>(obj) );
          }
          virtual variant to_variant()const { return variant( static_cast<const DerivedClass&>(*this), MAX_NESTING ); }
+         virtual void to_json( std::string& buffer )const
+         {
+            graphene::protocol::json_writer( buffer, MAX_NESTING ).write( static_cast<const DerivedClass&>(*this) );
+         }
          virtual vector<char> pack()const  { return fc::raw::pack( static_cast<const DerivedClass&>(*this) ); }
+         virtual void pack_to( vector<char>& buffer )const
+         {
+            const DerivedClass& self = static_cast<const DerivedClass&>(*this);
+            const size_t offset = buffer.size();
+            buffer.resize( offset + fc::raw::pack_size( self ) );
+            fc::datastream<char*> ds( buffer.data() + offset, buffer.size() - offset );
+            fc::raw::pack( ds, self );
+         }
+         virtual void unpack_from( const char* data, size_t size )
+         {
+            // unpack into a fresh object, unpacking does not reset all members, e.g. absent optionals
+            DerivedClass tmp;
+            fc::datastream<const char*> ds( data, size );
+            fc::raw::unpack( ds, tmp );
+            static_cast<DerivedClass&>(*this) = std::move( tmp );
+         }
    };
 
    typedef flat_map<uint8_t, object_id_type> annotation_map;
@@ -48,8 +48,11 @@ namespace graphene { namespace db {
 
          /**
           * Saves the complete state of the object_database to disk, this could take a while
+          *
+          * @param incremental if true, indexes that have not changed since the last @ref open or @ref flush
+          *                    are taken over from the previous checkpoint instead of being written again
           */
-         void flush();
+         void flush( bool incremental = false );
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
@@ -77,9 +80,26 @@ namespace graphene { namespace db {
          const index&  get_index(object_id_type id)const { return get_index(id.space(),id.type()); }
          /// @}
 
+         /// Calls inspector for every index that has been added, ordered by space and type
+         void inspect_all_indexes( const std::function<void(const index&)>& inspector )const;
+
+         /// @return memory usage of every index
+         vector<index_memory_usage> get_memory_usage()const;
+
          const object& get_object( object_id_type id )const;
          const object* find_object( object_id_type id )const;
 
+         /**
+          * While a recorder is set, the IDs of all objects looked up through @ref get_object and @ref find_object,
+          * which includes the typed getters, are added to it. Lookups through secondary indexes are not recorded.
+          * @return the previous recorder
+          */
+         flat_set<object_id_type>* set_read_recorder( flat_set<object_id_type>* recorder )
+         {
+            std::swap( _read_recorder, recorder );
+            return recorder;
+         }
+
          /// These methods are mutators of the object_database. You must use these methods to make changes to the object_database,
          /// in order to maintain proper undo history.
          ///@{
@@ -176,6 +196,9 @@ namespace graphene { namespace db {
 
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
+         /// whether the files in the object_database directory reflect the indexes' last opened or saved state
+         bool                                                      _checkpoint_valid = false;
+         flat_set<object_id_type>*                                 _read_recorder = nullptr;
    };
 
 } } // graphene::db
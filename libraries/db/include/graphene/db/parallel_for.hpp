@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <functional>
+
+namespace graphene { namespace db {
+
+   /**
+    * Calls task( i ) for every i in [0, count) on up to max_threads threads including the calling one, and returns
+    * when all calls have returned. 0 threads means one per hardware thread.
+    *
+    * Unlike waiting for tasks started with fc::do_parallel, this blocks the calling thread without yielding to its
+    * other fibers, so nothing on that thread can change the object database while the tasks read it.
+    * The first exception thrown by a task is rethrown after all tasks have finished.
+    */
+   void parallel_for( size_t count, const std::function<void(size_t)>& task, size_t max_threads = 0 );
+
+} } // graphene::db
@@ -99,6 +99,19 @@ namespace graphene { namespace db {
             } FC_CAPTURE_AND_RETHROW()
          }
 
+         virtual index_memory_usage get_memory_usage()const override
+         {
+            index_memory_usage usage;
+            usage.space_id = T::space_id;
+            usage.type_id = T::type_id;
+            for( const auto& ptr : _objects )
+               if( ptr )
+                  ++usage.object_count;
+            usage.used_bytes = usage.object_count * sizeof(T) + _objects.size() * sizeof(unique_ptr<object>);
+            usage.reserved_bytes = usage.object_count * sizeof(T) + _objects.capacity() * sizeof(unique_ptr<object>);
+            return usage;
+         }
+
          class const_iterator
          {
             public:
@@ -24,6 +24,8 @@
 #pragma once
 #include <graphene/db/object.hpp>
 #include <deque>
+#include <functional>
+#include <map>
 #include <fc/exception/exception.hpp>
 
 namespace graphene { namespace db {
@@ -31,10 +33,64 @@ namespace graphene { namespace db {
    using std::unordered_map;
    using fc::flat_set;
    class object_database;
+   class index;
+
+   /**
+    * @class undo_preimage_log
+    * @brief Values of objects before their first modification in an undo session
+    *
+    * The values are packed one after another into a single buffer owned by the session, and looked up through an
+    * open addressing hash table, so recording a modification neither copies the object on the heap nor allocates
+    * a map node. Erased values stay in the buffer until the session ends.
+    */
+   class undo_preimage_log
+   {
+      public:
+         bool   contains( object_id_type id )const { return find( id ) != nullptr; }
+         size_t size()const { return _live; }
+         bool   empty()const { return _live == 0; }
+
+         /// records the current value of obj, which must not be recorded already
+         void   save( const object& obj );
+         /// records the value of id recorded in other
+         void   copy_from( const undo_preimage_log& other, object_id_type id );
+         /// replaces the content of obj with its recorded value
+         void   restore( object& obj )const;
+         /// @return a copy of the recorded value, current is an object of the same type
+         unique_ptr<object> get( const object& current )const;
+         void   erase( object_id_type id );
+
+         /// calls f( id ) for every recorded object, in the order of recording
+         template<typename Functor>
+         void   for_each_id( Functor&& f )const
+         {
+            for( const auto& r : _records )
+               if( !r.erased )
+                  f( r.id );
+         }
+
+      private:
+         struct record
+         {
+            object_id_type id;
+            size_t         offset = 0;
+            size_t         size = 0;
+            bool           erased = false;
+         };
+
+         const record* find( object_id_type id )const;
+         size_t        find_slot( object_id_type id )const;
+         void          add_record( object_id_type id, size_t offset );
+
+         vector<char>     _buffer;
+         vector<record>   _records;
+         vector<uint32_t> _table; ///< 1 + index into _records, or 0 for an empty slot
+         size_t           _live = 0;
+   };
 
    struct undo_state
    {
-      unordered_map<object_id_type, unique_ptr<object> > old_values;
+      undo_preimage_log                                  old_values;
       unordered_map<object_id_type, object_id_type>      old_index_next_ids;
       std::unordered_set<object_id_type>                 new_ids;
       unordered_map<object_id_type, unique_ptr<object> > removed;
@@ -124,6 +180,8 @@ namespace graphene { namespace db {
          const undo_state& head()const;
 
       private:
+         friend class undo_revert_view;
+
          void undo();
          void merge();
          void commit();
@@ -135,4 +193,30 @@ namespace graphene { namespace db {
          size_t                  _max_size = 256;
    };
 
+   /**
+    * @class undo_revert_view
+    * @brief Read-only view of the objects as they were before the changes recorded in the newest undo states
+    *
+    * The view does not change the database. Neither the objects nor the undo states must be changed while the view
+    * is used, but several threads can read through it at the same time.
+    */
+   class undo_revert_view
+   {
+      public:
+         /// Reverts the newest count states of undo_db
+         undo_revert_view( const undo_database& undo_db, size_t count );
+
+         /// @return the next ID of idx before the reverted changes
+         object_id_type get_next_id( const index& idx )const;
+         /// Calls inspector for every object of idx before the reverted changes, ordered by ID if idx iterates by ID
+         void inspect_all_objects( const index& idx, const std::function<void(const object&)>& inspector )const;
+
+      private:
+         enum class change_type { none, created, modified, removed };
+         /// @return the first change of id in the reverted states older than the state with index end
+         std::pair<change_type, const undo_state*> find_first_change( object_id_type id, size_t end )const;
+
+         vector<const undo_state*> _states; ///< oldest first
+   };
+
 } } // graphene::db
@@ -44,10 +44,14 @@ void object_database::close()
 
 const object* object_database::find_object( object_id_type id )const
 {
+   if( _read_recorder != nullptr )
+      _read_recorder->insert( id );
    return get_index(id.space(),id.type()).find( id );
 }
 const object& object_database::get_object( object_id_type id )const
 {
+   if( _read_recorder != nullptr )
+      _read_recorder->insert( id );
    return get_index(id.space(),id.type()).get( id );
 }
 
@@ -80,12 +84,34 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
    return *idx;
 }
 
-void object_database::flush()
+void object_database::inspect_all_indexes( const std::function<void(const index&)>& inspector )const
+{
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            inspector( *idx );
+}
+
+vector<index_memory_usage> object_database::get_memory_usage()const
+{
+   vector<index_memory_usage> result;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            result.push_back( idx->get_memory_usage() );
+   return result;
+}
+
+void object_database::flush( bool incremental )
 {
    const auto tmp_dir = _data_dir / "object_database.tmp";
    const auto old_dir = _data_dir / "object_database.old";
    const auto target_dir = _data_dir / "object_database";
 
+   // unchanged indexes can only be taken over if the files in target_dir reflect their current state
+   incremental = incremental && _checkpoint_valid && fc::exists( target_dir ) && !fc::exists( target_dir / "lock" );
+   _checkpoint_valid = false;
+
    if( fc::exists( tmp_dir ) )
       fc::remove_all( tmp_dir );
    fc::create_directories( tmp_dir / "lock" );
@@ -93,11 +119,27 @@ void object_database::flush()
    constexpr size_t max_tasks = 200;
    tasks.reserve(max_tasks);
 
-   auto push_task = [this,&tasks,&tmp_dir]( size_t space, size_t type ) {
-      if( _index[space][type] )
-         tasks.push_back( fc::do_parallel( [this,space,type,&tmp_dir] () {
-            _index[space][type]->save( tmp_dir / fc::to_string(space) / fc::to_string(type) );
-         } ) );
+   size_t saved = 0;
+   size_t reused = 0;
+   auto push_task = [this,&tasks,&tmp_dir,&target_dir,incremental,&saved,&reused]( size_t space, size_t type ) {
+      if( !_index[space][type] )
+         return;
+      const auto rel_path = fc::path( fc::to_string(space) ) / fc::to_string(type);
+      if( incremental && !_index[space][type]->has_unsaved_changes() && fc::exists( target_dir / rel_path ) )
+      {
+         try {
+            fc::create_hard_link( target_dir / rel_path, tmp_dir / rel_path );
+         } catch( const fc::exception& ) {
+            // hard links may be unsupported by the file system
+            fc::copy( target_dir / rel_path, tmp_dir / rel_path );
+         }
+         ++reused;
+         return;
+      }
+      ++saved;
+      tasks.push_back( fc::do_parallel( [this,space,type,&tmp_dir,rel_path] () {
+         _index[space][type]->save( tmp_dir / rel_path );
+      } ) );
    };
 
    const auto spaces = _index.size();
@@ -119,6 +161,10 @@ void object_database::flush()
    }
    fc::rename( tmp_dir, target_dir );
    fc::remove_all( old_dir );
+   _checkpoint_valid = true;
+   if( incremental )
+      ilog( "Incremental object database checkpoint: ${s} indexes written, ${r} unchanged",
+            ("s",saved)("r",reused) );
 }
 
 void object_database::wipe(const fc::path& data_dir)
@@ -126,6 +172,7 @@ void object_database::wipe(const fc::path& data_dir)
    close();
    ilog("Wiping object database...");
    fc::remove_all(data_dir / "object_database");
+   _checkpoint_valid = false;
    ilog("Done wiping object database.");
 }
 
@@ -157,6 +204,7 @@ void object_database::open(const fc::path& data_dir)
    }
    for( auto& task : tasks )
       task.wait();
+   _checkpoint_valid = true;
    ilog( "Done opening object database." );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/db/parallel_for.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace graphene { namespace db {
+
+void parallel_for( size_t count, const std::function<void(size_t)>& task, size_t max_threads )
+{
+   if( max_threads == 0 )
+      max_threads = std::max<size_t>( std::thread::hardware_concurrency(), 1 );
+   const size_t num_threads = std::min( count, max_threads );
+
+   std::atomic<size_t> next{ 0 };
+   std::mutex          error_mutex;
+   std::exception_ptr  error;
+   auto run = [&task,count,&next,&error_mutex,&error]() {
+      for( size_t i = next++; i < count; i = next++ )
+      {
+         try
+         {
+            task( i );
+         }
+         catch( ... )
+         {
+            std::lock_guard<std::mutex> guard( error_mutex );
+            if( !error )
+               error = std::current_exception();
+         }
+      }
+   };
+
+   std::vector<std::thread> threads;
+   if( num_threads > 1 )
+   {
+      threads.reserve( num_threads - 1 );
+      try
+      {
+         for( size_t t = 1; t < num_threads; ++t )
+            threads.emplace_back( run );
+      }
+      catch( const std::system_error& )
+      {
+         // continue with the threads that could be started
+      }
+   }
+   run();
+   for( auto& thread : threads )
+      thread.join();
+
+   if( error )
+      std::rethrow_exception( error );
+}
+
+} } // graphene::db
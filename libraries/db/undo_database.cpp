@@ -25,8 +25,97 @@
 #include <graphene/db/undo_database.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <algorithm>
+
 namespace graphene { namespace db {
 
+namespace {
+   size_t preimage_hash( object_id_type id )
+   {
+      // Fibonacci hashing, ids of the same type only differ in the lowest bits
+      return size_t( ( id.number * 0x9E3779B97F4A7C15ULL ) >> 32 );
+   }
+}
+
+size_t undo_preimage_log::find_slot( object_id_type id )const
+{
+   const size_t mask = _table.size() - 1;
+   size_t slot = preimage_hash( id ) & mask;
+   while( _table[slot] != 0 && _records[_table[slot] - 1].id != id )
+      slot = ( slot + 1 ) & mask;
+   return slot;
+}
+
+const undo_preimage_log::record* undo_preimage_log::find( object_id_type id )const
+{
+   if( _table.empty() )
+      return nullptr;
+   const uint32_t entry = _table[ find_slot( id ) ];
+   if( entry == 0 || _records[entry - 1].erased )
+      return nullptr;
+   return &_records[entry - 1];
+}
+
+void undo_preimage_log::add_record( object_id_type id, size_t offset )
+{
+   // keep the table at most half full
+   if( ( _records.size() + 1 ) * 2 > _table.size() )
+   {
+      _table.assign( std::max<size_t>( 16, _table.size() * 2 ), 0 );
+      for( size_t i = 0; i < _records.size(); ++i )
+         _table[ find_slot( _records[i].id ) ] = uint32_t( i + 1 );
+   }
+   record r;
+   r.id = id;
+   r.offset = offset;
+   r.size = _buffer.size() - offset;
+   // a previously erased record of the same id is replaced in the table
+   _table[ find_slot( id ) ] = uint32_t( _records.size() + 1 );
+   _records.push_back( r );
+   ++_live;
+}
+
+void undo_preimage_log::save( const object& obj )
+{
+   assert( !contains( obj.id ) );
+   const size_t offset = _buffer.size();
+   obj.pack_to( _buffer );
+   add_record( obj.id, offset );
+}
+
+void undo_preimage_log::copy_from( const undo_preimage_log& other, object_id_type id )
+{
+   assert( !contains( id ) );
+   const record* r = other.find( id );
+   FC_ASSERT( r != nullptr, "No undo record of object ${id}", ("id",id) );
+   const size_t offset = _buffer.size();
+   _buffer.insert( _buffer.end(), other._buffer.begin() + r->offset, other._buffer.begin() + r->offset + r->size );
+   add_record( id, offset );
+}
+
+void undo_preimage_log::restore( object& obj )const
+{
+   const record* r = find( obj.id );
+   FC_ASSERT( r != nullptr, "No undo record of object ${id}", ("id",obj.id) );
+   obj.unpack_from( _buffer.data() + r->offset, r->size );
+}
+
+unique_ptr<object> undo_preimage_log::get( const object& current )const
+{
+   unique_ptr<object> result = current.clone();
+   restore( *result );
+   return result;
+}
+
+void undo_preimage_log::erase( object_id_type id )
+{
+   const record* r = find( id );
+   if( r == nullptr )
+      return;
+   const_cast<record*>( r )->erased = true;
+   --_live;
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -79,9 +168,8 @@ void undo_database::on_modify( const object& obj )
    auto& state = _stack.back();
    if( state.new_ids.find(obj.id) != state.new_ids.end() )
       return;
-   auto itr =  state.old_values.find(obj.id);
-   if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   if( state.old_values.contains(obj.id) ) return;
+   state.old_values.save( obj );
 }
 void undo_database::on_remove( const object& obj )
 {
@@ -95,9 +183,9 @@ void undo_database::on_remove( const object& obj )
       state.new_ids.erase(obj.id);
       return;
    }
-   if( state.old_values.count(obj.id) > 0 )
+   if( state.old_values.contains(obj.id) )
    {
-      state.removed[obj.id] = std::move(state.old_values[obj.id]);
+      state.removed[obj.id] = state.old_values.get( obj );
       state.old_values.erase(obj.id);
       return;
    }
@@ -112,10 +200,9 @@ void undo_database::undo()
    disable();
 
    auto& state = _stack.back();
-   for( auto& item : state.old_values )
-   {
-      _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
-   }
+   state.old_values.for_each_id( [this,&state]( object_id_type id ) {
+      _db.modify( _db.get_object( id ), [&state]( object& obj ){ state.old_values.restore( obj ); } );
+   });
 
    for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
    {
@@ -191,23 +278,22 @@ void undo_database::merge()
    // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's three containers.
 
    // *+upd
-   for( auto& obj : state.old_values )
-   {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
+   state.old_values.for_each_id( [&state,&prev_state]( object_id_type id ) {
+      if( prev_state.new_ids.find(id) != prev_state.new_ids.end() )
       {
          // new+upd -> new, type A
-         continue;
+         return;
       }
-      if( prev_state.old_values.find(obj.second->id) != prev_state.old_values.end() )
+      if( prev_state.old_values.contains(id) )
       {
          // upd(was=X) + upd(was=Y) -> upd(was=X), type A
-         continue;
+         return;
       }
       // del+upd -> N/A
-      assert( prev_state.removed.find(obj.second->id) == prev_state.removed.end() );
+      assert( prev_state.removed.find(id) == prev_state.removed.end() );
       // nop+upd(was=Y) -> upd(was=Y), type B
-      prev_state.old_values[obj.second->id] = std::move(obj.second);
-   }
+      prev_state.old_values.copy_from( state.old_values, id );
+   });
 
    // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
    for( auto id : state.new_ids )
@@ -239,12 +325,12 @@ void undo_database::merge()
          prev_state.new_ids.erase(obj.second->id);
          continue;
       }
-      auto it = prev_state.old_values.find(obj.second->id);
-      if( it != prev_state.old_values.end() )
+      if( prev_state.old_values.contains(obj.second->id) )
       {
          // upd(was=X) + del(was=Y) -> del(was=X)
-         prev_state.removed[obj.second->id] = std::move(it->second);
-         prev_state.old_values.erase(obj.second->id);
+         prev_state.old_values.restore( *obj.second );
+         prev_state.removed[obj.first] = std::move(obj.second);
+         prev_state.old_values.erase(obj.first);
          continue;
       }
       // del + del -> N/A
@@ -270,10 +356,9 @@ void undo_database::pop_commit()
    try {
       auto& state = _stack.back();
 
-      for( auto& item : state.old_values )
-      {
-         _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
-      }
+      state.old_values.for_each_id( [this,&state]( object_id_type id ) {
+         _db.modify( _db.get_object( id ), [&state]( object& obj ){ state.old_values.restore( obj ); } );
+      });
 
       for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
       {
@@ -304,4 +389,87 @@ const undo_state& undo_database::head()const
    return _stack.back();
 }
 
+undo_revert_view::undo_revert_view( const undo_database& undo_db, size_t count )
+{
+   FC_ASSERT( count <= undo_db._stack.size(), "Can not revert ${c} undo states, only ${s} are recorded",
+              ("c",count)("s",undo_db._stack.size()) );
+   _states.reserve( count );
+   for( size_t i = undo_db._stack.size() - count; i < undo_db._stack.size(); ++i )
+      _states.push_back( &undo_db._stack[i] );
+}
+
+std::pair<undo_revert_view::change_type, const undo_state*> undo_revert_view::find_first_change(
+      object_id_type id, size_t end )const
+{
+   for( size_t i = 0; i < end; ++i )
+   {
+      const undo_state* state = _states[i];
+      if( state->new_ids.find( id ) != state->new_ids.end() )
+         return std::make_pair( change_type::created, state );
+      if( state->old_values.contains( id ) )
+         return std::make_pair( change_type::modified, state );
+      if( state->removed.find( id ) != state->removed.end() )
+         return std::make_pair( change_type::removed, state );
+   }
+   return std::make_pair( change_type::none, nullptr );
+}
+
+object_id_type undo_revert_view::get_next_id( const index& idx )const
+{
+   const object_id_type index_id( idx.object_space_id(), idx.object_type_id(), 0 );
+   for( const undo_state* state : _states )
+   {
+      auto itr = state->old_index_next_ids.find( index_id );
+      if( itr != state->old_index_next_ids.end() )
+         return itr->second;
+   }
+   return idx.get_next_id();
+}
+
+void undo_revert_view::inspect_all_objects( const index& idx,
+                                            const std::function<void(const object&)>& inspector )const
+{
+   // Objects removed by the reverted changes are no longer in the index, they are reported in the order of their
+   // instances between the objects of the index
+   std::map< uint64_t, unique_ptr<object> > removed;
+   for( size_t i = 0; i < _states.size(); ++i )
+   {
+      for( const auto& item : _states[i]->removed )
+      {
+         if( item.first.space() != idx.object_space_id() || item.first.type() != idx.object_type_id() )
+            continue;
+         const auto change = find_first_change( item.first, i );
+         if( change.first == change_type::none )
+            removed[ item.first.instance() ] = item.second->clone();
+         else if( change.first == change_type::modified )
+            removed[ item.first.instance() ] = change.second->old_values.get( *item.second );
+         // objects created by a reverted change did not exist before
+      }
+   }
+
+   auto next_removed = removed.begin();
+   idx.inspect_all_objects( [this,&inspector,&removed,&next_removed]( const object& obj ) {
+      for( ; next_removed != removed.end() && next_removed->first < obj.id.instance(); ++next_removed )
+         inspector( *next_removed->second );
+      const auto change = find_first_change( obj.id, _states.size() );
+      switch( change.first )
+      {
+         case change_type::none:
+            inspector( obj );
+            break;
+         case change_type::modified:
+            inspector( *change.second->old_values.get( obj ) );
+            break;
+         case change_type::removed:
+            // removed objects are never inserted again, except by undoing the removal
+            inspector( *change.second->removed.at( obj.id ) );
+            break;
+         case change_type::created:
+            break;
+      }
+   });
+   for( ; next_removed != removed.end(); ++next_removed )
+      inspector( *next_removed->second );
+}
+
 } } // graphene::db
@@ -32,6 +32,8 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/typename.hpp>
 
+#include <memory>
+
 namespace graphene { namespace net {
 
   /**
@@ -116,6 +118,52 @@ namespace graphene { namespace net {
      }
   };
 
+  /**
+   *  A message serialized once in the form it is written to a connection: the header, the data, and zero
+   *  padding up to a multiple of 16 bytes.  It is immutable, so that the send queues of any number of peers
+   *  can share it instead of each holding a copy.
+   */
+  class packed_message
+  {
+  public:
+     explicit packed_message( const message& m );
+
+     /// the header, data and padding
+     const std::vector<char>& buffer()const { return _buffer; }
+     uint32_t    msg_type()const { return _msg_type; }
+     const char* data()const { return _buffer.data() + sizeof(message_header); }
+     uint32_t    data_size()const { return _data_size; }
+
+     /// @return the hash of the data, the same as message::id()
+     message_hash_type id()const;
+     /// @return a copy of the message
+     message get_message()const;
+
+     template<typename T>
+     T as()const
+     {
+         try {
+          FC_ASSERT( _msg_type == T::type );
+          T tmp;
+          fc::datastream<const char*> ds( data(), _data_size );
+          fc::raw::unpack( ds, tmp );
+          return tmp;
+         } FC_RETHROW_EXCEPTIONS( warn,
+              "error unpacking network message as a '${type}'  ${x} !=? ${msg_type}",
+              ("type", fc::get_typename<T>::name() )
+              ("x", T::type)
+              ("msg_type", _msg_type)
+              );
+     }
+
+  private:
+     std::vector<char> _buffer;
+     uint32_t          _msg_type;
+     uint32_t          _data_size;
+  };
+
+  using packed_message_ptr = std::shared_ptr<const packed_message>;
+
 } } // graphene::net
 
 FC_REFLECT_TYPENAME( graphene::net::message_header )
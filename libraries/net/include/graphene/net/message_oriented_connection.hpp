@@ -52,6 +52,8 @@ namespace graphene { namespace net {
        void connect_to(const fc::ip::endpoint& remote_endpoint);
 
        void send_message(const message& message_to_send);
+       /// sends a message which is already packed, e.g. one shared with other connections
+       void send_message(const packed_message& message_to_send);
        void close_connection();
        void destroy_connection();
 
@@ -66,7 +66,7 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual packed_message_ptr get_message_for_item(const item_id& item) = 0;
     };
 
     using peer_connection_ptr = std::shared_ptr<peer_connection>;
@@ -120,7 +120,7 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual packed_message_ptr get_message(peer_connection_delegate* node) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -142,7 +142,22 @@ namespace graphene { namespace net
           message_send_time_field_offset(message_send_time_field_offset)
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        packed_message_ptr get_message(peer_connection_delegate* node) override;
+        size_t get_size_in_queue() override;
+      };
+
+      /* when you queue up a 'shared_queued_message', the packed message is shared with the
+       * queues of all other peers it is sent to
+       */
+      struct shared_queued_message : queued_message
+      {
+        packed_message_ptr message_to_send;
+
+        explicit shared_queued_message(packed_message_ptr message_to_send) :
+          message_to_send(std::move(message_to_send))
+        {}
+
+        packed_message_ptr get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -158,13 +173,13 @@ namespace graphene { namespace net
           item_to_send(std::move(the_item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        packed_message_ptr get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
 
       size_t _total_queued_messages_size = 0;
-      std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message> > > _queued_messages;
+      std::queue<std::unique_ptr<queued_message> > _queued_messages;
       fc::future<void> _send_queued_messages_done;
     public:
       fc::time_point connection_initiation_time;
@@ -283,12 +298,18 @@ namespace graphene { namespace net
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      /// queues a packed message without copying it, for messages sent to many peers
+      void send_message(packed_message_ptr message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection();
 
       uint64_t get_total_bytes_sent() const;
       uint64_t get_total_bytes_received() const;
+      /// @return the number of messages waiting to be sent to the peer
+      size_t get_queued_message_count() const { return _queued_messages.size(); }
+      /// @return the bytes of the messages waiting to be sent, shared messages are counted in full
+      size_t get_queued_messages_size() const { return _total_queued_messages_size; }
 
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
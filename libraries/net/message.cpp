@@ -25,8 +25,40 @@
 
 #include <graphene/net/message.hpp>
 
+#include <cstring>
+
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::message_header, BOOST_PP_SEQ_NIL, (size)(msg_type) )
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::message, (graphene::net::message_header), (data) )
 
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::message_header)
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::message)
+
+namespace graphene { namespace net {
+
+packed_message::packed_message( const message& m )
+   : _msg_type( m.msg_type.value() ), _data_size( m.size.value() )
+{
+   const size_t size_of_message_and_header = sizeof(message_header) + _data_size;
+   // pad the message we send to a multiple of 16 bytes
+   const size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
+   _buffer.resize( size_with_padding );
+   memcpy( _buffer.data(), (const char*)&m, sizeof(message_header) );
+   memcpy( _buffer.data() + sizeof(message_header), m.data.data(), _data_size );
+   memset( _buffer.data() + size_of_message_and_header, 0, size_with_padding - size_of_message_and_header );
+}
+
+message_hash_type packed_message::id()const
+{
+   return fc::ripemd160::hash( data(), _data_size );
+}
+
+message packed_message::get_message()const
+{
+   message result;
+   result.msg_type = _msg_type;
+   result.size = _data_size;
+   result.data.assign( data(), data() + _data_size );
+   return result;
+}
+
+} } // graphene::net
@@ -158,8 +158,9 @@ private:
    struct block_clock_index{};
    struct message_info
    {
-      message_hash_type message_hash;
-      message           message_body;
+      message_hash_type  message_hash;
+      /// packed once, shared by the send queues of all peers requesting it
+      packed_message_ptr message_body;
       uint32_t          block_clock_when_received;
 
       /// for network performance stats
@@ -169,12 +170,12 @@ private:
       message_hash_type message_contents_hash;
 
       message_info( const message_hash_type& message_hash,
-                    const message&           message_body,
+                    packed_message_ptr       message_body,
                     uint32_t                 block_clock_when_received,
                     const message_propagation_data& propagation_data,
                     message_hash_type        message_contents_hash ) :
             message_hash( message_hash ),
-            message_body( message_body ),
+            message_body( std::move(message_body) ),
             block_clock_when_received( block_clock_when_received ),
             propagation_data( propagation_data ),
             message_contents_hash( message_contents_hash )
@@ -200,7 +201,7 @@ public:
                        const message_hash_type& hash_of_message_to_cache,
                        const message_propagation_data& propagation_data,
                        const message_hash_type& message_content_hash );
-   message get_message( const message_hash_type& hash_of_message_to_lookup ) const;
+   packed_message_ptr get_message( const message_hash_type& hash_of_message_to_lookup ) const;
    message_propagation_data get_message_propagation_data(
          const message_hash_type& hash_of_msg_contents_to_lookup ) const;
    size_t size() const { return _message_cache.size(); }
@@ -777,7 +778,7 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      packed_message_ptr         get_message_for_item(const item_id& item) override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
@@ -37,6 +37,8 @@
 
 #include <fc/thread/thread.hpp>
 
+#include <functional>
+
 namespace graphene { namespace account_history {
 
 namespace detail
@@ -63,6 +65,27 @@ class account_history_plugin_impl
       friend class graphene::account_history::account_history_plugin;
 
    private:
+      /**
+       *  Rewinds the position up to which objects have been moved to the store when an object before it is
+       *  inserted, i.e. when ids are reused after blocks were popped or when undo restores removed objects.
+       *  Storing is idempotent, so these objects are checked against the store and removed from memory again.
+       */
+      template<typename IdType>
+      class store_position_index : public secondary_index
+      {
+         public:
+            explicit store_position_index( IdType& next_to_store ) : _next_to_store( next_to_store ) {}
+
+            void object_inserted( const object& obj ) override
+            {
+               if( obj.id.instance() < _next_to_store.instance.value )
+                  _next_to_store = IdType( obj.id.instance() );
+            }
+
+         private:
+            IdType& _next_to_store;
+      };
+
       account_history_plugin& _self;
       flat_set<account_id_type> _tracked_accounts;
       flat_set<account_id_type> _extended_history_accounts;
@@ -72,9 +95,21 @@ class account_history_plugin_impl
       uint64_t _max_ops_per_account = -1;
       uint64_t _extended_max_ops_per_account = -1;
 
+      /// Irreversible history is moved here if enabled, only the recent history is kept in memory then
+      std::unique_ptr<history_store> _store;
+      uint64_t _store_ram_ops_per_account = 100;
+      /// The operations and entries before these have been moved to the store
+      operation_history_id_type _next_op_to_store;
+      account_transaction_history_id_type _next_entry_to_store;
+
       /** add one history record, then check and remove the earliest history record */
       void add_account_history( const account_id_type account_id, const operation_history_id_type op_id );
 
+      /** move the irreversible history to the store, keeping the most recent entries of every account in memory */
+      void store_irreversible_history();
+      void remove_stored_entries( const account_id_type account_id );
+      void remove_stored_operation( const operation_history_id_type op_id );
+
 };
 
 void account_history_plugin_impl::update_account_histories( const signed_block& b )
@@ -98,7 +133,7 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
 
       auto create_oho = [&]() {
          is_first = false;
-         return optional<operation_history_object>( db.create<operation_history_object>( [&]( operation_history_object& h )
+         const auto& new_oho = db.create<operation_history_object>( [&]( operation_history_object& h )
          {
             if( o_op.valid() )
             {
@@ -109,7 +144,8 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
                h.op_in_trx    = o_op->op_in_trx;
                h.virtual_op   = o_op->virtual_op;
             }
-         } ) );
+         } );
+         return optional<operation_history_object>( new_oho );
       };
 
       if( !o_op.valid() || ( _max_ops_per_account == 0 && _partial_operations ) )
@@ -194,6 +230,9 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
       if (_partial_operations && ! oho.valid())
          skip_oho_id();
    }
+
+   if( _store )
+      store_irreversible_history();
 }
 
 void account_history_plugin_impl::add_account_history( const account_id_type account_id, const operation_history_id_type op_id )
@@ -271,6 +310,78 @@ void account_history_plugin_impl::add_account_history( const account_id_type acc
    }
 }
 
+void account_history_plugin_impl::store_irreversible_history()
+{
+   graphene::chain::database& db = database();
+   const uint32_t last_irreversible_block = db.get_dynamic_global_properties().last_irreversible_block_num;
+
+   const auto& ops_by_id = db.get_index_type<operation_history_index>().indices().get<by_id>();
+   vector<operation_history_id_type> unreferenced_ops;
+   const auto& his_idx = db.get_index_type<account_transaction_history_index>();
+   const auto& by_opid_idx = his_idx.indices().get<by_opid>();
+   for( auto itr = ops_by_id.lower_bound( _next_op_to_store );
+        itr != ops_by_id.end() && itr->block_num <= last_irreversible_block; ++itr )
+   {
+      _store->store_operation( *itr );
+      _next_op_to_store = operation_history_id_type( itr->id.instance() + 1 );
+      if( by_opid_idx.find( itr->id ) == by_opid_idx.end() )
+         unreferenced_ops.push_back( itr->id );
+   }
+   for( const auto& op_id : unreferenced_ops )
+      remove_stored_operation( op_id );
+
+   const auto& entries_by_id = his_idx.indices().get<by_id>();
+   flat_set<account_id_type> accounts;
+   for( auto itr = entries_by_id.lower_bound( _next_entry_to_store );
+        itr != entries_by_id.end() && itr->operation_id < _next_op_to_store; ++itr )
+   {
+      _store->store_entry( itr->account, itr->sequence, itr->operation_id );
+      _next_entry_to_store = account_transaction_history_id_type( itr->id.instance() + 1 );
+      accounts.insert( itr->account );
+   }
+   _store->flush();
+
+   for( const auto& account_id : accounts )
+      remove_stored_entries( account_id );
+}
+
+void account_history_plugin_impl::remove_stored_entries( const account_id_type account_id )
+{
+   graphene::chain::database& db = database();
+   const uint64_t stored_sequence = _store->last_sequence( account_id );
+   const uint64_t total_ops = account_id(db).statistics(db).total_ops;
+   const auto& his_idx = db.get_index_type<account_transaction_history_index>();
+   const auto& by_seq_idx = his_idx.indices().get<by_seq>();
+   auto itr = by_seq_idx.lower_bound( boost::make_tuple( account_id, 0 ) );
+   // _store_ram_ops_per_account is at least 1, so stats.most_recent_op always stays in memory
+   while( itr != by_seq_idx.end() && itr->account == account_id && itr->sequence <= stored_sequence
+          && total_ops - itr->sequence >= _store_ram_ops_per_account )
+   {
+      const auto op_id = itr->operation_id;
+      const auto itr_remove = itr;
+      ++itr;
+      db.remove( *itr_remove );
+      // the oldest entry in memory continues in the store
+      if( itr != by_seq_idx.end() && itr->account == account_id )
+      {
+         db.modify( *itr, [&]( account_transaction_history_object& obj ){
+            obj.next = account_transaction_history_id_type();
+         });
+      }
+      const auto& by_opid_idx = his_idx.indices().get<by_opid>();
+      if( by_opid_idx.find( op_id ) == by_opid_idx.end() )
+         remove_stored_operation( op_id );
+   }
+}
+
+void account_history_plugin_impl::remove_stored_operation( const operation_history_id_type op_id )
+{
+   graphene::chain::database& db = database();
+   const operation_history_object* op = db.find( op_id );
+   if( op != nullptr )
+      db.remove( *op );
+}
+
 } // end namespace detail
 
 
@@ -312,6 +423,16 @@ void account_history_plugin::plugin_set_program_options(
          ("extended-history-by-registrar",
           boost::program_options::value<std::vector<std::string>>()->composing()->multitoken(),
           "Track longer history for accounts with this registrar (may specify multiple times)")
+         ("index-operations-by-block", boost::program_options::value<bool>(),
+          "Index the operation history by block, so that block_api::export_raw_blocks can export the virtual "
+          "operations of the blocks (default: false, requires the full history, so it can not be combined with "
+          "track-account, partial-operations, max-ops-per-account or account-history-store)")
+         ("account-history-store", boost::program_options::value<bool>(),
+          "Move irreversible account history from memory to an append-only store in the data directory "
+          "(default: false, can not be combined with max-ops-per-account or index-operations-by-block)")
+         ("account-history-store-ram-ops", boost::program_options::value<uint64_t>(),
+          "Number of the most recent operations per account which stay in memory when the account history "
+          "store is enabled (default: 100, minimum: 1)")
          ;
    cfg.add(cli);
 }
@@ -320,7 +441,11 @@ void account_history_plugin::plugin_initialize(const boost::program_options::var
 {
    database().applied_block.connect( [&]( const signed_block& b){ my->update_account_histories(b); } );
    my->_oho_index = database().add_index< primary_index< operation_history_index > >();
-   database().add_index< primary_index< account_transaction_history_index > >();
+   auto* entry_index = database().add_index< primary_index< account_transaction_history_index > >();
+   const bool index_by_block = options.count("index-operations-by-block") > 0
+                               && options["index-operations-by-block"].as<bool>();
+   if( index_by_block )
+      my->_oho_index->add_secondary_index< operation_history_block_index >();
 
    LOAD_VALUE_SET(options, "track-account", my->_tracked_accounts, graphene::chain::account_id_type);
    if (options.count("partial-operations") > 0) {
@@ -337,15 +462,83 @@ void account_history_plugin::plugin_initialize(const boost::program_options::var
                   graphene::chain::account_id_type);
    LOAD_VALUE_SET(options, "extended-history-by-registrar", my->_extended_history_registrars,
                   graphene::chain::account_id_type);
+
+   // an export with missing virtual operations could not be told apart from a complete one
+   if( index_by_block )
+   {
+      if( !my->_tracked_accounts.empty() )
+         FC_THROW_EXCEPTION( graphene::chain::plugin_exception,
+               "index-operations-by-block can not be combined with track-account" );
+      if( my->_partial_operations )
+         FC_THROW_EXCEPTION( graphene::chain::plugin_exception,
+               "index-operations-by-block can not be combined with partial-operations" );
+      if( options.count("max-ops-per-account") > 0 )
+         FC_THROW_EXCEPTION( graphene::chain::plugin_exception,
+               "index-operations-by-block can not be combined with max-ops-per-account" );
+   }
+
+   if( options.count("account-history-store") > 0 && options["account-history-store"].as<bool>() )
+   {
+      if( options.count("max-ops-per-account") > 0 )
+         FC_THROW_EXCEPTION( graphene::chain::plugin_exception,
+               "account-history-store can not be combined with max-ops-per-account" );
+      // the virtual operations of irreversible blocks are no longer in memory
+      if( index_by_block )
+         FC_THROW_EXCEPTION( graphene::chain::plugin_exception,
+               "account-history-store can not be combined with index-operations-by-block" );
+      if( app().data_dir().empty() )
+         FC_THROW_EXCEPTION( graphene::chain::plugin_exception,
+               "account-history-store requires a data directory" );
+      if( options.count("account-history-store-ram-ops") > 0 )
+         my->_store_ram_ops_per_account = std::max<uint64_t>( 1, options["account-history-store-ram-ops"].as<uint64_t>() );
+      my->_store = std::make_unique<history_store>();
+      my->_store->open( app().data_dir() / "account_history" );
+      my->_oho_index->add_secondary_index< detail::account_history_plugin_impl::store_position_index<
+            operation_history_id_type > >( std::ref( my->_next_op_to_store ) );
+      entry_index->add_secondary_index< detail::account_history_plugin_impl::store_position_index<
+            account_transaction_history_id_type > >( std::ref( my->_next_entry_to_store ) );
+   }
 }
 
 void account_history_plugin::plugin_startup()
 {
 }
 
+void account_history_plugin::plugin_shutdown()
+{
+   if( my->_store )
+      my->_store->close();
+}
+
 flat_set<account_id_type> account_history_plugin::tracked_accounts() const
 {
    return my->_tracked_accounts;
 }
 
+const history_store* account_history_plugin::get_history_store() const
+{
+   return my->_store.get();
+}
+
+void operation_history_block_index::object_inserted( const object& obj )
+{
+   const auto& o = static_cast<const operation_history_object&>( obj );
+   operations_by_block.emplace( o.block_num, o.id );
+}
+
+void operation_history_block_index::object_removed( const object& obj )
+{
+   const auto& o = static_cast<const operation_history_object&>( obj );
+   operations_by_block.erase( std::make_pair( o.block_num, o.id ) );
+}
+
+vector<operation_history_id_type> operation_history_block_index::get_operations( uint32_t block_num )const
+{
+   vector<operation_history_id_type> result;
+   for( auto itr = operations_by_block.lower_bound( std::make_pair( block_num, operation_history_id_type() ) );
+        itr != operations_by_block.end() && itr->first == block_num; ++itr )
+      result.push_back( itr->second );
+   return result;
+}
+
 } }
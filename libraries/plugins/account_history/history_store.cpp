@@ -0,0 +1,513 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/account_history/history_store.hpp>
+
+#include <fc/interprocess/file_mapping.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/endian/buffers.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace graphene { namespace account_history {
+
+namespace detail {
+
+/**
+ *  A file which is only ever appended to or truncated. Appended data is buffered until flush(), stored data
+ *  is read through a read-only memory mapping which is extended after the file has grown.
+ */
+class append_only_file
+{
+   public:
+      void open( const fc::path& filename )
+      {
+         _filename = filename;
+         if( !fc::exists( _filename ) )
+            std::ofstream( _filename.generic_string().c_str(), std::ofstream::binary );
+         _stream.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+         _stream.open( _filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+         _file_size = fc::file_size( _filename );
+      }
+
+      bool is_open()const { return _stream.is_open(); }
+
+      void close()
+      {
+         if( !is_open() )
+            return;
+         flush();
+         unmap();
+         _stream.close();
+      }
+
+      /// @return the size including the data which has not been flushed yet
+      uint64_t size()const { return _file_size + _pending.size(); }
+
+      /// @return the position of the appended data
+      uint64_t append( const char* data, size_t len )
+      {
+         const uint64_t pos = size();
+         _pending.insert( _pending.end(), data, data + len );
+         return pos;
+      }
+
+      void flush()
+      {
+         if( !_pending.empty() )
+         {
+            _stream.seekp( _file_size );
+            _stream.write( _pending.data(), _pending.size() );
+            _file_size += _pending.size();
+            _pending.clear();
+         }
+         _stream.flush();
+      }
+
+      /// @return a pointer to @p len bytes at @p pos, valid until the next call of a non-const method
+      const char* read( uint64_t pos, size_t len )
+      {
+         FC_ASSERT( pos + len <= size(), "Read beyond the end of ${f}", ("f",_filename)("pos",pos)("len",len) );
+         if( pos >= _file_size )
+            return _pending.data() + ( pos - _file_size );
+         FC_ASSERT( pos + len <= _file_size, "Read of a partially flushed record in ${f}", ("f",_filename) );
+         if( !_region || _region->get_size() < pos + len )
+         {
+            // grow geometrically past the end of the file, only the flushed part of the mapping is read
+            uint64_t map_size = _file_size;
+#ifndef _WIN32
+            if( _region )
+               map_size = std::max<uint64_t>( map_size, 2 * _region->get_size() );
+#endif
+            unmap();
+            _stream.flush();
+            _mapping = std::make_unique<fc::file_mapping>( _filename.generic_string().c_str(), fc::read_only );
+            _region = std::make_unique<fc::mapped_region>( *_mapping, fc::read_only, 0, map_size );
+         }
+         return (const char*)_region->get_address() + pos;
+      }
+
+      void truncate( uint64_t new_size )
+      {
+         if( new_size >= size() )
+            return;
+         flush();
+         unmap();
+         _stream.close();
+         fc::resize_file( _filename, new_size );
+         _stream.open( _filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+         _file_size = new_size;
+      }
+
+   private:
+      void unmap()
+      {
+         _region.reset();
+         _mapping.reset();
+      }
+
+      fc::path                              _filename;
+      std::fstream                          _stream;
+      uint64_t                              _file_size = 0;
+      vector<char>                          _pending;
+      std::unique_ptr<fc::file_mapping>     _mapping;
+      std::unique_ptr<fc::mapped_region>    _region;
+};
+
+struct operation_index_entry
+{
+   boost::endian::little_uint64_buf_t pos;
+   boost::endian::little_uint32_buf_t size;
+};
+
+struct head_record
+{
+   boost::endian::little_uint64_buf_t last_entry;
+   boost::endian::little_uint64_buf_t last_sequence;
+};
+
+} // detail
+
+struct history_store::stored_entry
+{
+   boost::endian::little_uint64_buf_t account;
+   boost::endian::little_uint64_buf_t sequence;
+   boost::endian::little_uint64_buf_t operation;
+   boost::endian::little_uint64_buf_t prev;    ///< number plus one of the previous entry of the account, 0 if none
+   boost::endian::little_uint64_buf_t skip;    ///< number plus one of the newest entry of the account with
+                                               ///< sequence <= ( sequence & ( sequence - 1 ) ), 0 if none
+};
+
+using detail::operation_index_entry;
+using detail::head_record;
+
+history_store::history_store()
+   : _op_index( std::make_unique<detail::append_only_file>() ),
+     _op_data( std::make_unique<detail::append_only_file>() ),
+     _entries( std::make_unique<detail::append_only_file>() )
+{
+}
+
+history_store::~history_store()
+{
+   close();
+}
+
+void history_store::open( const fc::path& dir )
+{ try {
+   std::lock_guard<std::mutex> guard( _mutex );
+   fc::create_directories( dir );
+   _op_index->open( dir / "operations.index" );
+   _op_data->open( dir / "operations" );
+   _entries->open( dir / "entries" );
+
+   _heads_filename = dir / "heads";
+   if( !fc::exists( _heads_filename ) )
+      std::ofstream( _heads_filename.generic_string().c_str(), std::ofstream::binary );
+   _heads_file.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   _heads_file.open( _heads_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+
+   recover();
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+bool history_store::is_open()const
+{
+   return _entries->is_open();
+}
+
+void history_store::flush()
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   _op_data->flush();
+   _op_index->flush();
+   _entries->flush();
+
+   // the header records up to which entry the heads are complete
+   head_record header;
+   header.last_entry = _entries->size() / sizeof( stored_entry );
+   header.last_sequence = 0;
+   _heads_file.seekp( 0 );
+   _heads_file.write( (const char*)&header, sizeof( header ) );
+   _heads_file.flush();
+}
+
+void history_store::close()
+{
+   if( !is_open() )
+      return;
+   flush();
+   std::lock_guard<std::mutex> guard( _mutex );
+   _op_data->close();
+   _op_index->close();
+   _entries->close();
+   _heads_file.close();
+   _heads.clear();
+}
+
+void history_store::recover()
+{
+   // drop incomplete records at the end of the files
+   const uint64_t index_size = _op_index->size();
+   _op_index->truncate( index_size - index_size % sizeof( operation_index_entry ) );
+   const uint64_t entries_size = _entries->size();
+   _entries->truncate( entries_size - entries_size % sizeof( stored_entry ) );
+
+   // drop operations whose data was not written completely
+   uint64_t op_count = _op_index->size() / sizeof( operation_index_entry );
+   uint64_t data_end = 0;
+   for( uint64_t i = op_count; i > 0; --i )
+   {
+      operation_index_entry e;
+      memcpy( &e, _op_index->read( ( i - 1 ) * sizeof( e ), sizeof( e ) ), sizeof( e ) );
+      if( e.size.value() == 0 )
+         continue;
+      if( e.pos.value() + e.size.value() <= _op_data->size() )
+      {
+         data_end = e.pos.value() + e.size.value();
+         break;
+      }
+      op_count = i - 1;
+   }
+   _op_index->truncate( op_count * sizeof( operation_index_entry ) );
+   _op_data->truncate( data_end );
+
+   // drop entries of dropped operations, entries are stored in the order of their operations
+   uint64_t entry_count = _entries->size() / sizeof( stored_entry );
+   while( entry_count > 0 && read_entry( entry_count - 1 ).operation.value() >= op_count )
+      --entry_count;
+   _entries->truncate( entry_count * sizeof( stored_entry ) );
+
+   // load the heads and bring them up to date with the entries
+   const uint64_t head_count = fc::file_size( _heads_filename ) / sizeof( head_record );
+   vector<head_record> records( head_count );
+   if( head_count > 0 )
+   {
+      _heads_file.seekg( 0 );
+      _heads_file.read( (char*)records.data(), head_count * sizeof( head_record ) );
+   }
+   uint64_t covered = head_count > 0 ? records[0].last_entry.value() : 0;
+   _heads.resize( head_count > 0 ? head_count - 1 : 0 );
+   for( size_t i = 0; i < _heads.size(); ++i )
+   {
+      _heads[i].last_entry = records[i+1].last_entry.value();
+      _heads[i].last_sequence = records[i+1].last_sequence.value();
+      if( _heads[i].last_entry > entry_count )
+         covered = entry_count + 1;
+   }
+   if( covered > entry_count )
+   {
+      wlog( "Rebuilding the account heads of the account history store from ${n} entries", ("n",entry_count) );
+      _heads.assign( _heads.size(), account_head() );
+      covered = 0;
+   }
+   flat_set<uint64_t> updated;
+   for( uint64_t number = covered; number < entry_count; ++number )
+   {
+      const stored_entry e = read_entry( number );
+      const uint64_t account = e.account.value();
+      if( account >= _heads.size() )
+         _heads.resize( account + 1 );
+      if( e.sequence.value() > _heads[account].last_sequence )
+      {
+         _heads[account].last_entry = number + 1;
+         _heads[account].last_sequence = e.sequence.value();
+         updated.insert( account );
+      }
+   }
+   for( uint64_t account : updated )
+      write_head( account );
+
+   head_record header;
+   header.last_entry = entry_count;
+   header.last_sequence = 0;
+   _heads_file.seekp( 0 );
+   _heads_file.write( (const char*)&header, sizeof( header ) );
+   _heads_file.flush();
+}
+
+history_store::stored_entry history_store::read_entry( uint64_t number )const
+{
+   stored_entry e;
+   memcpy( &e, _entries->read( number * sizeof( e ), sizeof( e ) ), sizeof( e ) );
+   return e;
+}
+
+void history_store::write_head( uint64_t account )
+{
+   head_record r;
+   r.last_entry = _heads[account].last_entry;
+   r.last_sequence = _heads[account].last_sequence;
+   _heads_file.seekp( ( account + 1 ) * sizeof( r ) );
+   _heads_file.write( (const char*)&r, sizeof( r ) );
+}
+
+const history_store::account_head* history_store::get_head( account_id_type account )const
+{
+   const uint64_t instance = account.instance.value;
+   if( instance >= _heads.size() || _heads[instance].last_entry == 0 )
+      return nullptr;
+   return &_heads[instance];
+}
+
+uint64_t history_store::next_operation()const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   return _op_index->size() / sizeof( operation_index_entry );
+}
+
+void history_store::store_operation( const operation_history_object& op )
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   const uint64_t id = op.id.instance();
+   const vector<char> packed = fc::raw::pack( op );
+   uint64_t op_count = _op_index->size() / sizeof( operation_index_entry );
+   if( id < op_count )
+   {
+      operation_index_entry e;
+      memcpy( &e, _op_index->read( id * sizeof( e ), sizeof( e ) ), sizeof( e ) );
+      if( e.size.value() == packed.size()
+            && memcmp( _op_data->read( e.pos.value(), e.size.value() ), packed.data(), packed.size() ) == 0 )
+         return;
+      wlog( "Operation ${id} differs from the stored one, discarding the stored account history from there on",
+            ("id",op.id) );
+      truncate( id );
+      op_count = id;
+   }
+
+   operation_index_entry e;
+   e.pos = 0;
+   e.size = 0;
+   for( ; op_count < id; ++op_count )
+      _op_index->append( (const char*)&e, sizeof( e ) );
+   e.pos = _op_data->append( packed.data(), packed.size() );
+   e.size = packed.size();
+   _op_index->append( (const char*)&e, sizeof( e ) );
+}
+
+optional<operation_history_object> history_store::fetch_operation( operation_history_id_type id )const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   const uint64_t instance = id.instance.value;
+   if( instance >= _op_index->size() / sizeof( operation_index_entry ) )
+      return {};
+   operation_index_entry e;
+   memcpy( &e, _op_index->read( instance * sizeof( e ), sizeof( e ) ), sizeof( e ) );
+   if( e.size.value() == 0 )
+      return {};
+   fc::datastream<const char*> ds( _op_data->read( e.pos.value(), e.size.value() ), e.size.value() );
+   operation_history_object result;
+   fc::raw::unpack( ds, result );
+   return result;
+}
+
+void history_store::truncate( uint64_t first_op )
+{
+   // rewind the heads of the accounts whose entries are dropped
+   const uint64_t entry_count = _entries->size() / sizeof( stored_entry );
+   uint64_t new_count = entry_count;
+   while( new_count > 0 && read_entry( new_count - 1 ).operation.value() >= first_op )
+      --new_count;
+   for( uint64_t number = entry_count; number > new_count; --number )
+   {
+      const stored_entry e = read_entry( number - 1 );
+      account_head& head = _heads[e.account.value()];
+      head.last_entry = e.prev.value();
+      head.last_sequence = head.last_entry > 0 ? read_entry( head.last_entry - 1 ).sequence.value() : 0;
+      write_head( e.account.value() );
+   }
+   _entries->truncate( new_count * sizeof( stored_entry ) );
+
+   const uint64_t op_count = _op_index->size() / sizeof( operation_index_entry );
+   for( uint64_t i = first_op; i < op_count; ++i )
+   {
+      operation_index_entry e;
+      memcpy( &e, _op_index->read( i * sizeof( e ), sizeof( e ) ), sizeof( e ) );
+      if( e.size.value() > 0 )
+      {
+         _op_data->truncate( e.pos.value() );
+         break;
+      }
+   }
+   _op_index->truncate( first_op * sizeof( operation_index_entry ) );
+}
+
+uint64_t history_store::last_sequence( account_id_type account )const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   const account_head* head = get_head( account );
+   return head ? head->last_sequence : 0;
+}
+
+void history_store::store_entry( account_id_type account, uint64_t sequence, operation_history_id_type op )
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   FC_ASSERT( op.instance.value < _op_index->size() / sizeof( operation_index_entry ),
+              "Operation ${op} of the history entry has not been stored", ("op",op) );
+   const uint64_t instance = account.instance.value;
+   if( instance >= _heads.size() )
+      _heads.resize( instance + 1 );
+   account_head& head = _heads[instance];
+   if( sequence <= head.last_sequence )
+      return;
+
+   stored_entry e;
+   e.account = instance;
+   e.sequence = sequence;
+   e.operation = op.instance.value;
+   e.prev = head.last_entry;
+   const uint64_t skip_sequence = sequence & ( sequence - 1 );
+   e.skip = skip_sequence > 0 ? find_entry_by_sequence( head, skip_sequence ) : 0;
+   head.last_entry = _entries->append( (const char*)&e, sizeof( e ) ) / sizeof( e ) + 1;
+   head.last_sequence = sequence;
+   write_head( instance );
+}
+
+uint64_t history_store::find_entry_by_sequence( const account_head& head, uint64_t sequence )const
+{
+   uint64_t number = head.last_entry;
+   while( number > 0 )
+   {
+      const stored_entry e = read_entry( number - 1 );
+      if( e.sequence.value() <= sequence )
+         return number;
+      if( e.skip.value() > 0 && read_entry( e.skip.value() - 1 ).sequence.value() >= sequence )
+         number = e.skip.value();
+      else
+         number = e.prev.value();
+   }
+   return 0;
+}
+
+uint64_t history_store::find_entry_by_operation( const account_head& head, uint64_t op )const
+{
+   uint64_t number = head.last_entry;
+   while( number > 0 )
+   {
+      const stored_entry e = read_entry( number - 1 );
+      if( e.operation.value() <= op )
+         return number;
+      if( e.skip.value() > 0 && read_entry( e.skip.value() - 1 ).operation.value() >= op )
+         number = e.skip.value();
+      else
+         number = e.prev.value();
+   }
+   return 0;
+}
+
+uint64_t history_store::find_sequence( account_id_type account, operation_history_id_type op )const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   const account_head* head = get_head( account );
+   if( !head )
+      return 0;
+   const uint64_t number = find_entry_by_operation( *head, op.instance.value );
+   return number > 0 ? read_entry( number - 1 ).sequence.value() : 0;
+}
+
+vector<history_store::entry> history_store::get_entries( account_id_type account, uint64_t start, uint64_t stop,
+                                                         uint32_t limit )const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   vector<entry> result;
+   const account_head* head = get_head( account );
+   if( !head )
+      return result;
+   uint64_t number = find_entry_by_sequence( *head, start );
+   while( number > 0 && result.size() < limit )
+   {
+      const stored_entry e = read_entry( number - 1 );
+      if( e.sequence.value() < stop )
+         break;
+      entry item;
+      item.sequence = e.sequence.value();
+      item.operation_id = operation_history_id_type( e.operation.value() );
+      result.push_back( item );
+      number = e.prev.value();
+   }
+   return result;
+}
+
+} } // graphene::account_history
@@ -23,6 +23,8 @@
  */
 #pragma once
 
+#include <graphene/account_history/history_store.hpp>
+
 #include <graphene/app/plugin.hpp>
 #include <graphene/chain/database.hpp>
 
@@ -30,6 +32,8 @@
 
 #include <fc/thread/future.hpp>
 
+#include <set>
+
 namespace graphene { namespace account_history {
    using namespace chain;
    //using namespace graphene::db;
@@ -56,6 +60,23 @@ enum account_history_object_type
 };
 
 
+/**
+ *  @brief This secondary index finds the operation history objects of a block, it is only maintained when the
+ *         index-operations-by-block option is enabled.
+ */
+class operation_history_block_index : public secondary_index
+{
+   public:
+      void object_inserted( const object& obj ) override;
+      void object_removed( const object& obj ) override;
+
+      /// @return the operation history objects of the block in the order they were created
+      vector<operation_history_id_type> get_operations( uint32_t block_num )const;
+
+   private:
+      std::set< std::pair< uint32_t, operation_history_id_type > > operations_by_block;
+};
+
 namespace detail
 {
     class account_history_plugin_impl;
@@ -73,9 +94,13 @@ class account_history_plugin : public graphene::app::plugin
          boost::program_options::options_description& cfg) override;
       void plugin_initialize(const boost::program_options::variables_map& options) override;
       void plugin_startup() override;
+      void plugin_shutdown() override;
 
       flat_set<account_id_type> tracked_accounts()const;
 
+      /// @return the store of the irreversible account history, or nullptr if the history is only kept in memory
+      const history_store* get_history_store()const;
+
    private:
       std::unique_ptr<detail::account_history_plugin_impl> my;
 };
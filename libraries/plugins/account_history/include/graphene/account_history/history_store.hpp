@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/operation_history_object.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace graphene { namespace account_history {
+   using namespace chain;
+
+   namespace detail { class append_only_file; }
+
+   /**
+    *  @brief Append-only on-disk store for irreversible account history
+    *
+    *  Operations are appended to a data file and located through an index of fixed size entries
+    *  by their instance. The history entries of all accounts are appended to one file of fixed size
+    *  records, each record links to the previous entry of the same account and to an older entry
+    *  at a power of two sequence distance, so that an entry can be found by sequence number or by
+    *  operation id in logarithmic time. The last entry of every account is kept in memory and in a
+    *  separate file which is rewritten in place.
+    *
+    *  Only irreversible history must be stored. Storing is idempotent: operations and account
+    *  entries which are stored already are skipped, an operation which differs from the stored one
+    *  discards the stored history from that operation on. The store recovers from an unclean
+    *  shutdown by discarding incomplete records when opened.
+    *
+    *  All methods are thread safe.
+    */
+   class history_store
+   {
+      public:
+         struct entry
+         {
+            uint64_t                  sequence = 0;
+            operation_history_id_type operation_id;
+         };
+
+         history_store();
+         ~history_store();
+
+         void open( const fc::path& dir );
+         bool is_open()const;
+         void flush();
+         void close();
+
+         /// @return the instance of the next operation to store, i. e. all operations before it are stored
+         uint64_t next_operation()const;
+         /// Stores the operation unless it is stored already, gaps in the operation ids are allowed
+         void store_operation( const operation_history_object& op );
+         optional<operation_history_object> fetch_operation( operation_history_id_type id )const;
+
+         /// @return the sequence number of the last entry stored for the account, 0 if there is none
+         uint64_t last_sequence( account_id_type account )const;
+         /**
+          *  Stores an entry of the account history unless an entry with the same or a higher sequence number
+          *  is stored already. The operation must have been stored before.
+          */
+         void store_entry( account_id_type account, uint64_t sequence, operation_history_id_type op );
+         /// @return the sequence number of the newest entry of the account with an operation id <= @p op, 0 if none
+         uint64_t find_sequence( account_id_type account, operation_history_id_type op )const;
+         /**
+          *  @return up to @p limit entries of the account with @p stop <= sequence <= @p start,
+          *          ordered by descending sequence number
+          */
+         vector<entry> get_entries( account_id_type account, uint64_t start, uint64_t stop, uint32_t limit )const;
+
+      private:
+         struct account_head
+         {
+            uint64_t last_entry = 0;    ///< number of the last entry of the account plus one, 0 if none
+            uint64_t last_sequence = 0;
+         };
+         struct stored_entry;
+
+         stored_entry read_entry( uint64_t number )const;
+         /// @return the number plus one of the newest entry of the account with sequence <= @p sequence, 0 if none
+         uint64_t find_entry_by_sequence( const account_head& head, uint64_t sequence )const;
+         uint64_t find_entry_by_operation( const account_head& head, uint64_t op )const;
+         const account_head* get_head( account_id_type account )const;
+         void write_head( uint64_t account );
+         void truncate( uint64_t first_op );
+         void recover();
+
+         fc::path                                    _heads_filename;
+         std::unique_ptr<detail::append_only_file>   _op_index;
+         std::unique_ptr<detail::append_only_file>   _op_data;
+         std::unique_ptr<detail::append_only_file>   _entries;
+         mutable std::fstream                        _heads_file;
+         vector<account_head>                        _heads;
+         mutable std::mutex                          _mutex;
+   };
+
+} } // graphene::account_history
@@ -127,6 +127,72 @@ const flat_set<liquidity_pool_id_type>& asset_in_liquidity_pools_index::get_liqu
    return empty_set;
 }
 
+void market_depth_index::object_inserted( const object& objct )
+{ try {
+   const auto& o = static_cast<const limit_order_object&>( objct );
+   const share_type to_receive = o.amount_to_receive().amount;
+
+   book_side& side = book_sides[ std::make_pair( o.sell_asset_id(), o.receive_asset_id() ) ];
+   auto itr = side.levels.find( o.sell_price_key );
+   if( itr == side.levels.end() )
+   {
+      itr = side.levels.emplace( o.sell_price_key, price_level() ).first;
+      itr->second.sell_price = o.sell_price;
+   }
+   itr->second.for_sale += o.for_sale;
+   itr->second.to_receive += to_receive;
+   ++itr->second.order_count;
+
+   side.for_sale += o.for_sale;
+   side.to_receive += to_receive;
+   ++side.order_count;
+} FC_CAPTURE_AND_RETHROW( (objct) ) }
+
+void market_depth_index::object_removed( const object& objct )
+{ try {
+   const auto& o = static_cast<const limit_order_object&>( objct );
+   auto side_itr = book_sides.find( std::make_pair( o.sell_asset_id(), o.receive_asset_id() ) );
+   if( side_itr == book_sides.end() ) // should not happen
+      return;
+   book_side& side = side_itr->second;
+   auto itr = side.levels.find( o.sell_price_key );
+   if( itr == side.levels.end() ) // should not happen
+      return;
+   const share_type to_receive = o.amount_to_receive().amount;
+
+   if( --itr->second.order_count == 0 )
+      side.levels.erase( itr );
+   else
+   {
+      itr->second.for_sale -= o.for_sale;
+      itr->second.to_receive -= to_receive;
+   }
+
+   side.for_sale -= o.for_sale;
+   side.to_receive -= to_receive;
+   --side.order_count;
+   // Note: do not erase empty sides from the map, markets with orders usually get new orders again
+} FC_CAPTURE_AND_RETHROW( (objct) ) }
+
+void market_depth_index::about_to_modify( const object& objct )
+{ try {
+   object_removed( objct );
+} FC_CAPTURE_AND_RETHROW( (objct) ) }
+
+void market_depth_index::object_modified( const object& objct )
+{ try {
+   object_inserted( objct );
+} FC_CAPTURE_AND_RETHROW( (objct) ) }
+
+const market_depth_index::book_side* market_depth_index::get_book_side( const asset_id_type& sell_asset,
+                                                                        const asset_id_type& receive_asset )const
+{
+   auto itr = book_sides.find( std::make_pair( sell_asset, receive_asset ) );
+   if( itr == book_sides.end() )
+      return nullptr;
+   return &itr->second;
+}
+
 namespace detail
 {
 
@@ -198,6 +264,10 @@ void api_helper_indexes::plugin_startup()
    for( const auto& pool : database().get_index_type<liquidity_pool_index>().indices() )
       asset_in_liquidity_pools_idx->object_inserted( pool );
 
+   market_depth_idx = database().add_secondary_index< primary_index<limit_order_index>, market_depth_index >();
+   for( const auto& order : database().get_index_type<limit_order_index>().indices() )
+      market_depth_idx->object_inserted( order );
+
 }
 
 } }
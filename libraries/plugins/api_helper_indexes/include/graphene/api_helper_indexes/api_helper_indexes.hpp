@@ -24,8 +24,11 @@
 #pragma once
 
 #include <graphene/app/plugin.hpp>
+#include <graphene/chain/market_object.hpp>
 #include <graphene/protocol/types.hpp>
 
+#include <map>
+
 namespace graphene { namespace api_helper_indexes {
 using namespace chain;
 
@@ -71,6 +74,45 @@ class asset_in_liquidity_pools_index: public secondary_index
       flat_map<asset_id_type, flat_set<liquidity_pool_id_type>> asset_in_pools_map;
 };
 
+/**
+ *  @brief This secondary index aggregates the limit orders of every market into price levels.
+ *
+ *  The levels of each side of a market are kept ordered best price first together with the totals of the side,
+ *  so the best bid and ask and the depth of a book are available without walking its orders. It is updated
+ *  whenever an order is created, filled or cancelled.
+ */
+class market_depth_index : public secondary_index
+{
+   public:
+      struct price_level
+      {
+         price       sell_price;      ///< price of the first order placed at this level
+         share_type  for_sale;        ///< asset id is sell_price.base.asset_id
+         share_type  to_receive;      ///< sum of what the orders receive when filled, asset id is sell_price.quote.asset_id
+         uint32_t    order_count = 0;
+      };
+
+      struct book_side
+      {
+         /// orders with prices of the same ratio share a level
+         std::map< price_key, price_level, std::greater<price_key> > levels;
+         share_type  for_sale;
+         share_type  to_receive;
+         uint32_t    order_count = 0;
+      };
+
+      void object_inserted( const object& obj ) override;
+      void object_removed( const object& obj ) override;
+      void about_to_modify( const object& before ) override;
+      void object_modified( const object& after ) override;
+
+      /// @return the side of the book selling @p sell_asset for @p receive_asset, or nullptr if it never had orders
+      const book_side* get_book_side( const asset_id_type& sell_asset, const asset_id_type& receive_asset )const;
+
+   private:
+      std::map< std::pair<asset_id_type, asset_id_type>, book_side > book_sides;
+};
+
 namespace detail
 {
     class api_helper_indexes_impl;
@@ -96,6 +138,7 @@ class api_helper_indexes : public graphene::app::plugin
       std::unique_ptr<detail::api_helper_indexes_impl> my;
       amount_in_collateral_index* amount_in_collateral_idx = nullptr;
       asset_in_liquidity_pools_index* asset_in_liquidity_pools_idx = nullptr;
+      market_depth_index* market_depth_idx = nullptr;
 };
 
 } } //graphene::template
@@ -110,12 +110,15 @@ void debug_witness_plugin::on_changed_objects( const std::vector<graphene::db::o
    if( _json_object_stream && (ids.size() > 0) )
    {
       const chain::database& db = database();
+      std::string json;
       for( const graphene::db::object_id_type& oid : ids )
       {
          const graphene::db::object* obj = db.find_object( oid );
          if( obj != nullptr )
          {
-            (*_json_object_stream) << fc::json::to_string( obj->to_variant() ) << '\n';
+            json.clear();
+            obj->to_json( json );
+            (*_json_object_stream) << json << '\n';
          }
       }
    }
@@ -27,10 +27,13 @@
 #include <graphene/chain/database.hpp>
 #include <graphene/app/api.hpp>
 
+#include <fc/io/raw.hpp>
 #include <fc/network/http/websocket.hpp>
 #include <fc/rpc/websocket_api.hpp>
 #include <fc/api.hpp>
 
+#include <deque>
+
 namespace graphene { namespace delayed_node {
 namespace bpo = boost::program_options;
 
@@ -40,9 +43,20 @@ struct delayed_node_plugin_impl {
    fc::http::websocket_client client;
    std::shared_ptr<fc::rpc::websocket_api_connection> client_connection;
    fc::api<graphene::app::database_api> database_api;
+   /// Set if the trusted node grants access to its block_api, blocks are then fetched in ranges
+   fc::optional<fc::api<graphene::app::block_api>> block_api;
    boost::signals2::scoped_connection client_connection_closed;
    graphene::chain::block_id_type last_received_remote_head;
    graphene::chain::block_id_type last_processed_remote_head;
+   uint32_t max_requests = 4;
+   uint32_t blocks_per_request = 100;
+};
+
+/// A block waiting to be pushed, with the precomputation started for it
+struct fetched_block
+{
+   graphene::chain::signed_block block;
+   fc::future<void> precomputed;
 };
 }
 
@@ -59,6 +73,12 @@ void delayed_node_plugin::plugin_set_program_options(bpo::options_description& c
    cli.add_options()
          ("trusted-node", boost::program_options::value<std::string>(),
           "RPC endpoint of a trusted validating node (required for delayed_node)")
+         ("delayed-node-max-requests", boost::program_options::value<uint32_t>()->default_value(4),
+          "Number of requests for blocks to keep outstanding while catching up with the trusted node")
+         ("delayed-node-blocks-per-request", boost::program_options::value<uint32_t>()->default_value(100),
+          "Number of blocks to request at once, if the trusted node grants access to its block_api, "
+          "otherwise blocks are requested one by one. Must not exceed the api-limit-export-raw-blocks "
+          "of the trusted node")
          ;
    cfg.add(cli);
 }
@@ -86,6 +106,21 @@ void delayed_node_plugin::connect()
    my->client_connection_closed = my->client_connection->closed.connect([this] {
       connection_failed();
    });
+
+   my->block_api.reset();
+   try
+   {
+      auto login = my->client_connection->get_remote_api<graphene::app::login_api>(1);
+      fc::api<graphene::app::block_api> block_api = login->block();
+      block_api->export_raw_blocks( 1, 1 ); // make sure the trusted node is recent enough
+      my->block_api = block_api;
+      ilog( "Fetching blocks from the trusted node in ranges of ${n}", ("n", my->blocks_per_request) );
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "The block_api of the trusted node is not accessible, fetching blocks one by one: ${e}",
+            ("e", e.to_string()) );
+   }
 }
 
 void delayed_node_plugin::plugin_initialize(const boost::program_options::variables_map& options)
@@ -93,6 +128,130 @@ void delayed_node_plugin::plugin_initialize(const boost::program_options::variab
    FC_ASSERT(options.count("trusted-node") > 0);
    my = std::make_unique<detail::delayed_node_plugin_impl>();
    my->remote_endpoint = "ws://" + options.at("trusted-node").as<std::string>();
+   if( options.count("delayed-node-max-requests") > 0 )
+      my->max_requests = std::max( options.at("delayed-node-max-requests").as<uint32_t>(), 1u );
+   if( options.count("delayed-node-blocks-per-request") > 0 )
+      my->blocks_per_request = std::max( options.at("delayed-node-blocks-per-request").as<uint32_t>(), 1u );
+}
+
+std::vector<graphene::chain::signed_block> delayed_node_plugin::fetch_blocks( uint32_t first, uint32_t last )
+{
+   std::vector<graphene::chain::signed_block> result;
+   result.reserve( last - first + 1 );
+   if( my->block_api.valid() )
+   {
+      // a batch ends early when it gets large, the rest of the range is requested again
+      for( uint32_t next = first; next <= last; )
+      {
+         auto batch = (*my->block_api)->export_raw_blocks( next, last );
+         FC_ASSERT( batch.first_block_num == next && batch.block_count > 0 && batch.block_count <= last - next + 1,
+                    "Trusted node claims it has blocks it doesn't actually have." );
+         fc::datastream<const char*> ds( batch.data.data(), batch.data.size() );
+         for( uint32_t i = 0; i < batch.block_count; ++i )
+         {
+            std::vector<char> raw_block;
+            fc::raw::unpack( ds, raw_block );
+            result.push_back( fc::raw::unpack<graphene::chain::signed_block>( raw_block,
+                                                                              GRAPHENE_MAX_NESTED_OBJECTS ) );
+         }
+         next += batch.block_count;
+      }
+      FC_ASSERT( result.size() == last - first + 1, "Trusted node returned an incomplete range of blocks" );
+   }
+   else
+   {
+      for( uint32_t block_num = first; block_num <= last; ++block_num )
+      {
+         fc::optional<graphene::chain::signed_block> block = my->database_api->get_block( block_num );
+         FC_ASSERT( block, "Trusted node claims it has blocks it doesn't actually have." );
+         result.push_back( std::move( *block ) );
+      }
+   }
+   return result;
+}
+
+uint32_t delayed_node_plugin::fetch_and_push_blocks( uint32_t last_block_num )
+{
+   auto& db = database();
+   // Ranges of blocks are requested ahead, up to the configured number of outstanding requests, and the
+   // precomputation of a range is started as soon as it arrives, while the blocks before it are pushed.
+   std::deque<fc::future<std::vector<graphene::chain::signed_block>>> requests;
+   std::deque<std::unique_ptr<detail::fetched_block>> fetched;
+   uint32_t next_request = db.head_block_num() + 1;
+   uint32_t pushed_blocks = 0;
+
+   const auto start_time = fc::time_point::now();
+   auto last_report_time = start_time;
+   uint32_t last_report_blocks = 0;
+
+   try
+   {
+      while( db.head_block_num() < last_block_num )
+      {
+         const uint32_t per_request = my->block_api.valid() ? my->blocks_per_request : 1;
+         while( requests.size() < my->max_requests && next_request <= last_block_num )
+         {
+            const uint32_t last = next_request + std::min( per_request - 1, last_block_num - next_request );
+            requests.push_back( fc::async( [this,first=next_request,last]() {
+               return fetch_blocks( first, last );
+            }, "delayed_node_fetch" ) );
+            next_request = last + 1;
+         }
+
+         while( !requests.empty() && ( fetched.empty() || requests.front().ready() ) )
+         {
+            auto blocks = requests.front().wait();
+            requests.pop_front();
+            for( auto& block : blocks )
+            {
+               auto item = std::make_unique<detail::fetched_block>();
+               item->block = std::move( block );
+               item->precomputed = db.precompute_parallel( item->block, graphene::chain::database::skip_nothing );
+               fetched.push_back( std::move( item ) );
+            }
+         }
+
+         FC_ASSERT( !fetched.empty(), "Trusted node claims it has blocks it doesn't actually have." );
+         detail::fetched_block& next = *fetched.front();
+         FC_ASSERT( next.block.block_num() == db.head_block_num() + 1,
+                    "Trusted node returned block #${n} instead of #${e}",
+                    ("n", next.block.block_num())("e", db.head_block_num() + 1) );
+         dlog( "Pushing block #${n}", ("n", next.block.block_num()) );
+         next.precomputed.wait();
+         db.push_block( next.block );
+         fetched.pop_front();
+         ++pushed_blocks;
+
+         const auto now = fc::time_point::now();
+         if( now - last_report_time >= fc::seconds(10) )
+         {
+            ilog( "Delayed node synced to block #${n}, ${r} blocks remaining, ${bps} blocks/s",
+                  ("n", db.head_block_num())("r", last_block_num - db.head_block_num())
+                  ("bps", uint64_t( pushed_blocks - last_report_blocks ) * 1000000
+                          / ( now - last_report_time ).count()) );
+            last_report_time = now;
+            last_report_blocks = pushed_blocks;
+         }
+      }
+   }
+   catch( ... )
+   {
+      // the precomputations still in flight refer to the blocks
+      for( const auto& item : fetched )
+      {
+         try { item->precomputed.wait(); } catch( ... ) {}
+      }
+      throw;
+   }
+
+   const auto elapsed = fc::time_point::now() - start_time;
+   if( pushed_blocks > 1 && elapsed.count() > 0 )
+      ilog( "Delayed node pushed ${n} blocks in ${t} ms, ${bps} blocks/s",
+            ("n", pushed_blocks)("t", elapsed.count() / 1000)
+            ("bps", uint64_t( pushed_blocks ) * 1000000 / elapsed.count()) );
+   else if( pushed_blocks == 1 )
+      ilog( "Pushed block #${n}", ("n", db.head_block_num()) );
+   return pushed_blocks;
 }
 
 void delayed_node_plugin::sync_with_trusted_node()
@@ -116,16 +275,7 @@ void delayed_node_plugin::sync_with_trusted_node()
          break;
       }
       pass_count++;
-      while( remote_dpo.last_irreversible_block_num > db.head_block_num() )
-      {
-         fc::optional<graphene::chain::signed_block> block = my->database_api->get_block( db.head_block_num()+1 );
-         // TODO: during sync, decouple requesting blocks from preprocessing + applying them
-         FC_ASSERT(block, "Trusted node claims it has blocks it doesn't actually have.");
-         ilog("Pushing block #${n}", ("n", block->block_num()));
-         db.precompute_parallel( *block, graphene::chain::database::skip_nothing ).wait();
-         db.push_block(*block);
-         synced_blocks++;
-      }
+      synced_blocks += fetch_and_push_blocks( remote_dpo.last_irreversible_block_num );
    }
 }
 
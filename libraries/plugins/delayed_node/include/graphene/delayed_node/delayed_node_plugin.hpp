@@ -24,6 +24,7 @@
 #pragma once
 
 #include <graphene/app/plugin.hpp>
+#include <graphene/protocol/block.hpp>
 
 namespace graphene { namespace delayed_node {
 namespace detail { struct delayed_node_plugin_impl; }
@@ -46,6 +47,9 @@ protected:
    void connection_failed();
    void connect();
    void sync_with_trusted_node();
+   /// Fetches blocks from the trusted node and pushes them until the given block number, @return number of blocks
+   uint32_t fetch_and_push_blocks( uint32_t last_block_num );
+   std::vector<graphene::protocol::signed_block> fetch_blocks( uint32_t first, uint32_t last );
 };
 
 } } //graphene::account_history
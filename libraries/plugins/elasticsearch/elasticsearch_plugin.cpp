@@ -64,11 +64,16 @@ class elasticsearch_plugin_impl
       uint32_t _elasticsearch_start_es_after_block = 0;
       bool _elasticsearch_operation_string = false;
       mode _elasticsearch_mode = mode::only_save;
+      uint32_t _elasticsearch_max_in_flight = 4;
+      uint32_t _elasticsearch_queue_size = 256;
+      uint32_t _elasticsearch_spill_size = 4096;
       CURL *curl; // curl handler
       vector <string> bulk_lines; //  vector of op lines
       vector<std::string> prepare;
 
-      graphene::utilities::ES es;
+      std::unique_ptr<graphene::utilities::es_bulk_exporter> exporter;
+      /// data of blocks up to this one has been exported before a restart
+      uint32_t resume_after_block = 0;
       uint32_t limit_documents;
       int16_t op_type;
       operation_history_struct os;
@@ -93,7 +98,6 @@ class elasticsearch_plugin_impl
       void cleanObjects(const account_transaction_history_id_type& ath, const account_id_type& account_id);
       void createBulkLine(const account_transaction_history_object& ath);
       void prepareBulk(const account_transaction_history_id_type& ath_id);
-      void populateESstruct();
 };
 
 elasticsearch_plugin_impl::~elasticsearch_plugin_impl()
@@ -184,30 +188,15 @@ bool elasticsearch_plugin_impl::update_account_histories( const signed_block& b
    }
    // we send bulk at end of block when we are in sync for better real time client experience
    if(is_sync)
-   {
-      populateESstruct();
-      if(es.bulk_lines.size() > 0)
-      {
-         prepare.clear();
-         if(!graphene::utilities::SendBulk(std::move(es)))
-         {
-            // Note: although called with `std::move()`, `es` is not updated in `SendBulk()`
-            elog( "Error sending ${n} lines of bulk data to Elastic Search, the first lines are:",
-                  ("n",es.bulk_lines.size()) );
-            for( size_t i = 0; i < es.bulk_lines.size() && i < 10; ++i )
-            {
-               edump( (es.bulk_lines[i]) );
-            }
-            return false;
-         }
-         else
-            bulk_lines.clear();
-      }
-   }
+      exporter->push(std::move(bulk_lines), b.block_num());
 
    if(bulk_lines.size() != limit_documents)
       bulk_lines.reserve(limit_documents);
 
+   if(b.block_num() % 10000 == 0)
+      ilog("elasticsearch ACCOUNT HISTORY: export queue at block ${b}: ${s}",
+           ("b",b.block_num())("s",exporter->get_stats()));
+
    return true;
 }
 
@@ -305,29 +294,15 @@ bool elasticsearch_plugin_impl::add_elasticsearch( const account_id_type account
    const auto &stats_obj = getStatsObject(account_id);
    const auto &ath = addNewEntry(stats_obj, account_id, oho);
    growStats(stats_obj, ath);
-   if(block_number > _elasticsearch_start_es_after_block)  {
+   if(block_number > _elasticsearch_start_es_after_block && block_number > resume_after_block)  {
       createBulkLine(ath);
       prepareBulk(ath.id);
    }
    cleanObjects(ath.id, account_id);
 
-   if (curl && bulk_lines.size() >= limit_documents) { // we are in bulk time, ready to add data to elasticsearech
-      prepare.clear();
-      populateESstruct();
-      if(!graphene::utilities::SendBulk(std::move(es)))
-      {
-         // Note: although called with `std::move()`, `es` is not updated in `SendBulk()`
-         elog( "Error sending ${n} lines of bulk data to Elastic Search, the first lines are:",
-               ("n",es.bulk_lines.size()) );
-         for( size_t i = 0; i < es.bulk_lines.size() && i < 10; ++i )
-         {
-            edump( (es.bulk_lines[i]) );
-         }
-         return false;
-      }
-      else
-         bulk_lines.clear();
-   }
+   // we are in bulk time, hand the data over to the exporter, the rest of this block follows later
+   if (bulk_lines.size() >= limit_documents)
+      exporter->push(std::move(bulk_lines), block_number - 1);
 
    return true;
 }
@@ -419,17 +394,6 @@ void elasticsearch_plugin_impl::cleanObjects(const account_transaction_history_i
    }
 }
 
-void elasticsearch_plugin_impl::populateESstruct()
-{
-   es.curl = curl;
-   es.bulk_lines = std::move(bulk_lines);
-   es.elasticsearch_url = _elasticsearch_node_url;
-   es.auth = _elasticsearch_basic_auth;
-   es.index_prefix = _elasticsearch_index_prefix;
-   es.endpoint = "";
-   es.query = "";
-}
-
 } // end namespace detail
 
 elasticsearch_plugin::elasticsearch_plugin(graphene::app::application& app) :
@@ -476,6 +440,13 @@ void elasticsearch_plugin::plugin_set_program_options(
                "Save operation as string. Needed to serve history api calls(false)")
          ("elasticsearch-mode", boost::program_options::value<uint16_t>(),
                "Mode of operation: only_save(0), only_query(1), all(2) - Default: 0")
+         ("elasticsearch-max-in-flight", boost::program_options::value<uint32_t>(),
+               "Number of bulk requests sent to elasticsearch at the same time(4)")
+         ("elasticsearch-queue-size", boost::program_options::value<uint32_t>(),
+               "Megabytes of bulk data to keep in memory while waiting for elasticsearch(256)")
+         ("elasticsearch-spill-size", boost::program_options::value<uint32_t>(),
+               "Megabytes of bulk data to store on disk when the memory queue is full, "
+               "block processing waits when both are full(4096)")
          ;
    cfg.add(cli);
 }
@@ -518,13 +489,41 @@ void elasticsearch_plugin::plugin_initialize(const boost::program_options::varia
          FC_THROW_EXCEPTION(graphene::chain::plugin_exception, "Elasticsearch mode not valid");
       my->_elasticsearch_mode = static_cast<mode>(options["elasticsearch-mode"].as<uint16_t>());
    }
+   if (options.count("elasticsearch-max-in-flight") > 0) {
+      my->_elasticsearch_max_in_flight = options["elasticsearch-max-in-flight"].as<uint32_t>();
+   }
+   if (options.count("elasticsearch-queue-size") > 0) {
+      my->_elasticsearch_queue_size = options["elasticsearch-queue-size"].as<uint32_t>();
+   }
+   if (options.count("elasticsearch-spill-size") > 0) {
+      my->_elasticsearch_spill_size = options["elasticsearch-spill-size"].as<uint32_t>();
+   }
 
    if(my->_elasticsearch_mode != mode::only_query) {
       if (my->_elasticsearch_mode == mode::all && !my->_elasticsearch_operation_string)
          FC_THROW_EXCEPTION(graphene::chain::plugin_exception,
                "If elasticsearch-mode is set to all then elasticsearch-operation-string need to be true");
 
+      graphene::utilities::es_bulk_exporter::options exporter_options;
+      exporter_options.url = my->_elasticsearch_node_url;
+      exporter_options.auth = my->_elasticsearch_basic_auth;
+      exporter_options.max_in_flight = my->_elasticsearch_max_in_flight;
+      exporter_options.max_queued_bytes = uint64_t(my->_elasticsearch_queue_size) * 1024 * 1024;
+      exporter_options.max_spilled_bytes = uint64_t(my->_elasticsearch_spill_size) * 1024 * 1024;
+      if(!app().data_dir().empty())
+         exporter_options.spill_dir = app().data_dir() / "elasticsearch" / "account_history";
+      my->exporter = std::make_unique<graphene::utilities::es_bulk_exporter>(exporter_options);
+      my->resume_after_block = my->exporter->get_acknowledged_block();
+      if(my->resume_after_block > 0)
+         ilog("elasticsearch ACCOUNT HISTORY: data up to block ${b} has been exported already",
+              ("b",my->resume_after_block));
+
       database().applied_block.connect([this](const signed_block &b) {
+         // the chain is built again from genesis, e.g. after a resync, whatever Elasticsearch has is not trusted
+         if (b.block_num() == 1) {
+            my->exporter->reset_acknowledged_block();
+            my->resume_after_block = 0;
+         }
          if (!my->update_account_histories(b))
             FC_THROW_EXCEPTION(graphene::chain::plugin_exception,
                   "Error populating ES database, we are going to keep trying.");
@@ -544,6 +543,22 @@ void elasticsearch_plugin::plugin_startup()
    ilog("elasticsearch ACCOUNT HISTORY: plugin_startup() begin");
 }
 
+void elasticsearch_plugin::plugin_shutdown()
+{
+   if(!my->exporter)
+      return;
+   // all data of the head block has been collected at this point
+   my->exporter->push(std::move(my->bulk_lines), database().head_block_num());
+   // saves what has not been sent yet
+   my->exporter.reset();
+}
+
+graphene::utilities::es_exporter_stats elasticsearch_plugin::get_exporter_stats()const
+{
+   FC_ASSERT( my->exporter, "Elasticsearch plugin is not exporting data" );
+   return my->exporter->get_stats();
+}
+
 operation_history_object elasticsearch_plugin::get_operation_by_id(operation_history_id_type id)
 {
    const string operation_id_string = std::string(object_id_type(id));
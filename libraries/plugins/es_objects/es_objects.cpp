@@ -66,10 +66,18 @@ class es_objects_plugin_impl
       bool _es_objects_asset_bitasset = true;
       std::string _es_objects_index_prefix = "objects-";
       uint32_t _es_objects_start_es_after_block = 0;
+      // later versions of an object must not overtake earlier ones
+      uint32_t _es_objects_max_in_flight = 1;
+      uint32_t _es_objects_queue_size = 256;
+      uint32_t _es_objects_spill_size = 4096;
       CURL *curl; // curl handler
       vector <std::string> bulk;
       vector<std::string> prepare;
 
+      std::unique_ptr<graphene::utilities::es_bulk_exporter> exporter;
+      /// data of blocks up to this one has been exported before a restart
+      uint32_t resume_after_block = 0;
+
       bool _es_objects_keep_only_current = true;
 
       uint32_t block_number;
@@ -114,15 +122,7 @@ bool es_objects_plugin_impl::genesis()
       });
    }
 
-   graphene::utilities::ES es;
-   es.curl = curl;
-   es.bulk_lines = bulk;
-   es.elasticsearch_url = _es_objects_elasticsearch_url;
-   es.auth = _es_objects_auth;
-   if (!graphene::utilities::SendBulk(std::move(es)))
-      FC_THROW_EXCEPTION(graphene::chain::plugin_exception, "Error inserting genesis data.");
-   else
-      bulk.clear();
+   exporter->push(std::move(bulk), 0);
 
    return true;
 }
@@ -134,7 +134,7 @@ bool es_objects_plugin_impl::index_database(const vector<object_id_type>& ids, s
    block_time = db.head_block_time();
    block_number = db.head_block_num();
 
-   if(block_number > _es_objects_start_es_after_block) {
+   if(block_number > _es_objects_start_es_after_block && block_number > resume_after_block) {
 
       // check if we are in replay or in sync and change number of bulk documents accordingly
       uint32_t limit_documents = 0;
@@ -202,19 +202,9 @@ bool es_objects_plugin_impl::index_database(const vector<object_id_type>& ids, s
          }
       }
 
-      if (curl && bulk.size() >= limit_documents) { // we are in bulk time, ready to add data to elasticsearech
-
-         graphene::utilities::ES es;
-         es.curl = curl;
-         es.bulk_lines = bulk;
-         es.elasticsearch_url = _es_objects_elasticsearch_url;
-         es.auth = _es_objects_auth;
-
-         if (!graphene::utilities::SendBulk(std::move(es)))
-            return false;
-         else
-            bulk.clear();
-      }
+      // we are in bulk time, hand the data over to the exporter, more objects of this block may follow
+      if (bulk.size() >= limit_documents)
+         exporter->push(std::move(bulk), block_number - 1);
    }
 
    return true;
@@ -316,6 +306,14 @@ void es_objects_plugin::plugin_set_program_options(
                "Keep only current state of the objects(true)")
          ("es-objects-start-es-after-block", boost::program_options::value<uint32_t>(),
                "Start doing ES job after block(0)")
+         ("es-objects-max-in-flight", boost::program_options::value<uint32_t>(),
+               "Number of bulk requests sent at the same time, more than 1 can store outdated objects "
+               "if es-objects-keep-only-current is set(1)")
+         ("es-objects-queue-size", boost::program_options::value<uint32_t>(),
+               "Megabytes of bulk data to keep in memory while waiting for elasticsearch(256)")
+         ("es-objects-spill-size", boost::program_options::value<uint32_t>(),
+               "Megabytes of bulk data to store on disk when the memory queue is full, "
+               "block processing waits when both are full(4096)")
          ;
    cfg.add(cli);
 }
@@ -361,8 +359,38 @@ void es_objects_plugin::plugin_initialize(const boost::program_options::variable
    if (options.count("es-objects-start-es-after-block") > 0) {
       my->_es_objects_start_es_after_block = options["es-objects-start-es-after-block"].as<uint32_t>();
    }
+   if (options.count("es-objects-max-in-flight") > 0) {
+      my->_es_objects_max_in_flight = options["es-objects-max-in-flight"].as<uint32_t>();
+   }
+   if (options.count("es-objects-queue-size") > 0) {
+      my->_es_objects_queue_size = options["es-objects-queue-size"].as<uint32_t>();
+   }
+   if (options.count("es-objects-spill-size") > 0) {
+      my->_es_objects_spill_size = options["es-objects-spill-size"].as<uint32_t>();
+   }
+
+   graphene::utilities::es_bulk_exporter::options exporter_options;
+   exporter_options.url = my->_es_objects_elasticsearch_url;
+   exporter_options.auth = my->_es_objects_auth;
+   exporter_options.max_in_flight = my->_es_objects_max_in_flight;
+   exporter_options.max_queued_bytes = uint64_t(my->_es_objects_queue_size) * 1024 * 1024;
+   exporter_options.max_spilled_bytes = uint64_t(my->_es_objects_spill_size) * 1024 * 1024;
+   if(!app().data_dir().empty())
+      exporter_options.spill_dir = app().data_dir() / "elasticsearch" / "objects";
+   my->exporter = std::make_unique<graphene::utilities::es_bulk_exporter>(exporter_options);
+   my->resume_after_block = my->exporter->get_acknowledged_block();
+   if(my->resume_after_block > 0)
+      ilog("elasticsearch OBJECTS: data up to block ${b} has been exported already", ("b",my->resume_after_block));
 
    database().applied_block.connect([this](const signed_block &b) {
+      if(b.block_num() % 10000 == 0)
+         ilog("elasticsearch OBJECTS: export queue at block ${b}: ${s}",
+              ("b",b.block_num())("s",my->exporter->get_stats()));
+      // the chain is built again from genesis, e.g. after a resync, whatever Elasticsearch has is not trusted
+      if(b.block_num() == 1) {
+         my->exporter->reset_acknowledged_block();
+         my->resume_after_block = 0;
+      }
       if(b.block_num() == 1 && my->_es_objects_start_es_after_block == 0) {
          if (!my->genesis())
             FC_THROW_EXCEPTION(graphene::chain::plugin_exception, "Error populating genesis data.");
@@ -407,4 +435,20 @@ void es_objects_plugin::plugin_startup()
    ilog("elasticsearch OBJECTS: plugin_startup() begin");
 }
 
+void es_objects_plugin::plugin_shutdown()
+{
+   if(!my->exporter)
+      return;
+   // all objects of the head block have been collected at this point
+   my->exporter->push(std::move(my->bulk), database().head_block_num());
+   // saves what has not been sent yet
+   my->exporter.reset();
+}
+
+graphene::utilities::es_exporter_stats es_objects_plugin::get_exporter_stats()const
+{
+   FC_ASSERT( my->exporter, "es_objects plugin is not exporting data" );
+   return my->exporter->get_stats();
+}
+
 } }
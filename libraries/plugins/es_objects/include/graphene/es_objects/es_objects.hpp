@@ -25,6 +25,7 @@
 
 #include <graphene/app/plugin.hpp>
 #include <graphene/chain/database.hpp>
+#include <graphene/utilities/elasticsearch.hpp>
 
 namespace graphene { namespace es_objects {
 
@@ -48,6 +49,10 @@ class es_objects_plugin : public graphene::app::plugin
          boost::program_options::options_description& cfg) override;
       void plugin_initialize(const boost::program_options::variables_map& options) override;
       void plugin_startup() override;
+      void plugin_shutdown() override;
+
+      /// @return queue depth and progress of the export to elasticsearch
+      graphene::utilities::es_exporter_stats get_exporter_stats()const;
 
    private:
       std::unique_ptr<detail::es_objects_plugin_impl> my;
@@ -30,6 +30,55 @@
 
 namespace graphene { namespace snapshot_plugin {
 
+/// Describes the file holding the serialized objects of one index in a binary snapshot
+struct snapshot_index_file
+{
+   uint8_t     space_id = 0;
+   uint8_t     type_id = 0;
+   std::string file;        ///< path relative to the snapshot directory
+   uint64_t    size = 0;    ///< uncompressed size in bytes
+   fc::sha256  hash;        ///< hash of the uncompressed file
+};
+
+/**
+ * A binary snapshot is a directory holding the object database at an irreversible block in the format of its own
+ * index files, that block, and this manifest, which is written last.
+ */
+struct snapshot_manifest
+{
+   uint32_t                          format_version = 0;
+   std::string                       db_version;
+   graphene::chain::chain_id_type    chain_id;
+   uint32_t                          head_block_num = 0;
+   graphene::chain::block_id_type    head_block_id;
+   fc::time_point_sec                head_block_time;
+   uint32_t                          first_block_num = 0; ///< number of the first block in the blocks file
+   fc::sha256                        blocks_hash;         ///< hash of the uncompressed blocks file
+   bool                              compressed = false;  ///< whether the files are gzip compressed
+   fc::sha256                        state_hash;          ///< hash of the hashes of all index files
+   std::vector<snapshot_index_file>  indexes;
+};
+
+/**
+ * Writes a binary snapshot of the state at the last irreversible block to the directory dest.
+ *
+ * That state is read by reverting the undo states of the newer blocks, so this must be called while the head block
+ * is being applied, i. e. from @ref graphene::chain::database::applied_block. The indexes are written in parallel
+ * while the calling thread is blocked, so the database does not change meanwhile.
+ *
+ * @return the manifest of the snapshot, or nothing if the undo states do not reach back to the last irreversible
+ *         block yet, e. g. shortly after the node was started
+ */
+fc::optional<snapshot_manifest> write_binary_snapshot( const graphene::chain::database& db,
+                                                       const graphene::chain::signed_block& head,
+                                                       const fc::path& dest, bool compress );
+
+/**
+ * Replaces the chain data in chain_dir, the "blockchain" directory of a node, with the binary snapshot in src.
+ * @return the manifest of the snapshot
+ */
+snapshot_manifest restore_binary_snapshot( const fc::path& src, const fc::path& chain_dir );
+
 class snapshot_plugin : public graphene::app::plugin {
    public:
       using graphene::app::plugin::plugin;
@@ -43,13 +92,26 @@ class snapshot_plugin : public graphene::app::plugin {
       ) override;
 
       void plugin_initialize( const boost::program_options::variables_map& options ) override;
+      void plugin_startup() override;
 
    private:
        void check_snapshot( const graphene::chain::signed_block& b);
+       void restore_snapshot( const fc::path& src );
 
        uint32_t           snapshot_block = -1, last_block = 0;
        fc::time_point_sec snapshot_time = fc::time_point_sec::maximum(), last_time = fc::time_point_sec(1);
        fc::path           dest;
+       bool               binary_format = true;
+       bool               compress = true;
+       /// a binary snapshot has been requested but the state of the last irreversible block was not available yet
+       bool               snapshot_pending = false;
+
+       fc::optional<snapshot_manifest>   restored;
 };
 
 } } //graphene::snapshot_plugin
+
+FC_REFLECT( graphene::snapshot_plugin::snapshot_index_file, (space_id)(type_id)(file)(size)(hash) )
+FC_REFLECT( graphene::snapshot_plugin::snapshot_manifest,
+            (format_version)(db_version)(chain_id)(head_block_num)(head_block_id)(head_block_time)
+            (first_block_num)(blocks_hash)(compressed)(state_hash)(indexes) )
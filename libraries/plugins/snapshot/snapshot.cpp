@@ -23,9 +23,21 @@
  */
 #include <graphene/snapshot/snapshot.hpp>
 
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/config.hpp>
 #include <graphene/chain/database.hpp>
 
+#include <graphene/db/parallel_for.hpp>
+
+#include <fc/interprocess/file_mapping.hpp>
 #include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+#include <fstream>
+#include <sstream>
 
 using namespace graphene::snapshot_plugin;
 using std::string;
@@ -36,15 +48,31 @@ namespace bpo = boost::program_options;
 static const char* OPT_BLOCK_NUM  = "snapshot-at-block";
 static const char* OPT_BLOCK_TIME = "snapshot-at-time";
 static const char* OPT_DEST       = "snapshot-to";
+static const char* OPT_FORMAT     = "snapshot-format";
+static const char* OPT_COMPRESS   = "snapshot-compress";
+static const char* OPT_RESTORE    = "restore-from-snapshot";
+
+static const uint32_t snapshot_format_version = 2;
+static const char*    manifest_filename = "manifest.json";
+static const char*    blocks_filename = "blocks";
+static const size_t   copy_buffer_size = 1024 * 1024;
 
 void snapshot_plugin::plugin_set_program_options(
    boost::program_options::options_description& command_line_options,
    boost::program_options::options_description& config_file_options)
 {
    command_line_options.add_options()
-         (OPT_BLOCK_NUM, bpo::value<uint32_t>(), "Block number after which to do a snapshot")
+         (OPT_BLOCK_NUM, bpo::value<uint32_t>(),
+               "Block number after which to do a snapshot. Binary snapshots hold the state at the last "
+               "irreversible block at that time")
          (OPT_BLOCK_TIME, bpo::value<string>(), "Block time (ISO format) after which to do a snapshot")
-         (OPT_DEST, bpo::value<string>(), "Pathname of JSON file where to store the snapshot")
+         (OPT_DEST, bpo::value<string>(),
+               "Pathname of the directory (binary format) or JSON file (json format) where to store the snapshot")
+         (OPT_FORMAT, bpo::value<string>()->default_value("binary"),
+               "Snapshot format, 'binary' can be restored with restore-from-snapshot, 'json' is for inspection")
+         (OPT_COMPRESS, bpo::value<bool>()->default_value(true), "Whether to gzip the files of binary snapshots")
+         (OPT_RESTORE, bpo::value<string>(),
+               "Pathname of a binary snapshot to initialize the blockchain database from, replacing existing chain data")
          ;
    config_file_options.add(command_line_options);
 }
@@ -56,13 +84,16 @@ std::string snapshot_plugin::plugin_name()const
 
 std::string snapshot_plugin::plugin_description()const
 {
-   return "Create snapshots at a specified time or block number.";
+   return "Create snapshots at a specified time or block number, and start from them.";
 }
 
 void snapshot_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 { try {
    ilog("snapshot plugin: plugin_initialize() begin");
 
+   if( options.count(OPT_RESTORE) > 0 )
+      restore_snapshot( options[OPT_RESTORE].as<std::string>() );
+
    if( options.count(OPT_BLOCK_NUM) > 0 || options.count(OPT_BLOCK_TIME) > 0 )
    {
       FC_ASSERT( options.count(OPT_DEST) > 0,
@@ -72,6 +103,14 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
          snapshot_block = options[OPT_BLOCK_NUM].as<uint32_t>();
       if( options.count(OPT_BLOCK_TIME) > 0 )
          snapshot_time = fc::time_point_sec::from_iso_string( options[OPT_BLOCK_TIME].as<std::string>() );
+      if( options.count(OPT_FORMAT) > 0 )
+      {
+         const auto& format = options[OPT_FORMAT].as<std::string>();
+         FC_ASSERT( format == "binary" || format == "json", "Unknown snapshot format ${f}", ("f",format) );
+         binary_format = ( format == "binary" );
+      }
+      if( options.count(OPT_COMPRESS) > 0 )
+         compress = options[OPT_COMPRESS].as<bool>();
       database().applied_block.connect( [&]( const graphene::chain::signed_block& b ) {
          check_snapshot( b );
       });
@@ -82,6 +121,19 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
    ilog("snapshot plugin: plugin_initialize() end");
 } FC_LOG_AND_RETHROW() }
 
+void snapshot_plugin::plugin_startup()
+{
+   if( !restored.valid() )
+      return;
+   const auto& db = database();
+   FC_ASSERT( db.head_block_id() == restored->head_block_id && db.get_chain_id() == restored->chain_id,
+              "The database does not match the restored snapshot",
+              ("head_block_id",db.head_block_id())("snapshot_head_block_id",restored->head_block_id)
+              ("chain_id",db.get_chain_id())("snapshot_chain_id",restored->chain_id) );
+   ilog( "snapshot plugin: started from snapshot at block ${n}", ("n",restored->head_block_num) );
+   restored.reset();
+}
+
 static void create_snapshot( const graphene::chain::database& db, const fc::path& dest )
 {
    ilog("snapshot plugin: creating snapshot");
@@ -95,32 +147,360 @@ static void create_snapshot( const graphene::chain::database& db, const fc::path
       wlog( "Failed to open snapshot destination: ${ex}", ("ex",e) );
       return;
    }
-   for( uint32_t space_id = 0; space_id < 256; space_id++ )
-      for( uint32_t type_id = 0; type_id < 256; type_id++ )
+   std::string line;
+   db.inspect_all_indexes( [&out,&line]( const graphene::db::index& index ) {
+      index.inspect_all_objects( [&out,&line]( const graphene::db::object& o ) {
+         line.clear();
+         o.to_json( line );
+         line += '\n';
+         out.write( line.data(), line.size() );
+      });
+   });
+   out.close();
+   ilog("snapshot plugin: created snapshot");
+}
+
+namespace {
+
+/// Passes the bytes written through it on to another stream, and hashes and counts them
+class hashing_streambuf : public std::streambuf
+{
+   public:
+      explicit hashing_streambuf( std::ostream& target ) : _target( target )
       {
-         try
+         setp( _buffer.data(), _buffer.data() + _buffer.size() );
+      }
+
+      /// @return the hash and the number of the bytes written, must be called once after writing
+      std::pair<fc::sha256,uint64_t> result()
+      {
+         FC_ASSERT( flush_buffer(), "Failed to write" );
+         return std::make_pair( _enc.result(), _size );
+      }
+
+   protected:
+      int_type overflow( int_type ch ) override
+      {
+         if( !flush_buffer() )
+            return traits_type::eof();
+         if( !traits_type::eq_int_type( ch, traits_type::eof() ) )
          {
-            db.get_index( (uint8_t)space_id, (uint8_t)type_id );
+            *pptr() = traits_type::to_char_type( ch );
+            pbump( 1 );
          }
-         catch (fc::assert_exception& e)
+         return traits_type::not_eof( ch );
+      }
+
+      int sync() override
+      {
+         return flush_buffer() ? 0 : -1;
+      }
+
+   private:
+      bool flush_buffer()
+      {
+         const auto count = pptr() - pbase();
+         if( count > 0 )
          {
-            continue;
+            _enc.write( pbase(), count );
+            _target.write( pbase(), count );
+            _size += count;
+            pbump( -int(count) );
          }
-         auto& index = db.get_index( (uint8_t)space_id, (uint8_t)type_id );
-         index.inspect_all_objects( [&out]( const graphene::db::object& o ) {
-            out << fc::json::to_string( o.to_variant() ) << '\n';
-         });
+         return bool( _target );
       }
+
+      std::ostream&       _target;
+      std::vector<char>   _buffer = std::vector<char>( copy_buffer_size );
+      fc::sha256::encoder _enc;
+      uint64_t            _size = 0;
+};
+
+/**
+ * Creates file and passes a stream writing to it to writer, compressing the data if necessary.
+ * @return the hash and the size of the uncompressed data
+ */
+std::pair<fc::sha256,uint64_t> write_file( const fc::path& file, bool compressed,
+                                           const std::function<void(std::ostream&)>& writer )
+{
+   std::ofstream out( file.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+   FC_ASSERT( out, "Failed to create ${f}", ("f",file) );
+   boost::iostreams::filtering_ostream zout;
+   if( compressed )
+      zout.push( boost::iostreams::gzip_compressor() );
+   zout.push( out );
+   hashing_streambuf hashing( zout );
+   std::ostream hashed_out( &hashing );
+   writer( hashed_out );
+   FC_ASSERT( hashed_out, "Failed to write ${f}", ("f",file) );
+   const auto result = hashing.result();
+   zout.reset(); // flushes the compressor and writes the gzip trailer
    out.close();
-   ilog("snapshot plugin: created snapshot");
+   FC_ASSERT( !out.fail(), "Failed to write ${f}", ("f",file) );
+   return result;
+}
+
+/**
+ * Copies a snapshot file to target, decompressing it if necessary.
+ * @return the hash and the size of the copied data
+ */
+std::pair<fc::sha256,uint64_t> restore_file( const fc::path& file, const fc::path& target, bool compressed )
+{
+   std::ifstream in( file.generic_string(), std::ifstream::binary | std::ifstream::in );
+   FC_ASSERT( in, "Failed to open ${f}", ("f",file) );
+   boost::iostreams::filtering_istream zin;
+   if( compressed )
+      zin.push( boost::iostreams::gzip_decompressor() );
+   zin.push( in );
+
+   std::ofstream out( target.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+   FC_ASSERT( out, "Failed to create ${f}", ("f",target) );
+   fc::sha256::encoder enc;
+   uint64_t size = 0;
+   vector<char> buffer( copy_buffer_size );
+   while( zin )
+   {
+      zin.read( buffer.data(), buffer.size() );
+      const auto count = zin.gcount();
+      if( count <= 0 )
+         break;
+      enc.write( buffer.data(), count );
+      out.write( buffer.data(), count );
+      size += count;
+   }
+   FC_ASSERT( zin.eof(), "Failed to read ${f}", ("f",file) );
+   out.close();
+   FC_ASSERT( !out.fail(), "Failed to write ${f}", ("f",target) );
+   return std::make_pair( enc.result(), size );
 }
 
+fc::sha256 get_state_hash( const vector<snapshot_index_file>& indexes )
+{
+   fc::sha256::encoder enc;
+   for( const auto& f : indexes )
+   {
+      fc::raw::pack( enc, f.space_id );
+      fc::raw::pack( enc, f.type_id );
+      fc::raw::pack( enc, f.hash );
+   }
+   return enc.result();
+}
+
+} // anonymous namespace
+
+namespace graphene { namespace snapshot_plugin {
+
+fc::optional<snapshot_manifest> write_binary_snapshot( const graphene::chain::database& db,
+                                                       const graphene::chain::signed_block& head,
+                                                       const fc::path& dest, bool compress )
+{ try {
+   // The blocks after the last irreversible one are reverted through their undo states, so that a node started
+   // from the snapshot does not need to switch forks below its first block. While blocks are applied without undo
+   // states during a replay, they are far enough behind the last stored block to be irreversible.
+   uint32_t block_num = head.block_num();
+   size_t reverted = 0;
+   if( db._undo_db.enabled() )
+   {
+      block_num = db.get_dynamic_global_properties().last_irreversible_block_num;
+      reverted = head.block_num() - block_num;
+      if( block_num == 0 || reverted > db._undo_db.size() )
+         return {};
+   }
+   const auto block = ( reverted == 0 ? fc::optional<graphene::chain::signed_block>( head )
+                                      : db.fetch_block_by_number( block_num ) );
+   FC_ASSERT( block.valid(), "Block ${n} not found", ("n",block_num) );
+
+   ilog( "snapshot plugin: creating snapshot of block ${n}", ("n",block_num) );
+   const auto start = fc::time_point::now();
+   const graphene::db::undo_revert_view view( db._undo_db, reverted );
+
+   vector<const graphene::db::index*> indexes;
+   db.inspect_all_indexes( [&indexes]( const graphene::db::index& idx ) {
+      indexes.push_back( &idx );
+   });
+
+   const fc::path tmp_dir( dest.generic_string() + ".tmp" );
+   if( fc::exists( tmp_dir ) )
+      fc::remove_all( tmp_dir );
+   fc::create_directories( tmp_dir / "objects" );
+
+   snapshot_manifest manifest;
+   manifest.format_version = snapshot_format_version;
+   manifest.db_version = GRAPHENE_CURRENT_DB_VERSION;
+   manifest.chain_id = db.get_chain_id();
+   manifest.head_block_num = block_num;
+   manifest.head_block_id = block->id();
+   manifest.head_block_time = block->timestamp;
+   manifest.first_block_num = block_num;
+   manifest.compressed = compress;
+   manifest.indexes.resize( indexes.size() );
+
+   // Every index and the block are streamed to their own file. The calling thread takes part and does not yield,
+   // so nothing changes the database before all files have been written.
+   graphene::db::parallel_for( indexes.size() + 1, [&indexes,&view,&manifest,&block,&tmp_dir,compress]( size_t i ) {
+      if( i == indexes.size() )
+      {
+         manifest.blocks_hash = write_file( tmp_dir / blocks_filename, compress, [&block]( std::ostream& out ) {
+            fc::raw::pack( out, fc::raw::pack( *block ) );
+         }).first;
+         return;
+      }
+      auto& f = manifest.indexes[i];
+      f.space_id = indexes[i]->object_space_id();
+      f.type_id = indexes[i]->object_type_id();
+      f.file = ( fc::path( "objects" ) / ( fc::to_string( uint64_t(f.space_id) ) + "."
+                                           + fc::to_string( uint64_t(f.type_id) ) ) ).generic_string();
+      const auto result = write_file( tmp_dir / f.file, compress, [&view,idx=indexes[i]]( std::ostream& out ) {
+         idx->save_to( out, view );
+      });
+      f.hash = result.first;
+      f.size = result.second;
+   });
+   manifest.state_hash = get_state_hash( manifest.indexes );
+
+   // the manifest is written last, a directory without it is incomplete
+   fc::json::save_to_file( manifest, tmp_dir / manifest_filename );
+   if( fc::exists( dest ) )
+      fc::remove_all( dest );
+   fc::rename( tmp_dir, dest );
+   ilog( "snapshot plugin: wrote snapshot of block ${n} with ${i} indexes to ${d} in ${t} ms, state hash ${h}",
+         ("n",block_num)("i",indexes.size())("d",dest)("t",(fc::time_point::now() - start).count() / 1000)
+         ("h",manifest.state_hash) );
+   return manifest;
+} FC_CAPTURE_AND_RETHROW( (dest) ) }
+
+snapshot_manifest restore_binary_snapshot( const fc::path& src, const fc::path& chain_dir )
+{ try {
+   const auto manifest = fc::json::from_file( src / manifest_filename ).as<snapshot_manifest>( 20 );
+   FC_ASSERT( manifest.format_version == snapshot_format_version,
+              "Unsupported snapshot format version ${v}", ("v",manifest.format_version) );
+   FC_ASSERT( manifest.db_version == GRAPHENE_CURRENT_DB_VERSION,
+              "Snapshot has been created with database version ${v}, expected ${e}",
+              ("v",manifest.db_version)("e",GRAPHENE_CURRENT_DB_VERSION) );
+   FC_ASSERT( get_state_hash( manifest.indexes ) == manifest.state_hash, "Snapshot manifest is inconsistent" );
+
+   const auto start = fc::time_point::now();
+   fc::create_directories( chain_dir );
+   fc::remove_all( chain_dir / "object_database" );
+   fc::remove_all( chain_dir / "database" );
+
+   // restore into a locked directory first, the object database ignores it if this fails halfway
+   const auto tmp_dir = chain_dir / "object_database.tmp";
+   if( fc::exists( tmp_dir ) )
+      fc::remove_all( tmp_dir );
+   fc::create_directories( tmp_dir / "lock" );
+   for( const auto& f : manifest.indexes )
+      fc::create_directories( tmp_dir / fc::to_string( uint64_t(f.space_id) ) );
+   graphene::db::parallel_for( manifest.indexes.size(), [&manifest,&src,&tmp_dir]( size_t i ) {
+      const auto& f = manifest.indexes[i];
+      const auto target = tmp_dir / fc::to_string( uint64_t(f.space_id) ) / fc::to_string( uint64_t(f.type_id) );
+      const auto result = restore_file( src / f.file, target, manifest.compressed );
+      FC_ASSERT( result.first == f.hash && result.second == f.size, "Snapshot file ${f} is corrupted",
+                 ("f",f.file) );
+   });
+
+   // the blocks are read from the decompressed file through a memory mapping
+   const auto blocks_tmp = chain_dir / "snapshot_blocks.tmp";
+   const auto blocks_result = restore_file( src / blocks_filename, blocks_tmp, manifest.compressed );
+   FC_ASSERT( blocks_result.first == manifest.blocks_hash, "Snapshot file ${f} is corrupted", ("f",blocks_filename) );
+   graphene::chain::block_id_type last_id;
+   if( blocks_result.second > 0 )
+   {
+      fc::file_mapping fm( blocks_tmp.generic_string().c_str(), fc::read_only );
+      fc::mapped_region mr( fm, fc::read_only, 0, blocks_result.second );
+      fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
+
+      graphene::chain::block_database block_db;
+      block_db.open( chain_dir / "database" / "block_num_to_block" );
+      uint32_t block_num = manifest.first_block_num;
+      while( ds.remaining() > 0 )
+      {
+         vector<char> raw;
+         fc::raw::unpack( ds, raw );
+         const auto block = fc::raw::unpack<graphene::chain::signed_block>( raw );
+         FC_ASSERT( block.block_num() == block_num, "Unexpected block ${n} in snapshot, expected ${e}",
+                    ("n",block.block_num())("e",block_num) );
+         last_id = block.id();
+         block_db.store( last_id, block );
+         ++block_num;
+      }
+      block_db.close();
+   }
+   fc::remove( blocks_tmp );
+   FC_ASSERT( last_id == manifest.head_block_id, "Snapshot blocks do not end with the head block" );
+
+   fc::remove_all( tmp_dir / "lock" );
+   fc::rename( tmp_dir, chain_dir / "object_database" );
+
+   std::ofstream version_file( (chain_dir / "db_version").generic_string(),
+                               std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+   version_file.write( manifest.db_version.c_str(), manifest.db_version.size() );
+   version_file.close();
+   FC_ASSERT( !version_file.fail(), "Failed to write to ${d}", ("d",chain_dir) );
+
+   ilog( "snapshot plugin: restored snapshot at block ${n} in ${t} ms",
+         ("n",manifest.head_block_num)("t",(fc::time_point::now() - start).count() / 1000) );
+   return manifest;
+} FC_CAPTURE_AND_RETHROW( (src)(chain_dir) ) }
+
+} } // graphene::snapshot_plugin
+
+void snapshot_plugin::restore_snapshot( const fc::path& src )
+{ try {
+   const auto manifest = fc::json::from_file( src / manifest_filename ).as<snapshot_manifest>( 20 );
+   const fc::path chain_dir = app().data_dir() / "blockchain";
+   const fc::path marker = chain_dir / "restored_snapshot";
+   if( fc::exists( marker ) )
+   {
+      std::string restored_id;
+      fc::read_file_contents( marker, restored_id );
+      if( restored_id == manifest.head_block_id.str() )
+      {
+         ilog( "snapshot plugin: snapshot at block ${n} has been restored before, not restoring it again",
+               ("n",manifest.head_block_num) );
+         return;
+      }
+      fc::remove( marker );
+   }
+
+   wlog( "snapshot plugin: restoring snapshot at block ${n} from ${s}, existing chain data is discarded",
+         ("n",manifest.head_block_num)("s",src) );
+   restored = restore_binary_snapshot( src, chain_dir );
+
+   std::ofstream marker_file( marker.generic_string(),
+                              std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+   marker_file << restored->head_block_id.str();
+   marker_file.close();
+   FC_ASSERT( !marker_file.fail(), "Failed to write ${f}", ("f",marker) );
+} FC_CAPTURE_AND_RETHROW( (src) ) }
+
 void snapshot_plugin::check_snapshot( const graphene::chain::signed_block& b )
 { try {
     uint32_t current_block = b.block_num();
     if( (last_block < snapshot_block && snapshot_block <= current_block)
            || (last_time < snapshot_time && snapshot_time <= b.timestamp) )
-       create_snapshot( database(), dest );
+    {
+       if( binary_format )
+          snapshot_pending = true;
+       else
+          create_snapshot( database(), dest );
+    }
     last_block = current_block;
     last_time = b.timestamp;
+
+    if( snapshot_pending )
+    {
+       try
+       {
+          if( write_binary_snapshot( database(), b, dest, compress ).valid() )
+             snapshot_pending = false;
+          else
+             ilog( "snapshot plugin: waiting for the undo history to reach back to the last irreversible block" );
+       }
+       catch( const fc::exception& e )
+       {
+          wlog( "snapshot plugin: failed to create snapshot: ${e}", ("e",e.to_detail_string()) );
+          snapshot_pending = false;
+       }
+    }
 } FC_LOG_AND_RETHROW() }
@@ -27,6 +27,11 @@
 #include "restriction_predicate.hxx"
 #include "sliced_lists.hxx"
 
+#include <fc/io/raw.hpp>
+
+#include <map>
+#include <mutex>
+
 namespace graphene { namespace protocol {
 
 restriction_predicate_function get_restriction_predicate(vector<restriction> rs, operation::tag_type op_type) {
@@ -78,6 +83,35 @@ restriction_predicate_function get_restriction_predicate(vector<restriction> rs,
    return [f=std::move(f)](const operation& op) { return f(op).reverse_path(); };
 }
 
+std::shared_ptr<const restriction_predicate_function> get_shared_restriction_predicate(
+      const vector<restriction>& rs, operation::tag_type op_type) {
+   using shared_predicate = std::shared_ptr<const restriction_predicate_function>;
+   static std::mutex cache_mutex;
+   static std::map<vector<char>, std::weak_ptr<const restriction_predicate_function>> cache;
+   static size_t prune_threshold = 64;
+
+   vector<char> key = fc::raw::pack(std::make_pair(static_cast<int64_t>(op_type), rs));
+
+   std::lock_guard<std::mutex> guard(cache_mutex);
+   auto itr = cache.find(key);
+   if (itr != cache.end()) {
+      if (shared_predicate predicate = itr->second.lock())
+         return predicate;
+   }
+
+   auto predicate = std::make_shared<const restriction_predicate_function>(get_restriction_predicate(rs, op_type));
+   cache[std::move(key)] = predicate;
+
+   // Forget predicates nobody holds any more once the cache has grown enough to make the sweep worthwhile
+   if (cache.size() >= prune_threshold) {
+      for (auto i = cache.begin(); i != cache.end(); )
+         i = i->second.expired()? cache.erase(i) : std::next(i);
+      prune_threshold = std::max<size_t>(64, cache.size() * 2);
+   }
+
+   return predicate;
+}
+
 predicate_result& predicate_result::reverse_path() {
    if (success == true)
       return *this;
@@ -238,6 +238,17 @@ template<typename Field, typename Argument> struct predicate_ge : predicate_comp
    constexpr bool operator()(const Field& f, const Argument& a) const { return base::operator()(f, a) >= 0; }
 };
 
+// Check whether two sorted ranges share any element, without materializing their intersection
+template<typename I1, typename I2>
+bool sorted_ranges_intersect(I1 first1, I1 last1, I2 first2, I2 last2) {
+   while (first1 != last1 && first2 != last2) {
+      if (*first1 < *first2) ++first1;
+      else if (*first2 < *first1) ++first2;
+      else return true;
+   }
+   return false;
+}
+
 // Field-in-list predicate
 template<typename F, typename C, typename = void> struct predicate_in : predicate_invalid<F, C> {};
 template<typename Field, typename Element>
@@ -297,10 +308,7 @@ struct predicate_not_in<Container, flat_set<Element>,
    // Sorted container
    template<typename C = Container, std::enable_if_t<is_flat_set<C>, bool> = true>
    bool operator()(const Container& c, const flat_set<Element>& a) const {
-      flat_set<typename Container::value_type> intersection;
-      std::set_intersection(c.begin(), c.end(), a.begin(), a.end(),
-                            std::inserter(intersection, intersection.begin()));
-      return intersection.empty();
+      return !sorted_ranges_intersect(c.begin(), c.end(), a.begin(), a.end());
    }
 };
 
@@ -345,10 +353,7 @@ struct predicate_has_none<flat_set<FieldElement>, flat_set<ArgumentElement>,
    // Field is already flat_set
    constexpr static bool valid = true;
    bool operator()(const flat_set<FieldElement>& f, const flat_set<ArgumentElement>& a) const {
-      flat_set<FieldElement> intersection;
-      std::set_intersection(f.begin(), f.end(), a.begin(), a.end(),
-                            std::inserter(intersection, intersection.begin()));
-      return intersection.empty();
+      return !sorted_ranges_intersect(f.begin(), f.end(), a.begin(), a.end());
    }
 };
 template<typename FieldContainer, typename ArgumentElement>
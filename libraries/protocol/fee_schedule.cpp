@@ -34,6 +34,23 @@ namespace graphene { namespace protocol {
    {
    }
 
+   // The cached fee table is not copied, the copy builds its own on first use
+   fee_schedule::fee_schedule( const fee_schedule& other )
+      : parameters( other.parameters ), scale( other.scale )
+   {
+   }
+
+   fee_schedule& fee_schedule::operator=( const fee_schedule& other )
+   {
+      if( this != &other )
+      {
+         parameters = other.parameters;
+         scale = other.scale;
+         invalidate_fee_table();
+      }
+      return *this;
+   }
+
    fee_schedule fee_schedule::get_default()
    {
       fee_schedule result;
@@ -45,6 +62,15 @@ namespace graphene { namespace protocol {
       return result;
    }
 
+   void fee_schedule::set_parameters( const fee_parameters& params )
+   {
+      auto itr = parameters.find( params );
+      if( itr != parameters.end() )
+         parameters.erase( itr );
+      parameters.insert( params );
+      invalidate_fee_table();
+   }
+
    struct set_fee_visitor
    {
       typedef void result_type;
@@ -76,6 +102,7 @@ namespace graphene { namespace protocol {
       for( fee_parameters& i : parameters )
          i.visit( zero_fee_visitor() );
       this->scale = 0;
+      invalidate_fee_table();
    }
 
    asset fee_schedule::set_fee( operation& op, const price& core_exchange_rate )const
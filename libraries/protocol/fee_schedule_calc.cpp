@@ -27,58 +27,129 @@
 #include <fc/io/raw.hpp>
 #include <fc/uint128.hpp>
 
+#include <atomic>
+#include <memory>
+
 #define MAX_FEE_STABILIZATION_ITERATION 4
 
 namespace graphene { namespace protocol {
 
+   namespace detail {
+
+      /**
+       *  Fee parameters of all operation types resolved once per fee schedule, so that calculating a fee
+       *  is a vector lookup instead of a search in the parameter set with exception based fallbacks.
+       */
+      struct fee_table
+      {
+         /// The parameter version of the schedule this table was built from
+         uint32_t version = 0;
+
+         /// Indexed by operation::which()
+         vector<fee_parameters> parameters;
+
+         /// Used by htlc_create_operation
+         uint32_t transfer_price_per_kbyte = transfer_operation::fee_parameters_type().price_per_kbyte;
+         /// Used by asset_create_operation
+         optional<uint64_t> sub_asset_creation_fee;
+
+      };
+
+      struct fee_table_builder
+      {
+         typedef void result_type;
+
+         const fee_schedule& schedule;
+         fee_table& table;
+         const int current_op;
+         fee_table_builder( const fee_schedule& s, fee_table& t, int which ):schedule(s),table(t),current_op(which){}
+
+         template<typename OpType>
+         result_type operator()( const OpType& )const
+         {
+            fee_parameters& params = table.parameters[current_op];
+            try {
+               params = schedule.get<OpType>();
+            } catch (fc::assert_exception&) {
+               params.set_which(current_op);
+               auto itr = schedule.get_parameters().find(params);
+               if( itr != schedule.get_parameters().end() ) params = *itr;
+            }
+         }
+      };
+
+      static std::shared_ptr<const fee_table> build_fee_table( const fee_schedule& schedule, uint32_t version )
+      {
+         auto table = std::make_shared<fee_table>();
+         table->version = version;
+         const int op_count = fee_parameters().count();
+         table->parameters.resize( op_count );
+         for( int i = 0; i < op_count; ++i )
+         {
+            operation op; op.set_which(i);
+            op.visit( fee_table_builder( schedule, *table, i ) );
+         }
+         if( schedule.exists<transfer_operation>() )
+            table->transfer_price_per_kbyte = schedule.get<transfer_operation>().price_per_kbyte;
+         if( schedule.exists<account_transfer_operation>() && schedule.exists<ticket_create_operation>() )
+            table->sub_asset_creation_fee = schedule.get<account_transfer_operation>().fee;
+         return table;
+      }
+
+   } // detail
+
    struct calc_fee_visitor
    {
       typedef uint64_t result_type;
 
-      const fee_schedule& param;
+      const detail::fee_table& table;
       const int current_op;
-      calc_fee_visitor( const fee_schedule& p, const operation& op ):param(p),current_op(op.which()){}
+      calc_fee_visitor( const detail::fee_table& t, const operation& op ):table(t),current_op(op.which()){}
 
       template<typename OpType>
       result_type operator()( const OpType& op )const
       {
-         try {
-            return op.calculate_fee( param.get<OpType>() ).value;
-         } catch (fc::assert_exception& e) {
-             fee_parameters params; params.set_which(current_op);
-             auto itr = param.parameters.find(params);
-             if( itr != param.parameters.end() ) params = *itr;
-             return op.calculate_fee( params.get<typename OpType::fee_parameters_type>() ).value;
-         }
+         return op.calculate_fee( table.parameters[current_op].get<typename OpType::fee_parameters_type>() ).value;
       }
    };
 
    template<>
    uint64_t calc_fee_visitor::operator()(const htlc_create_operation& op)const
    {
-      //TODO: refactor for performance (see https://github.com/bitshares/bitshares-core/issues/2150)
-      transfer_operation::fee_parameters_type t;
-      if (param.exists<transfer_operation>())
-         t = param.get<transfer_operation>();
-      return op.calculate_fee( param.get<htlc_create_operation>(), t.price_per_kbyte).value;
+      return op.calculate_fee( table.parameters[current_op].get<htlc_create_operation::fee_parameters_type>(),
+                               table.transfer_price_per_kbyte ).value;
    }
 
    template<>
    uint64_t calc_fee_visitor::operator()(const asset_create_operation& op)const
    {
-      //TODO: refactor for performance (see https://github.com/bitshares/bitshares-core/issues/2150)
-      optional<uint64_t> sub_asset_creation_fee;
-      if( param.exists<account_transfer_operation>() && param.exists<ticket_create_operation>() )
-         sub_asset_creation_fee = param.get<account_transfer_operation>().fee;
-      asset_create_operation::fee_parameters_type old_asset_creation_fee_params;
-      if( param.exists<asset_create_operation>() )
-         old_asset_creation_fee_params = param.get<asset_create_operation>();
-      return op.calculate_fee( old_asset_creation_fee_params, sub_asset_creation_fee ).value;
+      return op.calculate_fee( table.parameters[current_op].get<asset_create_operation::fee_parameters_type>(),
+                               table.sub_asset_creation_fee ).value;
+   }
+
+   void fee_schedule::invalidate_fee_table()
+   {
+      ++_parameters_version;
+      std::atomic_store( &_fee_table, std::shared_ptr<const detail::fee_table>() );
+   }
+
+   std::shared_ptr<const detail::fee_table> fee_schedule::get_fee_table()const
+   {
+      // a table built concurrently with an invalidation carries the old version and is rebuilt
+      const uint32_t version = _parameters_version.load();
+      auto table = std::atomic_load( &_fee_table );
+      if( !table || table->version != version )
+      {
+         table = detail::build_fee_table( *this, version );
+         std::atomic_store( &_fee_table, table );
+      }
+      return table;
    }
 
    asset fee_schedule::calculate_fee( const operation& op )const
    {
-      uint64_t required_fee = op.visit( calc_fee_visitor( *this, op ) );
+      const auto table = get_fee_table();
+      uint64_t required_fee = op.visit( calc_fee_visitor( *table, op ) );
       if( scale != GRAPHENE_100_PERCENT )
       {
          auto scaled = fc::uint128_t(required_fee) * scale;
@@ -24,6 +24,8 @@
 #pragma once
 #include <graphene/protocol/operations.hpp>
 
+#include <atomic>
+
 namespace graphene { namespace protocol {
 
    template<typename T> struct transform_to_fee_parameters;
@@ -34,6 +36,8 @@ namespace graphene { namespace protocol {
    };
    using fee_parameters = transform_to_fee_parameters<operation>::type;
 
+   namespace detail { struct fee_table; }
+
    template<typename Operation>
    class fee_helper {
      public:
@@ -54,12 +58,6 @@ namespace graphene { namespace protocol {
          FC_ASSERT( itr != parameters.end() );
          return itr->get<account_create_operation::fee_parameters_type>();
       }
-      typename account_create_operation::fee_parameters_type& get(fee_parameters::flat_set_type& parameters)const
-      {
-         auto itr = parameters.find( account_create_operation::fee_parameters_type() );
-         FC_ASSERT( itr != parameters.end() );
-         return itr->get<account_create_operation::fee_parameters_type>();
-      }
    };
 
    template<>
@@ -173,6 +171,8 @@ namespace graphene { namespace protocol {
    struct fee_schedule
    {
       fee_schedule();
+      fee_schedule( const fee_schedule& other );
+      fee_schedule& operator=( const fee_schedule& other );
 
       static fee_schedule get_default();
 
@@ -205,24 +205,43 @@ namespace graphene { namespace protocol {
          return fee_helper<Operation>().cget(parameters);
       }
       template<typename Operation>
-      typename Operation::fee_parameters_type& get()
-      {
-         return fee_helper<Operation>().get(parameters);
-      }
-      template<typename Operation>
       bool exists()const
       {
          auto itr = parameters.find(typename Operation::fee_parameters_type());
          return itr != parameters.end();
       }
 
+      /// Returns the fee parameters of all operation types, sorted by fee_parameters.which()
+      const fee_parameters::flat_set_type& get_parameters()const { return parameters; }
       /**
-       *  @note must be sorted by fee_parameters.which() and have no duplicates
+       *  Sets the fee parameters of the operation type of @p params, replacing present ones of that type.
+       *  @note Do not calculate fees with this schedule while the change is made.
        */
-      fee_parameters::flat_set_type parameters;
+      void set_parameters( const fee_parameters& params );
+
       uint32_t                 scale = GRAPHENE_100_PERCENT; ///< fee * scale / GRAPHENE_100_PERCENT
       private:
+      friend struct fc::reflector<fee_schedule>;
+
       static void set_fee_parameters(fee_schedule& sched);
+
+      /// Drops the cached fee table, it will be rebuilt from @ref parameters on the next fee calculation
+      void invalidate_fee_table();
+
+      /**
+       *  @note must be sorted by fee_parameters.which() and have no duplicates
+       *  @note deserialization writes this without dropping the cached fee table, so deserialize into a fresh
+       *        schedule and assign it to update an existing one
+       */
+      fee_parameters::flat_set_type parameters;
+
+      /// Returns the fee table for the current parameters, building it if necessary
+      std::shared_ptr<const detail::fee_table> get_fee_table()const;
+
+      /// Fee parameters of every operation type indexed by operation::which(), built lazily
+      mutable std::shared_ptr<const detail::fee_table> _fee_table;
+      /// Increased by @ref invalidate_fee_table, a table built from an older version is not used
+      std::atomic<uint32_t> _parameters_version{ 0 };
    };
 
    typedef fee_schedule fee_schedule_type;
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/protocol/address.hpp>
+#include <graphene/protocol/pts_address.hpp>
+#include <graphene/protocol/types.hpp>
+#include <graphene/protocol/vote.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/reflect/variant.hpp>
+#include <fc/time.hpp>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graphene { namespace protocol {
+
+/**
+ * Reflected types that have a custom to_variant implementation must not be written member by member.
+ * Specialize this for such types to have them written through fc::variant.
+ */
+template<typename T> struct json_writer_uses_variant : std::false_type {};
+template<> struct json_writer_uses_variant<address> : std::true_type {};
+template<> struct json_writer_uses_variant<pts_address> : std::true_type {};
+template<> struct json_writer_uses_variant<vote_id_type> : std::true_type {};
+
+/**
+ * @brief Writes values as JSON directly into a string buffer, driven by the FC_REFLECT metadata of their types
+ *
+ * The output is byte-identical to fc::json::to_string( fc::variant( value, max_depth ) ) with the default
+ * output format, but the common cases (reflected structs, integers, plain strings, ids, times, optionals
+ * and containers) are written without building an intermediate fc::variant tree. Everything else, e.g.
+ * static variants, extensions, hashes, enums and values that need escaping or quoting, is written through
+ * fc::variant, so that the output never depends on which path was taken.
+ */
+class json_writer
+{
+   public:
+      explicit json_writer( std::string& buffer, uint32_t max_depth = GRAPHENE_MAX_NESTED_OBJECTS )
+         : _buffer( buffer ), _max_depth( max_depth ) {}
+
+      /// appends the JSON representation of value to the buffer
+      template<typename T>
+      void write( const T& value ) { write_value( value, _max_depth ); }
+
+      /// @return the JSON representation of value
+      template<typename T>
+      static std::string to_string( const T& value, uint32_t max_depth = GRAPHENE_MAX_NESTED_OBJECTS )
+      {
+         std::string result;
+         json_writer( result, max_depth ).write( value );
+         return result;
+      }
+
+   private:
+      template<typename Class>
+      struct member_writer
+      {
+         json_writer&  writer;
+         const Class&  obj;
+         uint32_t      depth;
+         mutable bool  first = true;
+
+         member_writer( json_writer& w, const Class& o, uint32_t d ) : writer( w ), obj( o ), depth( d ) {}
+
+         template<typename Member, class C, Member (C::*member)>
+         void operator()( const char* name )const
+         {
+            if( !first )
+               writer._buffer += ',';
+            first = false;
+            writer._buffer += '"';
+            writer._buffer += name;
+            writer._buffer += "\":";
+            writer.write_value( obj.*member, depth );
+         }
+      };
+
+      struct integral_tag {};
+      struct reflected_tag {};
+      struct variant_tag {};
+
+      template<typename T>
+      using category = typename std::conditional<
+            std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value
+               && sizeof(T) <= sizeof(uint64_t),
+            integral_tag,
+            typename std::conditional<
+                  fc::reflector<T>::is_defined::value && !fc::reflector<T>::is_enum::value
+                     && !json_writer_uses_variant<T>::value,
+                  reflected_tag,
+                  variant_tag >::type >::type;
+
+      template<typename T>
+      void write_value( const T& value, uint32_t depth ) { write_value( value, depth, category<T>() ); }
+
+      template<typename T>
+      void write_value( const T& value, uint32_t, integral_tag )
+      {
+         // fc quotes integers that do not fit into 32 bits, with slightly different limits for signed and
+         // unsigned values, only the range where both agree is written directly
+         if( std::is_signed<T>::value ? ( int64_t(value) >= INT32_MIN && int64_t(value) <= INT32_MAX )
+                                      : ( uint64_t(value) <= uint64_t(INT32_MAX) ) )
+            _buffer += std::to_string( int64_t(value) );
+         else
+            write_variant( fc::variant( value ) );
+      }
+
+      template<typename T>
+      void write_value( const T& value, uint32_t depth, reflected_tag )
+      {
+         FC_ASSERT( depth > 0, "Recursion depth exceeded" );
+         _buffer += '{';
+         fc::reflector<T>::visit( member_writer<T>( *this, value, depth - 1 ) );
+         _buffer += '}';
+      }
+
+      template<typename T>
+      void write_value( const T& value, uint32_t depth, variant_tag )
+      {
+         write_variant( fc::variant( value, depth ) );
+      }
+
+      void write_value( bool value, uint32_t ) { _buffer += value ? "true" : "false"; }
+
+      void write_value( const std::string& value, uint32_t )
+      {
+         for( char c : value )
+         {
+            if( c < 0x20 || c > 0x7e || c == '"' || c == '\\' )
+            {
+               write_variant( fc::variant( value ) );
+               return;
+            }
+         }
+         _buffer += '"';
+         _buffer += value;
+         _buffer += '"';
+      }
+
+      void write_value( const std::vector<char>& value, uint32_t depth ) { write_variant( fc::variant( value, depth ) ); }
+
+      void write_value( const fc::time_point_sec& value, uint32_t ) { write_plain_string( std::string( value ) ); }
+
+      void write_value( const object_id_type& value, uint32_t ) { write_plain_string( std::string( value ) ); }
+
+      template<uint8_t SpaceID, uint8_t TypeID>
+      void write_value( const object_id<SpaceID, TypeID>& value, uint32_t )
+      {
+         write_plain_string( std::string( object_id_type( value ) ) );
+      }
+
+      void write_value( const public_key_type& value, uint32_t ) { write_plain_string( std::string( value ) ); }
+
+      template<typename T>
+      void write_value( const fc::safe<T>& value, uint32_t depth ) { write_value( value.value, depth ); }
+
+      template<typename T>
+      void write_value( const fc::optional<T>& value, uint32_t depth )
+      {
+         if( value.valid() )
+            write_value( *value, depth );
+         else
+            _buffer += "null";
+      }
+
+      template<typename A, typename B>
+      void write_value( const std::pair<A, B>& value, uint32_t depth )
+      {
+         FC_ASSERT( depth > 0, "Recursion depth exceeded" );
+         _buffer += '[';
+         write_value( value.first, depth - 1 );
+         _buffer += ',';
+         write_value( value.second, depth - 1 );
+         _buffer += ']';
+      }
+
+      template<typename T, typename... A>
+      void write_value( const std::vector<T, A...>& value, uint32_t depth ) { write_array( value, depth ); }
+      template<typename T, typename... A>
+      void write_value( const std::deque<T, A...>& value, uint32_t depth ) { write_array( value, depth ); }
+      template<typename T, typename... A>
+      void write_value( const std::set<T, A...>& value, uint32_t depth ) { write_array( value, depth ); }
+      template<typename T, typename... A>
+      void write_value( const boost::container::flat_set<T, A...>& value, uint32_t depth )
+      {
+         write_array( value, depth );
+      }
+
+      template<typename K, typename V, typename... A>
+      void write_value( const std::map<K, V, A...>& value, uint32_t depth ) { write_map( value, depth ); }
+      template<typename K, typename V, typename... A>
+      void write_value( const boost::container::flat_map<K, V, A...>& value, uint32_t depth )
+      {
+         write_map( value, depth );
+      }
+
+      template<typename Container>
+      void write_array( const Container& value, uint32_t depth )
+      {
+         FC_ASSERT( depth > 0, "Recursion depth exceeded" );
+         FC_ASSERT( value.size() <= MAX_NUM_ARRAY_ELEMENTS );
+         _buffer += '[';
+         bool first = true;
+         for( const auto& item : value )
+         {
+            if( !first )
+               _buffer += ',';
+            first = false;
+            write_value( item, depth - 1 );
+         }
+         _buffer += ']';
+      }
+
+      template<typename Map>
+      void write_map( const Map& value, uint32_t depth )
+      {
+         // maps with string keys may be written as objects by fc
+         if( std::is_same<typename Map::key_type, std::string>::value )
+            write_variant( fc::variant( value, depth ) );
+         else
+            write_array( value, depth );
+      }
+
+      /// appends a string that is known to need no escaping
+      void write_plain_string( const std::string& value )
+      {
+         _buffer += '"';
+         _buffer += value;
+         _buffer += '"';
+      }
+
+      void write_variant( const fc::variant& value )
+      {
+         _buffer += fc::json::to_string( value, fc::json::stringify_large_ints_and_doubles, _max_depth );
+      }
+
+      std::string&   _buffer;
+      const uint32_t _max_depth;
+};
+
+} } // graphene::protocol
@@ -27,6 +27,7 @@
 #include <graphene/protocol/operations.hpp>
 
 #include <functional>
+#include <memory>
 
 namespace graphene { namespace protocol {
 
@@ -69,6 +70,18 @@ using restriction_predicate_function = std::function<predicate_result(const oper
  */
 restriction_predicate_function get_restriction_predicate(vector<restriction> rs, operation::tag_type op_type);
 
+/**
+ * @brief get_shared_restriction_predicate Get a shared, compiled predicate function for the supplied restrictions
+ * @param rs The restrictions to evaluate operations against
+ * @param op_type The tag specifying which operation type the restrictions apply to
+ * @return A predicate function equivalent to that returned by @ref get_restriction_predicate
+ *
+ * Predicates are cached by their restrictions and operation type for as long as any holder keeps them alive, so
+ * identical restriction sets are compiled only once no matter how many objects or object revisions refer to them.
+ */
+std::shared_ptr<const restriction_predicate_function> get_shared_restriction_predicate(
+      const vector<restriction>& rs, operation::tag_type op_type);
+
 } } // namespace graphene::protocol
 
 FC_REFLECT_ENUM(graphene::protocol::predicate_result::rejection_reason,
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/protocol/types.hpp>
+
+#include <atomic>
+#include <memory>
+
+namespace graphene { namespace protocol {
+
+   struct signature_cache_stats
+   {
+      uint64_t capacity = 0; ///< maximum number of cached keys
+      uint64_t size = 0;     ///< number of cached keys
+      uint64_t hits = 0;     ///< number of keys taken from the cache
+      uint64_t misses = 0;   ///< number of keys recovered from signatures
+   };
+
+   namespace detail { struct signature_cache_shard; }
+
+   /**
+    * @class signature_cache
+    * @brief Process-wide cache of the public keys recovered from signatures
+    *
+    * A transaction is usually verified several times, when it is received, when pending transactions are applied
+    * again after a block, when it is included in a block and by API calls, each time in another copy of the
+    * transaction. Recovering a public key from a compact signature is the most expensive part of it, so the keys
+    * are cached by digest and signature.
+    *
+    * The cache is split into shards guarded by their own mutex. Each shard keeps two generations of entries, when
+    * the current generation is full it replaces the previous one, so that the least recently used half of the
+    * entries is dropped at once.
+    */
+   class signature_cache
+   {
+      public:
+         static constexpr size_t default_capacity = 100000;
+
+         static signature_cache& instance();
+
+         /**
+          * @brief Get the key that produced a signature of a digest, recover it if it is not cached
+          * @throw fc::exception if the signature is invalid
+          */
+         public_key_type recover( const digest_type& digest, const signature_type& signature );
+
+         /// Set the maximum number of cached keys, 0 disables the cache. Drops all entries.
+         void set_capacity( size_t capacity );
+         /// Drop all entries and reset the counters
+         void clear();
+
+         signature_cache_stats get_stats()const;
+
+      private:
+         signature_cache();
+         ~signature_cache();
+
+         static constexpr size_t num_shards = 16;
+
+         std::unique_ptr<detail::signature_cache_shard[]> _shards;
+         std::atomic<size_t>   _capacity;
+         std::atomic<uint64_t> _hits;
+         std::atomic<uint64_t> _misses;
+   };
+
+} } // graphene::protocol
+
+FC_REFLECT( graphene::protocol::signature_cache_stats, (capacity)(size)(hits)(misses) )
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2020 Contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/protocol/signature_cache.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace graphene { namespace protocol {
+
+namespace detail {
+
+   struct signature_cache_key
+   {
+      digest_type    digest;
+      signature_type signature;
+
+      bool operator==( const signature_cache_key& other )const
+      {
+         return digest == other.digest && signature == other.signature;
+      }
+   };
+
+   struct signature_cache_key_hash
+   {
+      size_t operator()( const signature_cache_key& key )const
+      {
+         // both the digest and the r value of the signature are uniformly distributed
+         uint64_t sig_part;
+         std::memcpy( &sig_part, key.signature.data + 1, sizeof(sig_part) );
+         return static_cast<size_t>( key.digest._hash[0] ^ sig_part );
+      }
+   };
+
+   struct signature_cache_shard
+   {
+      using map_type = std::unordered_map< signature_cache_key, public_key_type, signature_cache_key_hash >;
+
+      mutable std::mutex mutex;
+      map_type           current;
+      map_type           previous;
+
+      /// Insert into the current generation, replacing the previous generation when full
+      void insert( const signature_cache_key& key, const public_key_type& value, size_t generation_size )
+      {
+         if( current.size() >= generation_size )
+         {
+            previous = std::move( current );
+            current = map_type();
+         }
+         current.emplace( key, value );
+      }
+   };
+
+} // detail
+
+signature_cache& signature_cache::instance()
+{
+   static signature_cache cache;
+   return cache;
+}
+
+signature_cache::signature_cache()
+   : _shards( new detail::signature_cache_shard[num_shards] ), _capacity( default_capacity ), _hits( 0 ), _misses( 0 )
+{}
+
+signature_cache::~signature_cache() = default;
+
+public_key_type signature_cache::recover( const digest_type& digest, const signature_type& signature )
+{
+   const size_t capacity = _capacity.load( std::memory_order_relaxed );
+   if( capacity == 0 )
+   {
+      ++_misses;
+      return fc::ecc::public_key( signature, digest );
+   }
+
+   detail::signature_cache_key key{ digest, signature };
+   const size_t hash = detail::signature_cache_key_hash()( key );
+   detail::signature_cache_shard& shard = _shards[ ( hash >> 8 ) % num_shards ];
+   const size_t generation_size = std::max<size_t>( capacity / num_shards / 2, 1 );
+
+   {
+      std::lock_guard<std::mutex> guard( shard.mutex );
+      auto itr = shard.current.find( key );
+      if( itr != shard.current.end() )
+      {
+         ++_hits;
+         return itr->second;
+      }
+      itr = shard.previous.find( key );
+      if( itr != shard.previous.end() )
+      {
+         ++_hits;
+         public_key_type result = itr->second;
+         shard.previous.erase( itr );
+         shard.insert( key, result, generation_size );
+         return result;
+      }
+   }
+
+   // recover without holding the lock, another thread may do the same meanwhile, which is harmless
+   ++_misses;
+   public_key_type result = fc::ecc::public_key( signature, digest );
+
+   std::lock_guard<std::mutex> guard( shard.mutex );
+   if( shard.current.find( key ) == shard.current.end() )
+      shard.insert( key, result, generation_size );
+   return result;
+}
+
+void signature_cache::set_capacity( size_t capacity )
+{
+   _capacity = capacity;
+   clear();
+}
+
+void signature_cache::clear()
+{
+   for( size_t i = 0; i < num_shards; ++i )
+   {
+      std::lock_guard<std::mutex> guard( _shards[i].mutex );
+      _shards[i].current.clear();
+      _shards[i].previous.clear();
+   }
+   _hits = 0;
+   _misses = 0;
+}
+
+signature_cache_stats signature_cache::get_stats()const
+{
+   signature_cache_stats result;
+   result.capacity = _capacity;
+   for( size_t i = 0; i < num_shards; ++i )
+   {
+      std::lock_guard<std::mutex> guard( _shards[i].mutex );
+      result.size += _shards[i].current.size() + _shards[i].previous.size();
+   }
+   result.hits = _hits;
+   result.misses = _misses;
+   return result;
+}
+
+} } // graphene::protocol
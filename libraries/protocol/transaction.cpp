@@ -28,6 +28,7 @@
 #include <graphene/protocol/fee_schedule.hpp>
 #include <graphene/protocol/pts_address.hpp>
 #include <graphene/protocol/restriction_predicate.hpp>
+#include <graphene/protocol/signature_cache.hpp>
 
 #include <fc/io/raw.hpp>
 
@@ -354,7 +355,7 @@ const flat_set<public_key_type>& signed_transaction::get_signature_keys( const c
    for( const auto&  sig : signatures )
    {
       GRAPHENE_ASSERT(
-         result.insert( fc::ecc::public_key(sig,d) ).second,
+         result.insert( signature_cache::instance().recover( d, sig ) ).second,
             tx_duplicate_sig,
             "Duplicate Signature detected" );
    }
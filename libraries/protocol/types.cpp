@@ -107,9 +107,12 @@ namespace fc
                        uint32_t max_depth ) {
         // If it's null, just make a new one
         if (!vo) vo = std::make_shared<const graphene::protocol::fee_schedule>();
-        // Convert the non-const shared_ptr<const fee_schedule> to a non-const fee_schedule& so we can write it
+        // Deserialize into a fresh schedule and assign it, so that the cached fee table of vo is dropped
         // Don't decrement max_depth since we're not actually deserializing at this step
-        from_variant(var, const_cast<graphene::protocol::fee_schedule&>(*vo), max_depth);
+        graphene::protocol::fee_schedule result;
+        from_variant(var, result, max_depth);
+        // Convert the non-const shared_ptr<const fee_schedule> to a non-const fee_schedule& so we can write it
+        const_cast<graphene::protocol::fee_schedule&>(*vo) = result;
     }
 
 namespace raw {
@@ -27,6 +27,15 @@
 #include <boost/algorithm/string.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
 
 size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
 {
@@ -188,4 +197,428 @@ const std::string doCurl(CurlRequest& curl)
    return CurlReadBuffer;
 }
 
+namespace detail {
+
+struct es_batch
+{
+   uint64_t    sequence = 0;
+   uint32_t    complete_block = 0;
+   uint64_t    size = 0;
+   std::string body;            ///< empty while the batch is spilled
+   bool        spilled = false;
+};
+
+class es_bulk_exporter_impl
+{
+   public:
+      explicit es_bulk_exporter_impl( const es_bulk_exporter::options& o );
+      ~es_bulk_exporter_impl();
+
+      void push( std::string&& body, uint32_t complete_block );
+      void flush();
+      void reset();
+
+      const es_bulk_exporter::options opts;
+      mutable std::mutex              mtx;
+      /// notified whenever the queue or the set of pending batches changes
+      std::condition_variable         changed;
+      /// batches that have not been taken by a sender, ordered by sequence
+      std::deque<es_batch>            queue;
+      /// sequence -> (complete block, acknowledged) of every batch that has been pushed but not acknowledged yet
+      std::map<uint64_t,std::pair<uint32_t,bool>> pending;
+      uint64_t                        next_sequence = 0;
+      es_exporter_stats               stats;
+      bool                            stopping = false;
+      std::vector<std::thread>        senders;
+
+   private:
+      void run_sender();
+      bool send( CURL* curl, const std::string& body )const;
+      fc::path batch_file( uint64_t sequence )const;
+      void spill( es_batch& b )const;
+      void load( es_batch& b )const;
+      void requeue( es_batch&& b );
+      void acknowledge( uint64_t sequence );
+      void save_acknowledged_block()const;
+};
+
+es_bulk_exporter_impl::es_bulk_exporter_impl( const es_bulk_exporter::options& o ) : opts( o )
+{
+   if( !opts.spill_dir.empty() )
+   {
+      fc::create_directories( opts.spill_dir );
+      const auto ack_file = opts.spill_dir / "acknowledged_block";
+      if( fc::exists( ack_file ) )
+      {
+         std::ifstream in( ack_file.generic_string() );
+         in >> stats.acknowledged_block;
+      }
+      std::vector<uint64_t> sequences;
+      for( fc::directory_iterator itr( opts.spill_dir ); itr != fc::directory_iterator(); ++itr )
+      {
+         const auto file = *itr;
+         if( file.extension() == ".batch" )
+            sequences.push_back( std::stoull( file.stem().generic_string() ) );
+      }
+      std::sort( sequences.begin(), sequences.end() );
+      for( const auto sequence : sequences )
+      {
+         es_batch b;
+         b.sequence = sequence;
+         b.spilled = true;
+         const auto file = batch_file( sequence );
+         std::ifstream in( file.generic_string(), std::ifstream::binary | std::ifstream::in );
+         fc::raw::unpack( in, b.complete_block );
+         b.size = fc::file_size( file ) - sizeof( b.complete_block );
+         pending[sequence] = std::make_pair( b.complete_block, false );
+         ++stats.spilled_batches;
+         stats.spilled_bytes += b.size;
+         queue.push_back( std::move(b) );
+         next_sequence = sequence + 1;
+      }
+      if( !sequences.empty() )
+         ilog( "Resuming export of ${n} batches to Elasticsearch from ${d}, acknowledged up to block ${b}",
+               ("n",sequences.size())("d",opts.spill_dir)("b",stats.acknowledged_block) );
+   }
+   const auto threads = std::max<uint32_t>( opts.max_in_flight, 1 );
+   for( uint32_t i = 0; i < threads; ++i )
+      senders.emplace_back( [this] () { run_sender(); } );
+}
+
+es_bulk_exporter_impl::~es_bulk_exporter_impl()
+{
+   {
+      std::lock_guard<std::mutex> lock( mtx );
+      stopping = true;
+   }
+   changed.notify_all();
+   for( auto& sender : senders )
+      sender.join();
+
+   try
+   {
+      if( !opts.spill_dir.empty() )
+      {
+         for( auto& b : queue )
+            if( !b.spilled )
+               spill( b );
+         if( !queue.empty() )
+            ilog( "Saved ${n} batches that have not been sent to Elasticsearch to ${d}",
+                  ("n",queue.size())("d",opts.spill_dir) );
+         save_acknowledged_block();
+      }
+      else if( !queue.empty() )
+         elog( "${n} batches have not been sent to Elasticsearch", ("n",queue.size()) );
+   }
+   catch( const fc::exception& e )
+   {
+      elog( "Failed to save the Elasticsearch export queue: ${e}", ("e",e.to_detail_string()) );
+   }
+}
+
+void es_bulk_exporter_impl::push( std::string&& body, uint32_t complete_block )
+{
+   es_batch b;
+   b.complete_block = complete_block;
+   b.size = body.size();
+   b.body = std::move( body );
+
+   std::unique_lock<std::mutex> lock( mtx );
+   b.sequence = next_sequence++;
+   pending[b.sequence] = std::make_pair( complete_block, false );
+   bool waited = false;
+   while( stats.queued_batches > 0 && stats.queued_bytes + b.size > opts.max_queued_bytes )
+   {
+      if( !opts.spill_dir.empty() && stats.spilled_bytes + b.size <= opts.max_spilled_bytes )
+      {
+         // this is the only thread that adds batches, so nothing can overtake this one meanwhile
+         lock.unlock();
+         spill( b );
+         lock.lock();
+         break;
+      }
+      if( !waited )
+         wlog( "Elasticsearch export queue is full, waiting for ${n} requests in flight",
+               ("n",stats.in_flight) );
+      waited = true;
+      changed.wait( lock );
+   }
+   if( b.spilled )
+   {
+      ++stats.spilled_batches;
+      stats.spilled_bytes += b.size;
+   }
+   else
+   {
+      ++stats.queued_batches;
+      stats.queued_bytes += b.size;
+   }
+   queue.push_back( std::move(b) );
+   lock.unlock();
+   changed.notify_all();
+}
+
+void es_bulk_exporter_impl::flush()
+{
+   std::unique_lock<std::mutex> lock( mtx );
+   changed.wait( lock, [this] () { return pending.empty(); } );
+}
+
+void es_bulk_exporter_impl::reset()
+{
+   {
+      std::lock_guard<std::mutex> lock( mtx );
+      for( const auto& b : queue )
+      {
+         pending.erase( b.sequence );
+         if( b.spilled )
+            fc::remove( batch_file( b.sequence ) );
+      }
+      queue.clear();
+      stats.queued_batches = 0;
+      stats.queued_bytes = 0;
+      stats.spilled_batches = 0;
+      stats.spilled_bytes = 0;
+      // the batches in flight must not advance the acknowledged block when they are accepted
+      for( auto& p : pending )
+         p.second.first = 0;
+      stats.acknowledged_block = 0;
+      if( !opts.spill_dir.empty() )
+         save_acknowledged_block();
+   }
+   changed.notify_all();
+}
+
+void es_bulk_exporter_impl::run_sender()
+{
+   CURL* curl = curl_easy_init();
+   curl_easy_setopt( curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2 );
+   while( true )
+   {
+      es_batch b;
+      {
+         std::unique_lock<std::mutex> lock( mtx );
+         changed.wait( lock, [this] () { return stopping || !queue.empty(); } );
+         // without a spill directory, keep sending what is left when stopping
+         if( queue.empty() || ( stopping && !opts.spill_dir.empty() ) )
+            break;
+         b = std::move( queue.front() );
+         queue.pop_front();
+         if( b.spilled )
+         {
+            --stats.spilled_batches;
+            stats.spilled_bytes -= b.size;
+         }
+         else
+         {
+            --stats.queued_batches;
+            stats.queued_bytes -= b.size;
+         }
+         ++stats.in_flight;
+      }
+      changed.notify_all();
+
+      bool sent = false;
+      bool dropped = false;
+      if( b.spilled )
+      {
+         try
+         {
+            load( b );
+         }
+         catch( const fc::exception& e )
+         {
+            elog( "Dropping unreadable Elasticsearch batch ${f}: ${e}",
+                  ("f",batch_file( b.sequence ))("e",e.to_detail_string()) );
+            dropped = true;
+         }
+      }
+      uint32_t retry_seconds = 1;
+      while( !dropped && !( sent = send( curl, b.body ) ) )
+      {
+         std::unique_lock<std::mutex> lock( mtx );
+         ++stats.failed_requests;
+         if( stopping )
+            break;
+         wlog( "Failed to send ${n} bytes of bulk data to Elasticsearch, retrying in ${s} seconds",
+               ("n",b.size)("s",retry_seconds) );
+         changed.wait_for( lock, std::chrono::seconds( retry_seconds ), [this] () { return stopping; } );
+         retry_seconds = std::min<uint32_t>( retry_seconds * 2, 60 );
+      }
+
+      {
+         std::lock_guard<std::mutex> lock( mtx );
+         --stats.in_flight;
+         if( sent || dropped )
+         {
+            if( sent )
+               ++stats.sent_batches;
+            acknowledge( b.sequence );
+         }
+         else
+            requeue( std::move(b) );
+      }
+      changed.notify_all();
+      if( !sent && !dropped ) // only when stopping
+         break;
+      if( b.spilled )
+         fc::remove( batch_file( b.sequence ) );
+   }
+   curl_easy_cleanup( curl );
+}
+
+bool es_bulk_exporter_impl::send( CURL* curl, const std::string& body )const
+{
+   try
+   {
+      CurlRequest curl_request;
+      curl_request.handler = curl;
+      curl_request.url = opts.url + "_bulk";
+      curl_request.auth = opts.auth;
+      curl_request.type = "POST";
+      curl_request.query = body;
+
+      const auto response = doCurl( curl_request );
+      return handleBulkResponse( getResponseCode( curl ), response );
+   }
+   catch( const fc::exception& e )
+   {
+      elog( "Unexpected response from Elasticsearch: ${e}", ("e",e.to_detail_string()) );
+   }
+   return false;
+}
+
+fc::path es_bulk_exporter_impl::batch_file( uint64_t sequence )const
+{
+   return opts.spill_dir / ( fc::to_string( sequence ) + ".batch" );
+}
+
+void es_bulk_exporter_impl::spill( es_batch& b )const
+{
+   const auto file = batch_file( b.sequence );
+   std::ofstream out( file.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+   fc::raw::pack( out, b.complete_block );
+   out.write( b.body.data(), b.body.size() );
+   out.close();
+   FC_ASSERT( !out.fail(), "Failed to write ${f}", ("f",file) );
+   b.body = std::string();
+   b.spilled = true;
+}
+
+void es_bulk_exporter_impl::load( es_batch& b )const
+{
+   const auto file = batch_file( b.sequence );
+   std::ifstream in( file.generic_string(), std::ifstream::binary | std::ifstream::in );
+   uint32_t complete_block = 0;
+   fc::raw::unpack( in, complete_block );
+   b.body.resize( b.size );
+   in.read( &b.body[0], b.size );
+   FC_ASSERT( in && complete_block == b.complete_block, "Failed to read ${f}", ("f",file) );
+}
+
+void es_bulk_exporter_impl::requeue( es_batch&& b )
+{
+   const uint32_t complete_block = pending[b.sequence].first;
+   if( b.complete_block != complete_block )
+   {
+      // the acknowledged block has been reset while the batch was in flight, the saved copy is outdated
+      b.complete_block = complete_block;
+      if( b.spilled )
+      {
+         fc::remove( batch_file( b.sequence ) );
+         b.spilled = false;
+      }
+   }
+   if( b.spilled )
+   {
+      b.body = std::string(); // still on disk
+      ++stats.spilled_batches;
+      stats.spilled_bytes += b.size;
+   }
+   else
+   {
+      ++stats.queued_batches;
+      stats.queued_bytes += b.size;
+   }
+   auto itr = std::find_if( queue.begin(), queue.end(), [&b]( const es_batch& q ) {
+      return q.sequence > b.sequence;
+   });
+   queue.insert( itr, std::move(b) );
+}
+
+void es_bulk_exporter_impl::acknowledge( uint64_t sequence )
+{
+   pending[sequence].second = true;
+   bool advanced = false;
+   while( !pending.empty() && pending.begin()->second.second )
+   {
+      stats.acknowledged_block = std::max( stats.acknowledged_block, pending.begin()->second.first );
+      pending.erase( pending.begin() );
+      advanced = true;
+   }
+   if( advanced && !opts.spill_dir.empty() )
+   {
+      try
+      {
+         save_acknowledged_block();
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "Failed to save the last block acknowledged by Elasticsearch: ${e}", ("e",e.to_detail_string()) );
+      }
+   }
+}
+
+void es_bulk_exporter_impl::save_acknowledged_block()const
+{
+   const auto file = opts.spill_dir / "acknowledged_block";
+   const auto tmp_file = opts.spill_dir / "acknowledged_block.tmp";
+   {
+      std::ofstream out( tmp_file.generic_string(), std::ofstream::out | std::ofstream::trunc );
+      out << stats.acknowledged_block;
+      out.close();
+      FC_ASSERT( !out.fail(), "Failed to write ${f}", ("f",tmp_file) );
+   }
+   fc::rename( tmp_file, file );
+}
+
+} // end namespace detail
+
+es_bulk_exporter::es_bulk_exporter( const options& opts )
+   : my( std::make_unique<detail::es_bulk_exporter_impl>( opts ) )
+{
+}
+
+es_bulk_exporter::~es_bulk_exporter() = default;
+
+void es_bulk_exporter::push( std::vector<std::string>&& bulk_lines, uint32_t complete_block )
+{
+   if( bulk_lines.empty() )
+      return;
+   my->push( joinBulkLines( bulk_lines ), complete_block );
+   bulk_lines.clear();
+}
+
+void es_bulk_exporter::flush()
+{
+   my->flush();
+}
+
+uint32_t es_bulk_exporter::get_acknowledged_block()const
+{
+   std::lock_guard<std::mutex> lock( my->mtx );
+   return my->stats.acknowledged_block;
+}
+
+void es_bulk_exporter::reset_acknowledged_block()
+{
+   my->reset();
+}
+
+es_exporter_stats es_bulk_exporter::get_stats()const
+{
+   std::lock_guard<std::mutex> lock( my->mtx );
+   return my->stats;
+}
+
 } } // end namespace graphene::utilities
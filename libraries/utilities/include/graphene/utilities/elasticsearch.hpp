@@ -23,10 +23,13 @@
  */
 #pragma once
 #include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <curl/curl.h>
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
 #include <fc/time.hpp>
 #include <fc/variant_object.hpp>
 
@@ -65,4 +68,71 @@ namespace graphene { namespace utilities {
    const std::string joinBulkLines(const std::vector<std::string>& bulk);
    long getResponseCode(CURL *handler);
 
+   /// Queue depth and progress of an @ref es_bulk_exporter
+   struct es_exporter_stats
+   {
+      uint64_t queued_batches = 0;     ///< batches waiting in memory
+      uint64_t queued_bytes = 0;
+      uint64_t spilled_batches = 0;    ///< batches waiting on disk
+      uint64_t spilled_bytes = 0;
+      uint64_t in_flight = 0;          ///< bulk requests being sent
+      uint64_t sent_batches = 0;
+      uint64_t failed_requests = 0;
+      uint32_t acknowledged_block = 0; ///< all data up to this block has been accepted by Elasticsearch
+   };
+
+   namespace detail { class es_bulk_exporter_impl; }
+
+   /**
+    * Sends bulk requests to Elasticsearch from dedicated threads, so that a slow or unavailable Elasticsearch
+    * node does not stall the thread producing the data.
+    *
+    * Batches are sent in the order they were pushed, up to max_in_flight of them at the same time. Failed
+    * requests are retried until they succeed. Batches that do not fit into max_queued_bytes are written to
+    * spill_dir; once the spill directory is full, or if there is none, @ref push waits for the queue to drain.
+    *
+    * The number of the last block whose data has been accepted completely is kept in spill_dir, together with
+    * the batches that have not been sent when the exporter is destroyed, so that exporting resumes where it
+    * stopped after a restart. When the data is exported again from the start, e.g. after a resync, the producer
+    * calls @ref reset_acknowledged_block so that the block number of a previous export is not trusted.
+    */
+   class es_bulk_exporter
+   {
+      public:
+         struct options
+         {
+            std::string url;
+            std::string auth;
+            uint32_t    max_in_flight = 4;
+            uint64_t    max_queued_bytes = 256 * 1024 * 1024;
+            fc::path    spill_dir;                            ///< empty to keep everything in memory
+            uint64_t    max_spilled_bytes = 4ULL * 1024 * 1024 * 1024;
+         };
+
+         explicit es_bulk_exporter( const options& opts );
+         ~es_bulk_exporter();
+
+         /**
+          * Queues a bulk request, waits if the queue is full.
+          * @param bulk_lines the lines of the request
+          * @param complete_block all data of this block and the blocks before it has been pushed
+          */
+         void push( std::vector<std::string>&& bulk_lines, uint32_t complete_block );
+         /// Waits until everything that has been pushed is accepted by Elasticsearch
+         void flush();
+
+         /// @return the last block whose data has been accepted completely, also after a restart
+         uint32_t get_acknowledged_block()const;
+         /// Forgets the acknowledged block and drops the queued batches, which are going to be pushed again
+         void reset_acknowledged_block();
+         es_exporter_stats get_stats()const;
+
+      private:
+         std::unique_ptr<detail::es_bulk_exporter_impl> my;
+   };
+
 } } // end namespace graphene::utilities
+
+FC_REFLECT( graphene::utilities::es_exporter_stats,
+            (queued_batches)(queued_bytes)(spilled_batches)(spilled_bytes)(in_flight)(sent_batches)
+            (failed_requests)(acknowledged_block) )
@@ -444,8 +444,8 @@ namespace graphene { namespace wallet { namespace detail {
       const fee_schedule_type& current_fees = current_params.get_current_fees();
 
       flat_map< int, fee_parameters > fee_map;
-      fee_map.reserve( current_fees.parameters.size() );
-      for( const fee_parameters& op_fee : current_fees.parameters )
+      fee_map.reserve( current_fees.get_parameters().size() );
+      for( const fee_parameters& op_fee : current_fees.get_parameters() )
          fee_map[ op_fee.which() ] = op_fee;
       uint32_t scale = current_fees.scale;
 
@@ -490,7 +490,7 @@ namespace graphene { namespace wallet { namespace detail {
       fee_schedule_type new_fees;
 
       for( const std::pair< int, fee_parameters >& item : fee_map )
-         new_fees.parameters.insert( item.second );
+         new_fees.set_parameters( item.second );
       new_fees.scale = scale;
 
       chain_parameters new_params = current_params;
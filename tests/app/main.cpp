@@ -34,6 +34,8 @@
 #include <graphene/witness/witness.hpp>
 #include <graphene/grouped_orders/grouped_orders_plugin.hpp>
 
+#include <graphene/net/core_messages.hpp>
+
 #include <fc/thread/thread.hpp>
 #include <fc/log/appender.hpp>
 #include <fc/log/console_appender.hpp>
@@ -42,6 +44,8 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <algorithm>
+
 #include "../../libraries/app/application_impl.hxx"
 
 #include "../common/init_unit_test_suite.hpp"
@@ -391,6 +395,48 @@ BOOST_AUTO_TEST_CASE( two_node_network )
    }
 }
 
+/// the form of a message that is shared between the send queues of the peers
+BOOST_AUTO_TEST_CASE( packed_message_test )
+{
+   using namespace graphene::net;
+
+   std::vector<item_hash_t> hashes;
+   for( uint32_t i = 0; i < 3; ++i )
+      hashes.push_back( fc::ripemd160::hash( std::to_string( i ) ) );
+   const item_ids_inventory_message inventory( trx_message_type, hashes );
+   const message inventory_message( inventory );
+
+   // the inventory is packed once and every peer queues the same buffer
+   const packed_message_ptr packed = std::make_shared<packed_message>( inventory_message );
+   std::vector<packed_message_ptr> peer1_queue{ packed };
+   std::vector<packed_message_ptr> peer2_queue{ packed };
+   BOOST_CHECK( &peer1_queue.front()->buffer() == &peer2_queue.front()->buffer() );
+
+   // header, data and zero padding up to a multiple of 16 bytes
+   const auto& buffer = packed->buffer();
+   const size_t unpadded_size = sizeof(message_header) + inventory_message.size.value();
+   BOOST_CHECK_EQUAL( buffer.size() % 16, 0u );
+   BOOST_REQUIRE_GE( buffer.size(), unpadded_size );
+   BOOST_CHECK_LT( buffer.size(), unpadded_size + 16 );
+   BOOST_CHECK( std::all_of( buffer.begin() + unpadded_size, buffer.end(), []( char c ) { return c == 0; } ) );
+   BOOST_CHECK( std::equal( inventory_message.data.begin(), inventory_message.data.end(), packed->data() ) );
+
+   BOOST_CHECK_EQUAL( packed->msg_type(), uint32_t( item_ids_inventory_message_type ) );
+   BOOST_CHECK_EQUAL( packed->data_size(), inventory_message.size.value() );
+   BOOST_CHECK( packed->id() == inventory_message.id() );
+   BOOST_CHECK( packed->get_message().data == inventory_message.data );
+   const auto unpacked = packed->as<item_ids_inventory_message>();
+   BOOST_CHECK_EQUAL( unpacked.item_type, uint32_t( trx_message_type ) );
+   BOOST_CHECK( unpacked.item_hashes_available == hashes );
+   BOOST_CHECK_THROW( packed->as<item_not_available_message>(), fc::exception );
+
+   // the reply of a node which does not have the requested item
+   const item_id requested( block_message_type, hashes.front() );
+   const packed_message_ptr not_available = std::make_shared<packed_message>( item_not_available_message( requested ) );
+   BOOST_CHECK_EQUAL( not_available->msg_type(), uint32_t( item_not_available_message_type ) );
+   BOOST_CHECK( not_available->as<item_not_available_message>().requested_item == requested );
+}
+
 /// a contrived example to test the breaking out of application_impl to a header file
 BOOST_AUTO_TEST_CASE(application_impl_breakout) {
 
@@ -196,6 +196,16 @@ std::shared_ptr<boost::program_options::variables_map> database_fixture_base::in
    else if( rand() % 100 >= 50 ) // this should lead to no change
       fc::set_option( options, "enable-p2p-network", true );
 
+   if (fixture.current_test_name == "account_history_store"
+         || fixture.current_test_name == "account_history_store_undo")
+   {
+      fc::set_option( options, "account-history-store", true );
+      fc::set_option( options, "account-history-store-ram-ops", (uint64_t)2 );
+   }
+   if (fixture.current_test_name == "export_raw_blocks")
+   {
+      fc::set_option( options, "index-operations-by-block", true );
+   }
    if (fixture.current_test_name == "get_account_history_operations")
    {
       fc::set_option( options, "max-ops-per-account", (uint64_t)75 );
@@ -880,8 +890,8 @@ void database_fixture_base::change_fees(
    const fee_schedule& current_fees = current_chain_params.get_current_fees();
 
    flat_map< int, fee_parameters > fee_map;
-   fee_map.reserve( current_fees.parameters.size() );
-   for( const fee_parameters& op_fee : current_fees.parameters )
+   fee_map.reserve( current_fees.get_parameters().size() );
+   for( const fee_parameters& op_fee : current_fees.get_parameters() )
       fee_map[ op_fee.which() ] = op_fee;
    for( const fee_parameters& new_fee : new_params )
       fee_map[ new_fee.which() ] = new_fee;
@@ -889,7 +899,7 @@ void database_fixture_base::change_fees(
    fee_schedule_type new_fees;
 
    for( const std::pair< int, fee_parameters >& item : fee_map )
-      new_fees.parameters.insert( item.second );
+      new_fees.set_parameters( item.second );
    if( new_scale != 0 )
       new_fees.scale = new_scale;
 
@@ -1742,15 +1752,15 @@ void database_fixture_base::set_htlc_committee_parameters()
    new_fee_schedule->scale = GRAPHENE_100_PERCENT;
    // replace the old with the new
    flat_map<uint64_t, graphene::chain::fee_parameters> htlc_fees = get_htlc_fee_parameters();
-   for(auto param : existing_fee_schedule.parameters)
+   for(auto param : existing_fee_schedule.get_parameters())
    {
       auto itr = htlc_fees.find(param.which());
       if (itr == htlc_fees.end()) {
          // Only define fees for operations which are already forked in!
          if (hardfork_visitor(db.head_block_time()).visit(param.which()))
-            new_fee_schedule->parameters.insert(param);
+            new_fee_schedule->set_parameters(param);
       } else {
-         new_fee_schedule->parameters.insert( (*itr).second);
+         new_fee_schedule->set_parameters( (*itr).second);
       }
    }
    // htlc parameters
@@ -35,6 +35,14 @@
 
 #include "../common/utils.hpp"
 
+#include <boost/algorithm/string.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/asio.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #define ES_WAIT_TIME (fc::milliseconds(10000))
 
 using namespace graphene::chain;
@@ -558,3 +566,213 @@ BOOST_AUTO_TEST_CASE(elasticsearch_history_api) {
    }
 }
 BOOST_AUTO_TEST_SUITE_END()
+
+namespace {
+
+/// Answers bulk requests like an Elasticsearch node, the first ones fail if requested
+class es_stand_in
+{
+   public:
+      explicit es_stand_in( uint32_t failures )
+         : _acceptor( _io, boost::asio::ip::tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) ),
+           _failures( failures )
+      {
+         _thread = std::thread( [this] () { run(); } );
+      }
+      ~es_stand_in()
+      {
+         _stopping = true;
+         // wake up the blocking accept
+         boost::asio::ip::tcp::socket socket( _io );
+         boost::system::error_code ec;
+         socket.connect( _acceptor.local_endpoint(), ec );
+         _thread.join();
+      }
+
+      std::string url()const
+      {
+         return "http://127.0.0.1:" + std::to_string( _acceptor.local_endpoint().port() ) + "/";
+      }
+
+      /// @return the bodies of the requests that have been answered successfully
+      std::vector<std::string> received()
+      {
+         std::lock_guard<std::mutex> lock( _mutex );
+         return _received;
+      }
+
+   private:
+      void run()
+      {
+         while( !_stopping )
+         {
+            boost::asio::ip::tcp::socket socket( _io );
+            boost::system::error_code ec;
+            _acceptor.accept( socket, ec );
+            if( ec || _stopping )
+               break;
+            handle( socket );
+         }
+      }
+
+      void handle( boost::asio::ip::tcp::socket& socket )
+      {
+         boost::system::error_code ec;
+         boost::asio::streambuf buffer;
+         const auto header_size = boost::asio::read_until( socket, buffer, "\r\n\r\n", ec );
+         if( ec )
+            return;
+         std::string headers( boost::asio::buffers_begin( buffer.data() ),
+                              boost::asio::buffers_begin( buffer.data() ) + header_size );
+         buffer.consume( header_size );
+         size_t content_length = 0;
+         std::vector<std::string> lines;
+         boost::split( lines, headers, boost::is_any_of( "\n" ) );
+         for( auto& line : lines )
+         {
+            boost::trim( line );
+            if( boost::istarts_with( line, "content-length:" ) )
+               content_length = std::stoul( line.substr( 15 ) );
+         }
+         if( buffer.size() < content_length )
+            boost::asio::read( socket, buffer, boost::asio::transfer_exactly( content_length - buffer.size() ), ec );
+         std::string body( boost::asio::buffers_begin( buffer.data() ),
+                           boost::asio::buffers_begin( buffer.data() ) + content_length );
+
+         std::string status = "200 OK";
+         if( _failures > 0 )
+         {
+            --_failures;
+            status = "500 Internal Server Error";
+         }
+         else
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _received.push_back( body );
+         }
+         const std::string response_body = "{\"errors\":false}";
+         const std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: application/json\r\n"
+               + "Content-Length: " + std::to_string( response_body.size() ) + "\r\nConnection: close\r\n\r\n"
+               + response_body;
+         boost::asio::write( socket, boost::asio::buffer( response ), ec );
+      }
+
+      boost::asio::io_service        _io;
+      boost::asio::ip::tcp::acceptor _acceptor;
+      uint32_t                       _failures;
+      std::atomic<bool>              _stopping { false };
+      std::mutex                     _mutex;
+      std::vector<std::string>       _received;
+      std::thread                    _thread;
+};
+
+std::vector<std::string> make_bulk( uint32_t block_num )
+{
+   fc::mutable_variant_object header;
+   header["_index"] = "test";
+   header["_id"] = std::to_string( block_num );
+   return graphene::utilities::createBulk( header, "{\"block\":" + std::to_string( block_num ) + "}" );
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE( es_exporter_tests )
+
+BOOST_AUTO_TEST_CASE( es_bulk_exporter_retry_spill_resume )
+{ try {
+   fc::temp_directory spill_dir( graphene::utilities::temp_directory_path() );
+
+   graphene::utilities::es_bulk_exporter::options opts;
+   opts.max_in_flight = 2;
+   opts.max_queued_bytes = 1; // every batch but the first one is spilled
+   opts.spill_dir = spill_dir.path();
+
+   {
+      es_stand_in es( 2 );
+      opts.url = es.url();
+      graphene::utilities::es_bulk_exporter exporter( opts );
+      for( uint32_t block = 1; block <= 10; ++block )
+         exporter.push( make_bulk( block ), block );
+      exporter.flush();
+
+      const auto stats = exporter.get_stats();
+      BOOST_CHECK_EQUAL( stats.acknowledged_block, 10u );
+      BOOST_CHECK_EQUAL( stats.sent_batches, 10u );
+      BOOST_CHECK_EQUAL( stats.failed_requests, 2u );
+      BOOST_CHECK_EQUAL( stats.queued_batches + stats.spilled_batches + stats.in_flight, 0u );
+      BOOST_CHECK_EQUAL( es.received().size(), 10u );
+   }
+
+   {
+      // Elasticsearch is down, unsent batches are saved on shutdown
+      es_stand_in es( 1000 );
+      opts.url = es.url();
+      graphene::utilities::es_bulk_exporter exporter( opts );
+      BOOST_CHECK_EQUAL( exporter.get_acknowledged_block(), 10u );
+      for( uint32_t block = 11; block <= 13; ++block )
+         exporter.push( make_bulk( block ), block );
+   }
+
+   {
+      es_stand_in es( 0 );
+      opts.url = es.url();
+      graphene::utilities::es_bulk_exporter exporter( opts );
+      BOOST_CHECK_EQUAL( exporter.get_acknowledged_block(), 10u );
+      const auto stats = exporter.get_stats();
+      BOOST_CHECK_EQUAL( stats.spilled_batches + stats.in_flight + stats.sent_batches, 3u );
+      exporter.flush();
+      BOOST_CHECK_EQUAL( exporter.get_acknowledged_block(), 13u );
+      const auto received = es.received();
+      BOOST_REQUIRE_EQUAL( received.size(), 3u );
+      const auto all = boost::algorithm::join( received, "" );
+      for( uint32_t block = 11; block <= 13; ++block )
+         BOOST_CHECK( all.find( "\"block\":" + std::to_string( block ) + "}" ) != std::string::npos );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( es_bulk_exporter_reset )
+{ try {
+   fc::temp_directory spill_dir( graphene::utilities::temp_directory_path() );
+
+   graphene::utilities::es_bulk_exporter::options opts;
+   opts.max_in_flight = 2;
+   opts.max_queued_bytes = 1;
+   opts.spill_dir = spill_dir.path();
+
+   {
+      es_stand_in es( 0 );
+      opts.url = es.url();
+      graphene::utilities::es_bulk_exporter exporter( opts );
+      for( uint32_t block = 1; block <= 5; ++block )
+         exporter.push( make_bulk( block ), block );
+      exporter.flush();
+      BOOST_CHECK_EQUAL( exporter.get_acknowledged_block(), 5u );
+      exporter.reset_acknowledged_block();
+      BOOST_CHECK_EQUAL( exporter.get_acknowledged_block(), 0u );
+   }
+
+   {
+      // the queued batches are dropped, those in flight no longer count
+      es_stand_in es( 1000 );
+      opts.url = es.url();
+      graphene::utilities::es_bulk_exporter exporter( opts );
+      BOOST_CHECK_EQUAL( exporter.get_acknowledged_block(), 0u );
+      for( uint32_t block = 6; block <= 8; ++block )
+         exporter.push( make_bulk( block ), block );
+      exporter.reset_acknowledged_block();
+      const auto stats = exporter.get_stats();
+      BOOST_CHECK_EQUAL( stats.acknowledged_block, 0u );
+      BOOST_CHECK_EQUAL( stats.queued_batches + stats.spilled_batches, 0u );
+   }
+
+   {
+      es_stand_in es( 0 );
+      opts.url = es.url();
+      graphene::utilities::es_bulk_exporter exporter( opts );
+      exporter.flush();
+      BOOST_CHECK_EQUAL( exporter.get_acknowledged_block(), 0u );
+      BOOST_CHECK_LE( es.received().size(), 2u );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
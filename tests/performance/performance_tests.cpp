@@ -28,15 +28,26 @@
 
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/committee_member_object.hpp>
+#include <graphene/chain/custom_authority_object.hpp>
+#include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/market_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
+#include <graphene/chain/witness_object.hpp>
 
 #include <graphene/db/simple_index.hpp>
 
+#include <graphene/protocol/fee_schedule.hpp>
+#include <graphene/protocol/signature_cache.hpp>
+
 #include <fc/crypto/digest.hpp>
+#include <fc/io/json.hpp>
 
 #include "../common/database_fixture.hpp"
 #include <cstdlib>
 #include <iostream>
+#include <random>
+#include <set>
 
 using namespace graphene::chain;
 
@@ -54,6 +65,48 @@ BOOST_AUTO_TEST_CASE( sigcheck_benchmark )
    auto end = fc::time_point::now();
    auto elapsed = end-start;
    wlog( "Benchmark: verify ${sps} signatures/s", ("sps",(cycles*1000000)/elapsed.count()) );
+
+   // A transaction is verified several times in different copies, when it is received, after every block
+   // while it is pending, and in the block that includes it, that is what the signature cache is for.
+   const uint32_t tx_count = 10000;
+   const uint32_t copies = 4;
+   vector<signed_transaction> transactions;
+   transactions.reserve( tx_count );
+   for( uint32_t i = 0; i < tx_count; ++i )
+   {
+      transfer_operation op;
+      op.from = account_id_type( 1 );
+      op.to = account_id_type( 2 );
+      op.amount = asset( 1 + i );
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      tx.expiration = fc::time_point_sec( 1600000000 );
+      tx.sign( nathan_key, db.get_chain_id() );
+      transactions.push_back( tx );
+   }
+   auto& cache = graphene::protocol::signature_cache::instance();
+   const auto verify_copies = [&]( const char* scenario ) {
+      cache.clear();
+      auto start = fc::time_point::now();
+      for( uint32_t c = 0; c < copies; ++c )
+         for( const auto& tx : transactions )
+            precomputable_transaction( tx ).get_signature_keys( db.get_chain_id() );
+      auto elapsed = fc::time_point::now() - start;
+      auto stats = cache.get_stats();
+      wlog( "Benchmark: ${scenario}: verify ${n} transactions ${c} times each in ${total}ms, "
+            "${hits} cache hits, ${misses} misses",
+            ("scenario",scenario)("n",tx_count)("c",copies)("total",elapsed.count()/1000)
+            ("hits",stats.hits)("misses",stats.misses) );
+      return stats;
+   };
+   cache.set_capacity( 0 );
+   auto uncached = verify_copies( "without signature cache" );
+   BOOST_CHECK_EQUAL( uncached.misses, tx_count * copies );
+   cache.set_capacity( graphene::protocol::signature_cache::default_capacity );
+   auto cached = verify_copies( "with signature cache" );
+   BOOST_CHECK_EQUAL( cached.misses, tx_count );
+   BOOST_CHECK_EQUAL( cached.hits, tx_count * ( copies - 1 ) );
+   cache.clear();
 }
 
 // See https://bitshares.org/blog/2015/06/08/measuring-performance/
@@ -208,4 +261,302 @@ BOOST_AUTO_TEST_CASE( one_hundred_k_benchmark )
    db._undo_db.enable();
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( vote_tally_benchmark )
+{ try {
+   generate_blocks( HARDFORK_CORE_2262_TIME );
+   generate_block();
+
+#ifdef NDEBUG
+   const uint32_t account_count = 2000000;
+#else
+   const uint32_t account_count = 30000;
+#endif
+
+   vector<witness_id_type> witnesses;
+   vector<vote_id_type> witness_votes;
+   for( const witness_object& wit : db.get_index_type<witness_index>().indices() )
+   {
+      witnesses.push_back( wit.id );
+      witness_votes.push_back( wit.vote_id );
+   }
+   vector<vote_id_type> committee_votes;
+   for( const committee_member_object& cm : db.get_index_type<committee_member_index>().indices() )
+      committee_votes.push_back( cm.vote_id );
+   vector<uint64_t> expected_witness_votes( witness_votes.size(), 0 );
+
+   // Voting stake is given to the synthetic accounts directly, without creating the tickets that
+   // would back it, thus the objects are created and cleaned up outside of the fixture's supply checks
+   const auto now = db.head_block_time();
+   vector<account_statistics_id_type> voters;
+   voters.reserve( account_count );
+   auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < account_count; ++i )
+   {
+      const uint64_t stake = 1 + i % 1000;
+      expected_witness_votes[ i % witness_votes.size() ] += stake;
+      const account_object& acct = db.create<account_object>( [&]( account_object& a ) {
+         a.name = "voter" + fc::to_string( i );
+         a.registrar = a.referrer = a.lifetime_referrer = GRAPHENE_COMMITTEE_ACCOUNT;
+         a.membership_expiration_date = time_point_sec::maximum();
+         a.owner = a.active = authority( 1, init_account_pub_key, 1 );
+         a.options.memo_key = init_account_pub_key;
+         a.options.voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+         a.options.votes.insert( witness_votes[ i % witness_votes.size() ] );
+         a.options.votes.insert( committee_votes[ i % committee_votes.size() ] );
+         a.options.num_witness = 1;
+         a.options.num_committee = 1;
+         a.num_committee_voted = 1;
+         a.statistics = db.create<account_statistics_object>( [&a,stake,now]( account_statistics_object& s ) {
+            s.owner = a.id;
+            s.name = a.name;
+            s.is_voting = true;
+            s.last_vote_time = now;
+            s.total_core_pol = stake;
+            s.total_pol_value = stake;
+         }).id;
+      });
+      voters.push_back( acct.statistics );
+   }
+   auto elapsed = fc::time_point::now() - start;
+   wlog( "Created ${n} voting accounts in ${total}ms", ("n",account_count)("total",elapsed.count()/1000) );
+
+   // Votes of the accounts created by the fixture are counted as well
+   for( size_t i = 0; i < witness_votes.size(); ++i )
+      expected_witness_votes[i] += witnesses[i](db).total_votes;
+
+   const auto maint_slot = db.get_slot_at_time( db.get_dynamic_global_properties().next_maintenance_time );
+   start = fc::time_point::now();
+   db.generate_block( db.get_slot_time( maint_slot ), db.get_scheduled_witness( maint_slot ),
+                      init_account_priv_key, ~0 );
+   elapsed = fc::time_point::now() - start;
+   wlog( "Tallied votes of ${n} accounts in ${total}ms => ${aps} accounts/s",
+         ("n",account_count)("total",elapsed.count()/1000)
+         ("aps",(uint64_t(account_count)*1000000)/elapsed.count()) );
+
+   for( size_t i = 0; i < witness_votes.size(); ++i )
+      BOOST_CHECK_EQUAL( witnesses[i](db).total_votes, expected_witness_votes[i] );
+   BOOST_CHECK_EQUAL( voters.back()(db).vp_all, 1 + ( account_count - 1 ) % 1000 );
+
+   for( const auto& voter : voters )
+      db.modify( voter(db), []( account_statistics_object& s ) {
+         s.total_core_pol = 0;
+         s.total_pol_value = 0;
+      });
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( json_writer_benchmark )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice, asset(100000000) );
+   const asset_object& uia = create_user_issued_asset( "BENCHCOIN", alice, 0 );
+   issue_uia( alice, uia.amount( 100000000 ) );
+   for( uint32_t i = 0; i < 500; ++i )
+   {
+      transfer( alice_id, bob_id, asset( 1 + i ) );
+      create_sell_order( alice_id, uia.amount( 100 ), asset( 1000 + i ) );
+   }
+   generate_block();
+
+   // Accounts, balances, orders and operation history, i. e. what most API calls return
+   std::vector<const graphene::db::object*> objects;
+   db.inspect_all_indexes( [&objects]( const graphene::db::index& index ) {
+      index.inspect_all_objects( [&objects]( const graphene::db::object& o ) {
+         objects.push_back( &o );
+      });
+   });
+
+   const uint32_t cycles = 20;
+   size_t variant_bytes = 0;
+   auto start = fc::time_point::now();
+   for( uint32_t c = 0; c < cycles; ++c )
+      for( const auto* o : objects )
+         variant_bytes += fc::json::to_string( o->to_variant() ).size();
+   auto variant_elapsed = fc::time_point::now() - start;
+
+   size_t writer_bytes = 0;
+   std::string buffer;
+   start = fc::time_point::now();
+   for( uint32_t c = 0; c < cycles; ++c )
+      for( const auto* o : objects )
+      {
+         buffer.clear();
+         o->to_json( buffer );
+         writer_bytes += buffer.size();
+      }
+   auto writer_elapsed = fc::time_point::now() - start;
+
+   BOOST_CHECK_EQUAL( variant_bytes, writer_bytes );
+   wlog( "Benchmark: wrote ${n} objects ${c} times as JSON, via fc::variant in ${v}ms, via json_writer in ${w}ms",
+         ("n",objects.size())("c",cycles)("v",variant_elapsed.count()/1000)("w",writer_elapsed.count()/1000) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( order_book_benchmark )
+{ try {
+   // the order book of one market, ordered by comparing prices like before and by the cached price keys
+   typedef multi_index_container< limit_order_object, indexed_by<
+      ordered_unique<
+         composite_key< limit_order_object,
+            member< limit_order_object, price, &limit_order_object::sell_price >,
+            member< object, object_id_type, &object::id > >,
+         composite_key_compare< std::greater<price>, std::less<object_id_type> > > > > price_book_type;
+   typedef multi_index_container< limit_order_object, indexed_by<
+      ordered_unique<
+         composite_key< limit_order_object,
+            member< limit_order_object, price_key, &limit_order_object::sell_price_key >,
+            member< object, object_id_type, &object::id > >,
+         composite_key_compare< std::greater<price_key>, std::less<object_id_type> > > > > key_book_type;
+
+   const asset_id_type sold_asset( 1 );
+   const asset_id_type received_asset;
+   const uint32_t depth = 200000;
+   const uint32_t taker_count = 50000;
+   std::mt19937_64 rng( 42 );
+
+   // a deep book around the price of 1, with many orders on the same price levels
+   std::vector<limit_order_object> orders( depth );
+   for( uint32_t i = 0; i < depth; ++i )
+   {
+      limit_order_object& o = orders[i];
+      o.id = limit_order_id_type( i );
+      o.for_sale = 1 + rng() % 1000;
+      const int64_t scale = 1 + rng() % 16;
+      o.sell_price = price( asset( scale * ( 100000 + rng() % 2000 ), sold_asset ),
+                            asset( scale * 101000, received_asset ) );
+   }
+   std::vector<price> takers;
+   for( uint32_t i = 0; i < taker_count; ++i )
+      takers.emplace_back( asset( 100000 + rng() % 2000, received_asset ), asset( 101000, sold_asset ) );
+
+   // the lookups done by database::apply_order() for a new order, followed by a walk over the matching orders
+   auto match_takers = [&takers]( const auto& book, auto make_key ) {
+      share_type matched = 0;
+      for( const price& taker : takers )
+      {
+         const price max_price = ~taker;
+         auto itr = book.lower_bound( make_key( max_price.max() ) );
+         auto end = book.upper_bound( make_key( max_price ) );
+         for( uint32_t filled = 0; itr != end && filled < 20; ++itr, ++filled )
+            matched += itr->for_sale;
+      }
+      return matched;
+   };
+
+   auto start = fc::time_point::now();
+   price_book_type price_book( orders.begin(), orders.end() );
+   const auto price_insert_elapsed = fc::time_point::now() - start;
+   start = fc::time_point::now();
+   const share_type price_matched = match_takers( price_book, []( const price& p ) { return p; } );
+   const auto price_match_elapsed = fc::time_point::now() - start;
+
+   // the keys are computed when the orders are created
+   start = fc::time_point::now();
+   for( limit_order_object& o : orders )
+      o.update_derived_keys();
+   key_book_type key_book( orders.begin(), orders.end() );
+   const auto key_insert_elapsed = fc::time_point::now() - start;
+   start = fc::time_point::now();
+   const share_type key_matched = match_takers( key_book, []( const price& p ) { return price_key( p ); } );
+   const auto key_match_elapsed = fc::time_point::now() - start;
+
+   BOOST_CHECK_EQUAL( price_matched.value, key_matched.value );
+   BOOST_REQUIRE_EQUAL( price_book.size(), key_book.size() );
+   BOOST_CHECK( std::equal( price_book.begin(), price_book.end(), key_book.begin(),
+                            []( const limit_order_object& a, const limit_order_object& b ) { return a.id == b.id; } ) );
+
+   wlog( "Benchmark: ${n} orders inserted by price in ${pi}ms, by price key in ${ki}ms; "
+         "${t} takers matched by price in ${pm}ms, by price key in ${km}ms",
+         ("n",depth)("t",taker_count)
+         ("pi",price_insert_elapsed.count()/1000)("ki",key_insert_elapsed.count()/1000)
+         ("pm",price_match_elapsed.count()/1000)("km",key_match_elapsed.count()/1000) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( fee_calculation_benchmark )
+{ try {
+   // one default constructed operation of every type
+   std::vector<operation> ops( fee_parameters().count() );
+   for( size_t i = 0; i < ops.size(); ++i )
+      ops[i].set_which( i );
+
+   const uint32_t cycles = 20000;
+   // a complete schedule, and an empty one where every fee falls back to the defaults
+   auto run = [&ops]( const fee_schedule& schedule ) {
+      share_type total = 0;
+      for( uint32_t c = 0; c < cycles; ++c )
+         for( const operation& op : ops )
+            total += schedule.calculate_fee( op ).amount;
+      return total;
+   };
+
+   const fee_schedule full_schedule = fee_schedule::get_default();
+   auto start = fc::time_point::now();
+   const share_type full_total = run( full_schedule );
+   const auto full_elapsed = fc::time_point::now() - start;
+
+   const fee_schedule empty_schedule;
+   start = fc::time_point::now();
+   const share_type empty_total = run( empty_schedule );
+   const auto empty_elapsed = fc::time_point::now() - start;
+
+   BOOST_CHECK( full_total > 0 );
+   BOOST_CHECK( empty_total > 0 );
+   wlog( "Benchmark: calculated fees of ${n} operation types ${c} times with a complete schedule in ${f}ms, "
+         "with an empty schedule in ${e}ms",
+         ("n",ops.size())("c",cycles)("f",full_elapsed.count()/1000)("e",empty_elapsed.count()/1000) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( custom_authority_benchmark )
+{ try {
+   ACTORS( (alice)(bob) );
+
+   const uint32_t authority_count = 100;
+   const uint32_t restriction_sets = 10;
+   const unsigned_int to_index = 2;           // transfer_operation::to
+   const unsigned_int amount_index = 3;       // transfer_operation::amount
+   const unsigned_int asset_amount_index = 0; // asset::amount
+
+   for( uint32_t i = 0; i < authority_count; ++i )
+   {
+      const uint32_t set_number = i % restriction_sets;
+      flat_set<account_id_type> blocked_recipients;
+      for( uint32_t j = 0; j <= set_number; ++j )
+         blocked_recipients.insert( account_id_type( 1000 + j ) );
+      db.create<custom_authority_object>( [&]( custom_authority_object& auth ) {
+         auth.account = alice_id;
+         auth.enabled = true;
+         auth.valid_from = db.head_block_time();
+         auth.valid_to = db.head_block_time() + fc::days(1);
+         auth.operation_type = operation::tag<transfer_operation>::value;
+         auth.auth = authority( 1, bob_id, 1 );
+         auth.restrictions[auth.restriction_counter++] =
+               restriction( to_index, restriction::func_not_in, blocked_recipients );
+         auth.restrictions[auth.restriction_counter++] =
+               restriction( amount_index, restriction::func_attr, vector<restriction>{
+                  restriction( asset_amount_index, restriction::func_lt, int64_t( 1000 + set_number ) ) } );
+      });
+   }
+
+   // identical restriction sets are compiled only once
+   std::set<const restriction_predicate_function*> predicates;
+   for( const custom_authority_object& auth : db.get_index_type<custom_authority_index>().indices() )
+      predicates.insert( auth.get_predicate().get() );
+   BOOST_CHECK_EQUAL( predicates.size(), restriction_sets );
+
+   transfer_operation top;
+   top.from = alice_id;
+   top.to = bob_id;
+   top.amount = asset( 500 );
+   const operation op = top;
+
+   const uint32_t cycles = 2000;
+   size_t viable = 0;
+   auto start = fc::time_point::now();
+   for( uint32_t c = 0; c < cycles; ++c )
+      viable += db.get_viable_custom_authorities( alice_id, op ).size();
+   const auto elapsed = fc::time_point::now() - start;
+
+   BOOST_CHECK_EQUAL( viable, size_t(authority_count) * cycles );
+   wlog( "Benchmark: evaluated ${n} custom authorities ${c} times in ${t}ms",
+         ("n",authority_count)("c",cycles)("t",elapsed.count()/1000) );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
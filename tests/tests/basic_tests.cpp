@@ -29,6 +29,7 @@
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/exceptions.hpp>
+#include <graphene/chain/market_object.hpp>
 
 #include <graphene/db/simple_index.hpp>
 
@@ -316,6 +317,40 @@ BOOST_AUTO_TEST_CASE( price_test )
     BOOST_CHECK( dummy.margin_call_params_equal( dummy3 ) );
 }
 
+BOOST_AUTO_TEST_CASE( price_key_test )
+{
+    // neighbouring ratios, equal ratios with different amounts and amounts that can not be converted exactly
+    std::vector<price> prices;
+    const std::vector<int64_t> amounts = { 1, 2, 3, 7, 1000, 1001, 999999999999999ll, GRAPHENE_MAX_SHARE_SUPPLY,
+                                           (int64_t(1) << 53) - 1, int64_t(1) << 53, (int64_t(1) << 53) + 1,
+                                           (int64_t(1) << 62) + 3 };
+    for( uint32_t base = 0; base < 2; ++base )
+       for( uint32_t quote = 0; quote < 2; ++quote )
+          if( base != quote )
+             for( int64_t a : amounts )
+                for( int64_t b : amounts )
+                   prices.emplace_back( asset( a, asset_id_type(base) ), asset( b, asset_id_type(quote) ) );
+    std::mt19937_64 rng( 21 );
+    for( uint32_t i = 0; i < 1000; ++i )
+    {
+       const int64_t a = 1 + rng() % 100000;
+       const int64_t b = 1 + rng() % 100000;
+       const int64_t k = 1 + rng() % 1000;
+       prices.emplace_back( asset( a, asset_id_type(1) ), asset( b ) );
+       prices.emplace_back( asset( a * k, asset_id_type(1) ), asset( b * k ) );
+    }
+
+    std::vector<price_key> keys( prices.begin(), prices.end() );
+    uint64_t mismatches = 0;
+    for( size_t i = 0; i < prices.size(); ++i )
+       for( size_t j = 0; j < prices.size(); ++j )
+       {
+          if( ( keys[i] < keys[j] ) != ( prices[i] < prices[j] ) )
+             ++mismatches;
+       }
+    BOOST_CHECK_EQUAL( mismatches, 0u );
+}
+
 BOOST_AUTO_TEST_CASE( price_multiplication_test )
 { try {
    // random test
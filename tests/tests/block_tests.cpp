@@ -36,6 +36,8 @@
 #include <graphene/chain/witness_schedule_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 
+#include <graphene/snapshot/snapshot.hpp>
+
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
@@ -101,7 +103,16 @@ BOOST_AUTO_TEST_CASE( block_database_test )
          fetch = bdb.fetch_optional( b.id() );
          FC_ASSERT( fetch.valid() );
          FC_ASSERT( fetch->witness ==  b.witness );
+
+         auto raw = bdb.fetch_raw_by_number( b.block_num() );
+         FC_ASSERT( raw.valid() );
+         FC_ASSERT( *raw == fc::raw::pack( signed_block( b ) ) );
+         raw = bdb.fetch_raw_optional( b.id() );
+         FC_ASSERT( raw.valid() );
+         FC_ASSERT( *raw == fc::raw::pack( signed_block( b ) ) );
       }
+      FC_ASSERT( !bdb.fetch_raw_by_number( 6 ).valid() );
+      FC_ASSERT( !bdb.fetch_raw_optional( block_id_type() ).valid() );
 
       for( uint32_t i = 1; i < 5; ++i )
       {
@@ -192,6 +203,83 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
    }
 }
 
+BOOST_AUTO_TEST_CASE( binary_snapshot_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path snapshot_dir = data_dir.path() / "snapshot";
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      fc::optional<graphene::snapshot_plugin::snapshot_manifest> manifest;
+      std::map< std::pair<uint8_t,uint8_t>, std::string > expected;
+      {
+         database db;
+         db.open( data_dir.path() / "original", make_genesis, GRAPHENE_CURRENT_DB_VERSION );
+         // create accounts in every block, their transaction objects expire and are removed a few blocks later
+         uint32_t created = 0;
+         auto generate = [&db,&init_account_priv_key,&created]() {
+            account_create_operation cop;
+            cop.name = "snapshot" + fc::to_string( created++ );
+            cop.owner = authority( 1, init_account_priv_key.get_public_key(), 1 );
+            cop.active = cop.owner;
+            signed_transaction trx;
+            set_expiration( db, trx );
+            trx.operations.push_back( cop );
+            PUSH_TX( db, trx, ~0 );
+            db.generate_block( db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                               database::skip_nothing );
+         };
+         for( uint32_t i = 0; i < 30; ++i )
+            generate();
+
+         auto connection = db.applied_block.connect( [&db,&manifest,&snapshot_dir]( const signed_block& b ) {
+            if( !manifest.valid() )
+               manifest = graphene::snapshot_plugin::write_binary_snapshot( db, b, snapshot_dir, true );
+         });
+         generate();
+         connection.disconnect();
+         BOOST_REQUIRE( manifest.valid() );
+         // the snapshot holds the state at the last irreversible block, without the newer changes
+         BOOST_CHECK_LT( manifest->head_block_num, db.head_block_num() );
+         BOOST_CHECK_EQUAL( manifest->head_block_num, db.get_dynamic_global_properties().last_irreversible_block_num );
+         BOOST_CHECK( manifest->head_block_id == db.fetch_block_by_number( manifest->head_block_num )->id() );
+
+         while( db.head_block_num() > manifest->head_block_num )
+            db.pop_block();
+         db.clear_pending();
+         db.inspect_all_indexes( [&expected]( const graphene::db::index& idx ) {
+            std::ostringstream out;
+            idx.save_to( out );
+            expected[ std::make_pair( idx.object_space_id(), idx.object_type_id() ) ] = out.str();
+         });
+      }
+      {
+         const fc::path chain_dir = data_dir.path() / "restored";
+         const auto restored = graphene::snapshot_plugin::restore_binary_snapshot( snapshot_dir, chain_dir );
+         BOOST_CHECK( restored.state_hash == manifest->state_hash );
+
+         database db;
+         db.open( chain_dir, []{ return genesis_state_type(); }, GRAPHENE_CURRENT_DB_VERSION );
+         BOOST_CHECK( db.head_block_id() == manifest->head_block_id );
+         size_t compared = 0;
+         db.inspect_all_indexes( [&expected,&compared]( const graphene::db::index& idx ) {
+            std::ostringstream out;
+            idx.save_to( out );
+            BOOST_CHECK( out.str() == expected.at( std::make_pair( idx.object_space_id(), idx.object_type_id() ) ) );
+            ++compared;
+         });
+         BOOST_CHECK_EQUAL( compared, expected.size() );
+
+         // the restored node continues from the snapshot block
+         db.generate_block( db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                            database::skip_nothing );
+         BOOST_CHECK_EQUAL( db.head_block_num(), manifest->head_block_num + 1 );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( undo_block )
 {
    try {
@@ -1385,6 +1473,232 @@ BOOST_FIXTURE_TEST_CASE( transaction_invalidated_in_cache, database_fixture )
    }
 }
 
+BOOST_FIXTURE_TEST_CASE( pending_transactions_replayed, database_fixture )
+{
+   try
+   {
+      ACTORS( (alice)(bob)(carol)(dave) );
+      fund( alice );
+      fund( bob );
+      fund( carol );
+      fund( dave );
+
+      auto generate_block = [&]( database& d, uint32_t skip ) -> signed_block
+      {
+         return d.generate_block(d.get_slot_time(1), d.get_scheduled_witness(1), init_account_priv_key, skip);
+      };
+
+      // tx's created by ACTORS() have bogus authority, so we need to
+      // skip_transaction_signatures in the block where they're included
+      generate_block( db, database::skip_transaction_signatures );
+
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+
+      database db2;
+      {
+         std::string genesis_json;
+         fc::read_file_contents( data_dir.path() / "genesis.json", genesis_json );
+         genesis_state_type genesis = fc::json::from_string( genesis_json ).as<genesis_state_type>( 50 );
+         genesis.initial_chain_id = fc::sha256::hash( genesis_json );
+         db2.open(data_dir2.path(), [&genesis] () { return genesis; }, "TEST");
+      }
+      while( db2.head_block_num() < db.head_block_num() )
+      {
+         optional< signed_block > b = db.fetch_block_by_number( db2.head_block_num()+1 );
+         db2.push_block(*b, database::skip_witness_signature
+                           |database::skip_transaction_signatures );
+      }
+
+      auto generate_xfer_tx = [&]( account_id_type from, account_id_type to, share_type amount,
+                                   const fc::ecc::private_key& key ) -> signed_transaction
+      {
+         signed_transaction tx;
+         transfer_operation xfer_op;
+         xfer_op.from = from;
+         xfer_op.to = to;
+         xfer_op.amount = asset( amount, asset_id_type() );
+         xfer_op.fee = asset( 0, asset_id_type() );
+         tx.operations.push_back( xfer_op );
+         tx.set_expiration( db.head_block_time() + 10 * db.get_global_properties().parameters.block_interval );
+         sign( tx, key );
+         return tx;
+      };
+
+      const share_type alice_balance = db.get_balance( alice_id, asset_id_type() ).amount;
+      const share_type carol_balance = db.get_balance( carol_id, asset_id_type() ).amount;
+
+      signed_transaction tx_a = generate_xfer_tx( alice_id, bob_id, 1000, alice_private_key );
+      signed_transaction tx_c = generate_xfer_tx( carol_id, dave_id, 500, carol_private_key );
+
+      // db has both transactions pending, the block produced by db2 only contains the first one
+      PUSH_TX( db, tx_a );
+      PUSH_TX( db, tx_c );
+      PUSH_TX( db2, tx_a );
+
+      const mempool_stats before = db.get_mempool_stats();
+      BOOST_CHECK_EQUAL( before.size, 2u );
+
+      PUSH_BLOCK( db, generate_block( db2, database::skip_nothing ) );
+
+      // the transfer of carol does not depend on anything changed by the block, so it is not evaluated again
+      const mempool_stats after = db.get_mempool_stats();
+      BOOST_CHECK_EQUAL( after.size, 1u );
+      BOOST_CHECK_EQUAL( after.revalidations, before.revalidations + 1 );
+      BOOST_CHECK_EQUAL( after.full_revalidations, before.full_revalidations );
+      BOOST_CHECK_EQUAL( after.dropped_included, before.dropped_included + 1 );
+      BOOST_CHECK_EQUAL( after.replayed, before.replayed + 1 );
+      BOOST_CHECK_EQUAL( after.reevaluated, before.reevaluated );
+
+      BOOST_CHECK_EQUAL( db.get_balance( alice_id, asset_id_type() ).amount.value, alice_balance.value - 1000 );
+      BOOST_CHECK_EQUAL( db.get_balance( carol_id, asset_id_type() ).amount.value, carol_balance.value - 500 );
+      BOOST_CHECK( db.is_known_transaction( tx_c.id() ) );
+
+      // a pending transaction depending on the changes of a block is evaluated again
+      signed_transaction tx_b = generate_xfer_tx( bob_id, alice_id, 300, bob_private_key );
+      PUSH_TX( db, tx_b );
+      signed_transaction tx_d = generate_xfer_tx( alice_id, bob_id, 200, alice_private_key );
+      PUSH_TX( db2, tx_d );
+      PUSH_BLOCK( db, generate_block( db2, database::skip_nothing ) );
+
+      const mempool_stats last = db.get_mempool_stats();
+      BOOST_CHECK_EQUAL( last.size, 2u );
+      BOOST_CHECK_EQUAL( last.replayed, after.replayed + 1 );
+      BOOST_CHECK_EQUAL( last.reevaluated, after.reevaluated + 1 );
+      BOOST_CHECK_EQUAL( db.get_balance( alice_id, asset_id_type() ).amount.value, alice_balance.value - 900 );
+      BOOST_CHECK_EQUAL( db.get_balance( carol_id, asset_id_type() ).amount.value, carol_balance.value - 500 );
+
+      // the pending transactions are included in the next block produced by db
+      PUSH_BLOCK( db2, generate_block( db, database::skip_nothing ) );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().size, 0u );
+      BOOST_CHECK_EQUAL( db2.get_balance( alice_id, asset_id_type() ).amount.value, alice_balance.value - 900 );
+      BOOST_CHECK_EQUAL( db2.get_balance( carol_id, asset_id_type() ).amount.value, carol_balance.value - 500 );
+   }
+   catch (fc::exception& e)
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( mempool_fee_priority, database_fixture )
+{
+   try
+   {
+      ACTORS( (alice)(bob)(carol)(dave) );
+      fund( alice );
+      fund( bob );
+      fund( carol );
+      fund( dave );
+      generate_block();
+
+      auto make_xfer_tx = [&]( account_id_type from, const fc::ecc::private_key& key, share_type amount,
+                               share_type fee ) -> signed_transaction
+      {
+         signed_transaction tx;
+         transfer_operation xfer_op;
+         xfer_op.from = from;
+         xfer_op.to = account_id_type();
+         xfer_op.amount = asset( amount );
+         xfer_op.fee = asset( fee );
+         tx.operations.push_back( xfer_op );
+         set_expiration( db, tx );
+         sign( tx, key );
+         return tx;
+      };
+
+      BOOST_TEST_MESSAGE( "Limit the number of pending transactions per account" );
+      mempool_limits limits;
+      limits.max_per_account = 2;
+      db.set_mempool_limits( limits );
+      PUSH_TX( db, make_xfer_tx( alice_id, alice_private_key, 1, 100 ) );
+      PUSH_TX( db, make_xfer_tx( alice_id, alice_private_key, 2, 100 ) );
+      GRAPHENE_REQUIRE_THROW( PUSH_TX( db, make_xfer_tx( alice_id, alice_private_key, 3, 100 ) ), fc::exception );
+      PUSH_TX( db, make_xfer_tx( bob_id, bob_private_key, 3, 100 ) );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().rejected, 1u );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().size, 3u );
+      generate_block();
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().size, 0u );
+
+      BOOST_TEST_MESSAGE( "Drop the worst paying transactions when the memory limit is reached" );
+      db.set_mempool_limits( mempool_limits() );
+      signed_transaction low_tx = make_xfer_tx( bob_id, bob_private_key, 4, 10 );
+      signed_transaction mid_tx = make_xfer_tx( carol_id, carol_private_key, 4, 20 );
+      signed_transaction high_tx = make_xfer_tx( alice_id, alice_private_key, 4, 30 );
+      PUSH_TX( db, low_tx );
+      PUSH_TX( db, mid_tx );
+      PUSH_TX( db, high_tx );
+      limits = mempool_limits();
+      limits.max_memory = db.get_mempool_stats().memory_usage;
+      db.set_mempool_limits( limits );
+
+      // does not pay more than any pending transaction
+      GRAPHENE_REQUIRE_THROW( PUSH_TX( db, make_xfer_tx( dave_id, dave_private_key, 4, 5 ) ), fc::exception );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().rejected, 2u );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().size, 3u );
+
+      // transactions which fail to apply do not push out any others, whatever fee they declare
+      GRAPHENE_REQUIRE_THROW( PUSH_TX( db, make_xfer_tx( dave_id, dave_private_key, 1000000000000LL, 1000 ) ),
+                              fc::exception );
+      GRAPHENE_REQUIRE_THROW( PUSH_TX( db, high_tx ), fc::exception );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().evicted_low_fee, 0u );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().rejected, 2u );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().size, 3u );
+      BOOST_CHECK( db.is_known_transaction( low_tx.id() ) );
+
+      signed_transaction best_tx = make_xfer_tx( dave_id, dave_private_key, 4, 1000 );
+      const uint64_t revalidations = db.get_mempool_stats().revalidations;
+      PUSH_TX( db, best_tx );
+      const mempool_stats stats = db.get_mempool_stats();
+      BOOST_CHECK_GE( stats.evicted_low_fee, 1u );
+      BOOST_CHECK_LE( stats.memory_usage, limits.max_memory );
+      // the pending state is not rebuilt for the eviction, but the evicted transaction is not included
+      BOOST_CHECK_EQUAL( stats.revalidations, revalidations );
+      const auto included = [&]( const signed_block& b, const signed_transaction& tx ) {
+         return std::any_of( b.transactions.begin(), b.transactions.end(),
+                             [&tx]( const processed_transaction& t ) { return t.id() == tx.id(); } );
+      };
+      const signed_block evicting_block = generate_block();
+      BOOST_CHECK( !included( evicting_block, low_tx ) );
+      BOOST_CHECK( included( evicting_block, high_tx ) );
+      BOOST_CHECK( included( evicting_block, best_tx ) );
+      BOOST_CHECK( !db.is_known_transaction( low_tx.id() ) );
+      db.set_mempool_limits( mempool_limits() );
+
+      BOOST_TEST_MESSAGE( "Include the best paying transactions if not all fit into a block" );
+      const auto& gpo = db.get_global_properties();
+      const uint32_t old_maximum_block_size = gpo.parameters.maximum_block_size;
+      // room for one transfer only
+      db._undo_db.disable();
+      db.modify( gpo, []( global_property_object& p ) {
+         p.parameters.maximum_block_size = fc::raw::pack_size( signed_block_header() ) + 200;
+      });
+      db._undo_db.enable();
+
+      signed_transaction cheap_tx = make_xfer_tx( bob_id, bob_private_key, 5, 10 );
+      signed_transaction paying_tx = make_xfer_tx( carol_id, carol_private_key, 5, 500 );
+      PUSH_TX( db, cheap_tx );
+      PUSH_TX( db, paying_tx );
+      signed_block block = generate_block();
+      BOOST_REQUIRE_EQUAL( block.transactions.size(), 1u );
+      BOOST_CHECK( block.transactions.front().id() == paying_tx.id() );
+      BOOST_CHECK_EQUAL( db.get_mempool_stats().size, 1u );
+
+      db._undo_db.disable();
+      db.modify( gpo, [old_maximum_block_size]( global_property_object& p ) {
+         p.parameters.maximum_block_size = old_maximum_block_size;
+      });
+      db._undo_db.enable();
+      block = generate_block();
+      BOOST_REQUIRE_EQUAL( block.transactions.size(), 1u );
+      BOOST_CHECK( block.transactions.front().id() == cheap_tx.id() );
+   }
+   catch( fc::exception& e )
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( genesis_reserve_ids )
 {
    try
@@ -6230,4 +6230,55 @@ BOOST_AUTO_TEST_CASE(custom_auths) { try {
       FC_LOG_AND_RETHROW()
    }
 
+   BOOST_AUTO_TEST_CASE(custom_authority_predicate_sharing) {
+      try {
+         ACTORS((alice)(bob))
+
+         // Authorities with identical restrictions share one compiled predicate, built when they are created
+         const auto to_index = member_index<transfer_operation>("to");
+         auto create_auth = [&](account_id_type recipient) {
+            return db.create<custom_authority_object>([&](custom_authority_object& auth) {
+               auth.account = alice_id;
+               auth.enabled = true;
+               auth.valid_from = db.head_block_time();
+               auth.valid_to = db.head_block_time() + 1000;
+               auth.operation_type = operation::tag<transfer_operation>::value;
+               auth.auth = authority(1, bob_id, 1);
+               auth.restrictions[auth.restriction_counter++] = restriction(to_index, FUNC(eq), recipient);
+            }).id;
+         };
+         const custom_authority_id_type first_id = create_auth(bob_id);
+         const custom_authority_id_type second_id = create_auth(bob_id);
+         BOOST_REQUIRE(first_id(db).get_predicate() != nullptr);
+         BOOST_CHECK(first_id(db).get_predicate() == second_id(db).get_predicate());
+
+         transfer_operation top;
+         top.from = alice_id;
+         top.to = bob_id;
+         top.amount = asset(100);
+         const operation op = top;
+         BOOST_CHECK((*first_id(db).get_predicate())(op).success);
+         BOOST_CHECK_EQUAL(db.get_viable_custom_authorities(alice_id, op).size(), 2u);
+
+         {
+            // Modifying the restrictions compiles a new predicate for the modified authority only
+            auto session = db._undo_db.start_undo_session();
+            db.modify(second_id(db), [&](custom_authority_object& auth) {
+               auth.restrictions[0] = restriction(to_index, FUNC(eq), alice_id);
+            });
+            BOOST_CHECK(first_id(db).get_predicate() != second_id(db).get_predicate());
+            BOOST_CHECK(!(*second_id(db).get_predicate())(op).success);
+            rejected_predicate_map rejected;
+            BOOST_CHECK_EQUAL(db.get_viable_custom_authorities(alice_id, op, &rejected).size(), 1u);
+            BOOST_CHECK_EQUAL(rejected.size(), 1u);
+            BOOST_CHECK(rejected.count(second_id) == 1);
+         }
+
+         // Undoing the modification restores the shared predicate
+         BOOST_CHECK(first_id(db).get_predicate() == second_id(db).get_predicate());
+         BOOST_CHECK_EQUAL(db.get_viable_custom_authorities(alice_id, op).size(), 2u);
+      }
+      FC_LOG_AND_RETHROW()
+   }
+
 BOOST_AUTO_TEST_SUITE_END()
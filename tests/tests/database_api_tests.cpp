@@ -24,7 +24,10 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <graphene/app/api.hpp>
+#include <graphene/app/api_worker_pool.hpp>
 #include <graphene/app/database_api.hpp>
+#include <graphene/app/subscription_dispatcher.hpp>
 #include <graphene/chain/hardfork.hpp>
 
 #include <fc/crypto/digest.hpp>
@@ -1909,4 +1912,403 @@ BOOST_AUTO_TEST_CASE( get_trade_history )
 } FC_LOG_AND_RETHROW() }
 
 
+BOOST_AUTO_TEST_CASE( get_order_book_depth )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice, asset( 10000000 ) );
+   const asset_object& uia = create_user_issued_asset( "DEPTHCOIN", bob, 0 );
+   issue_uia( bob, uia.amount( 10000000 ) );
+   const asset_object& core = asset_id_type()( db );
+
+   graphene::app::database_api db_api( db, &( app.get_options() ) );
+   auto depth = db_api.get_order_book_depth( GRAPHENE_SYMBOL, "DEPTHCOIN", 10 );
+   BOOST_CHECK( depth.bids.empty() );
+   BOOST_CHECK( depth.asks.empty() );
+   BOOST_CHECK_EQUAL( depth.bid_depth, core.amount_to_string( 0 ) );
+
+   // bids, the first two at the same price
+   create_sell_order( alice_id, asset( 100 ), uia.amount( 10 ) );
+   create_sell_order( alice_id, asset( 200 ), uia.amount( 20 ) );
+   const limit_order_object* low_bid = create_sell_order( alice_id, asset( 50 ), uia.amount( 10 ) );
+   // asks
+   create_sell_order( bob_id, uia.amount( 10 ), asset( 200 ) );
+   create_sell_order( bob_id, uia.amount( 10 ), asset( 300 ) );
+
+   depth = db_api.get_order_book_depth( GRAPHENE_SYMBOL, "DEPTHCOIN", 10 );
+   BOOST_REQUIRE_EQUAL( depth.bids.size(), 2u );
+   BOOST_CHECK_EQUAL( depth.bids[0].base, core.amount_to_string( 300 ) );
+   BOOST_CHECK_EQUAL( depth.bids[0].quote, uia.amount_to_string( 30 ) );
+   BOOST_CHECK_EQUAL( depth.bids[0].orders, 2u );
+   BOOST_CHECK_EQUAL( depth.bids[1].base, core.amount_to_string( 50 ) );
+   BOOST_CHECK_EQUAL( depth.bids[1].cumulative_base, core.amount_to_string( 350 ) );
+   BOOST_CHECK_EQUAL( depth.bids[1].cumulative_quote, uia.amount_to_string( 40 ) );
+   BOOST_CHECK_EQUAL( depth.bid_depth, core.amount_to_string( 350 ) );
+   BOOST_CHECK_EQUAL( depth.bid_orders, 3u );
+
+   BOOST_REQUIRE_EQUAL( depth.asks.size(), 2u );
+   BOOST_CHECK_EQUAL( depth.asks[0].quote, uia.amount_to_string( 10 ) );
+   BOOST_CHECK_EQUAL( depth.asks[0].base, core.amount_to_string( 200 ) );
+   BOOST_CHECK_EQUAL( depth.asks[1].cumulative_base, core.amount_to_string( 500 ) );
+   BOOST_CHECK_EQUAL( depth.ask_depth, uia.amount_to_string( 20 ) );
+   BOOST_CHECK_EQUAL( depth.ask_orders, 2u );
+
+   // the price levels match the order book
+   auto book = db_api.get_order_book( GRAPHENE_SYMBOL, "DEPTHCOIN", 10 );
+   BOOST_CHECK_EQUAL( depth.bids[0].price, book.bids[0].price );
+   BOOST_CHECK_EQUAL( depth.asks[0].price, book.asks[0].price );
+
+   // a partial fill of the best ask
+   BOOST_CHECK( create_sell_order( alice_id, asset( 100 ), uia.amount( 5 ) ) == nullptr );
+   depth = db_api.get_order_book_depth( GRAPHENE_SYMBOL, "DEPTHCOIN", 1 );
+   BOOST_REQUIRE_EQUAL( depth.asks.size(), 1u );
+   BOOST_CHECK_EQUAL( depth.asks[0].quote, uia.amount_to_string( 5 ) );
+   BOOST_CHECK_EQUAL( depth.asks[0].base, core.amount_to_string( 100 ) );
+   BOOST_CHECK_EQUAL( depth.ask_depth, uia.amount_to_string( 15 ) );
+   BOOST_CHECK_EQUAL( depth.bids.size(), 1u );
+
+   // a cancelled order removes its price level
+   cancel_limit_order( *low_bid );
+   depth = db_api.get_order_book_depth( GRAPHENE_SYMBOL, "DEPTHCOIN", 10 );
+   BOOST_CHECK_EQUAL( depth.bids.size(), 1u );
+   BOOST_CHECK_EQUAL( depth.bid_depth, core.amount_to_string( 300 ) );
+   BOOST_CHECK_EQUAL( depth.bid_orders, 2u );
+
+   BOOST_CHECK_THROW( db_api.get_order_book_depth( GRAPHENE_SYMBOL, "DEPTHCOIN", 51 ), fc::exception );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( export_raw_blocks )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice, asset( 10000000 ) );
+   const asset_object& uia = create_user_issued_asset( "EXPORTCOIN", bob, 0 );
+   issue_uia( bob, uia.amount( 10000000 ) );
+   generate_block();
+
+   // the matching orders fill in the next block
+   create_sell_order( bob_id, uia.amount( 100 ), asset( 200 ) );
+   create_sell_order( alice_id, asset( 200 ), uia.amount( 100 ) );
+   generate_block();
+   const uint32_t fill_block_num = db.head_block_num();
+   generate_blocks( 3 );
+   const uint32_t head_num = db.head_block_num();
+
+   graphene::app::block_api block_api( db, &( app.get_options() ) );
+   vector<vector<char>> raw_blocks;
+   for( uint32_t block_num = 1; block_num <= head_num; ++block_num )
+      raw_blocks.push_back( *db.fetch_raw_block_by_id( db.get_block_id_for_num( block_num ) ) );
+
+   // the batch stops at the head block
+   auto batch = block_api.export_raw_blocks( 1, head_num + 10, true );
+   BOOST_CHECK_EQUAL( batch.first_block_num, 1u );
+   BOOST_REQUIRE_EQUAL( batch.block_count, head_num );
+
+   fc::datastream<const char*> ds( batch.data.data(), batch.data.size() );
+   for( uint32_t block_num = 1; block_num <= head_num; ++block_num )
+   {
+      vector<char> raw_block;
+      vector<operation_history_object> virtual_ops;
+      fc::raw::unpack( ds, raw_block );
+      fc::raw::unpack( ds, virtual_ops );
+      BOOST_CHECK( raw_block == raw_blocks[block_num - 1] );
+      BOOST_CHECK( fc::raw::unpack<signed_block>( raw_block ).block_num() == block_num );
+      for( const auto& op : virtual_ops )
+         BOOST_CHECK_EQUAL( op.block_num, block_num );
+      if( block_num == fill_block_num )
+      {
+         BOOST_REQUIRE_EQUAL( virtual_ops.size(), 2u );
+         BOOST_CHECK( virtual_ops[0].op.is_type<fill_order_operation>() );
+         BOOST_CHECK( virtual_ops[1].op.is_type<fill_order_operation>() );
+      }
+   }
+   BOOST_CHECK_EQUAL( ds.remaining(), 0u );
+
+   // without virtual operations the data only contains the blocks
+   batch = block_api.export_raw_blocks( head_num - 1, head_num );
+   BOOST_REQUIRE_EQUAL( batch.block_count, 2u );
+   fc::datastream<const char*> ds2( batch.data.data(), batch.data.size() );
+   for( uint32_t block_num = head_num - 1; block_num <= head_num; ++block_num )
+   {
+      vector<char> raw_block;
+      fc::raw::unpack( ds2, raw_block );
+      BOOST_CHECK( raw_block == raw_blocks[block_num - 1] );
+   }
+   BOOST_CHECK_EQUAL( ds2.remaining(), 0u );
+
+   BOOST_CHECK_EQUAL( block_api.export_raw_blocks( head_num + 1, head_num + 5 ).block_count, 0u );
+   BOOST_CHECK_THROW( block_api.export_raw_blocks( 5, 4 ), fc::exception );
+
+   // the range is limited by the configured maximum
+   const uint64_t configured_limit = app.get_options().api_limit_export_raw_blocks;
+   BOOST_CHECK_EQUAL( block_api.export_raw_blocks( 1, configured_limit ).block_count, head_num );
+   BOOST_CHECK_THROW( block_api.export_raw_blocks( 1, configured_limit + 1 ), fc::exception );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( export_raw_blocks_without_block_index )
+{ try {
+   generate_blocks( 5 );
+   const uint32_t head_num = db.head_block_num();
+
+   // virtual operations can not be exported without the index of the operation history by block
+   graphene::app::block_api block_api( db, &( app.get_options() ) );
+   BOOST_CHECK_THROW( block_api.export_raw_blocks( 1, head_num, true ), fc::exception );
+   BOOST_CHECK_EQUAL( block_api.export_raw_blocks( 1, head_num ).block_count, head_num );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( api_worker_threads )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice, asset( 10000000 ) );
+   const asset_object& uia = create_user_issued_asset( "WORKCOIN", bob, 0 );
+   issue_uia( bob, uia.amount( 10000000 ) );
+   for( uint32_t i = 0; i < 10; ++i )
+   {
+      create_sell_order( alice_id, asset( 100 ), uia.amount( 100 + i ) );
+      create_sell_order( bob_id, uia.amount( 100 ), asset( 200 + i ) );
+   }
+   generate_block();
+
+   graphene::app::application_options opt = app.get_options();
+   opt.api_workers = std::make_shared<graphene::app::api_worker_pool>( db, 2 );
+   graphene::app::database_api worker_api( db, &opt );
+   graphene::app::database_api local_api( db, &( app.get_options() ) );
+
+   // results do not depend on where the query runs
+   auto worker_accounts = worker_api.get_full_accounts( { "alice", "bob" }, false );
+   auto local_accounts = local_api.get_full_accounts( { "alice", "bob" }, false );
+   BOOST_REQUIRE_EQUAL( worker_accounts.size(), 2u );
+   BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( worker_accounts, GRAPHENE_MAX_NESTED_OBJECTS ) ),
+                      fc::json::to_string( fc::variant( local_accounts, GRAPHENE_MAX_NESTED_OBJECTS ) ) );
+   BOOST_CHECK_EQUAL( worker_api.get_limit_orders( GRAPHENE_SYMBOL, "WORKCOIN", 100 ).size(), 20u );
+   auto book = worker_api.get_order_book( GRAPHENE_SYMBOL, "WORKCOIN", 50 );
+   BOOST_CHECK_EQUAL( book.bids.size(), 10u );
+   BOOST_CHECK_EQUAL( book.asks.size(), 10u );
+
+   // queries keep running on the workers while this thread changes the database
+   bool done = false;
+   uint32_t queries = 0;
+   fc::future<void> reader = fc::async( [&]() {
+      while( !done )
+      {
+         auto accounts = worker_api.get_full_accounts( { "alice" }, false );
+         BOOST_CHECK_EQUAL( accounts.size(), 1u );
+         BOOST_CHECK_GE( worker_api.get_limit_orders( GRAPHENE_SYMBOL, "WORKCOIN", 100 ).size(), 20u );
+         ++queries;
+      }
+   } );
+   for( uint32_t i = 0; i < 10; ++i )
+   {
+      create_sell_order( alice_id, asset( 100 ), uia.amount( 1000 + i ) );
+      create_sell_order( bob_id, uia.amount( 100 ), asset( 2000 + i ) );
+      generate_block();
+      fc::yield();
+   }
+   done = true;
+   reader.wait();
+   BOOST_CHECK_GT( queries, 0u );
+   BOOST_CHECK_EQUAL( worker_api.get_limit_orders( GRAPHENE_SYMBOL, "WORKCOIN", 100 ).size(), 40u );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( api_response_cache )
+{ try {
+   ACTORS( (alice)(bob)(carol) );
+   fund( alice, asset( 10000000 ) );
+   const asset_object& uia = create_user_issued_asset( "CACHECOIN", bob, 0 );
+   issue_uia( bob, uia.amount( 10000000 ) );
+   create_sell_order( bob_id, uia.amount( 100 ), asset( 200 ) );
+   generate_block();
+
+   graphene::app::application_options opt = app.get_options();
+   opt.response_cache = std::make_shared<graphene::app::api_response_cache>( db, 1024 * 1024 );
+   graphene::app::database_api db_api( db, &opt );
+   const auto& cache = *opt.response_cache;
+
+   // repeated queries are served from the cache
+   db_api.get_dynamic_global_properties();
+   db_api.get_dynamic_global_properties();
+   auto book = db_api.get_order_book( GRAPHENE_SYMBOL, "CACHECOIN", 10 );
+   BOOST_CHECK_EQUAL( db_api.get_order_book( GRAPHENE_SYMBOL, "CACHECOIN", 10 ).asks.size(), book.asks.size() );
+   db_api.get_order_book( GRAPHENE_SYMBOL, "CACHECOIN", 5 );
+   db_api.get_full_accounts( { "alice" }, false );
+   db_api.get_full_accounts( { "alice" }, false );
+   db_api.get_full_accounts( { "carol" }, false );
+   auto stats = cache.get_stats();
+   BOOST_CHECK_EQUAL( stats.hits, 3u );
+   BOOST_CHECK_EQUAL( stats.misses, 5u );
+   BOOST_CHECK_EQUAL( stats.entries, 5u );
+   BOOST_CHECK_GT( stats.size, 0u );
+
+   // a pending transaction invalidates the responses depending on the accounts it impacts
+   transfer( alice_id, bob_id, asset( 1000 ) );
+   stats = cache.get_stats();
+   BOOST_CHECK_EQUAL( stats.entries, 4u );
+   BOOST_CHECK_EQUAL( stats.invalidated, 1u );
+
+   // one which may fill orders invalidates the markets and all accounts
+   create_sell_order( alice_id, asset( 100 ), uia.amount( 100 ) );
+   stats = cache.get_stats();
+   BOOST_CHECK_EQUAL( stats.entries, 1u );
+   BOOST_CHECK_EQUAL( stats.invalidated, 4u );
+   BOOST_CHECK_EQUAL( db_api.get_order_book( GRAPHENE_SYMBOL, "CACHECOIN", 10 ).bids.size(),
+                      book.bids.size() + 1 );
+   BOOST_CHECK_EQUAL( db_api.get_full_accounts( { "alice" }, false ).at( "alice" ).limit_orders.size(), 1u );
+   db_api.get_dynamic_global_properties();
+   BOOST_CHECK_EQUAL( cache.get_stats().hits, 4u );
+
+   // a block invalidates everything
+   generate_block();
+   BOOST_CHECK_EQUAL( cache.get_stats().entries, 0u );
+   BOOST_CHECK_EQUAL( cache.get_stats().size, 0u );
+
+   // so does undoing the pending state, which drops the pending transactions
+   const auto core_balance = [&db_api]( const string& name ) {
+      for( const auto& balance : db_api.get_full_accounts( { name }, false ).at( name ).balances )
+         if( balance.asset_type == asset_id_type() )
+            return balance.balance;
+      return share_type();
+   };
+   transfer( alice_id, carol_id, asset( 1000 ) );
+   const share_type alice_balance = db.get_balance( alice_id, asset_id_type() ).amount;
+   BOOST_CHECK( core_balance( "alice" ) == alice_balance );
+   BOOST_CHECK_EQUAL( cache.get_stats().entries, 1u );
+   db.clear_pending();
+   BOOST_CHECK_EQUAL( cache.get_stats().entries, 0u );
+   BOOST_CHECK( core_balance( "alice" ) > alice_balance );
+
+   // and popping a block
+   generate_block();
+   db_api.get_dynamic_global_properties();
+   BOOST_CHECK_EQUAL( cache.get_stats().entries, 1u );
+   db.pop_block();
+   BOOST_CHECK_EQUAL( cache.get_stats().entries, 0u );
+   generate_block();
+
+   // the least recently used responses are evicted to stay within the capacity
+   uint64_t max_size = 0;
+   for( const string& name : { "alice", "bob", "carol" } )
+   {
+      const uint64_t old_size = cache.get_stats().size;
+      db_api.get_full_accounts( { name }, false );
+      max_size = std::max( max_size, cache.get_stats().size - old_size );
+   }
+   graphene::app::application_options small_opt = app.get_options();
+   small_opt.response_cache = std::make_shared<graphene::app::api_response_cache>( db, max_size );
+   graphene::app::database_api small_api( db, &small_opt );
+   small_api.get_full_accounts( { "alice" }, false );
+   small_api.get_full_accounts( { "bob" }, false );
+   small_api.get_full_accounts( { "carol" }, false );
+   stats = small_opt.response_cache->get_stats();
+   BOOST_CHECK_LE( stats.size, max_size );
+   BOOST_CHECK_EQUAL( stats.entries, 1u );
+   BOOST_CHECK_EQUAL( stats.evicted, 2u );
+
+   BOOST_CHECK_EQUAL( graphene::app::database_api( db, &( app.get_options() ) ).get_response_cache_stats().capacity,
+                      0u );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( subscription_dispatcher_sessions )
+{ try {
+   generate_block();
+
+   graphene::app::application_options opt = app.get_options();
+   opt.subscriptions = std::make_shared<graphene::app::subscription_dispatcher>( db, 1 );
+   graphene::app::database_api slow_api( db, &opt );
+   graphene::app::database_api fast_api( db, &opt );
+
+   // the slow client does not return from its callback until released
+   auto release = fc::promise<void>::create( "release slow client" );
+   uint32_t slow_notified = 0;
+   uint32_t fast_notified = 0;
+   slow_api.set_subscribe_callback( [&]( const variant& ) {
+      ++slow_notified;
+      fc::future<void>( release ).wait();
+   }, false );
+   fast_api.set_subscribe_callback( [&]( const variant& ) { ++fast_notified; }, false );
+
+   // every block changes the dynamic global properties
+   const object_id_type dgp_id = db.get_dynamic_global_properties().id;
+   slow_api.get_objects( { dgp_id } );
+   fast_api.get_objects( { dgp_id } );
+
+   // the changed object is serialized once for both sessions
+   generate_block();
+   fc::usleep( fc::milliseconds( 200 ) );
+   auto stats = fast_api.get_subscription_stats();
+   BOOST_CHECK_EQUAL( stats.sessions, 2u );
+   BOOST_CHECK_EQUAL( stats.serialized_objects, 1u );
+   BOOST_CHECK_EQUAL( stats.notifications, 2u );
+   BOOST_CHECK_EQUAL( fast_notified, 1u );
+   BOOST_CHECK_EQUAL( slow_notified, 1u );
+   BOOST_CHECK_EQUAL( slow_api.get_subscription_stats().session_pending, 1u );
+
+   // the slow session does not get further notifications until it catches up
+   generate_block();
+   fc::usleep( fc::milliseconds( 200 ) );
+   BOOST_CHECK_EQUAL( fast_notified, 2u );
+   BOOST_CHECK_EQUAL( slow_notified, 1u );
+   stats = slow_api.get_subscription_stats();
+   BOOST_CHECK_EQUAL( stats.serialized_objects, 2u );
+   BOOST_CHECK_EQUAL( stats.dropped, 1u );
+   BOOST_CHECK_EQUAL( stats.session_dropped, 1u );
+   BOOST_CHECK_EQUAL( fast_api.get_subscription_stats().session_dropped, 0u );
+
+   release->set_value();
+   fc::usleep( fc::milliseconds( 200 ) );
+   BOOST_CHECK_EQUAL( slow_api.get_subscription_stats().session_pending, 0u );
+
+   generate_block();
+   fc::usleep( fc::milliseconds( 200 ) );
+   BOOST_CHECK_EQUAL( slow_notified, 2u );
+   BOOST_CHECK_EQUAL( fast_notified, 3u );
+
+   // unsubscribed sessions are not notified
+   slow_api.cancel_all_subscriptions();
+   fast_api.cancel_all_subscriptions();
+   BOOST_CHECK_EQUAL( fast_api.get_subscription_stats().sessions, 0u );
+   generate_block();
+   fc::usleep( fc::milliseconds( 200 ) );
+   BOOST_CHECK_EQUAL( fast_api.get_subscription_stats().serialized_objects, 3u );
+   BOOST_CHECK_EQUAL( fast_notified, 3u );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( subscription_dispatcher_refuses_items_over_limit )
+{ try {
+   generate_block();
+
+   graphene::app::application_options opt = app.get_options();
+   opt.subscriptions = std::make_shared<graphene::app::subscription_dispatcher>( db,
+         graphene::app::subscription_dispatcher::default_max_pending_notifications, 1 );
+   graphene::app::database_api db_api( db, &opt );
+
+   uint32_t notified = 0;
+   db_api.set_subscribe_callback( [&]( const variant& ) { ++notified; }, false );
+
+   // the second object is refused, subscribing to the first one again is not
+   const object_id_type dgp_id = db.get_dynamic_global_properties().id;
+   db_api.get_objects( { dgp_id } );
+   db_api.get_objects( { asset_id_type() } );
+   db_api.get_objects( { dgp_id } );
+   auto stats = db_api.get_subscription_stats();
+   BOOST_CHECK_EQUAL( stats.refused, 1u );
+   BOOST_CHECK_EQUAL( stats.session_refused, 1u );
+
+   generate_block();
+   fc::usleep( fc::milliseconds( 200 ) );
+   BOOST_CHECK_EQUAL( notified, 1u );
+
+   // without a limit nothing is refused
+   opt.subscriptions = std::make_shared<graphene::app::subscription_dispatcher>( db,
+         graphene::app::subscription_dispatcher::default_max_pending_notifications, 0 );
+   graphene::app::database_api unlimited_api( db, &opt );
+   unlimited_api.set_subscribe_callback( []( const variant& ) {}, false );
+   unlimited_api.get_objects( { dgp_id, asset_id_type(), account_id_type() } );
+   BOOST_CHECK_EQUAL( unlimited_api.get_subscription_stats().refused, 0u );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -29,7 +29,12 @@
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
 
+#include <graphene/utilities/tempdir.hpp>
+
 #include <fc/crypto/digest.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
 
 #include "../common/database_fixture.hpp"
 
@@ -310,4 +315,169 @@ BOOST_AUTO_TEST_CASE( required_approval_index_test ) // see https://github.com/b
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( incremental_flush_test )
+{ try {
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   account_balance_id_type bal_id;
+   account_statistics_id_type stats_id;
+   {
+      database db1;
+      db1.object_database::open( data_dir.path() );
+      bal_id = db1.create<account_balance_object>( []( account_balance_object& obj ){
+         obj.owner = account_id_type(123);
+         obj.balance = 42;
+      }).id;
+      stats_id = db1.create<account_statistics_object>( []( account_statistics_object& obj ){
+         obj.owner = account_id_type(123);
+         obj.total_ops = 7;
+      }).id;
+      db1.flush();
+      BOOST_CHECK( !db1.get_index_type<account_balance_index>().has_unsaved_changes() );
+      BOOST_CHECK( !db1.get_index<account_statistics_object>().has_unsaved_changes() );
+
+      // only the balance index is written, the statistics index is taken over from the last checkpoint
+      db1.modify( bal_id(db1), []( account_balance_object& obj ){
+         obj.balance = 43;
+      });
+      BOOST_CHECK( db1.get_index_type<account_balance_index>().has_unsaved_changes() );
+      BOOST_CHECK( !db1.get_index<account_statistics_object>().has_unsaved_changes() );
+      db1.flush( true );
+      BOOST_CHECK( !db1.get_index_type<account_balance_index>().has_unsaved_changes() );
+   }
+   {
+      database db2;
+      db2.object_database::open( data_dir.path() );
+      BOOST_CHECK( !db2.get_index_type<account_balance_index>().has_unsaved_changes() );
+      BOOST_CHECK_EQUAL( 43, bal_id(db2).balance.value );
+      BOOST_CHECK_EQUAL( 123u, bal_id(db2).owner.instance.value );
+      BOOST_CHECK_EQUAL( 7u, stats_id(db2).total_ops );
+      BOOST_CHECK( db2.get_index_type<account_balance_index>().get_next_id() == object_id_type( bal_id ) + 1 );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( chunked_index_memory_usage_test )
+{ try {
+   database db;
+   const auto& idx = db.get_index_type<account_balance_index>();
+   const auto initial = idx.get_memory_usage();
+   BOOST_CHECK( initial.exact );
+   BOOST_CHECK_EQUAL( initial.object_count, 0u );
+
+   vector<account_balance_id_type> ids;
+   for( uint64_t i = 0; i < 100; ++i )
+      ids.push_back( db.create<account_balance_object>( [i]( account_balance_object& obj ){
+         obj.owner = account_id_type(i);
+      }).id );
+
+   const auto filled = idx.get_memory_usage();
+   BOOST_CHECK_EQUAL( filled.object_count, 100u );
+   BOOST_CHECK_GE( filled.used_bytes, initial.used_bytes + 100 * sizeof(account_balance_object) );
+   BOOST_CHECK_GE( filled.reserved_bytes, filled.used_bytes );
+
+   for( const auto& id : ids )
+      db.remove( id(db) );
+   const auto emptied = idx.get_memory_usage();
+   BOOST_CHECK_EQUAL( emptied.object_count, 0u );
+   BOOST_CHECK_EQUAL( emptied.used_bytes, initial.used_bytes );
+   // freed nodes are kept for reuse
+   BOOST_CHECK_EQUAL( emptied.reserved_bytes, filled.reserved_bytes );
+
+   bool found = false;
+   for( const auto& usage : db.get_memory_usage() )
+      if( usage.space_id == account_balance_object::space_id && usage.type_id == account_balance_object::type_id )
+         found = true;
+   BOOST_CHECK( found );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( undo_modify_merge_test )
+{ try {
+   database db;
+   auto ses = db._undo_db.start_undo_session();
+   const auto& bal1 = db.create<account_balance_object>( []( account_balance_object& obj ){
+      obj.balance = 1;
+   });
+   const auto& bal2 = db.create<account_balance_object>( []( account_balance_object& obj ){
+      obj.balance = 2;
+   });
+   const account_balance_id_type id1 = bal1.id;
+   const account_balance_id_type id2 = bal2.id;
+   ses.commit();
+
+   {
+      auto outer = db._undo_db.start_undo_session();
+      db.modify( id1(db), []( account_balance_object& obj ){ obj.balance = 10; } );
+      {
+         auto inner = db._undo_db.start_undo_session();
+         // modified twice, the value before the first modification is kept
+         db.modify( id1(db), []( account_balance_object& obj ){ obj.balance = 11; } );
+         db.modify( id2(db), []( account_balance_object& obj ){ obj.balance = 20; } );
+         db.modify( id2(db), []( account_balance_object& obj ){ obj.balance = 21; } );
+         inner.merge();
+      }
+      BOOST_CHECK_EQUAL( id1(db).balance.value, 11 );
+      BOOST_CHECK_EQUAL( id2(db).balance.value, 21 );
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_values.size(), 2u );
+      {
+         auto inner = db._undo_db.start_undo_session();
+         // modified then removed, the removed value is the one before the modification
+         db.modify( id2(db), []( account_balance_object& obj ){ obj.balance = 22; } );
+         db.remove( id2(db) );
+         BOOST_CHECK( db._undo_db.head().old_values.empty() );
+         BOOST_REQUIRE_EQUAL( db._undo_db.head().removed.size(), 1u );
+         BOOST_CHECK_EQUAL( static_cast<const account_balance_object&>(
+                               *db._undo_db.head().removed.begin()->second ).balance.value, 21 );
+         inner.merge();
+      }
+      BOOST_CHECK( db.find( id2 ) == nullptr );
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_values.size(), 1u );
+      BOOST_CHECK( !db._undo_db.head().old_values.contains( id2 ) );
+      BOOST_REQUIRE_EQUAL( db._undo_db.head().removed.size(), 1u );
+      BOOST_CHECK_EQUAL( static_cast<const account_balance_object&>(
+                            *db._undo_db.head().removed.begin()->second ).balance.value, 2 );
+      outer.undo();
+   }
+   BOOST_CHECK_EQUAL( id1(db).balance.value, 1 );
+   BOOST_CHECK_EQUAL( id2(db).balance.value, 2 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( database_lock_fibers )
+{ try {
+   database_lock lock;
+
+   // reentrant for the fiber holding the write side only
+   lock.lock_write();
+   lock.lock_write();
+   bool other_fiber_locked = false;
+   fc::future<void> other_fiber = fc::async( [&lock,&other_fiber_locked]() {
+      database_lock::write_guard guard( lock );
+      other_fiber_locked = true;
+   } );
+   fc::usleep( fc::milliseconds( 10 ) );
+   BOOST_CHECK( !other_fiber_locked );
+   lock.unlock_write();
+   fc::usleep( fc::milliseconds( 10 ) );
+   BOOST_CHECK( !other_fiber_locked );
+   lock.unlock_write();
+   other_fiber.wait();
+   BOOST_CHECK( other_fiber_locked );
+
+   // a change waits for the running reads of other threads
+   std::atomic<bool> reading{ false };
+   std::atomic<bool> read_done{ false };
+   fc::thread reader_thread( "database_lock_reader" );
+   fc::future<void> reader = reader_thread.async( [&lock,&reading,&read_done]() {
+      database_lock::read_guard guard( lock );
+      reading = true;
+      fc::usleep( fc::milliseconds( 50 ) );
+      read_done = true;
+   } );
+   while( !reading )
+      fc::usleep( fc::milliseconds( 1 ) );
+   {
+      database_lock::write_guard guard( lock );
+      BOOST_CHECK( read_done );
+   }
+   reader.wait();
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
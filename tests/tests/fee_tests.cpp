@@ -690,7 +690,9 @@ BOOST_AUTO_TEST_CASE( account_create_fee_scaling )
    db.modify(global_property_id_type()(db), [](global_property_object& gpo)
    {
       gpo.parameters.get_mutable_fees() = fee_schedule::get_default();
-      gpo.parameters.get_mutable_fees().get<account_create_operation>().basic_fee = 1;
+      auto account_create_fees = gpo.parameters.get_mutable_fees().get<account_create_operation>();
+      account_create_fees.basic_fee = 1;
+      gpo.parameters.get_mutable_fees().set_parameters( account_create_fees );
    });
 
    for( int i = db.get_dynamic_global_properties().accounts_registered_this_interval; i < accounts_per_scale; ++i )
@@ -3631,7 +3633,7 @@ BOOST_AUTO_TEST_CASE( defaults_test )
 
     limit_order_create_operation::fee_parameters_type new_order_fee; new_order_fee.fee = 123;
     // set fee + check
-    schedule.parameters.insert( new_order_fee );
+    schedule.set_parameters( new_order_fee );
     fee = schedule.calculate_fee( limit_order_create_operation() );
     BOOST_CHECK_EQUAL( (int64_t)new_order_fee.fee, fee.amount.value );
 
@@ -3643,13 +3645,13 @@ BOOST_AUTO_TEST_CASE( defaults_test )
     BOOST_CHECK_EQUAL( (int64_t)default_short_fee.fee, fee.amount.value );
 
     // set call_order_update fee + check bid_collateral fee
-    schedule.parameters.insert( new_short_fee );
+    schedule.set_parameters( new_short_fee );
     fee = schedule.calculate_fee( bid_collateral_operation() );
     BOOST_CHECK_EQUAL( (int64_t)new_short_fee.fee, fee.amount.value );
 
     // set bid_collateral fee + check
     bid_collateral_operation::fee_parameters_type new_bid_fee; new_bid_fee.fee = 124;
-    schedule.parameters.insert( new_bid_fee );
+    schedule.set_parameters( new_bid_fee );
     fee = schedule.calculate_fee( bid_collateral_operation() );
     BOOST_CHECK_EQUAL( (int64_t)new_bid_fee.fee, fee.amount.value );
   }
@@ -3686,7 +3688,7 @@ BOOST_AUTO_TEST_CASE( sub_asset_creation_fee_test )
    ac_fee.symbol3 = 30000300;
    ac_fee.price_per_kbyte = 1050;
 
-   schedule.parameters.insert( ac_fee );
+   schedule.set_parameters( ac_fee );
 
    expected_data_fee = op.calculate_data_fee( op_size, ac_fee.price_per_kbyte );
    expected_fee = ac_fee.long_symbol + expected_data_fee;
@@ -3699,14 +3701,14 @@ BOOST_AUTO_TEST_CASE( sub_asset_creation_fee_test )
    account_transfer_operation::fee_parameters_type at_fee;
    at_fee.fee = 5500;
 
-   schedule.parameters.insert( at_fee );
+   schedule.set_parameters( at_fee );
 
    fee = schedule.calculate_fee( op );
    BOOST_CHECK_EQUAL( fee.amount.value, expected_fee );
 
    // enable sub-asset creation fee
    BOOST_TEST_MESSAGE("Testing our fee schedule with sub-asset creation fee enabled");
-   schedule.parameters.insert( ticket_create_operation::fee_parameters_type() );
+   schedule.set_parameters( ticket_create_operation::fee_parameters_type() );
 
    expected_fee = at_fee.fee + expected_data_fee;
 
@@ -3715,6 +3717,65 @@ BOOST_AUTO_TEST_CASE( sub_asset_creation_fee_test )
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( fee_table_update_test )
+{ try {
+   const account_create_operation op;
+   fee_schedule schedule = fee_schedule::get_default();
+   const share_type initial_fee = schedule.calculate_fee( op ).amount;
+
+   // replacing parameters must be reflected by the next calculation, also if the size of the parameter set
+   // and the storage of the parameters stay the same
+   auto params = schedule.get<account_create_operation>();
+   const auto parameter_count = schedule.get_parameters().size();
+   const fee_parameters* const storage = &*schedule.get_parameters().begin();
+   params.basic_fee += 1000;
+   params.premium_fee += 1000;
+   schedule.set_parameters( params );
+   BOOST_CHECK_EQUAL( schedule.get_parameters().size(), parameter_count );
+   BOOST_CHECK( &*schedule.get_parameters().begin() == storage );
+   BOOST_CHECK_EQUAL( schedule.calculate_fee( op ).amount.value, initial_fee.value + 1000 );
+
+   params.basic_fee += 1000;
+   params.premium_fee += 1000;
+   schedule.set_parameters( params );
+   BOOST_CHECK_EQUAL( schedule.calculate_fee( op ).amount.value, initial_fee.value + 2000 );
+
+   // a copy calculates with its own parameters
+   fee_schedule copy = schedule;
+   params.basic_fee += 1000;
+   params.premium_fee += 1000;
+   copy.set_parameters( params );
+   BOOST_CHECK_EQUAL( copy.calculate_fee( op ).amount.value, initial_fee.value + 3000 );
+   BOOST_CHECK_EQUAL( schedule.calculate_fee( op ).amount.value, initial_fee.value + 2000 );
+   copy = schedule;
+   BOOST_CHECK_EQUAL( copy.calculate_fee( op ).amount.value, initial_fee.value + 2000 );
+
+   // the schedule of the chain parameters is modified in place as well
+   chain_parameters chain_params;
+   chain_params.get_mutable_fees() = fee_schedule::get_default();
+   BOOST_CHECK_EQUAL( chain_params.get_current_fees().calculate_fee( op ).amount.value, initial_fee.value );
+   params = chain_params.get_current_fees().get<account_create_operation>();
+   params.basic_fee += 1000;
+   params.premium_fee += 1000;
+   chain_params.get_mutable_fees().set_parameters( params );
+   BOOST_CHECK_EQUAL( chain_params.get_current_fees().calculate_fee( op ).amount.value, initial_fee.value + 1000 );
+
+   // deserializing into the shared schedule replaces its parameters
+   fc::variant v( fee_schedule::get_default(), GRAPHENE_MAX_NESTED_OBJECTS );
+   fc::from_variant( v, chain_params.current_fees, GRAPHENE_MAX_NESTED_OBJECTS );
+   BOOST_CHECK_EQUAL( chain_params.get_current_fees().calculate_fee( op ).amount.value, initial_fee.value );
+
+   chain_params.get_mutable_fees().zero_all_fees();
+   BOOST_CHECK_EQUAL( chain_params.get_current_fees().calculate_fee( op ).amount.value, 0 );
+
+   // htlc_create fees fall back to the defaults if the schedule has no parameters for it
+   fee_schedule no_htlc_fees;
+   htlc_create_operation htlc;
+   htlc.claim_period_seconds = 0;
+   const htlc_create_operation::fee_parameters_type default_htlc_fee;
+   BOOST_CHECK_EQUAL( no_htlc_fees.calculate_fee( htlc ).amount.value, (int64_t)default_htlc_fee.fee );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( issue_429_test )
 {
    try
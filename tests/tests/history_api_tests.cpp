@@ -25,6 +25,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <graphene/app/api.hpp>
+#include <graphene/account_history/account_history_plugin.hpp>
 
 #include <graphene/utilities/tempdir.hpp>
 
@@ -762,4 +763,254 @@ BOOST_AUTO_TEST_CASE(api_limit_get_account_history_by_operations) {
 }
 
 
+BOOST_AUTO_TEST_CASE(account_history_store) {
+   try {
+      graphene::app::history_api hist_api(app);
+      auto ah_plugin = app.get_plugin<graphene::account_history::account_history_plugin>( "account_history" );
+      const auto* store = ah_plugin->get_history_store();
+      BOOST_REQUIRE( store != nullptr );
+
+      ACTORS( (alice)(bob) );
+      fund( alice, asset(1000000) );
+      for( int i = 0; i < 20; ++i )
+      {
+         transfer( alice_id, bob_id, asset(1 + i) );
+         if( i % 5 == 4 )
+            generate_block();
+      }
+      // make all of it irreversible
+      generate_blocks( 20 );
+
+      const uint64_t total_ops = alice_id(db).statistics(db).total_ops;
+      BOOST_CHECK_GE( store->last_sequence( alice_id ), total_ops - 2 );
+
+      // only the two most recent entries stay in memory
+      const auto& by_seq_idx = db.get_index_type<account_transaction_history_index>().indices().get<by_seq>();
+      uint64_t entries_in_memory = 0;
+      for( auto itr = by_seq_idx.lower_bound( boost::make_tuple( alice_id, 0 ) );
+           itr != by_seq_idx.end() && itr->account == alice_id; ++itr )
+         ++entries_in_memory;
+      BOOST_CHECK_EQUAL( entries_in_memory, 2u );
+
+      // the whole history is still available
+      vector<operation_history_object> relative = hist_api.get_relative_account_history( "alice", 0, 100, 0 );
+      BOOST_REQUIRE_EQUAL( relative.size(), total_ops );
+      vector<operation_history_object> history = hist_api.get_account_history( "alice", operation_history_id_type(),
+                                                                               100, operation_history_id_type() );
+      BOOST_REQUIRE_EQUAL( history.size(), total_ops );
+      for( size_t i = 0; i < history.size(); ++i )
+      {
+         BOOST_CHECK( history[i].id == relative[i].id );
+         if( i > 0 )
+            BOOST_CHECK_GT( history[i-1].id.instance(), history[i].id.instance() );
+      }
+      BOOST_CHECK( relative.back().op.is_type<account_create_operation>() );
+
+      // pages which start in the store
+      vector<operation_history_object> page = hist_api.get_account_history( "alice", operation_history_id_type(), 5,
+                                                                            history[10].id );
+      BOOST_REQUIRE_EQUAL( page.size(), 5u );
+      BOOST_CHECK( page.front().id == history[10].id );
+      BOOST_CHECK( page.back().id == history[14].id );
+
+      page = hist_api.get_account_history( "alice", history[13].id, 100, history[10].id );
+      BOOST_REQUIRE_EQUAL( page.size(), 3u );
+      BOOST_CHECK( page.back().id == history[12].id );
+
+      page = hist_api.get_relative_account_history( "alice", 3, 4, 10 );
+      BOOST_REQUIRE_EQUAL( page.size(), 4u );
+      BOOST_CHECK( page.front().id == relative[total_ops - 10].id );
+      BOOST_CHECK( page.back().id == relative[total_ops - 7].id );
+
+      const int transfer_op = operation::tag<transfer_operation>::value;
+      vector<operation_history_object> transfers = hist_api.get_account_history_operations( "alice", transfer_op,
+                                                      operation_history_id_type(), operation_history_id_type(), 100 );
+      BOOST_CHECK_EQUAL( transfers.size(), total_ops - 1 );
+      for( const auto& o : transfers )
+         BOOST_CHECK( o.op.is_type<transfer_operation>() );
+
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(account_history_store_undo) {
+   try {
+      graphene::app::history_api hist_api(app);
+      auto ah_plugin = app.get_plugin<graphene::account_history::account_history_plugin>( "account_history" );
+      const auto* store = ah_plugin->get_history_store();
+      BOOST_REQUIRE( store != nullptr );
+
+      ACTORS( (alice)(bob) );
+      fund( alice, asset(1000000) );
+      for( int i = 0; i < 10; ++i )
+         transfer( alice_id, bob_id, asset(1 + i) );
+      generate_block();
+
+      const auto& by_seq_idx = db.get_index_type<account_transaction_history_index>().indices().get<by_seq>();
+      const auto entries_in_memory = [&by_seq_idx]( account_id_type account ) {
+         uint64_t count = 0;
+         for( auto itr = by_seq_idx.lower_bound( boost::make_tuple( account, 0 ) );
+              itr != by_seq_idx.end() && itr->account == account; ++itr )
+            ++count;
+         return count;
+      };
+      const auto& ops_idx = db.get_index_type<operation_history_index>().indices();
+
+      // the block which makes the history of alice irreversible moves it to the store
+      const uint64_t total_ops = alice_id(db).statistics(db).total_ops;
+      for( int i = 0; i < 50 && store->last_sequence( alice_id ) < total_ops; ++i )
+         generate_block();
+      BOOST_REQUIRE_EQUAL( store->last_sequence( alice_id ), total_ops );
+      BOOST_CHECK_EQUAL( entries_in_memory( alice_id ), 2u );
+      const size_t ops_in_memory = ops_idx.size();
+
+      // popping it restores the removed history in memory
+      const signed_block block = *db.fetch_block_by_number( db.head_block_num() );
+      db.pop_block();
+      BOOST_CHECK_EQUAL( entries_in_memory( alice_id ), total_ops );
+      BOOST_CHECK_GT( ops_idx.size(), ops_in_memory );
+
+      // pushing it again removes the restored history from memory again
+      PUSH_BLOCK( db, block );
+      BOOST_CHECK_EQUAL( store->last_sequence( alice_id ), total_ops );
+      BOOST_CHECK_EQUAL( entries_in_memory( alice_id ), 2u );
+      BOOST_CHECK_EQUAL( ops_idx.size(), ops_in_memory );
+
+      vector<operation_history_object> relative = hist_api.get_relative_account_history( "alice", 0, 100, 0 );
+      BOOST_CHECK_EQUAL( relative.size(), total_ops );
+
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(history_store_recovery) {
+   try {
+      using graphene::account_history::history_store;
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path dir = data_dir.path() / "account_history";
+
+      const auto make_op = []( uint64_t instance ) {
+         operation_history_object op;
+         op.id = operation_history_id_type( instance );
+         transfer_operation t;
+         t.amount = asset( instance + 1 );
+         op.op = t;
+         op.block_num = instance + 1;
+         return op;
+      };
+
+      {
+         history_store store;
+         store.open( dir );
+         for( uint64_t i = 0; i < 5; ++i )
+         {
+            store.store_operation( make_op( i ) );
+            store.store_entry( account_id_type(1), i + 1, operation_history_id_type( i ) );
+         }
+         store.close();
+      }
+
+      // simulate a write torn by a crash: the data of the last operation and the last entry are incomplete,
+      // and a partial index record follows
+      fc::resize_file( dir / "operations", fc::file_size( dir / "operations" ) - 1 );
+      fc::resize_file( dir / "entries", fc::file_size( dir / "entries" ) - 3 );
+      {
+         std::ofstream index( ( dir / "operations.index" ).generic_string().c_str(),
+                              std::ofstream::binary | std::ofstream::app );
+         index.write( "\x01\x02\x03", 3 );
+      }
+
+      {
+         history_store store;
+         store.open( dir );
+         BOOST_CHECK_EQUAL( store.next_operation(), 4u );
+         BOOST_CHECK( !store.fetch_operation( operation_history_id_type(4) ).valid() );
+         auto op = store.fetch_operation( operation_history_id_type(3) );
+         BOOST_REQUIRE( op.valid() );
+         BOOST_CHECK( op->op.get<transfer_operation>().amount == asset(4) );
+         BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(1) ), 4u );
+         BOOST_CHECK_EQUAL( store.get_entries( account_id_type(1), 10, 1, 10 ).size(), 4u );
+
+         // storing continues where the intact history ends
+         store.store_operation( make_op( 4 ) );
+         store.store_entry( account_id_type(1), 5, operation_history_id_type(4) );
+         BOOST_CHECK_EQUAL( store.next_operation(), 5u );
+         BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(1) ), 5u );
+         BOOST_CHECK_EQUAL( store.find_sequence( account_id_type(1), operation_history_id_type(4) ), 5u );
+         store.close();
+      }
+
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(history_store_truncate_on_mismatch) {
+   try {
+      using graphene::account_history::history_store;
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      const auto make_op = []( uint64_t instance, int64_t amount ) {
+         operation_history_object op;
+         op.id = operation_history_id_type( instance );
+         transfer_operation t;
+         t.amount = asset( amount );
+         op.op = t;
+         return op;
+      };
+
+      history_store store;
+      store.open( data_dir.path() );
+      for( uint64_t i = 0; i < 6; ++i )
+      {
+         store.store_operation( make_op( i, i ) );
+         store.store_entry( account_id_type( 1 + i % 2 ), i / 2 + 1, operation_history_id_type( i ) );
+      }
+      BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(1) ), 3u );
+      BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(2) ), 3u );
+
+      // storing an operation again is a no-op
+      store.store_operation( make_op( 2, 2 ) );
+      BOOST_CHECK_EQUAL( store.next_operation(), 6u );
+      BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(1) ), 3u );
+
+      // a different operation discards the history from there on
+      store.store_operation( make_op( 3, 100 ) );
+      BOOST_CHECK_EQUAL( store.next_operation(), 4u );
+      BOOST_CHECK( store.fetch_operation( operation_history_id_type(3) )->op.get<transfer_operation>().amount
+                   == asset(100) );
+      BOOST_CHECK( !store.fetch_operation( operation_history_id_type(4) ).valid() );
+      BOOST_CHECK( store.fetch_operation( operation_history_id_type(2) )->op.get<transfer_operation>().amount
+                   == asset(2) );
+      // the entries of operations 3 to 5 are gone
+      BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(1) ), 2u );
+      BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(2) ), 1u );
+      auto entries = store.get_entries( account_id_type(1), 10, 1, 10 );
+      BOOST_REQUIRE_EQUAL( entries.size(), 2u );
+      BOOST_CHECK( entries.front().operation_id == operation_history_id_type(2) );
+
+      // and the history continues from there
+      store.store_entry( account_id_type(2), 2, operation_history_id_type(3) );
+      BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(2) ), 2u );
+      BOOST_CHECK_EQUAL( store.find_sequence( account_id_type(2), operation_history_id_type(5) ), 2u );
+
+      // the truncated state survives reopening
+      store.close();
+      store.open( data_dir.path() );
+      BOOST_CHECK_EQUAL( store.next_operation(), 4u );
+      BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(1) ), 2u );
+      BOOST_CHECK_EQUAL( store.last_sequence( account_id_type(2) ), 2u );
+      store.close();
+
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
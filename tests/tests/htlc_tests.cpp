@@ -704,14 +704,14 @@ BOOST_AUTO_TEST_CASE( htlc_hardfork_test )
          new_fee_schedule->scale = existing_fee_schedule.scale;
          // replace the old with the new
          flat_map<uint64_t, graphene::chain::fee_parameters> params_map = get_htlc_fee_parameters();
-         for(auto param : existing_fee_schedule.parameters)
+         for(auto param : existing_fee_schedule.get_parameters())
          {
             auto itr = params_map.find(param.which());
             if (itr == params_map.end())
-               new_fee_schedule->parameters.insert(param);
+               new_fee_schedule->set_parameters(param);
             else
             {
-               new_fee_schedule->parameters.insert( (*itr).second);
+               new_fee_schedule->set_parameters( (*itr).second);
             }
          }
          proposal_create_operation cop = proposal_create_operation::committee_proposal(
@@ -742,14 +742,14 @@ BOOST_AUTO_TEST_CASE( htlc_hardfork_test )
          new_fee_schedule->scale = existing_fee_schedule.scale;
          // replace the old with the new
          flat_map<uint64_t, graphene::chain::fee_parameters> params_map = get_htlc_fee_parameters();
-         for(auto param : existing_fee_schedule.parameters)
+         for(auto param : existing_fee_schedule.get_parameters())
          {
             auto itr = params_map.find(param.which());
             if (itr == params_map.end())
-               new_fee_schedule->parameters.insert(param);
+               new_fee_schedule->set_parameters(param);
             else
             {
-               new_fee_schedule->parameters.insert( (*itr).second);
+               new_fee_schedule->set_parameters( (*itr).second);
             }
          }
          proposal_create_operation cop = proposal_create_operation::committee_proposal(db.get_global_properties()
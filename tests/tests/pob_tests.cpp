@@ -124,13 +124,15 @@ BOOST_AUTO_TEST_CASE( validation_and_basic_logic_test )
       enable_fees();
       db.modify(global_property_id_type()(db), [](global_property_object& gpo)
       {
-         auto& fee_params = gpo.parameters.get_mutable_fees().parameters;
+         fee_schedule& fees = gpo.parameters.get_mutable_fees();
 
-         auto itr = fee_params.find( ticket_create_operation::fee_parameters_type() );
-         itr->get<ticket_create_operation::fee_parameters_type>().fee = 1;
+         ticket_create_operation::fee_parameters_type create_fee;
+         create_fee.fee = 1;
+         fees.set_parameters( create_fee );
 
-         itr = fee_params.find( ticket_update_operation::fee_parameters_type() );
-         itr->get<ticket_update_operation::fee_parameters_type>().fee = 2;
+         ticket_update_operation::fee_parameters_type update_fee;
+         update_fee.fee = 2;
+         fees.set_parameters( update_fee );
       });
 
       int64_t expected_balance = init_amount;
@@ -25,10 +25,12 @@
 #include <boost/test/unit_test.hpp>
 
 #include <graphene/chain/database.hpp>
+#include <graphene/protocol/json_writer.hpp>
 
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/elliptic.hpp>
+#include <fc/io/json.hpp>
 #include <fc/reflect/variant.hpp>
 
 #include "../common/database_fixture.hpp"
@@ -112,4 +114,67 @@ BOOST_AUTO_TEST_CASE( extension_serialization_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( json_writer_test )
+{
+   try
+   {
+      ACTORS( (alice)(bob) );
+      const asset_object& uia = create_user_issued_asset( "JSONCOIN", alice, 0 );
+      issue_uia( alice, uia.amount( 5000000000LL ) );
+      transfer( committee_account, alice_id, asset( 10000000 ) );
+      transfer( alice_id, bob_id, uia.amount( 4000000000LL ) );
+      create_sell_order( alice_id, asset( 1000 ), uia.amount( 3000 ) );
+      generate_block();
+
+      // every object in the database is written exactly like the variant based path would write it
+      size_t count = 0;
+      db.inspect_all_indexes( [&count]( const graphene::db::index& index ) {
+         index.inspect_all_objects( [&count]( const graphene::db::object& o ) {
+            std::string json;
+            o.to_json( json );
+            BOOST_CHECK_EQUAL( json, fc::json::to_string( o.to_variant() ) );
+            ++count;
+         });
+      });
+      BOOST_CHECK_GT( count, 0u );
+
+      // values that are written through fc::variant: escaped strings, large and negative integers, extensions
+      transfer_operation op;
+      op.from = alice_id;
+      op.to = bob_id;
+      op.amount = asset( -5000000000LL, uia.id );
+      op.fee = asset( 4294967296LL );
+      op.memo = memo_data();
+      op.memo->from = alice_private_key.get_public_key();
+      op.memo->to = bob_private_key.get_public_key();
+      op.memo->message = { 'a', '"', '\\', '\n', char(0xe4) };
+      const auto check_op = []( const operation& o ) {
+         BOOST_CHECK_EQUAL( json_writer::to_string( o ),
+                            fc::json::to_string( fc::variant( o, GRAPHENE_MAX_NESTED_OBJECTS ) ) );
+      };
+      check_op( op );
+
+      account_create_operation create_op = make_account( "quote\"d\\name\u00e4" );
+      buyback_account_options bbo;
+      bbo.asset_to_buy = uia.id;
+      bbo.asset_to_buy_issuer = alice_id;
+      bbo.markets.emplace( asset_id_type() );
+      create_op.extensions.value.buyback_options = bbo;
+      check_op( create_op );
+
+      trx.clear();
+      trx.operations.push_back( op );
+      trx.operations.push_back( create_op );
+      set_expiration( db, trx );
+      sign( trx, alice_private_key );
+      BOOST_CHECK_EQUAL( json_writer::to_string( trx ),
+                         fc::json::to_string( fc::variant( trx, GRAPHENE_MAX_NESTED_OBJECTS ) ) );
+   }
+   catch ( const fc::exception& e )
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -981,4 +981,75 @@ BOOST_AUTO_TEST_CASE( committee_votes_calculation )
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( parallel_vote_tally )
+{
+   try
+   {
+      INVOKE( put_my_witnesses );
+      INVOKE( put_my_committee_members );
+
+      generate_blocks( HARDFORK_CORE_2262_TIME );
+      generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+      set_expiration( db, trx );
+
+      graphene::app::database_api db_api1(db);
+      const auto wit13 = db_api1.get_witness_by_account( "witness13" );
+      const auto com13 = db_api1.get_committee_member_by_account( "committee13" );
+      BOOST_REQUIRE( wit13.valid() && com13.valid() );
+
+      // vote with an account that is not a candidate itself, so that the tally changes in the next maintenance
+      ACTOR( voter );
+      transfer( committee_account, voter_id, asset( 1000000 ) );
+      {
+         account_update_operation op;
+         op.account = voter_id;
+         op.new_options = op.account(db).options;
+         op.new_options->votes.insert( wit13->vote_id );
+         op.new_options->votes.insert( com13->vote_id );
+         op.new_options->num_witness = 1;
+         op.new_options->num_committee = 1;
+         trx.operations.clear();
+         trx.operations.push_back( op );
+         PUSH_TX( db, trx, ~0 );
+         trx.clear();
+      }
+
+      // the votes of all candidates and the voting power of all accounts after the maintenance
+      auto tally_results = [this]() {
+         vector<uint64_t> results;
+         for( const auto& wit : db.get_index_type<witness_index>().indices() )
+            results.push_back( wit.total_votes );
+         for( const auto& com : db.get_index_type<committee_member_index>().indices() )
+            results.push_back( com.total_votes );
+         for( const auto& stats : db.get_index_type<account_stats_index>().indices() )
+         {
+            results.push_back( stats.vp_all );
+            results.push_back( stats.vp_active );
+            results.push_back( stats.vp_committee );
+            results.push_back( stats.vp_witness );
+            results.push_back( stats.vp_worker );
+         }
+         return results;
+      };
+
+      db.set_vote_tally_threads( 1 );
+      generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+      const auto serial_results = tally_results();
+      const auto serial_witnesses = db.get_global_properties().active_witnesses;
+      const auto serial_committee = db.get_global_properties().active_committee_members;
+      BOOST_CHECK_GT( wit13->id( db ).total_votes, 0u );
+
+      // apply the maintenance block again with the votes counted in parallel
+      const signed_block maintenance_block = *db.fetch_block_by_number( db.head_block_num() );
+      db.pop_block();
+      db.set_vote_tally_threads( 4 );
+      PUSH_BLOCK( db, maintenance_block, ~0 );
+
+      BOOST_CHECK( tally_results() == serial_results );
+      BOOST_CHECK( db.get_global_properties().active_witnesses == serial_witnesses );
+      BOOST_CHECK( db.get_global_properties().active_committee_members == serial_committee );
+
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()